@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "distributed.h"
+#include "loss.h"
+#include "mlp.h"
+
+// Trains the same MLP on the same data with 1, 2, 4, ... processes that
+// exchange gradients by ring allreduce over shared memory, and reports the
+// throughput of each world size relative to a single process. The largest
+// world size defaults to the number of hardware threads, up to 8.
+int main(int argc, char **argv)
+{
+    // synthetic regression data
+    const size_t num_samples = 256;
+    const size_t num_inputs = 8;
+    std::vector<std::vector<double>> inputs(num_samples);
+    std::vector<std::vector<double>> targets(num_samples);
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        inputs[i].resize(num_inputs);
+        double sum = 0;
+        for (size_t j = 0; j < num_inputs; j++)
+        {
+            inputs[i][j] = std::sin(static_cast<double>(i * num_inputs + j));
+            sum += inputs[i][j];
+        }
+        targets[i] = {std::tanh(sum / 4)};
+    }
+
+    // configure training parameters
+    const std::vector<size_t> num_outputs{16, 16, 1};
+    const size_t epochs = 5;
+    const double lr = 0.01;
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    const size_t max_world_size =
+        argc > 1 ? std::stoul(argv[1])
+                 : std::max<size_t>(1, std::min<size_t>(8, hardware_threads));
+
+    double baseline = 0;
+    for (size_t world_size = 1; world_size <= max_world_size; world_size *= 2)
+    {
+        // The MLP is constructed before forking, so every rank starts from
+        // the same parameters.
+        MLP mlp(num_inputs, num_outputs);
+        const auto worker = [&](SharedMemoryCommunicator &communicator) {
+            for (size_t epoch = 0; epoch < epochs; epoch++)
+            {
+                for (auto &parameter : mlp.mutable_parameters())
+                {
+                    parameter.zero_grad();
+                }
+                for (size_t i = communicator.rank(); i < num_samples;
+                     i += communicator.world_size())
+                {
+                    Variable loss = MSELoss(mlp.forward(inputs[i]), targets[i]);
+                    loss.set_gradient(1.0);
+                    loss.backward();
+                }
+                allreduce_gradients(mlp, communicator, false);
+                for (auto &parameter : mlp.mutable_parameters())
+                {
+                    parameter.gradient_descent(
+                        lr / static_cast<double>(num_samples));
+                }
+            }
+        };
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            launch(world_size, 1 << 16, worker);
+        }
+        catch (const std::runtime_error &error)
+        {
+            fmt::print("world size {}: {}\n", world_size, error.what());
+            return 1;
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        const double throughput =
+            static_cast<double>(num_samples * epochs) / elapsed.count();
+        baseline = world_size == 1 ? throughput : baseline;
+        fmt::print("world size {}: {:.3f} s, {:.0f} samples/s, "
+                   "speedup {:.2f}\n",
+                   world_size,
+                   elapsed.count(),
+                   throughput,
+                   throughput / baseline);
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "mlp.h"
+#include "serving.h"
+
+namespace
+{
+std::atomic<bool> interrupted{false};
+
+
+void print_stats(const InferenceServer &server)
+{
+    const auto microseconds = [](std::chrono::nanoseconds ns) {
+        return std::chrono::duration<double, std::micro>(ns).count();
+    };
+    const double requests = static_cast<double>(server.requests().count());
+    const double batches = static_cast<double>(server.batches().count());
+    fmt::print("requests: {}, {:.0f}/s, mean batch {:.1f}, "
+               "p50 {:.1f} us, p99 {:.1f} us\n",
+               server.requests().count(),
+               server.requests().rate(),
+               batches > 0 ? requests / batches : 0.0,
+               microseconds(server.latency().percentile(50)),
+               microseconds(server.latency().percentile(99)));
+}
+} // namespace
+
+// Serves a randomly initialized MLP with dynamic batching.
+//
+//   inference_server [--socket PATH | --port PORT] [--batch N] [--wait-us N]
+//                    [--workers N] [--bench CLIENTS]
+//
+// With --bench, CLIENTS threads send 1000 requests each over the socket and
+// the statistics are printed once; otherwise the server runs until SIGINT
+// and prints its statistics every second.
+int main(int argc, char **argv)
+{
+    std::string path = "/tmp/tiny_neural_network.sock";
+    uint16_t port = 0;
+    size_t clients = 0;
+    ServerOptions options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string flag = argv[i];
+        const std::string value = argv[i + 1];
+        if (flag == "--socket")
+        {
+            path = value;
+        }
+        else if (flag == "--port")
+        {
+            port = static_cast<uint16_t>(std::stoul(value));
+        }
+        else if (flag == "--batch")
+        {
+            options.max_batch_size = std::stoul(value);
+        }
+        else if (flag == "--wait-us")
+        {
+            options.max_wait = std::chrono::microseconds(std::stol(value));
+        }
+        else if (flag == "--workers")
+        {
+            options.num_workers = std::stoul(value);
+        }
+        else if (flag == "--bench")
+        {
+            clients = std::stoul(value);
+        }
+        else
+        {
+            fmt::print("unknown option {}\n", flag);
+            return 1;
+        }
+    }
+
+    const size_t num_inputs = 16;
+    MLP mlp(num_inputs, std::vector<size_t>{64, 64, 4});
+    InferenceServer server(mlp, options);
+    std::unique_ptr<SocketServer> front_end =
+        port != 0 ? std::make_unique<SocketServer>(server, port)
+                  : std::make_unique<SocketServer>(server, path);
+    front_end->start();
+
+    if (clients == 0)
+    {
+        fmt::print("listening on {}\n",
+                   port != 0 ? fmt::format("port {}", port) : path);
+        std::signal(SIGINT, [](int) { interrupted = true; });
+        while (!interrupted)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            print_stats(server);
+        }
+        return 0;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; c++)
+    {
+        threads.emplace_back([&, c]() {
+            InferenceClient client = port != 0 ? InferenceClient(port)
+                                               : InferenceClient(path);
+            std::vector<double> inputs(num_inputs);
+            for (size_t r = 0; r < 1000; r++)
+            {
+                for (size_t i = 0; i < num_inputs; i++)
+                {
+                    inputs[i] = static_cast<double>((c + r + i) % 7) / 7;
+                }
+                client.predict(inputs);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    print_stats(server);
+    return 0;
+}
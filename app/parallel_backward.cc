@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "determinism.h"
+#include "loss.h"
+#include "mlp.h"
+#include "scheduler.h"
+
+namespace
+{
+// Builds the graph of one sample and returns its loss.
+Variable build_loss(MLP &mlp,
+                    const std::vector<double> &inputs,
+                    const std::vector<double> &targets)
+{
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+    Variable loss = MSELoss(mlp.forward(inputs), targets);
+    loss.set_gradient(1.0);
+    return loss;
+}
+} // namespace
+
+// Runs the backward pass of one large single-sample graph serially and on
+// work-stealing pools of 1, 2, 4, ... threads, with and without
+// deterministic mode, and reports the time of the backward pass alone. The
+// largest pool defaults to the number of hardware threads.
+int main(int argc, char **argv)
+{
+    const size_t num_inputs = 32;
+    const std::vector<size_t> num_outputs{64, 64, 1};
+    const size_t repeats = 20;
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    const size_t max_threads = argc > 1 ? std::stoul(argv[1])
+                                        : std::max<size_t>(1, hardware_threads);
+
+    MLP mlp(num_inputs, num_outputs);
+    std::vector<double> inputs(num_inputs);
+    for (size_t i = 0; i < num_inputs; i++)
+    {
+        inputs[i] = std::sin(static_cast<double>(i));
+    }
+    const std::vector<double> targets{0.5};
+
+    const auto time = [&](const std::function<void(Variable &)> &backward) {
+        double seconds = 0;
+        for (size_t r = 0; r < repeats; r++)
+        {
+            Variable loss = build_loss(mlp, inputs, targets);
+            const auto start = std::chrono::steady_clock::now();
+            backward(loss);
+            seconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        }
+        return seconds / static_cast<double>(repeats);
+    };
+
+    const double serial = time([](Variable &loss) { loss.backward(); });
+    fmt::print("{:>8}: {:.2f} ms\n", "serial", serial * 1e3);
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        WorkStealingPool pool(threads);
+        const auto backward = [&pool](Variable &loss) {
+            parallel_backward(loss, pool);
+        };
+        const double seconds = time(backward);
+        set_deterministic(true);
+        const double deterministic_seconds = time(backward);
+        set_deterministic(false);
+        fmt::print("{:>8}: {:.2f} ms, speedup {:.2f}, {} steals, "
+                   "deterministic {:.2f} ms\n",
+                   fmt::format("{} thr", threads),
+                   seconds * 1e3,
+                   serial / seconds,
+                   pool.steals(),
+                   deterministic_seconds * 1e3);
+    }
+    return 0;
+}
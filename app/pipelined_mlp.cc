@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "mlp.h"
+#include "pipeline.h"
+
+namespace
+{
+const size_t num_inputs = 8;
+const size_t num_samples = 2000;
+
+
+// Returns CSV records "x0,...,x7,target" after a delay that stands in for
+// reading from disk or the network.
+std::function<std::optional<std::string>()> make_reader()
+{
+    return [i = size_t{0}]() mutable -> std::optional<std::string> {
+        if (i == num_samples)
+        {
+            return std::nullopt;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        std::ostringstream record;
+        double sum = 0;
+        for (size_t j = 0; j < num_inputs; j++)
+        {
+            const double x = std::sin(static_cast<double>(i * num_inputs + j));
+            sum += x;
+            record << x << ',';
+        }
+        record << std::tanh(sum / 4);
+        i++;
+        return record.str();
+    };
+}
+
+
+Sample decode(const std::string &record)
+{
+    Sample sample;
+    std::istringstream stream(record);
+    std::string field;
+    while (std::getline(stream, field, ','))
+    {
+        sample.inputs.push_back(std::stod(field));
+    }
+    sample.targets.push_back(sample.inputs.back());
+    sample.inputs.pop_back();
+    return sample;
+}
+
+
+void report(const std::string &name,
+            const PipelineStats &stats,
+            std::chrono::duration<double> elapsed)
+{
+    fmt::print("{:>11}: {:.3f} s, {:.0f} samples/s, loss {:.4f}, "
+               "compute utilization {:.0f}%\n",
+               name,
+               elapsed.count(),
+               static_cast<double>(stats.samples) / elapsed.count(),
+               stats.loss,
+               100 * stats.compute_seconds / elapsed.count());
+}
+} // namespace
+
+// Trains the same MLP on the same records twice: with the synchronous
+// read -> decode -> batch -> train loop, and with the coroutine pipeline
+// that keeps reading while the previous batches train.
+int main()
+{
+    PipelineOptions options;
+    options.batch_size = 16;
+    options.lr = 0.05;
+
+    // Both runs start from the same parameters.
+    MLP synchronous(num_inputs, std::vector<size_t>{16, 16, 1});
+    MLP pipelined(num_inputs, std::vector<size_t>{16, 16, 1});
+    for (size_t i = 0; i < synchronous.parameters().size(); i++)
+    {
+        const double value = synchronous.parameters()[i].reference()->value();
+        pipelined.mutable_parameters()[i].set_value(value);
+        pipelined.mutable_parameters()[i].reference()->set_value(value);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PipelineStats stats =
+        train_synchronous(synchronous, make_reader(), decode, options);
+    report("synchronous", stats, std::chrono::steady_clock::now() - start);
+
+    Executor executor(2);
+    start = std::chrono::steady_clock::now();
+    stats =
+        train_pipelined(pipelined, executor, make_reader(), decode, options);
+    report("pipelined", stats, std::chrono::steady_clock::now() - start);
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include "determinism.h"
+#include "initializer.h"
+#include "mlp.h"
+#include "trainer.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+double milliseconds(std::chrono::nanoseconds ns)
+{
+    return std::chrono::duration<double, std::milli>(ns).count();
+}
+
+
+double mebibytes(size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+
+// Reads the training options from the "training" object of the config.
+TrainerOptions trainer_options(const json &config, size_t num_threads)
+{
+    TrainerOptions options;
+    options.epochs = config.value("epochs", options.epochs);
+    options.batch_size = config.value("batch_size", options.batch_size);
+    options.learning_rate =
+        config.value("learning_rate", options.learning_rate);
+    options.loss = parse_loss(config.value("loss", std::string("mse")));
+    options.shuffle = config.value("shuffle", options.shuffle);
+    options.patience = config.value("patience", options.patience);
+    options.num_threads = num_threads;
+    return options;
+}
+
+
+// Loads the checkpoint of the model config, whose architecture must match
+// the inputs and layers of the config where they are given.
+MLP load_checkpoint(const json &model)
+{
+    const auto path = model.at("checkpoint").get<std::string>();
+    MLP mlp = MLP::load(path);
+    if ((model.contains("inputs") &&
+         model["inputs"].get<size_t>() != mlp.n_in()) ||
+        (model.contains("layers") &&
+         model["layers"].get<std::vector<size_t>>() != mlp.n_outs()))
+    {
+        throw std::runtime_error(fmt::format(
+            "the checkpoint {} has {} inputs and {} layers, which do not "
+            "match the model config",
+            path,
+            mlp.n_in(),
+            mlp.n_outs().size()));
+    }
+    return mlp;
+}
+} // namespace
+
+// Trains an MLP on a CSV dataset and reports the loss, throughput, step
+// latency percentiles and memory of every epoch.
+//
+//   train --config CONFIG.json --data DATA.csv [--threads N] [--seed S]
+//         [--deterministic] [--save PATH]
+//
+// The config holds the model and the run:
+//
+//   {
+//       "model": {"inputs": 2, "layers": [16, 1], "init": "xavier_uniform",
+//                 "checkpoint": "initial.mlp"},
+//       "training": {"epochs": 20, "batch_size": 32, "learning_rate": 0.01,
+//                    "loss": "mse", "patience": 3, "shuffle": true,
+//                    "validation_split": 0.1}
+//   }
+//
+// A checkpoint, if given, replaces the initialization and defines the
+// architecture; the inputs and layers may then be left out, and must match
+// the checkpoint if not. Each line of the dataset holds the inputs of a
+// sample followed by its targets.
+int main(int argc, char **argv)
+{
+    cxxopts::Options cli("train", "Trains an MLP on a CSV dataset.");
+    cli.add_options()("c,config", "JSON model and run config",
+                      cxxopts::value<std::string>())(
+        "d,data", "CSV dataset", cxxopts::value<std::string>())(
+        "t,threads", "Threads of the initialization and the backward pass",
+        cxxopts::value<size_t>()->default_value("1"))(
+        "s,seed", "Seed of the initialization and the shuffle order",
+        cxxopts::value<uint64_t>())(
+        "deterministic", "Reproduce gradients bit for bit on any pool")(
+        "save", "Path of the final checkpoint",
+        cxxopts::value<std::string>())("h,help", "Print usage");
+
+    try
+    {
+        const auto args = cli.parse(argc, argv);
+        if (args.count("help") || !args.count("config") ||
+            !args.count("data"))
+        {
+            fmt::print("{}\n", cli.help());
+            return args.count("help") ? 0 : 1;
+        }
+
+        std::ifstream file(args["config"].as<std::string>());
+        if (!file)
+        {
+            throw std::runtime_error("cannot open " +
+                                     args["config"].as<std::string>());
+        }
+        const json config = json::parse(file);
+        const json &model = config.at("model");
+        const json training = config.value("training", json::object());
+
+        const uint64_t seed =
+            args.count("seed") ? args["seed"].as<uint64_t>() : 0;
+        if (args.count("deterministic"))
+        {
+            set_deterministic(true, seed);
+        }
+        else if (args.count("seed"))
+        {
+            set_seed(seed);
+        }
+
+        const size_t num_threads =
+            std::max<size_t>(1, args["threads"].as<size_t>());
+        MLP mlp =
+            model.contains("checkpoint")
+                ? load_checkpoint(model)
+                : MLP::deferred(
+                      model.at("inputs").get<size_t>(),
+                      model.at("layers").get<std::vector<size_t>>(),
+                      parse_init_scheme(
+                          model.value("init", std::string("uniform"))));
+        if (!mlp.materialized())
+        {
+            ThreadPool pool(num_threads);
+            mlp.materialize(&pool);
+        }
+
+        const Dataset data =
+            load_csv(args["data"].as<std::string>(), mlp.n_in());
+        const auto [train, validation] =
+            split_dataset(data, training.value("validation_split", 0.0));
+        fmt::print("{} parameters, {} training and {} validation samples, "
+                   "{} threads\n",
+                   mlp.num_parameters(),
+                   train.size(),
+                   validation.size(),
+                   num_threads);
+
+        Trainer trainer(mlp, trainer_options(training, num_threads));
+        trainer.add_epoch_hook([](const EpochStats &stats) {
+            fmt::print("epoch {:>3}: loss {:.6f}, validation {:.6f}, "
+                       "{:.0f} samples/s, step p50 {:.3f} ms, "
+                       "p90 {:.3f} ms, p99 {:.3f} ms, peak rss {:.1f} MiB, "
+                       "graph pool {:.1f} MiB\n",
+                       stats.epoch,
+                       stats.train_loss,
+                       stats.validation_loss,
+                       stats.samples_per_second,
+                       milliseconds(stats.step_p50),
+                       milliseconds(stats.step_p90),
+                       milliseconds(stats.step_p99),
+                       mebibytes(stats.peak_rss_bytes),
+                       mebibytes(stats.node_pool_bytes));
+            return true;
+        });
+        trainer.fit(train, validation);
+
+        if (args.count("save"))
+        {
+            mlp.save(args["save"].as<std::string>());
+        }
+    }
+    catch (const std::exception &error)
+    {
+        fmt::print(stderr, "train: {}\n", error.what());
+        return 1;
+    }
+    return 0;
+}
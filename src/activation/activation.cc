@@ -0,0 +1,390 @@
+#include "activation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace
+{
+constexpr double kLog2e = 1.4426950408889634;
+constexpr double kLn2Hi = 6.93147180369123816490e-01;
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kLn2 = 0.6931471805599453;
+constexpr double kSqrt2 = 1.4142135623730951;
+constexpr double kInvSqrt2 = 0.7071067811865476;
+constexpr double kSqrt2OverPi = 0.7978845608028654;
+// Adding and subtracting 1.5 * 2^52 rounds a double to the nearest integer
+// without a call to nearbyint, which keeps the loops vectorizable.
+constexpr double kRoundShifter = 6755399441055744.0;
+constexpr double kTwoPow52 = 4503599627370496.0;
+
+
+inline double from_bits(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+inline uint64_t to_bits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+inline double exp_kernel(double x)
+{
+    // exp(x) = 2^k * exp(r) with k = round(x / ln2) and |r| <= ln2 / 2.
+    x = std::min(std::max(x, -708.0), 709.0);
+    const double shifted = x * kLog2e + kRoundShifter;
+    const double k = shifted - kRoundShifter;
+    const double r = (x - k * kLn2Hi) - k * kLn2Lo;
+    const double p =
+        1.0 +
+        r * (1.0 +
+             r * (1.0 / 2 +
+                  r * (1.0 / 6 +
+                       r * (1.0 / 24 +
+                            r * (1.0 / 120 +
+                                 r * (1.0 / 720 + r * (1.0 / 5040)))))));
+    // The low bits of `shifted` hold k, so 2^k is built with integer ops only.
+    return p * from_bits((to_bits(shifted) + 1023) << 52);
+}
+
+
+inline double log_kernel(double x)
+{
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2)), log(m) = 2 * atanh(s).
+    const uint64_t bits = to_bits(x);
+    double e =
+        from_bits((bits >> 52) | 0x4330000000000000ULL) - kTwoPow52 - 1023;
+    double m =
+        from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    const bool large = m > kSqrt2;
+    m = large ? m * 0.5 : m;
+    e = large ? e + 1 : e;
+    const double s = (m - 1) / (m + 1);
+    const double s2 = s * s;
+    const double series =
+        1.0 +
+        s2 * (1.0 / 3 +
+              s2 * (1.0 / 5 +
+                    s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 * (1.0 / 11)))));
+    return e * kLn2 + 2 * s * series;
+}
+
+
+inline double tanh_kernel(double x)
+{
+    x = std::min(std::max(x, -20.0), 20.0);
+    const double e = exp_kernel(2 * x);
+    return (e - 1) / (e + 1);
+}
+
+
+inline double sigmoid_kernel(double x)
+{
+    return 1 / (1 + exp_kernel(-x));
+}
+
+
+inline double gelu_kernel(double x)
+{
+    const double inner = kSqrt2OverPi * (x + 0.044715 * x * x * x);
+    return 0.5 * x * (1 + tanh_kernel(inner));
+}
+
+
+inline double silu_kernel(double x)
+{
+    return x * sigmoid_kernel(x);
+}
+
+
+inline double softplus_kernel(double x)
+{
+    return std::max(x, 0.0) + log_kernel(1 + exp_kernel(-std::fabs(x)));
+}
+
+
+template <typename Function>
+void apply(Function function, const double *inputs, double *outputs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        outputs[i] = function(inputs[i]);
+    }
+}
+} // namespace
+
+
+ActivationFunction parse_activation(const std::string &activate_function)
+{
+    if (activate_function == "relu")
+    {
+        return ActivationFunction::Relu;
+    }
+    if (activate_function == "sigmoid")
+    {
+        return ActivationFunction::Sigmoid;
+    }
+    if (activate_function == "tanh")
+    {
+        return ActivationFunction::Tanh;
+    }
+    if (activate_function == "identity")
+    {
+        return ActivationFunction::Identity;
+    }
+    if (activate_function == "gelu")
+    {
+        return ActivationFunction::Gelu;
+    }
+    if (activate_function == "silu")
+    {
+        return ActivationFunction::Silu;
+    }
+    if (activate_function == "softplus")
+    {
+        return ActivationFunction::Softplus;
+    }
+    throw std::runtime_error("unknown activation function");
+}
+
+
+double fast_exp(double x)
+{
+    return exp_kernel(x);
+}
+
+
+double fast_log(double x)
+{
+    return log_kernel(x);
+}
+
+
+double fast_tanh(double x)
+{
+    return tanh_kernel(x);
+}
+
+
+double fast_sigmoid(double x)
+{
+    return sigmoid_kernel(x);
+}
+
+
+double gelu(double x)
+{
+    return 0.5 * x * (1 + std::erf(x * kInvSqrt2));
+}
+
+
+double fast_gelu(double x)
+{
+    return gelu_kernel(x);
+}
+
+
+double silu(double x)
+{
+    return x / (1 + std::exp(-x));
+}
+
+
+double fast_silu(double x)
+{
+    return silu_kernel(x);
+}
+
+
+double softplus(double x)
+{
+    return std::max(x, 0.0) + std::log1p(std::exp(-std::fabs(x)));
+}
+
+
+double fast_softplus(double x)
+{
+    return softplus_kernel(x);
+}
+
+
+double activate(ActivationFunction activation, double x, ActivationMode mode)
+{
+    const bool fast = mode == ActivationMode::Fast;
+    switch (activation)
+    {
+    case ActivationFunction::Relu:
+        return x > 0 ? x : 0;
+    case ActivationFunction::Sigmoid:
+        return fast ? fast_sigmoid(x) : 1 / (1 + std::exp(-x));
+    case ActivationFunction::Tanh:
+        return fast ? fast_tanh(x) : std::tanh(x);
+    case ActivationFunction::Identity:
+        return x;
+    case ActivationFunction::Gelu:
+        return fast ? fast_gelu(x) : gelu(x);
+    case ActivationFunction::Silu:
+        return fast ? fast_silu(x) : silu(x);
+    case ActivationFunction::Softplus:
+        return fast ? fast_softplus(x) : softplus(x);
+    }
+    throw std::runtime_error("unknown activation function");
+}
+
+
+double activation_derivative(ActivationFunction activation, double x, double y)
+{
+    switch (activation)
+    {
+    case ActivationFunction::Relu:
+        return x > 0 ? 1 : 0;
+    case ActivationFunction::Sigmoid:
+        return y * (1 - y);
+    case ActivationFunction::Tanh:
+        return 1 - y * y;
+    case ActivationFunction::Identity:
+        return 1;
+    case ActivationFunction::Gelu:
+        return 0.5 * (1 + std::erf(x * kInvSqrt2)) +
+               x * kInvSqrt2Pi * std::exp(-0.5 * x * x);
+    case ActivationFunction::Silu:
+    {
+        const double s = 1 / (1 + std::exp(-x));
+        return s * (1 + x * (1 - s));
+    }
+    case ActivationFunction::Softplus:
+        return 1 / (1 + std::exp(-x));
+    }
+    throw std::runtime_error("unknown activation function");
+}
+
+
+void batch_exp(const double *inputs,
+               double *outputs,
+               size_t n,
+               ActivationMode mode)
+{
+    if (mode == ActivationMode::Fast)
+    {
+        apply([](double x) { return exp_kernel(x); }, inputs, outputs, n);
+    }
+    else
+    {
+        apply([](double x) { return std::exp(x); }, inputs, outputs, n);
+    }
+}
+
+
+void batch_log(const double *inputs,
+               double *outputs,
+               size_t n,
+               ActivationMode mode)
+{
+    if (mode == ActivationMode::Fast)
+    {
+        apply([](double x) { return log_kernel(x); }, inputs, outputs, n);
+    }
+    else
+    {
+        apply([](double x) { return std::log(x); }, inputs, outputs, n);
+    }
+}
+
+
+void batch_activate(ActivationFunction activation,
+                    const double *inputs,
+                    double *outputs,
+                    size_t n,
+                    ActivationMode mode)
+{
+    // Dispatch once per batch so that each loop body is a single inlined
+    // kernel the compiler can vectorize.
+    const bool fast = mode == ActivationMode::Fast;
+    switch (activation)
+    {
+    case ActivationFunction::Relu:
+        apply([](double x) { return x > 0 ? x : 0; }, inputs, outputs, n);
+        return;
+    case ActivationFunction::Sigmoid:
+        if (fast)
+        {
+            apply([](double x) { return sigmoid_kernel(x); },
+                  inputs,
+                  outputs,
+                  n);
+        }
+        else
+        {
+            apply([](double x) { return 1 / (1 + std::exp(-x)); },
+                  inputs,
+                  outputs,
+                  n);
+        }
+        return;
+    case ActivationFunction::Tanh:
+        if (fast)
+        {
+            apply([](double x) { return tanh_kernel(x); }, inputs, outputs, n);
+        }
+        else
+        {
+            apply([](double x) { return std::tanh(x); }, inputs, outputs, n);
+        }
+        return;
+    case ActivationFunction::Identity:
+        std::copy(inputs, inputs + n, outputs);
+        return;
+    case ActivationFunction::Gelu:
+        if (fast)
+        {
+            apply([](double x) { return gelu_kernel(x); }, inputs, outputs, n);
+        }
+        else
+        {
+            apply([](double x) { return gelu(x); }, inputs, outputs, n);
+        }
+        return;
+    case ActivationFunction::Silu:
+        if (fast)
+        {
+            apply([](double x) { return silu_kernel(x); }, inputs, outputs, n);
+        }
+        else
+        {
+            apply([](double x) { return silu(x); }, inputs, outputs, n);
+        }
+        return;
+    case ActivationFunction::Softplus:
+        if (fast)
+        {
+            apply([](double x) { return softplus_kernel(x); },
+                  inputs,
+                  outputs,
+                  n);
+        }
+        else
+        {
+            apply([](double x) { return softplus(x); }, inputs, outputs, n);
+        }
+        return;
+    }
+}
+
+
+void batch_activate(ActivationFunction activation,
+                    std::vector<double> &values,
+                    ActivationMode mode)
+{
+    batch_activate(
+        activation, values.data(), values.data(), values.size(), mode);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+inline constexpr double kPi = 3.14159265358979323846;
+// 1 / sqrt(2 pi), the peak of the standard normal density.
+inline constexpr double kInvSqrt2Pi = 0.3989422804014327;
+
+/**
+ * @enum ActivationMode
+ * Selects between libm accuracy and fast approximations.
+ */
+enum class ActivationMode
+{
+    Exact, // Uses the standard library, correctly rounded up to libm accuracy.
+    Fast,  // Uses branch-free polynomial approximations that vectorize.
+};
+
+/**
+ * @enum ActivationFunction
+ * The activation functions supported by neurons and layers.
+ */
+enum class ActivationFunction
+{
+    Relu,
+    Sigmoid,
+    Tanh,
+    Identity,
+    Gelu,
+    Silu,
+    Softplus,
+};
+
+/**
+ * Parses the name of an activation function.
+ * @param activate_function The name, e.g. "tanh".
+ * @return The activation function.
+ * @throw std::runtime_error if the name is unknown.
+ */
+ActivationFunction parse_activation(const std::string &activate_function);
+
+/**
+ * Approximates exp(x) with a degree 7 polynomial after range reduction.
+ * @param x The input, clamped to [-708, 709].
+ * @return exp(x) with a relative error below 1e-8.
+ */
+double fast_exp(double x);
+
+/**
+ * Approximates log(x) with an atanh series on the reduced mantissa.
+ * @param x A positive, normal input.
+ * @return log(x) with an absolute error below 1e-10.
+ */
+double fast_log(double x);
+
+/**
+ * Approximates tanh(x) through fast_exp.
+ * @param x The input.
+ * @return tanh(x) with an absolute error below 1e-8.
+ */
+double fast_tanh(double x);
+
+/**
+ * Approximates the sigmoid function through fast_exp.
+ * @param x The input.
+ * @return sigmoid(x) with an absolute error below 1e-8.
+ */
+double fast_sigmoid(double x);
+
+/**
+ * Computes the Gaussian Error Linear Unit, x * Phi(x), with erf.
+ * @param x The input.
+ * @return gelu(x).
+ */
+double gelu(double x);
+
+/**
+ * Approximates GELU with the tanh formulation and fast_tanh.
+ * @param x The input.
+ * @return gelu(x) with an absolute error below 1e-3.
+ */
+double fast_gelu(double x);
+
+/**
+ * Computes the Sigmoid Linear Unit, x * sigmoid(x).
+ * @param x The input.
+ * @return silu(x).
+ */
+double silu(double x);
+
+/**
+ * Approximates SiLU through fast_sigmoid.
+ * @param x The input.
+ * @return silu(x) with a relative error below 1e-8.
+ */
+double fast_silu(double x);
+
+/**
+ * Computes softplus, log(1 + exp(x)), without overflow.
+ * @param x The input.
+ * @return softplus(x).
+ */
+double softplus(double x);
+
+/**
+ * Approximates softplus through fast_exp and fast_log.
+ * @param x The input.
+ * @return softplus(x) with an absolute error below 1e-8.
+ */
+double fast_softplus(double x);
+
+/**
+ * Applies an activation function to a scalar.
+ * @param activation The activation function.
+ * @param x The input.
+ * @param mode Whether to use the exact or the fast kernel.
+ * @return The activated value.
+ */
+double activate(ActivationFunction activation,
+                double x,
+                ActivationMode mode = ActivationMode::Exact);
+
+/**
+ * Computes the derivative of an activation function.
+ * @param activation The activation function.
+ * @param x The input of the activation.
+ * @param y The activated value.
+ * @return The derivative at x.
+ */
+double activation_derivative(ActivationFunction activation, double x, double y);
+
+/**
+ * Computes exp element-wise.
+ * @param inputs The inputs.
+ * @param outputs The outputs, may alias inputs.
+ * @param n The number of elements.
+ * @param mode Whether to use the exact or the fast kernel.
+ */
+void batch_exp(const double *inputs,
+               double *outputs,
+               size_t n,
+               ActivationMode mode = ActivationMode::Exact);
+
+/**
+ * Computes log element-wise.
+ * @param inputs The inputs.
+ * @param outputs The outputs, may alias inputs.
+ * @param n The number of elements.
+ * @param mode Whether to use the exact or the fast kernel.
+ */
+void batch_log(const double *inputs,
+               double *outputs,
+               size_t n,
+               ActivationMode mode = ActivationMode::Exact);
+
+/**
+ * Applies an activation function element-wise.
+ * @param activation The activation function.
+ * @param inputs The inputs.
+ * @param outputs The outputs, may alias inputs.
+ * @param n The number of elements.
+ * @param mode Whether to use the exact or the fast kernel.
+ */
+void batch_activate(ActivationFunction activation,
+                    const double *inputs,
+                    double *outputs,
+                    size_t n,
+                    ActivationMode mode = ActivationMode::Exact);
+
+/**
+ * Applies an activation function element-wise in place.
+ * @param activation The activation function.
+ * @param values The values to activate.
+ * @param mode Whether to use the exact or the fast kernel.
+ */
+void batch_activate(ActivationFunction activation,
+                    std::vector<double> &values,
+                    ActivationMode mode = ActivationMode::Exact);
@@ -0,0 +1,572 @@
+#include "conv.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace
+{
+// The number of output positions per block of the matrix product.
+const size_t block_positions = 256;
+
+
+// Sets the output size of an axis.
+void set_output_size(size_t &out,
+                     size_t in,
+                     size_t kernel,
+                     const ConvOptions &options)
+{
+    if (in == 0 || kernel == 0 || options.stride == 0 ||
+        options.dilation == 0)
+    {
+        throw std::invalid_argument(
+            "sizes, stride and dilation should be positive");
+    }
+    const size_t span = options.dilation * (kernel - 1) + 1;
+    if (span > in + 2 * options.padding)
+    {
+        throw std::invalid_argument("kernel is larger than the input");
+    }
+    out = (in + 2 * options.padding - span) / options.stride + 1;
+}
+
+
+// Resizes the outputs of a layer, reusing them if the size is right.
+void prepare_outputs(std::vector<Variable> &outputs, size_t n)
+{
+    if (outputs.size() != n)
+    {
+        outputs.clear();
+        outputs.resize(n);
+    }
+}
+
+
+// Computes out[c][p] = bias[c] + sum_t weights[c][t] * columns[t][p] for
+// blocks of positions, so that a block of columns stays in cache while all
+// channels read it.
+void multiply(const std::vector<double> &weights,
+              const std::vector<double> &bias,
+              const std::vector<double> &columns,
+              size_t n_taps,
+              size_t n_positions,
+              double *out)
+{
+    double accumulators[block_positions];
+    for (size_t first = 0; first < n_positions; first += block_positions)
+    {
+        const size_t n = std::min(block_positions, n_positions - first);
+        for (size_t c = 0; c < bias.size(); c++)
+        {
+            std::fill(accumulators, accumulators + n, bias[c]);
+            const double *filter = weights.data() + c * n_taps;
+            for (size_t t = 0; t < n_taps; t++)
+            {
+                const double weight = filter[t];
+                const double *column = columns.data() + t * n_positions + first;
+                for (size_t p = 0; p < n; p++)
+                {
+                    accumulators[p] += weight * column[p];
+                }
+            }
+            std::copy(
+                accumulators, accumulators + n, out + c * n_positions + first);
+        }
+    }
+}
+} // namespace
+
+
+Conv2D::Conv2D(size_t in_channels,
+               size_t out_channels,
+               Axis rows,
+               Axis columns,
+               std::string activate_function,
+               InitScheme scheme,
+               ThreadPool *pool)
+    : _in_channels(in_channels), _out_channels(out_channels), _rows(rows),
+      _columns(columns), _activate_function(std::move(activate_function))
+{
+    if (in_channels == 0 || out_channels == 0)
+    {
+        throw std::invalid_argument("channels should be positive");
+    }
+    set_output_size(_rows.out, _rows.in, _rows.kernel, _rows.options);
+    set_output_size(
+        _columns.out, _columns.in, _columns.kernel, _columns.options);
+
+    // The im2col table: the input index of each tap of each position.
+    const size_t n_taps = _in_channels * _rows.kernel * _columns.kernel;
+    const size_t n_positions = _rows.out * _columns.out;
+    _taps.resize(n_positions * n_taps);
+    _padded.assign(n_positions, false);
+    for (size_t y = 0; y < _rows.out; y++)
+    {
+        for (size_t x = 0; x < _columns.out; x++)
+        {
+            const size_t position = y * _columns.out + x;
+            size_t *taps = _taps.data() + position * n_taps;
+            for (size_t c = 0; c < _in_channels; c++)
+            {
+                for (size_t i = 0; i < _rows.kernel; i++)
+                {
+                    for (size_t j = 0; j < _columns.kernel; j++)
+                    {
+                        // Unsigned wrap-around marks the leading padding.
+                        const size_t row = y * _rows.options.stride +
+                                           i * _rows.options.dilation -
+                                           _rows.options.padding;
+                        const size_t column = x * _columns.options.stride +
+                                              j * _columns.options.dilation -
+                                              _columns.options.padding;
+                        const bool inside =
+                            row < _rows.in && column < _columns.in;
+                        *taps++ = inside ? (c * _rows.in + row) * _columns.in +
+                                               column
+                                         : _padding_tap;
+                        _padded[position] = _padded[position] || !inside;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<double> values((n_taps + 1) * _out_channels);
+    initialize_layer(
+        values.data(), n_taps, _out_channels, scheme, next_seed(), pool);
+    _filters.reserve(_out_channels);
+    _parameters.reserve(values.size());
+    for (size_t i = 0; i < _out_channels; i++)
+    {
+        const double *filter_values = values.data() + i * (n_taps + 1);
+        _filters.emplace_back(
+            filter_values, n_taps, filter_values[n_taps], _activate_function);
+        for (const auto &parameter : _filters[i].parameters())
+        {
+            _parameters.push_back(parameter);
+        }
+    }
+}
+
+
+Conv2D::Conv2D(size_t in_channels,
+               size_t height,
+               size_t width,
+               size_t out_channels,
+               size_t kernel_size,
+               ConvOptions options,
+               std::string activate_function,
+               InitScheme scheme,
+               ThreadPool *pool)
+    : Conv2D(in_channels,
+             out_channels,
+             Axis{height, kernel_size, options, 0},
+             Axis{width, kernel_size, options, 0},
+             std::move(activate_function),
+             scheme,
+             pool)
+{
+}
+
+
+void Conv2D::set_activation_mode(ActivationMode mode)
+{
+    _activation_mode = mode;
+    for (auto &filter : _filters)
+    {
+        filter.set_activation_mode(mode);
+    }
+}
+
+
+template <typename Inputs>
+void Conv2D::forward_positions(const Inputs &inputs,
+                               std::vector<Variable> &outputs)
+{
+    if (inputs.size() != n_in())
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    using Input = typename Inputs::value_type;
+    const size_t n_taps = _in_channels * _rows.kernel * _columns.kernel;
+    const size_t n_positions = _rows.out * _columns.out;
+    prepare_outputs(outputs, n_out());
+
+    // Each patch is gathered once for all output channels. Both buffers are
+    // reserved up front: growing them would move the copies, and a moved
+    // Variable no longer refers to its original.
+    std::vector<Input> patch;
+    std::vector<Variable> weights;
+    patch.reserve(n_taps);
+    weights.reserve(n_taps);
+    for (size_t position = 0; position < n_positions; position++)
+    {
+        const size_t *taps = _taps.data() + position * n_taps;
+        patch.clear();
+        if constexpr (std::is_same_v<Input, Variable>)
+        {
+            if (_padded[position])
+            {
+                // Padded taps are zero, so they are left out of the node.
+                for (size_t t = 0; t < n_taps; t++)
+                {
+                    if (taps[t] != _padding_tap)
+                    {
+                        patch.push_back(inputs[taps[t]]);
+                    }
+                }
+                for (size_t c = 0; c < _out_channels; c++)
+                {
+                    const Neuron &filter = _filters[c];
+                    weights.clear();
+                    for (size_t t = 0; t < n_taps; t++)
+                    {
+                        if (taps[t] != _padding_tap)
+                        {
+                            weights.push_back(filter.weights()[t]);
+                        }
+                    }
+                    outputs[c * n_positions + position] =
+                        fused_neuron(weights,
+                                     patch,
+                                     filter.bias(),
+                                     _activate_function,
+                                     _activation_mode);
+                }
+                continue;
+            }
+        }
+        for (size_t t = 0; t < n_taps; t++)
+        {
+            if (taps[t] != _padding_tap)
+            {
+                patch.push_back(inputs[taps[t]]);
+            }
+            else
+            {
+                patch.push_back(Input(0));
+            }
+        }
+        for (size_t c = 0; c < _out_channels; c++)
+        {
+            outputs[c * n_positions + position] = _filters[c].forward(patch);
+        }
+    }
+}
+
+
+std::vector<Variable> Conv2D::forward(const std::vector<double> &inputs)
+{
+    std::vector<Variable> result;
+    forward_positions(inputs, result);
+    return result;
+}
+
+
+std::vector<Variable> Conv2D::forward(const std::vector<Variable> &variables)
+{
+    std::vector<Variable> result;
+    forward_positions(variables, result);
+    return result;
+}
+
+
+void Conv2D::forward(const std::vector<double> &inputs,
+                     std::vector<Variable> &outputs)
+{
+    forward_positions(inputs, outputs);
+}
+
+
+void Conv2D::forward(const std::vector<Variable> &variables,
+                     std::vector<Variable> &outputs)
+{
+    forward_positions(variables, outputs);
+}
+
+
+std::vector<double> Conv2D::predict(const std::vector<double> &inputs) const
+{
+    return predict(inputs, 1);
+}
+
+
+std::vector<double> Conv2D::predict(const std::vector<double> &inputs,
+                                    size_t n) const
+{
+    if (inputs.size() != n_in() * n)
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    const size_t n_taps = _in_channels * _rows.kernel * _columns.kernel;
+    const size_t n_positions = _rows.out * _columns.out;
+    std::vector<double> weights(_out_channels * n_taps);
+    std::vector<double> bias(_out_channels);
+    for (size_t c = 0; c < _out_channels; c++)
+    {
+        for (size_t t = 0; t < n_taps; t++)
+        {
+            weights[c * n_taps + t] = _filters[c].weights()[t].value();
+        }
+        bias[c] = _filters[c].bias().value();
+    }
+
+    std::vector<double> result(n_out() * n);
+    std::vector<double> columns(n_taps * n_positions);
+    for (size_t b = 0; b < n; b++)
+    {
+        const double *sample = inputs.data() + b * n_in();
+        for (size_t position = 0; position < n_positions; position++)
+        {
+            const size_t *taps = _taps.data() + position * n_taps;
+            for (size_t t = 0; t < n_taps; t++)
+            {
+                columns[t * n_positions + position] =
+                    taps[t] != _padding_tap ? sample[taps[t]] : 0.0;
+            }
+        }
+        multiply(weights,
+                 bias,
+                 columns,
+                 n_taps,
+                 n_positions,
+                 result.data() + b * n_out());
+    }
+    batch_activate(
+        parse_activation(_activate_function), result, _activation_mode);
+    return result;
+}
+
+
+Pool2D::Pool2D(PoolKind kind,
+               size_t channels,
+               size_t height,
+               size_t width,
+               size_t kernel_rows,
+               size_t kernel_cols,
+               size_t stride_rows,
+               size_t stride_cols)
+    : _channels(channels), _height(height), _width(width),
+      _kernel_rows(kernel_rows), _kernel_cols(kernel_cols),
+      _stride_rows(stride_rows), _stride_cols(stride_cols), _kind(kind)
+{
+    if (channels == 0)
+    {
+        throw std::invalid_argument("channels should be positive");
+    }
+    ConvOptions rows;
+    rows.stride = stride_rows;
+    ConvOptions columns;
+    columns.stride = stride_cols;
+    set_output_size(_out_height, height, kernel_rows, rows);
+    set_output_size(_out_width, width, kernel_cols, columns);
+}
+
+
+std::vector<Variable> Pool2D::forward(const std::vector<Variable> &variables)
+{
+    std::vector<Variable> result;
+    forward(variables, result);
+    return result;
+}
+
+
+std::vector<Variable> Pool2D::forward(const std::vector<double> &inputs)
+{
+    std::vector<Variable> result;
+    forward(inputs, result);
+    return result;
+}
+
+
+void Pool2D::forward(const std::vector<Variable> &variables,
+                     std::vector<Variable> &outputs)
+{
+    if (variables.size() != n_in())
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    prepare_outputs(outputs, n_out());
+    const size_t window = _kernel_rows * _kernel_cols;
+    const std::vector<double> averages(window,
+                                       1.0 / static_cast<double>(window));
+    std::vector<Variable> taps;
+    taps.reserve(window);
+    size_t output = 0;
+    for (size_t c = 0; c < _channels; c++)
+    {
+        for (size_t y = 0; y < _out_height; y++)
+        {
+            for (size_t x = 0; x < _out_width; x++)
+            {
+                const size_t first =
+                    (c * _height + y * _stride_rows) * _width +
+                    x * _stride_cols;
+                if (_kind == PoolKind::Max)
+                {
+                    // The gradient only reaches the largest input.
+                    size_t largest = first;
+                    for (size_t i = 0; i < _kernel_rows; i++)
+                    {
+                        for (size_t j = 0; j < _kernel_cols; j++)
+                        {
+                            const size_t index = first + i * _width + j;
+                            if (variables[index].value() >
+                                variables[largest].value())
+                            {
+                                largest = index;
+                            }
+                        }
+                    }
+                    outputs[output++] = variables[largest].identity();
+                    continue;
+                }
+                taps.clear();
+                for (size_t i = 0; i < _kernel_rows; i++)
+                {
+                    for (size_t j = 0; j < _kernel_cols; j++)
+                    {
+                        taps.push_back(variables[first + i * _width + j]);
+                    }
+                }
+                outputs[output++] = dot_product(taps, averages);
+            }
+        }
+    }
+}
+
+
+void Pool2D::forward(const std::vector<double> &inputs,
+                     std::vector<Variable> &outputs)
+{
+    const std::vector<double> values = predict(inputs);
+    prepare_outputs(outputs, values.size());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        outputs[i] = Variable(values[i]);
+    }
+}
+
+
+std::vector<double> Pool2D::predict(const std::vector<double> &inputs) const
+{
+    if (inputs.size() != n_in())
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    std::vector<double> result(n_out());
+    const double scale = 1.0 / static_cast<double>(_kernel_rows * _kernel_cols);
+    size_t output = 0;
+    for (size_t c = 0; c < _channels; c++)
+    {
+        for (size_t y = 0; y < _out_height; y++)
+        {
+            for (size_t x = 0; x < _out_width; x++)
+            {
+                const double *window = inputs.data() +
+                                       (c * _height + y * _stride_rows) *
+                                           _width +
+                                       x * _stride_cols;
+                double value = _kind == PoolKind::Max ? window[0] : 0.0;
+                for (size_t i = 0; i < _kernel_rows; i++)
+                {
+                    for (size_t j = 0; j < _kernel_cols; j++)
+                    {
+                        const double tap = window[i * _width + j];
+                        value = _kind == PoolKind::Max ? std::max(value, tap)
+                                                       : value + tap;
+                    }
+                }
+                result[output++] =
+                    _kind == PoolKind::Max ? value : value * scale;
+            }
+        }
+    }
+    return result;
+}
+
+
+void Sequential::add(Module &&module)
+{
+    const size_t n_in =
+        std::visit([](const auto &layer) { return layer.n_in(); }, module);
+    if (!_modules.empty() && n_in != n_out())
+    {
+        throw std::invalid_argument(
+            "the inputs of a layer should match the outputs of the last");
+    }
+    _modules.push_back(std::move(module));
+    _results.resize(_modules.size());
+
+    // Moving the layers keeps the addresses of their parameters, but the
+    // parameters are collected again to keep their order.
+    _parameters.clear();
+    for (const auto &added : _modules)
+    {
+        std::visit(
+            [this](const auto &layer) {
+                _parameters.insert(_parameters.end(),
+                                   layer.parameters().begin(),
+                                   layer.parameters().end());
+            },
+            added);
+    }
+}
+
+
+size_t Sequential::n_in() const
+{
+    if (_modules.empty())
+    {
+        return 0;
+    }
+    return std::visit([](const auto &layer) { return layer.n_in(); },
+                      _modules.front());
+}
+
+
+size_t Sequential::n_out() const
+{
+    if (_modules.empty())
+    {
+        return 0;
+    }
+    return std::visit([](const auto &layer) { return layer.n_out(); },
+                      _modules.back());
+}
+
+
+std::vector<Variable> &Sequential::forward(const std::vector<double> &inputs)
+{
+    if (_modules.empty())
+    {
+        throw std::runtime_error("the model has no layers");
+    }
+    std::visit([&](auto &layer) { layer.forward(inputs, _results[0]); },
+               _modules[0]);
+    for (size_t i = 1; i < _modules.size(); i++)
+    {
+        std::visit(
+            [&](auto &layer) { layer.forward(_results[i - 1], _results[i]); },
+            _modules[i]);
+    }
+    return _results.back();
+}
+
+
+std::vector<double> Sequential::predict(const std::vector<double> &inputs) const
+{
+    if (_modules.empty())
+    {
+        throw std::runtime_error("the model has no layers");
+    }
+    std::vector<double> values = inputs;
+    for (const auto &module : _modules)
+    {
+        values = std::visit(
+            [&values](const auto &layer) { return layer.predict(values); },
+            module);
+    }
+    return values;
+}
@@ -0,0 +1,579 @@
+#pragma once
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../layer/layer.h"
+
+/**
+ * @struct ConvOptions
+ * The stride, zero padding and dilation of the spatial axes of a
+ * convolution.
+ */
+struct ConvOptions
+{
+    size_t stride = 1;   // The step between two outputs.
+    size_t padding = 0;  // The zeros added on both sides of the input.
+    size_t dilation = 1; // The step between two taps of the kernel.
+};
+
+/**
+ * @class Conv2D
+ * This class represents a 2D convolution layer with one neuron per output
+ * channel, whose weights are the filter, laid out as [in_channels][kernel
+ * rows][kernel columns], and whose bias is added to every output of the
+ * channel. Inputs and outputs are flat vectors laid out as [channels][rows]
+ * [columns], so the layer chains with `Layer` and the pooling layers.
+ *
+ * The patch of each output, the im2col column, is gathered through an
+ * index table built once. Each output on a graph is a single fused node,
+ * whose backward pass reaches the filter, the bias and the input taps.
+ * `predict` lays the patches out as a matrix and computes all outputs of a
+ * sample with one blocked matrix product.
+ */
+class Conv2D
+{
+protected:
+    /**
+     * @struct Axis
+     * The geometry of one spatial axis.
+     */
+    struct Axis
+    {
+        size_t in;           // The input size.
+        size_t kernel;       // The kernel size.
+        ConvOptions options; // The stride, padding and dilation.
+        size_t out;          // The output size.
+    };
+
+    /**
+     * Constructs a convolution from the geometry of its axes.
+     * @param in_channels The number of input channels.
+     * @param out_channels The number of output channels.
+     * @param rows The geometry of the rows.
+     * @param columns The geometry of the columns.
+     * @param activate_function The activation function.
+     * @param scheme The initialization of the filters.
+     * @param pool Draws the filters in parallel if given.
+     * @throw std::invalid_argument if the geometry is empty or the kernel
+     * does not fit into the padded input.
+     */
+    Conv2D(size_t in_channels,
+           size_t out_channels,
+           Axis rows,
+           Axis columns,
+           std::string activate_function,
+           InitScheme scheme,
+           ThreadPool *pool);
+
+private:
+    static constexpr size_t _padding_tap = ~size_t(0); // A padded tap.
+
+    size_t _in_channels;             // The number of input channels.
+    size_t _out_channels;            // The number of output channels.
+    Axis _rows;                      // The geometry of the rows.
+    Axis _columns;                   // The geometry of the columns.
+    std::string _activate_function;  // The activation function.
+    ActivationMode _activation_mode = ActivationMode::Exact; // The mode.
+    std::vector<Neuron> _filters;      // One neuron per output channel.
+    std::vector<Variable> _parameters; // All parameters of the layer.
+    std::vector<size_t> _taps; // The input index of each tap of each output
+                               // position, or `_padding_tap`.
+    std::vector<bool> _padded; // Whether a position has padded taps.
+
+    /**
+     * Computes the outputs of a sample on a graph.
+     * @param inputs The input values or variables.
+     * @param outputs The outputs, laid out as [channels][rows][columns].
+     */
+    template <typename Inputs>
+    void forward_positions(const Inputs &inputs,
+                           std::vector<Variable> &outputs);
+
+public:
+    /**
+     * Constructs a 2D convolution layer.
+     * @param in_channels The number of input channels.
+     * @param height The number of input rows.
+     * @param width The number of input columns.
+     * @param out_channels The number of output channels.
+     * @param kernel_size The number of rows and columns of the kernel.
+     * @param options The stride, padding and dilation of both axes.
+     * @param activate_function The activation function. Default is "tanh".
+     * @param scheme The initialization of the filters, drawn from one
+     * `next_seed()` stream with fan-in in_channels * kernel_size^2.
+     * @param pool Draws the filters in parallel if given.
+     * @throw std::invalid_argument if the geometry is empty or the kernel
+     * does not fit into the padded input.
+     */
+    Conv2D(size_t in_channels,
+           size_t height,
+           size_t width,
+           size_t out_channels,
+           size_t kernel_size,
+           ConvOptions options = ConvOptions(),
+           std::string activate_function = "tanh",
+           InitScheme scheme = InitScheme::Uniform,
+           ThreadPool *pool = nullptr);
+
+    /**
+     * The filters are views of the original ones when copied, so a layer
+     * can only be moved.
+     */
+    Conv2D(const Conv2D &other) = delete;
+    Conv2D &operator=(const Conv2D &other) = delete;
+
+    /**
+     * Move constructor. The filters keep their addresses, so the parameters
+     * stay valid.
+     * @param other The layer to be moved.
+     */
+    Conv2D(Conv2D &&other) noexcept = default;
+
+    /**
+     * Move assignment operator.
+     * @param other The layer to be assigned.
+     * @return A reference to the assigned layer.
+     */
+    Conv2D &operator=(Conv2D &&other) noexcept = default;
+
+    /**
+     * Returns the number of inputs, in_channels * height * width.
+     * @return The number of inputs.
+     */
+    size_t n_in() const
+    {
+        return _in_channels * _rows.in * _columns.in;
+    }
+
+    /**
+     * Returns the number of outputs, out_channels * out_height * out_width.
+     * @return The number of outputs.
+     */
+    size_t n_out() const
+    {
+        return _out_channels * _rows.out * _columns.out;
+    }
+
+    size_t in_channels() const
+    {
+        return _in_channels;
+    }
+
+    size_t out_channels() const
+    {
+        return _out_channels;
+    }
+
+    size_t out_height() const
+    {
+        return _rows.out;
+    }
+
+    size_t out_width() const
+    {
+        return _columns.out;
+    }
+
+    /**
+     * Returns the filters, one neuron per output channel.
+     * @return The filters.
+     */
+    const std::vector<Neuron> &filters() const
+    {
+        return _filters;
+    }
+
+    /**
+     * Returns all parameters of the layer, the weights and the bias of each
+     * filter in turn.
+     * @return The parameters.
+     */
+    const std::vector<Variable> &parameters() const
+    {
+        return _parameters;
+    }
+
+    /**
+     * Sets whether the layer uses the exact or the fast activation kernel.
+     * @param mode The activation mode.
+     */
+    void set_activation_mode(ActivationMode mode);
+
+    /**
+     * Computes the forward pass of the layer given the input values.
+     * @param inputs The input values.
+     * @return The output values of the layer as a vector of Variables.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<Variable> forward(const std::vector<double> &inputs);
+
+    /**
+     * Computes the forward pass of the layer given the input variables.
+     * Padded taps are left out of the output nodes.
+     * @param variables The input variables.
+     * @return The output values of the layer as a vector of Variables.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<Variable> forward(const std::vector<Variable> &variables);
+
+    /**
+     * Computes the forward pass into existing outputs, reusing them.
+     * @param inputs The input values.
+     * @param outputs The outputs of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    void forward(const std::vector<double> &inputs,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the forward pass into existing outputs, reusing them.
+     * @param variables The input variables.
+     * @param outputs The outputs of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    void forward(const std::vector<Variable> &variables,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the output values of the layer without building a graph,
+     * through im2col and a blocked matrix product.
+     * @param inputs The input values.
+     * @return The output values of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+
+    /**
+     * Computes the output values of the layer for a batch of inputs without
+     * building a graph.
+     * @param inputs The row-major input values, n x n_in.
+     * @param n The number of samples.
+     * @return The row-major output values, n x n_out.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs,
+                                size_t n) const;
+};
+
+/**
+ * @class Conv1D
+ * This class represents a 1D convolution layer, e.g. over the samples of a
+ * time series, with inputs and outputs laid out as [channels][positions].
+ */
+class Conv1D : public Conv2D
+{
+public:
+    /**
+     * Constructs a 1D convolution layer.
+     * @param in_channels The number of input channels.
+     * @param length The number of input positions.
+     * @param out_channels The number of output channels.
+     * @param kernel_size The number of taps of the kernel.
+     * @param options The stride, padding and dilation.
+     * @param activate_function The activation function. Default is "tanh".
+     * @param scheme The initialization of the filters.
+     * @param pool Draws the filters in parallel if given.
+     * @throw std::invalid_argument if the geometry is empty or the kernel
+     * does not fit into the padded input.
+     */
+    Conv1D(size_t in_channels,
+           size_t length,
+           size_t out_channels,
+           size_t kernel_size,
+           ConvOptions options = ConvOptions(),
+           std::string activate_function = "tanh",
+           InitScheme scheme = InitScheme::Uniform,
+           ThreadPool *pool = nullptr)
+        : Conv2D(in_channels,
+                 out_channels,
+                 Axis{1, 1, ConvOptions(), 0},
+                 Axis{length, kernel_size, options, 0},
+                 std::move(activate_function),
+                 scheme,
+                 pool){};
+
+    /**
+     * Returns the number of output positions.
+     * @return The output length.
+     */
+    size_t out_length() const
+    {
+        return out_width();
+    }
+};
+
+/**
+ * The reductions of a pooling layer.
+ */
+enum class PoolKind
+{
+    Max,     // The largest input of the window.
+    Average, // The mean of the window.
+};
+
+/**
+ * @class Pool2D
+ * This class represents a 2D pooling layer without parameters, applied to
+ * each channel of an input laid out as [channels][rows][columns]. On a
+ * graph, max pooling passes the gradient to the largest input of each
+ * window and average pooling spreads it evenly.
+ */
+class Pool2D
+{
+protected:
+    size_t _channels;     // The number of channels.
+    size_t _height;       // The number of input rows.
+    size_t _width;        // The number of input columns.
+    size_t _kernel_rows;  // The number of rows of a window.
+    size_t _kernel_cols;  // The number of columns of a window.
+    size_t _stride_rows;  // The step between two windows down the rows.
+    size_t _stride_cols;  // The step between two windows along a row.
+    size_t _out_height;   // The number of output rows.
+    size_t _out_width;    // The number of output columns.
+    PoolKind _kind;       // The reduction.
+
+    /**
+     * Constructs a pooling layer from the geometry of its axes.
+     * @throw std::invalid_argument if a window is empty or larger than the
+     * input, or a stride is zero.
+     */
+    Pool2D(PoolKind kind,
+           size_t channels,
+           size_t height,
+           size_t width,
+           size_t kernel_rows,
+           size_t kernel_cols,
+           size_t stride_rows,
+           size_t stride_cols);
+
+public:
+    /**
+     * Constructs a 2D pooling layer.
+     * @param kind The reduction.
+     * @param channels The number of channels.
+     * @param height The number of input rows.
+     * @param width The number of input columns.
+     * @param kernel_size The number of rows and columns of a window.
+     * @param stride The step between two windows, or 0 for kernel_size.
+     * @throw std::invalid_argument if the window is empty or larger than
+     * the input.
+     */
+    Pool2D(PoolKind kind,
+           size_t channels,
+           size_t height,
+           size_t width,
+           size_t kernel_size,
+           size_t stride = 0)
+        : Pool2D(kind,
+                 channels,
+                 height,
+                 width,
+                 kernel_size,
+                 kernel_size,
+                 stride == 0 ? kernel_size : stride,
+                 stride == 0 ? kernel_size : stride){};
+
+    size_t n_in() const
+    {
+        return _channels * _height * _width;
+    }
+
+    size_t n_out() const
+    {
+        return _channels * _out_height * _out_width;
+    }
+
+    size_t out_height() const
+    {
+        return _out_height;
+    }
+
+    size_t out_width() const
+    {
+        return _out_width;
+    }
+
+    /**
+     * Returns the parameters of the layer, always empty.
+     * @return The parameters.
+     */
+    const std::vector<Variable> &parameters() const
+    {
+        static const std::vector<Variable> none;
+        return none;
+    }
+
+    /**
+     * Computes the forward pass of the layer given the input variables.
+     * @param variables The input variables.
+     * @return The output values of the layer as a vector of Variables.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<Variable> forward(const std::vector<Variable> &variables);
+
+    /**
+     * Computes the forward pass of the layer given the input values.
+     * @param inputs The input values.
+     * @return The output values of the layer as a vector of Variables.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<Variable> forward(const std::vector<double> &inputs);
+
+    /**
+     * Computes the forward pass into existing outputs.
+     * @param variables The input variables.
+     * @param outputs The outputs of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    void forward(const std::vector<Variable> &variables,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the forward pass into existing outputs.
+     * @param inputs The input values.
+     * @param outputs The outputs of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    void forward(const std::vector<double> &inputs,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the output values of the layer without building a graph.
+     * @param inputs The input values.
+     * @return The output values of the layer.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+};
+
+/**
+ * @class Pool1D
+ * This class represents a 1D pooling layer over inputs laid out as
+ * [channels][positions].
+ */
+class Pool1D : public Pool2D
+{
+public:
+    /**
+     * Constructs a 1D pooling layer.
+     * @param kind The reduction.
+     * @param channels The number of channels.
+     * @param length The number of input positions.
+     * @param kernel_size The number of positions of a window.
+     * @param stride The step between two windows, or 0 for kernel_size.
+     * @throw std::invalid_argument if the window is empty or larger than
+     * the input.
+     */
+    Pool1D(PoolKind kind,
+           size_t channels,
+           size_t length,
+           size_t kernel_size,
+           size_t stride = 0)
+        : Pool2D(kind,
+                 channels,
+                 1,
+                 length,
+                 1,
+                 kernel_size,
+                 1,
+                 stride == 0 ? kernel_size : stride){};
+
+    size_t out_length() const
+    {
+        return _out_width;
+    }
+};
+
+/**
+ * A layer of a `Sequential` model.
+ */
+using Module = std::variant<Layer, Conv1D, Conv2D, Pool1D, Pool2D>;
+
+/**
+ * @class Sequential
+ * This class represents a model that applies its layers in turn, like
+ * `MLP`, but whose layers may also be convolutions and pooling layers.
+ */
+class Sequential
+{
+private:
+    std::vector<Module> _modules;                // The layers.
+    std::vector<Variable> _parameters;           // All parameters.
+    std::vector<std::vector<Variable>> _results; // The output of each layer.
+
+public:
+    /**
+     * Constructs a model without layers.
+     */
+    Sequential() = default;
+
+    Sequential(const Sequential &other) = delete;
+    Sequential &operator=(const Sequential &other) = delete;
+    Sequential(Sequential &&other) noexcept = default;
+    Sequential &operator=(Sequential &&other) noexcept = default;
+
+    /**
+     * Appends a layer, which is moved into the model so that its
+     * parameters stay valid.
+     * @param module The layer, taking the outputs of the last one.
+     * @throw std::invalid_argument if the number of inputs of the layer
+     * differs from the number of outputs of the last one.
+     */
+    void add(Module &&module);
+
+    const std::vector<Module> &modules() const
+    {
+        return _modules;
+    }
+
+    /**
+     * Returns the number of inputs of the first layer.
+     * @return The number of inputs, or 0 without layers.
+     */
+    size_t n_in() const;
+
+    /**
+     * Returns the number of outputs of the last layer.
+     * @return The number of outputs, or 0 without layers.
+     */
+    size_t n_out() const;
+
+    /**
+     * Returns all parameters of the model, layer by layer.
+     * @return The parameters.
+     */
+    const std::vector<Variable> &parameters() const
+    {
+        return _parameters;
+    }
+
+    /**
+     * Returns a mutable reference to the parameters of the model.
+     * @return The mutable parameters.
+     */
+    std::vector<Variable> &mutable_parameters()
+    {
+        return _parameters;
+    }
+
+    /**
+     * Computes the forward pass of the model. The outputs of the layers
+     * are reused by the next pass.
+     * @param inputs The input values.
+     * @return The output values of the model as a vector of Variables.
+     * @throw std::runtime_error if the model has no layers or the number of
+     * inputs is wrong.
+     */
+    std::vector<Variable> &forward(const std::vector<double> &inputs);
+
+    /**
+     * Computes the output values of the model without building a graph.
+     * @param inputs The input values.
+     * @return The output values of the model.
+     * @throw std::runtime_error if the model has no layers or the number of
+     * inputs is wrong.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+};
@@ -0,0 +1,90 @@
+#include "determinism.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+
+namespace
+{
+std::atomic<bool> deterministic_mode{false};
+std::atomic<bool> seeded{false};
+std::atomic<uint64_t> global_seed{0};
+std::atomic<uint64_t> seed_counter{0};
+std::atomic<size_t> num_lanes{8};
+} // namespace
+
+
+void set_deterministic(bool enabled, uint64_t seed)
+{
+    global_seed = seed;
+    seed_counter = 0;
+    seeded = enabled;
+    deterministic_mode = enabled;
+}
+
+
+void set_seed(uint64_t seed)
+{
+    global_seed = seed;
+    seed_counter = 0;
+    seeded = true;
+}
+
+
+bool deterministic()
+{
+    return deterministic_mode.load(std::memory_order_relaxed);
+}
+
+
+uint64_t next_seed()
+{
+    const uint64_t counter = splitmix64(seed_counter.fetch_add(1));
+    if (seeded.load(std::memory_order_relaxed))
+    {
+        return splitmix64(global_seed.load() ^ counter);
+    }
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    return splitmix64(static_cast<uint64_t>(now.count()) ^ counter);
+}
+
+
+size_t deterministic_lanes()
+{
+    return num_lanes.load(std::memory_order_relaxed);
+}
+
+
+void set_deterministic_lanes(size_t lanes)
+{
+    if (lanes == 0)
+    {
+        throw std::invalid_argument("the number of lanes should be > 0");
+    }
+    num_lanes = lanes;
+}
+
+
+SeedScope::SeedScope(uint64_t seed, bool deterministic)
+    : _deterministic(deterministic_mode), _seeded(seeded),
+      _seed(global_seed), _counter(seed_counter)
+{
+    if (deterministic)
+    {
+        set_deterministic(true, seed);
+    }
+    else
+    {
+        set_seed(seed);
+    }
+}
+
+
+SeedScope::~SeedScope()
+{
+    global_seed = _seed;
+    seed_counter = _counter;
+    seeded = _seeded;
+    deterministic_mode = _deterministic;
+}
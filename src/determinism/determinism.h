@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The SplitMix64 finalizer, which maps consecutive counters to unrelated
+ * 64-bit values. Seeds and counter-based random streams hash with it.
+ * @param x The value to mix.
+ * @return The mixed value.
+ */
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Enables or disables deterministic mode. In deterministic mode parallel
+ * reductions, such as the gradient accumulation of `parallel_backward`, sum
+ * in a fixed-shape tree that does not depend on the number of threads or on
+ * scheduling, and random seeds are derived from a global seed, so that
+ * retraining reproduces the same parameters bit for bit.
+ * @param enabled Whether deterministic mode is enabled.
+ * @param seed The global seed of `next_seed`.
+ * @note Enabling the mode restarts the seed sequence.
+ */
+void set_deterministic(bool enabled, uint64_t seed = 0);
+
+/**
+ * Returns whether deterministic mode is enabled.
+ * @return True in deterministic mode.
+ */
+bool deterministic();
+
+/**
+ * Sets the global seed of `next_seed` without enabling deterministic
+ * reductions, e.g. to reproduce the initial parameters of a model.
+ * `set_deterministic` overrides it.
+ * @param seed The global seed.
+ * @note Restarts the seed sequence.
+ */
+void set_seed(uint64_t seed);
+
+/**
+ * Returns a seed for a random engine. After `set_seed`, or in deterministic
+ * mode, the n-th call returns the same seed in every run; otherwise the seed
+ * mixes the clock with a call counter, so that seeds drawn in the same clock
+ * tick differ.
+ * @return The seed.
+ */
+uint64_t next_seed();
+
+/**
+ * Returns the number of lanes of deterministic reductions. Work is split
+ * into this many fixed shares whose partial results are combined in a
+ * fixed tree, so it bounds the parallelism of deterministic mode. Defaults
+ * to 8.
+ * @return The number of lanes.
+ */
+size_t deterministic_lanes();
+
+/**
+ * Sets the number of lanes of deterministic reductions. Results are only
+ * reproducible between runs with the same number of lanes.
+ * @param lanes The number of lanes, at least one.
+ * @throw std::invalid_argument if the number of lanes is zero.
+ */
+void set_deterministic_lanes(size_t lanes);
+
+
+/**
+ * @class SeedScope
+ * This class seeds `next_seed`, and optionally enables deterministic mode,
+ * for its lifetime. The destructor restores the previous mode and seed
+ * sequence, so that a scope which ends early, e.g. through an exception,
+ * does not leak its seed into later code.
+ */
+class SeedScope
+{
+private:
+    bool _deterministic; // The previous deterministic mode.
+    bool _seeded;        // Whether a global seed was previously set.
+    uint64_t _seed;      // The previous global seed.
+    uint64_t _counter;   // The previous position of the seed sequence.
+
+public:
+    /**
+     * Sets the global seed, see `set_seed` and `set_deterministic`.
+     * @param seed The global seed.
+     * @param deterministic Whether to enable deterministic mode as well.
+     */
+    explicit SeedScope(uint64_t seed, bool deterministic = false);
+
+    /**
+     * Restores the previous mode and seed sequence.
+     */
+    ~SeedScope();
+
+    SeedScope(const SeedScope &) = delete;
+    SeedScope &operator=(const SeedScope &) = delete;
+};
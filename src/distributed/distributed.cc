@@ -0,0 +1,366 @@
+#include "distributed.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace
+{
+// The barrier is placed in its own cache line before the rank buffers.
+constexpr size_t header_bytes = 64 * ((sizeof(pthread_barrier_t) + 63) / 64);
+
+
+pthread_barrier_t *shared_barrier(void *region)
+{
+    return static_cast<pthread_barrier_t *>(region);
+}
+
+
+// The range of the chunk c when n values are split over `parts` ranks.
+size_t chunk_begin(size_t c, size_t n, size_t parts)
+{
+    return c * n / parts;
+}
+
+
+// Reaps the workers as they exit. Once one of them fails, the others may
+// block forever in a collective that waits for it, so they are terminated.
+// Returns the rank of the first failed worker, or the number of workers.
+size_t wait_for_workers(const std::vector<pid_t> &workers)
+{
+    size_t failed = workers.size();
+    size_t running = workers.size();
+    std::vector<bool> reaped(workers.size(), false);
+    while (running > 0)
+    {
+        int status = 0;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (pid < 0)
+        {
+            // The remaining workers were reaped elsewhere, so their status
+            // is unknown.
+            const auto first = std::find(reaped.begin(), reaped.end(), false);
+            return std::min(failed,
+                            static_cast<size_t>(first - reaped.begin()));
+        }
+        const auto worker = std::find(workers.begin(), workers.end(), pid);
+        if (worker == workers.end())
+        {
+            continue;
+        }
+        const auto rank = static_cast<size_t>(worker - workers.begin());
+        reaped[rank] = true;
+        running--;
+        const bool succeeded =
+            WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+        if (!succeeded && failed == workers.size())
+        {
+            failed = rank;
+            for (size_t other = 0; other < workers.size(); other++)
+            {
+                if (!reaped[other])
+                {
+                    kill(workers[other], SIGTERM);
+                }
+            }
+        }
+    }
+    return failed;
+}
+
+
+// Reads the gradients of the variables referenced by the parameters.
+std::vector<double> gather_gradients(const MLP &mlp)
+{
+    const std::vector<Variable> &parameters = mlp.parameters();
+    std::vector<double> gradients(parameters.size());
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        const Variable *weight = parameters[i].reference();
+        gradients[i] = weight != nullptr ? weight->gradient()
+                                         : parameters[i].gradient();
+    }
+    return gradients;
+}
+
+
+// Writes the gradients to the parameters and the variables they reference,
+// since `Variable::gradient_descent` reads both.
+void scatter_gradients(MLP &mlp, const std::vector<double> &gradients)
+{
+    std::vector<Variable> &parameters = mlp.mutable_parameters();
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        parameters[i].set_gradient(gradients[i]);
+        if (parameters[i].reference() != nullptr)
+        {
+            parameters[i].reference()->set_gradient(gradients[i]);
+        }
+    }
+}
+} // namespace
+
+
+SharedMemoryCommunicator::SharedMemoryCommunicator(size_t world_size,
+                                                   size_t capacity)
+    : _world_size(world_size), _capacity(capacity), _rank(0),
+      _region(nullptr), _bytes(0)
+{
+    if (world_size == 0 || capacity == 0)
+    {
+        throw std::invalid_argument("world size and capacity should be > 0");
+    }
+    _bytes = header_bytes + world_size * capacity * sizeof(double);
+    _region = mmap(nullptr,
+                   _bytes,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS,
+                   -1,
+                   0);
+    if (_region == MAP_FAILED)
+    {
+        throw std::runtime_error("failed to map shared memory");
+    }
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    const int status = pthread_barrier_init(
+        shared_barrier(_region), &attr, static_cast<unsigned>(world_size));
+    pthread_barrierattr_destroy(&attr);
+    if (status != 0)
+    {
+        munmap(_region, _bytes);
+        throw std::runtime_error("failed to create the shared barrier");
+    }
+}
+
+
+SharedMemoryCommunicator::~SharedMemoryCommunicator()
+{
+    // The barrier is not destroyed: a worker terminated inside it leaves it
+    // in use, and destroying it would wait for that worker forever. It holds
+    // no resources beyond the mapping.
+    munmap(_region, _bytes);
+}
+
+
+double *SharedMemoryCommunicator::buffer(size_t rank) const
+{
+    return reinterpret_cast<double *>(static_cast<char *>(_region) +
+                                      header_bytes) +
+           rank * _capacity;
+}
+
+
+void SharedMemoryCommunicator::set_rank(size_t rank)
+{
+    if (rank >= _world_size)
+    {
+        throw std::invalid_argument("rank should be less than the world size");
+    }
+    _rank = rank;
+}
+
+
+void SharedMemoryCommunicator::barrier()
+{
+    pthread_barrier_wait(shared_barrier(_region));
+}
+
+
+void SharedMemoryCommunicator::ring_allreduce(double *data, size_t n)
+{
+    const size_t world = _world_size;
+    const size_t previous = (_rank + world - 1) % world;
+    double *own = buffer(_rank);
+    const double *left = buffer(previous);
+    std::memcpy(own, data, n * sizeof(double));
+    barrier();
+
+    // Reduce-scatter: in step s, each rank adds the chunk its left neighbour
+    // accumulated in step s - 1. Afterwards rank r owns chunk r + 1.
+    for (size_t step = 0; step + 1 < world; step++)
+    {
+        const size_t c = (_rank + 2 * world - step - 1) % world;
+        const size_t first = chunk_begin(c, n, world);
+        const size_t last = chunk_begin(c + 1, n, world);
+        for (size_t i = first; i < last; i++)
+        {
+            own[i] += left[i];
+        }
+        barrier();
+    }
+
+    // Allgather: in step s, each rank copies the finished chunk its left
+    // neighbour owns or received in step s - 1.
+    for (size_t step = 0; step + 1 < world; step++)
+    {
+        const size_t c = (_rank + world - step) % world;
+        const size_t first = chunk_begin(c, n, world);
+        const size_t last = chunk_begin(c + 1, n, world);
+        std::memcpy(own + first, left + first, (last - first) * sizeof(double));
+        barrier();
+    }
+
+    std::memcpy(data, own, n * sizeof(double));
+    barrier();
+}
+
+
+void SharedMemoryCommunicator::allreduce(double *data, size_t n)
+{
+    if (_world_size == 1)
+    {
+        return;
+    }
+    for (size_t offset = 0; offset < n; offset += _capacity)
+    {
+        ring_allreduce(data + offset, std::min(_capacity, n - offset));
+    }
+}
+
+
+void SharedMemoryCommunicator::allreduce(std::vector<double> &data)
+{
+    allreduce(data.data(), data.size());
+}
+
+
+void SharedMemoryCommunicator::broadcast(double *data, size_t n, size_t root)
+{
+    if (root >= _world_size)
+    {
+        throw std::invalid_argument("root should be less than the world size");
+    }
+    if (_world_size == 1)
+    {
+        return;
+    }
+    for (size_t offset = 0; offset < n; offset += _capacity)
+    {
+        const size_t count = std::min(_capacity, n - offset);
+        if (_rank == root)
+        {
+            std::memcpy(buffer(root), data + offset, count * sizeof(double));
+        }
+        barrier();
+        if (_rank != root)
+        {
+            std::memcpy(data + offset, buffer(root), count * sizeof(double));
+        }
+        barrier();
+    }
+}
+
+
+void launch(size_t world_size,
+            size_t capacity,
+            const std::function<void(SharedMemoryCommunicator &)> &worker)
+{
+    SharedMemoryCommunicator communicator(world_size, capacity);
+    std::vector<pid_t> workers;
+    workers.reserve(world_size);
+    // The parent stops the workers with SIGTERM when one of them fails,
+    // which a handler inherited from it must not intercept. SIGTERM stays
+    // blocked until a worker has restored the default action.
+    sigset_t terminate;
+    sigset_t previous;
+    sigemptyset(&terminate);
+    sigaddset(&terminate, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &terminate, &previous);
+    for (size_t rank = 0; rank < world_size; rank++)
+    {
+        const pid_t pid = fork();
+        if (pid < 0)
+        {
+            pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+            for (pid_t started : workers)
+            {
+                kill(started, SIGKILL);
+                waitpid(started, nullptr, 0);
+            }
+            throw std::runtime_error("failed to fork a worker");
+        }
+        if (pid == 0)
+        {
+            std::signal(SIGTERM, SIG_DFL);
+            pthread_sigmask(SIG_UNBLOCK, &terminate, nullptr);
+            int status = EXIT_SUCCESS;
+            try
+            {
+                communicator.set_rank(rank);
+                worker(communicator);
+            }
+            catch (...)
+            {
+                status = EXIT_FAILURE;
+            }
+            // Skip the destructors and atexit handlers of the parent's state.
+            _exit(status);
+        }
+        workers.push_back(pid);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    const size_t failed = wait_for_workers(workers);
+    if (failed < world_size)
+    {
+        throw std::runtime_error("the worker of rank " +
+                                 std::to_string(failed) + " failed");
+    }
+}
+
+
+void allreduce_gradients(MLP &mlp,
+                         SharedMemoryCommunicator &communicator,
+                         bool average)
+{
+    std::vector<double> gradients = gather_gradients(mlp);
+    communicator.allreduce(gradients);
+    if (average)
+    {
+        const auto world = static_cast<double>(communicator.world_size());
+        for (double &gradient : gradients)
+        {
+            gradient /= world;
+        }
+    }
+    scatter_gradients(mlp, gradients);
+}
+
+
+void broadcast_parameters(MLP &mlp,
+                          SharedMemoryCommunicator &communicator,
+                          size_t root)
+{
+    std::vector<Variable> &parameters = mlp.mutable_parameters();
+    std::vector<double> values(parameters.size());
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        const Variable *weight = parameters[i].reference();
+        values[i] = weight != nullptr ? weight->value() : parameters[i].value();
+    }
+    communicator.broadcast(values.data(), values.size(), root);
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        parameters[i].set_value(values[i]);
+        if (parameters[i].reference() != nullptr)
+        {
+            parameters[i].reference()->set_value(values[i]);
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../neural_network/mlp.h"
+
+/**
+ * @class SharedMemoryCommunicator
+ * This class represents a group of processes on one host that exchange data
+ * through an anonymous shared mapping. It must be created before the worker
+ * processes are forked, e.g. by `launch`, so that every rank shares the same
+ * mapping and process-shared barrier.
+ */
+class SharedMemoryCommunicator
+{
+private:
+    size_t _world_size; // The number of processes.
+    size_t _capacity;   // The number of doubles each rank can exchange.
+    size_t _rank;       // The rank of the calling process.
+    void *_region;      // The shared mapping.
+    size_t _bytes;      // The size of the shared mapping.
+
+    /**
+     * Returns the exchange buffer of a rank.
+     * @param rank The rank.
+     * @return The buffer of `capacity` doubles.
+     */
+    double *buffer(size_t rank) const;
+
+    /**
+     * Runs a ring allreduce on at most `capacity` doubles.
+     * @param data The values to sum in place.
+     * @param n The number of values.
+     */
+    void ring_allreduce(double *data, size_t n);
+
+public:
+    /**
+     * Constructs a communicator.
+     * @param world_size The number of processes.
+     * @param capacity The number of doubles exchanged per step; larger
+     * arrays are reduced in pieces.
+     * @throw std::invalid_argument if world_size or capacity is zero.
+     * @throw std::runtime_error if the shared mapping cannot be created.
+     */
+    SharedMemoryCommunicator(size_t world_size, size_t capacity);
+
+    SharedMemoryCommunicator(const SharedMemoryCommunicator &) = delete;
+    SharedMemoryCommunicator &
+    operator=(const SharedMemoryCommunicator &) = delete;
+
+    /**
+     * Unmaps the shared memory. The barrier is not destroyed, since a
+     * terminated worker may have left it in use.
+     */
+    ~SharedMemoryCommunicator();
+
+    /**
+     * Returns the number of processes.
+     * @return The world size.
+     */
+    size_t world_size() const
+    {
+        return _world_size;
+    }
+
+    /**
+     * Returns the rank of the calling process.
+     * @return The rank, in [0, world_size).
+     */
+    size_t rank() const
+    {
+        return _rank;
+    }
+
+    /**
+     * Sets the rank of the calling process after it was forked.
+     * @param rank The rank, in [0, world_size).
+     * @throw std::invalid_argument if the rank is out of range.
+     */
+    void set_rank(size_t rank);
+
+    /**
+     * Returns the number of doubles exchanged per step.
+     * @return The capacity.
+     */
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * Blocks until every rank has reached the barrier.
+     */
+    void barrier();
+
+    /**
+     * Sums an array over all ranks in place with a ring allreduce, a
+     * reduce-scatter followed by an allgather. Every rank receives bitwise
+     * identical results.
+     * @param data The values to sum.
+     * @param n The number of values, equal on every rank.
+     */
+    void allreduce(double *data, size_t n);
+
+    /**
+     * Sums a vector over all ranks in place.
+     * @param data The values to sum, of equal size on every rank.
+     */
+    void allreduce(std::vector<double> &data);
+
+    /**
+     * Copies an array from one rank to all ranks.
+     * @param data The values, overwritten on every rank but the root.
+     * @param n The number of values, equal on every rank.
+     * @param root The rank that sends its values.
+     */
+    void broadcast(double *data, size_t n, size_t root = 0);
+};
+
+/**
+ * Forks one worker process per rank and waits for all of them. A worker that
+ * throws exits with a failure status. Since the other ranks may then block
+ * in a collective that waits for it, they are terminated as soon as the
+ * first failure is seen.
+ * @param world_size The number of processes.
+ * @param capacity The number of doubles exchanged per allreduce step.
+ * @param worker The function run by every rank.
+ * @throw std::runtime_error if a process cannot be forked or a worker fails
+ * or is killed.
+ * @note Waiting reaps any child process of the caller that exits meanwhile.
+ */
+void launch(size_t world_size,
+            size_t capacity,
+            const std::function<void(SharedMemoryCommunicator &)> &worker);
+
+/**
+ * Sums the gradients of the MLP over all ranks, between backward and the
+ * parameter update of data-parallel training.
+ * @param mlp The MLP, with the same architecture on every rank.
+ * @param communicator The communicator.
+ * @param average Whether to divide the sum by the world size.
+ */
+void allreduce_gradients(MLP &mlp,
+                         SharedMemoryCommunicator &communicator,
+                         bool average = true);
+
+/**
+ * Copies the parameter values of one rank to all ranks, e.g. after a random
+ * initialization that differs between processes.
+ * @param mlp The MLP, with the same architecture on every rank.
+ * @param communicator The communicator.
+ * @param root The rank whose values are kept.
+ */
+void broadcast_parameters(MLP &mlp,
+                          SharedMemoryCommunicator &communicator,
+                          size_t root = 0);
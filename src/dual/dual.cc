@@ -0,0 +1,196 @@
+#include "dual.h"
+#include <fmt/format.h>
+#include <math.h>
+
+#include <stdexcept>
+
+
+std::ostream &operator<<(std::ostream &os, const Dual &dual)
+{
+    os << fmt::format("Dual(value: {}, tangent: {})",
+                      dual._value,
+                      dual._tangent);
+    return os;
+}
+
+
+Dual Dual::operator/(const Dual &other) const
+{
+    if (other._value == 0)
+    {
+        throw std::overflow_error("Division by zero");
+    }
+    const double value = _value / other._value;
+    return Dual(value, (_tangent - value * other._tangent) / other._value);
+}
+
+
+Dual Dual::pow(const double other) const
+{
+    if (_value == 0 && other < 0)
+    {
+        throw std::overflow_error("Negative power of zero");
+    }
+    return Dual(std::pow(_value, other),
+                _tangent * other * std::pow(_value, other - 1));
+}
+
+
+Dual Dual::exp() const
+{
+    const double value = std::exp(_value);
+    return Dual(value, _tangent * value);
+}
+
+
+Dual Dual::log() const
+{
+    if (_value <= 0)
+    {
+        throw std::overflow_error("Log of Non-positive number");
+    }
+    return Dual(std::log(_value), _tangent / _value);
+}
+
+
+Dual Dual::sin() const
+{
+    return Dual(std::sin(_value), _tangent * std::cos(_value));
+}
+
+
+Dual Dual::cos() const
+{
+    return Dual(std::cos(_value), -_tangent * std::sin(_value));
+}
+
+
+Dual Dual::tan() const
+{
+    if (std::fmod(_value - M_PI_2, M_PI) == 0)
+    {
+        throw std::overflow_error("tan of (2*k*pi+pi)/2");
+    }
+    const double value = std::tan(_value);
+    return Dual(value, _tangent * (1 + value * value));
+}
+
+
+Dual Dual::sinh() const
+{
+    return Dual(std::sinh(_value), _tangent * std::cosh(_value));
+}
+
+
+Dual Dual::cosh() const
+{
+    return Dual(std::cosh(_value), _tangent * std::sinh(_value));
+}
+
+
+Dual Dual::tanh() const
+{
+    return activate(ActivationFunction::Tanh);
+}
+
+
+Dual Dual::relu() const
+{
+    return activate(ActivationFunction::Relu);
+}
+
+
+Dual Dual::sigmoid() const
+{
+    return activate(ActivationFunction::Sigmoid);
+}
+
+
+Dual Dual::gelu() const
+{
+    return activate(ActivationFunction::Gelu);
+}
+
+
+Dual Dual::silu() const
+{
+    return activate(ActivationFunction::Silu);
+}
+
+
+Dual Dual::softplus() const
+{
+    return activate(ActivationFunction::Softplus);
+}
+
+
+Dual Dual::activate(ActivationFunction activation, ActivationMode mode) const
+{
+    const double value = ::activate(activation, _value, mode);
+    return Dual(value,
+                _tangent * activation_derivative(activation, _value, value));
+}
+
+
+Dual Dual::activate(const std::string &activate_function) const
+{
+    return activate(parse_activation(activate_function));
+}
+
+
+Dual dot_product(const std::vector<Dual> &a, const std::vector<Dual> &b)
+{
+    if (a.size() != b.size())
+    {
+        throw std::invalid_argument("a and b should have same size");
+    }
+    Dual result;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+
+Dual dot_product(const std::vector<Dual> &a, const std::vector<double> &b)
+{
+    if (a.size() != b.size())
+    {
+        throw std::invalid_argument("a and b should have same size");
+    }
+    Dual result;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        result += b[i] * a[i];
+    }
+    return result;
+}
+
+
+std::vector<Dual> make_duals(const std::vector<double> &values,
+                             const std::vector<double> &tangents)
+{
+    if (values.size() != tangents.size())
+    {
+        throw std::invalid_argument(
+            "values and tangents should have same size");
+    }
+    std::vector<Dual> result(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        result[i] = Dual(values[i], tangents[i]);
+    }
+    return result;
+}
+
+
+std::vector<double> tangents(const std::vector<Dual> &duals)
+{
+    std::vector<double> result(duals.size());
+    for (size_t i = 0; i < duals.size(); i++)
+    {
+        result[i] = duals[i].tangent();
+    }
+    return result;
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../activation/activation.h"
+
+/**
+ * @class Dual
+ * This class represents a dual number, value + tangent * eps with eps^2 = 0.
+ * Evaluating an expression on dual numbers propagates the tangent forward,
+ * so one pass yields the Jacobian-vector product along the seeded tangents
+ * without building or retaining a graph.
+ */
+class Dual
+{
+private:
+    double _value;   // The value of the dual number.
+    double _tangent; // The directional derivative of the value.
+
+public:
+    /**
+     * Constructs a new Dual object.
+     * @param value The value.
+     * @param tangent The tangent. Default is 0, i.e. a constant.
+     */
+    Dual(double value = 0, double tangent = 0)
+        : _value(value), _tangent(tangent){};
+
+    /**
+     * Returns the value of the dual number.
+     * @return The value.
+     */
+    double value() const
+    {
+        return _value;
+    }
+
+    /**
+     * Returns the tangent of the dual number.
+     * @return The tangent.
+     */
+    double tangent() const
+    {
+        return _tangent;
+    }
+
+    /**
+     * Sets the tangent of the dual number.
+     * @param tangent The new tangent.
+     */
+    void set_tangent(double tangent)
+    {
+        _tangent = tangent;
+    }
+
+    /**
+     * Overloads the stream insertion operator to print the dual number.
+     * @param os The output stream.
+     * @param dual The dual number to be printed.
+     * @return The modified output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &os, const Dual &dual);
+
+    /**
+     * Adds two dual numbers.
+     * @param other The dual number to be added.
+     * @return The result of the addition.
+     */
+    Dual operator+(const Dual &other) const
+    {
+        return Dual(_value + other._value, _tangent + other._tangent);
+    }
+
+    /**
+     * Subtracts two dual numbers.
+     * @param other The dual number to be subtracted.
+     * @return The result of the subtraction.
+     */
+    Dual operator-(const Dual &other) const
+    {
+        return Dual(_value - other._value, _tangent - other._tangent);
+    }
+
+    /**
+     * Multiplies two dual numbers.
+     * @param other The dual number to be multiplied.
+     * @return The result of the multiplication.
+     */
+    Dual operator*(const Dual &other) const
+    {
+        return Dual(_value * other._value,
+                    _tangent * other._value + _value * other._tangent);
+    }
+
+    /**
+     * Divides two dual numbers.
+     * @param other The dual number to be divided.
+     * @return The result of the division.
+     * @throw std::overflow_error if the divisor is zero.
+     */
+    Dual operator/(const Dual &other) const;
+
+    /**
+     * Negates the dual number.
+     * @return The negated dual number.
+     */
+    Dual operator-() const
+    {
+        return Dual(-_value, -_tangent);
+    }
+
+    /**
+     * Adds a dual number to this one.
+     * @param other The dual number to be added.
+     * @return Reference to this dual number.
+     */
+    Dual &operator+=(const Dual &other)
+    {
+        _value += other._value;
+        _tangent += other._tangent;
+        return *this;
+    }
+
+    /**
+     * Returns a copy of the dual number.
+     * @return The copy of the dual number.
+     */
+    Dual identity() const
+    {
+        return *this;
+    }
+
+    /**
+     * Raises the dual number to a scalar exponent.
+     * @param other The scalar exponent.
+     * @return The result of raising the dual number to the exponent.
+     * @throw std::overflow_error for a negative power of zero.
+     */
+    Dual pow(const double other) const;
+
+    /**
+     * Calculates the exponential of the dual number.
+     * @return The exponential of the dual number.
+     */
+    Dual exp() const;
+
+    /**
+     * Calculates the natural logarithm of the dual number.
+     * @return The natural logarithm of the dual number.
+     * @throw std::overflow_error if the value is not positive.
+     */
+    Dual log() const;
+
+    /**
+     * Calculates the sine of the dual number.
+     * @return The sine of the dual number.
+     */
+    Dual sin() const;
+
+    /**
+     * Calculates the cosine of the dual number.
+     * @return The cosine of the dual number.
+     */
+    Dual cos() const;
+
+    /**
+     * Calculates the tangent of the dual number.
+     * @return The tangent of the dual number.
+     * @throw std::overflow_error at the poles of tan.
+     */
+    Dual tan() const;
+
+    /**
+     * Calculates the hyperbolic sine of the dual number.
+     * @return The hyperbolic sine of the dual number.
+     */
+    Dual sinh() const;
+
+    /**
+     * Calculates the hyperbolic cosine of the dual number.
+     * @return The hyperbolic cosine of the dual number.
+     */
+    Dual cosh() const;
+
+    /**
+     * Calculates the hyperbolic tangent of the dual number.
+     * @return The hyperbolic tangent of the dual number.
+     */
+    Dual tanh() const;
+
+    /**
+     * Calculates the rectified linear unit (ReLU) of the dual number.
+     * @return The ReLU of the dual number.
+     */
+    Dual relu() const;
+
+    /**
+     * Calculates the sigmoid of the dual number.
+     * @return The sigmoid of the dual number.
+     */
+    Dual sigmoid() const;
+
+    /**
+     * Calculates the Gaussian Error Linear Unit (GELU) of the dual number.
+     * @return The GELU of the dual number.
+     */
+    Dual gelu() const;
+
+    /**
+     * Calculates the Sigmoid Linear Unit (SiLU) of the dual number.
+     * @return The SiLU of the dual number.
+     */
+    Dual silu() const;
+
+    /**
+     * Calculates the softplus of the dual number.
+     * @return The softplus of the dual number.
+     */
+    Dual softplus() const;
+
+    /**
+     * Activates the dual number with the given activation function.
+     * @param activation The activation function.
+     * @param mode Whether to use the exact or the fast kernel for the value.
+     * @return The activated dual number.
+     */
+    Dual activate(ActivationFunction activation,
+                  ActivationMode mode = ActivationMode::Exact) const;
+
+    /**
+     * Activates the dual number with the given activation function.
+     * @param activate_function The name of the activation function.
+     * @return The activated dual number.
+     * @throw std::runtime_error if the name is unknown.
+     */
+    Dual activate(const std::string &activate_function) const;
+};
+
+/**
+ * Adds a scalar and a dual number.
+ * @param other The scalar.
+ * @param dual The dual number.
+ * @return The result of the addition.
+ */
+inline Dual operator+(const double other, const Dual &dual)
+{
+    return Dual(other) + dual;
+}
+
+/**
+ * Subtracts a dual number from a scalar.
+ * @param other The scalar.
+ * @param dual The dual number.
+ * @return The result of the subtraction.
+ */
+inline Dual operator-(const double other, const Dual &dual)
+{
+    return Dual(other) - dual;
+}
+
+/**
+ * Multiplies a scalar and a dual number.
+ * @param other The scalar.
+ * @param dual The dual number.
+ * @return The result of the multiplication.
+ */
+inline Dual operator*(const double other, const Dual &dual)
+{
+    return Dual(other * dual.value(), other * dual.tangent());
+}
+
+/**
+ * Divides a scalar by a dual number.
+ * @param other The scalar.
+ * @param dual The dual number.
+ * @return The result of the division.
+ */
+inline Dual operator/(const double other, const Dual &dual)
+{
+    return Dual(other) / dual;
+}
+
+/**
+ * Calculates the dot product of two vectors of dual numbers.
+ * @param a The first vector of dual numbers.
+ * @param b The second vector of dual numbers.
+ * @return The dot product of the two vectors.
+ * @throw std::invalid_argument if the sizes differ.
+ */
+Dual dot_product(const std::vector<Dual> &a, const std::vector<Dual> &b);
+
+/**
+ * Calculates the dot product of a vector of dual numbers and a vector of
+ * scalars.
+ * @param a The vector of dual numbers.
+ * @param b The vector of scalars.
+ * @return The dot product of the two vectors.
+ * @throw std::invalid_argument if the sizes differ.
+ */
+Dual dot_product(const std::vector<Dual> &a, const std::vector<double> &b);
+
+/**
+ * Pairs values with tangents, e.g. inputs with the direction of a JVP.
+ * @param values The values.
+ * @param tangents The tangents.
+ * @return The dual numbers.
+ * @throw std::invalid_argument if the sizes differ.
+ */
+std::vector<Dual> make_duals(const std::vector<double> &values,
+                             const std::vector<double> &tangents);
+
+/**
+ * Extracts the tangents of dual numbers, e.g. the result of a JVP.
+ * @param duals The dual numbers.
+ * @return The tangents.
+ */
+std::vector<double> tangents(const std::vector<Dual> &duals);
@@ -0,0 +1,252 @@
+#include "embedding.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "../determinism/determinism.h"
+#include "../initializer/initializer.h"
+
+
+namespace
+{
+// The coefficient of each row of a bag.
+double bag_coefficient(size_t n, BagPooling pooling)
+{
+    return pooling == BagPooling::Mean ? 1.0 / static_cast<double>(n) : 1.0;
+}
+} // namespace
+
+
+Embedding::Embedding(size_t num_embeddings, size_t dim)
+    : _num_embeddings(num_embeddings), _dim(dim)
+{
+    if (num_embeddings == 0 || dim == 0)
+    {
+        throw std::invalid_argument("sizes should be positive");
+    }
+    const CounterRng rng(next_seed());
+    _table.resize(num_embeddings * dim);
+    for (size_t i = 0; i < _table.size(); i++)
+    {
+        _table[i] = rng.normal(i);
+    }
+}
+
+
+void Embedding::check_id(size_t id) const
+{
+    if (id >= _num_embeddings)
+    {
+        throw std::invalid_argument("id out of range");
+    }
+}
+
+
+size_t Embedding::materialize(size_t id)
+{
+    check_id(id);
+    const auto [it, inserted] = _slots.emplace(id, _touched.size());
+    if (inserted)
+    {
+        _touched.push_back(id);
+        // Constructed in place, so each leaf refers to itself.
+        for (size_t j = 0; j < _dim; j++)
+        {
+            _leaves.emplace_back(_table[id * _dim + j]);
+        }
+    }
+    return it->second;
+}
+
+
+std::vector<double> Embedding::row(size_t id) const
+{
+    check_id(id);
+    const auto first = _table.begin() + static_cast<long>(id * _dim);
+    return std::vector<double>(first, first + static_cast<long>(_dim));
+}
+
+
+std::vector<Variable> Embedding::forward(const std::vector<size_t> &ids)
+{
+    std::vector<Variable> result;
+    result.reserve(ids.size() * _dim);
+    for (const size_t id : ids)
+    {
+        const size_t slot = materialize(id);
+        // Copies keep the reference to their leaf.
+        for (size_t j = 0; j < _dim; j++)
+        {
+            result.push_back(_leaves[slot * _dim + j]);
+        }
+    }
+    return result;
+}
+
+
+std::vector<Variable> Embedding::forward(const std::vector<size_t> &ids,
+                                         BagPooling pooling)
+{
+    std::vector<Variable> result(_dim);
+    if (ids.empty())
+    {
+        return result;
+    }
+    std::vector<size_t> slots;
+    slots.reserve(ids.size());
+    for (const size_t id : ids)
+    {
+        slots.push_back(materialize(id));
+    }
+    const std::vector<double> coefficients(
+        ids.size(), bag_coefficient(ids.size(), pooling));
+    std::vector<Variable> column;
+    column.reserve(ids.size());
+    for (size_t j = 0; j < _dim; j++)
+    {
+        column.clear();
+        for (const size_t slot : slots)
+        {
+            column.push_back(_leaves[slot * _dim + j]);
+        }
+        result[j] = dot_product(column, coefficients);
+    }
+    return result;
+}
+
+
+std::vector<std::vector<Variable>>
+Embedding::forward(const std::vector<std::vector<size_t>> &bags,
+                   BagPooling pooling)
+{
+    std::vector<std::vector<Variable>> result;
+    result.reserve(bags.size());
+    for (const auto &bag : bags)
+    {
+        result.push_back(forward(bag, pooling));
+    }
+    return result;
+}
+
+
+std::vector<double> Embedding::predict(const std::vector<size_t> &ids) const
+{
+    std::vector<double> result;
+    result.reserve(ids.size() * _dim);
+    for (const size_t id : ids)
+    {
+        check_id(id);
+        const auto first = _table.begin() + static_cast<long>(id * _dim);
+        result.insert(result.end(), first, first + static_cast<long>(_dim));
+    }
+    return result;
+}
+
+
+std::vector<double> Embedding::predict(const std::vector<size_t> &ids,
+                                       BagPooling pooling) const
+{
+    std::vector<double> result(_dim, 0.0);
+    if (ids.empty())
+    {
+        return result;
+    }
+    const double coefficient = bag_coefficient(ids.size(), pooling);
+    for (const size_t id : ids)
+    {
+        check_id(id);
+        const double *row = _table.data() + id * _dim;
+        for (size_t j = 0; j < _dim; j++)
+        {
+            result[j] += coefficient * row[j];
+        }
+    }
+    return result;
+}
+
+
+SparseRowGradient Embedding::sparse_gradient() const
+{
+    std::vector<size_t> slots(_touched.size());
+    std::iota(slots.begin(), slots.end(), 0);
+    std::sort(slots.begin(), slots.end(), [this](size_t a, size_t b) {
+        return _touched[a] < _touched[b];
+    });
+
+    SparseRowGradient gradient;
+    gradient.dim = _dim;
+    gradient.rows.reserve(slots.size());
+    gradient.values.reserve(slots.size() * _dim);
+    for (const size_t slot : slots)
+    {
+        gradient.rows.push_back(_touched[slot]);
+        for (size_t j = 0; j < _dim; j++)
+        {
+            gradient.values.push_back(_leaves[slot * _dim + j].gradient());
+        }
+    }
+    return gradient;
+}
+
+
+void Embedding::zero_grad()
+{
+    for (auto &leaf : _leaves)
+    {
+        leaf.zero_grad();
+    }
+}
+
+
+void Embedding::gradient_descent(double learning_rate)
+{
+    for (size_t slot = 0; slot < _touched.size(); slot++)
+    {
+        double *row = _table.data() + _touched[slot] * _dim;
+        for (size_t j = 0; j < _dim; j++)
+        {
+            row[j] -= learning_rate * _leaves[slot * _dim + j].gradient();
+        }
+    }
+    release();
+}
+
+
+void Embedding::apply(const SparseRowGradient &gradient, double learning_rate)
+{
+    if (gradient.dim != _dim ||
+        gradient.values.size() != gradient.rows.size() * _dim)
+    {
+        throw std::invalid_argument("gradient does not match the table");
+    }
+    for (size_t i = 0; i < gradient.rows.size(); i++)
+    {
+        check_id(gradient.rows[i]);
+    }
+    for (size_t i = 0; i < gradient.rows.size(); i++)
+    {
+        const size_t id = gradient.rows[i];
+        double *row = _table.data() + id * _dim;
+        for (size_t j = 0; j < _dim; j++)
+        {
+            row[j] -= learning_rate * gradient.values[i * _dim + j];
+        }
+        const auto slot = _slots.find(id);
+        if (slot != _slots.end())
+        {
+            for (size_t j = 0; j < _dim; j++)
+            {
+                _leaves[slot->second * _dim + j].set_value(row[j]);
+            }
+        }
+    }
+}
+
+
+void Embedding::release()
+{
+    _slots.clear();
+    _touched.clear();
+    _leaves.clear();
+}
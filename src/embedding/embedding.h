@@ -0,0 +1,209 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "../variable/variable.h"
+
+/**
+ * @enum BagPooling
+ * How the rows of a bag of ids are reduced to one vector.
+ */
+enum class BagPooling
+{
+    Sum,  // The sum of the rows.
+    Mean, // The mean of the rows, zero for an empty bag.
+};
+
+/**
+ * @struct SparseRowGradient
+ * The gradient of an embedding table restricted to the rows it touched.
+ */
+struct SparseRowGradient
+{
+    size_t dim = 0;             // The length of a row.
+    std::vector<size_t> rows;   // The touched rows, in increasing order.
+    std::vector<double> values; // The gradient of each row, rows * dim.
+};
+
+/**
+ * @class Embedding
+ * This class represents an embedding table of `num_embeddings` rows of
+ * `dim` values, looked up by id instead of multiplied with a one-hot input.
+ *
+ * The table is a flat array of doubles. A row becomes `dim` leaf variables
+ * only when a forward pass looks it up, and stays so until the next update,
+ * so the graph, the gradient and the update of a step scale with the ids of
+ * the batch instead of the vocabulary. The leaves live in a deque whose
+ * elements never move, so the graph may refer to them while more rows are
+ * looked up.
+ */
+class Embedding
+{
+private:
+    size_t _num_embeddings;                    // The number of rows.
+    size_t _dim;                               // The length of a row.
+    std::vector<double> _table;                // The rows, row by row.
+    std::unordered_map<size_t, size_t> _slots; // The slot of each leaf row.
+    std::vector<size_t> _touched;              // The row of each slot.
+    std::deque<Variable> _leaves;              // dim leaves per slot.
+
+    /**
+     * Returns the leaves of a row, creating them on the first lookup.
+     * @param id The row.
+     * @return The slot of the row, whose leaves start at slot * dim.
+     * @throw std::invalid_argument if the id is not a row.
+     */
+    size_t materialize(size_t id);
+
+    /**
+     * Checks that an id is a row of the table.
+     * @param id The id.
+     * @throw std::invalid_argument if the id is not a row.
+     */
+    void check_id(size_t id) const;
+
+public:
+    /**
+     * Constructs a table whose values are drawn from N(0, 1).
+     * @param num_embeddings The number of rows.
+     * @param dim The length of a row.
+     * @throw std::invalid_argument if a size is zero.
+     */
+    Embedding(size_t num_embeddings, size_t dim);
+
+    Embedding(const Embedding &) = delete;
+    Embedding &operator=(const Embedding &) = delete;
+    Embedding(Embedding &&) = default;
+    Embedding &operator=(Embedding &&) = default;
+
+    /**
+     * Returns the number of rows.
+     * @return The number of rows.
+     */
+    size_t num_embeddings() const
+    {
+        return _num_embeddings;
+    }
+
+    /**
+     * Returns the length of a row.
+     * @return The length of a row.
+     */
+    size_t dim() const
+    {
+        return _dim;
+    }
+
+    /**
+     * Returns the table, laid out row by row.
+     * @return The num_embeddings * dim values.
+     * @note Rows looked up since the last update are not yet updated.
+     */
+    const std::vector<double> &table() const
+    {
+        return _table;
+    }
+
+    /**
+     * Returns the number of rows with leaves, i.e. touched since the last
+     * update.
+     * @return The number of touched rows.
+     */
+    size_t num_touched() const
+    {
+        return _touched.size();
+    }
+
+    /**
+     * Returns a row of the table.
+     * @param id The row.
+     * @return The dim values of the row.
+     * @throw std::invalid_argument if the id is not a row.
+     */
+    std::vector<double> row(size_t id) const;
+
+    /**
+     * Looks up rows on the graph.
+     * @param ids The rows.
+     * @return The rows, concatenated, ids.size() * dim outputs.
+     * @throw std::invalid_argument if an id is not a row.
+     */
+    std::vector<Variable> forward(const std::vector<size_t> &ids);
+
+    /**
+     * Looks up a bag of rows on the graph and pools them.
+     * @param ids The rows of the bag; repeated ids count repeatedly.
+     * @param pooling The sum or the mean.
+     * @return The dim pooled outputs, one node per output.
+     * @throw std::invalid_argument if an id is not a row.
+     */
+    std::vector<Variable> forward(const std::vector<size_t> &ids,
+                                  BagPooling pooling);
+
+    /**
+     * Looks up a batch of bags on the graph and pools each of them.
+     * @param bags The bags.
+     * @param pooling The sum or the mean.
+     * @return The dim pooled outputs of each bag.
+     * @throw std::invalid_argument if an id is not a row.
+     */
+    std::vector<std::vector<Variable>>
+    forward(const std::vector<std::vector<size_t>> &bags, BagPooling pooling);
+
+    /**
+     * Looks up rows without building a graph.
+     * @param ids The rows.
+     * @return The rows, concatenated.
+     * @throw std::invalid_argument if an id is not a row.
+     */
+    std::vector<double> predict(const std::vector<size_t> &ids) const;
+
+    /**
+     * Looks up and pools a bag of rows without building a graph.
+     * @param ids The rows of the bag.
+     * @param pooling The sum or the mean.
+     * @return The dim pooled values.
+     * @throw std::invalid_argument if an id is not a row.
+     */
+    std::vector<double> predict(const std::vector<size_t> &ids,
+                                BagPooling pooling) const;
+
+    /**
+     * Returns the gradient of the touched rows.
+     * @return The sparse gradient, rows in increasing order.
+     */
+    SparseRowGradient sparse_gradient() const;
+
+    /**
+     * Resets the gradient of the touched rows to zero.
+     */
+    void zero_grad();
+
+    /**
+     * Applies a step of gradient descent to the touched rows only, then
+     * releases their leaves. Rows that were not looked up are not read or
+     * written, which makes the update lazy: their gradient is zero.
+     * @param learning_rate The learning rate.
+     * @note The graph built on the released leaves must not be used again.
+     */
+    void gradient_descent(double learning_rate);
+
+    /**
+     * Applies a step of gradient descent with a sparse gradient computed
+     * elsewhere, e.g. merged from several workers. Touched rows keep their
+     * leaves, which take the new values.
+     * @param gradient The sparse gradient.
+     * @param learning_rate The learning rate.
+     * @throw std::invalid_argument if the length of the rows differs or a
+     * row is not in the table.
+     */
+    void apply(const SparseRowGradient &gradient, double learning_rate);
+
+    /**
+     * Releases the leaves of the touched rows without an update.
+     * @note The graph built on the released leaves must not be used again.
+     */
+    void release();
+};
@@ -0,0 +1,228 @@
+#include "execution_plan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace
+{
+PlanOp activation_op(const std::string &activate_function)
+{
+    if (activate_function == "relu")
+    {
+        return PlanOp::Relu;
+    }
+    if (activate_function == "sigmoid")
+    {
+        return PlanOp::Sigmoid;
+    }
+    if (activate_function == "tanh")
+    {
+        return PlanOp::Tanh;
+    }
+    if (activate_function == "identity")
+    {
+        return PlanOp::Identity;
+    }
+    throw std::runtime_error("unknown activation function");
+}
+} // namespace
+
+
+void ExecutionPlan::capture(MLP &mlp, size_t n_targets)
+{
+    invalidate();
+    const std::vector<Layer> &layers = mlp.layers();
+    if (layers.empty() || layers.back().n_out() != n_targets)
+    {
+        throw std::invalid_argument("invalid number of targets");
+    }
+
+    const std::vector<Variable> &parameters = mlp.parameters();
+    _parameters.reserve(parameters.size());
+    for (const auto &parameter : parameters)
+    {
+        _parameters.push_back(parameter.reference());
+    }
+
+    _n_inputs = layers.front().n_in();
+    _n_targets = n_targets;
+    _inputs_offset = parameters.size();
+    _targets_offset = _inputs_offset + _n_inputs;
+    size_t next_slot = _targets_offset + _n_targets;
+
+    // Parameters are laid out per neuron as its weights followed by its bias.
+    size_t parameter_slot = 0;
+    size_t layer_inputs = _inputs_offset;
+    for (const auto &layer : layers)
+    {
+        const PlanOp activation = activation_op(layer.activate_function());
+        const size_t layer_outputs = next_slot;
+        next_slot += layer.n_out();
+        for (size_t o = 0; o < layer.n_out(); o++)
+        {
+            const size_t weights = parameter_slot;
+            const size_t bias = weights + layer.n_in();
+            parameter_slot = bias + 1;
+
+            const size_t product = next_slot++;
+            const size_t sum = next_slot++;
+            _instructions.push_back(Instruction{PlanOp::DotProduct,
+                                                product,
+                                                weights,
+                                                layer_inputs,
+                                                layer.n_in()});
+            _instructions.push_back(
+                Instruction{PlanOp::Add, sum, product, bias, 2});
+            _instructions.push_back(
+                Instruction{activation, layer_outputs + o, sum, sum, 1});
+        }
+        layer_inputs = layer_outputs;
+    }
+    if (parameter_slot != parameters.size())
+    {
+        invalidate();
+        throw std::runtime_error("unexpected parameter layout");
+    }
+
+    _outputs_offset = layer_inputs;
+    _loss_slot = next_slot++;
+    _instructions.push_back(Instruction{PlanOp::MSELoss,
+                                        _loss_slot,
+                                        _outputs_offset,
+                                        _targets_offset,
+                                        n_targets});
+
+    const MappedAllocator<double> allocator(_memory_options);
+    _values = Buffer(next_slot, 0.0, allocator);
+    _gradients = Buffer(next_slot, 0.0, allocator);
+}
+
+
+void ExecutionPlan::invalidate()
+{
+    _instructions.clear();
+    _instructions.shrink_to_fit();
+    _parameters.clear();
+    _parameters.shrink_to_fit();
+    _values.clear();
+    _values.shrink_to_fit();
+    _gradients.clear();
+    _gradients.shrink_to_fit();
+    _n_inputs = 0;
+    _n_targets = 0;
+}
+
+
+double ExecutionPlan::replay(const std::vector<double> &inputs,
+                             const std::vector<double> &targets)
+{
+    if (!matches(inputs.size(), targets.size()))
+    {
+        throw std::invalid_argument(
+            "inputs and targets do not match the captured plan");
+    }
+
+    double *values = _values.data();
+    double *gradients = _gradients.data();
+    for (size_t i = 0; i < _parameters.size(); i++)
+    {
+        values[i] = _parameters[i]->value();
+    }
+    std::copy(inputs.begin(), inputs.end(), values + _inputs_offset);
+    std::copy(targets.begin(), targets.end(), values + _targets_offset);
+    std::fill(_gradients.begin(), _gradients.end(), 0.0);
+
+    for (const Instruction &ins : _instructions)
+    {
+        double &out = values[ins.output];
+        switch (ins.op)
+        {
+        case PlanOp::DotProduct:
+        {
+            double sum = 0;
+            for (size_t i = 0; i < ins.size; i++)
+            {
+                sum += values[ins.lhs + i] * values[ins.rhs + i];
+            }
+            out = sum;
+            break;
+        }
+        case PlanOp::Add:
+            out = values[ins.lhs] + values[ins.rhs];
+            break;
+        case PlanOp::Relu:
+            out = values[ins.lhs] > 0 ? values[ins.lhs] : 0;
+            break;
+        case PlanOp::Sigmoid:
+            out = 1 / (1 + std::exp(-values[ins.lhs]));
+            break;
+        case PlanOp::Tanh:
+            out = std::tanh(values[ins.lhs]);
+            break;
+        case PlanOp::Identity:
+            out = values[ins.lhs];
+            break;
+        case PlanOp::MSELoss:
+        {
+            double sum = 0;
+            for (size_t i = 0; i < ins.size; i++)
+            {
+                const double diff = values[ins.lhs + i] - values[ins.rhs + i];
+                sum += diff * diff;
+            }
+            out = sum / static_cast<double>(ins.size);
+            break;
+        }
+        }
+    }
+
+    gradients[_loss_slot] = 1.0;
+    for (auto it = _instructions.rbegin(); it != _instructions.rend(); ++it)
+    {
+        const Instruction &ins = *it;
+        const double out = values[ins.output];
+        const double grad = gradients[ins.output];
+        switch (ins.op)
+        {
+        case PlanOp::DotProduct:
+            for (size_t i = 0; i < ins.size; i++)
+            {
+                gradients[ins.lhs + i] += grad * values[ins.rhs + i];
+                gradients[ins.rhs + i] += grad * values[ins.lhs + i];
+            }
+            break;
+        case PlanOp::Add:
+            gradients[ins.lhs] += grad;
+            gradients[ins.rhs] += grad;
+            break;
+        case PlanOp::Relu:
+            gradients[ins.lhs] += values[ins.lhs] > 0 ? grad : 0;
+            break;
+        case PlanOp::Sigmoid:
+            gradients[ins.lhs] += grad * out * (1 - out);
+            break;
+        case PlanOp::Tanh:
+            gradients[ins.lhs] += grad * (1 - out * out);
+            break;
+        case PlanOp::Identity:
+            gradients[ins.lhs] += grad;
+            break;
+        case PlanOp::MSELoss:
+            // Matches MSELoss, which does not scale the gradient by 1 / size.
+            for (size_t i = 0; i < ins.size; i++)
+            {
+                gradients[ins.lhs + i] +=
+                    grad * 2.0 * (values[ins.lhs + i] - values[ins.rhs + i]);
+            }
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < _parameters.size(); i++)
+    {
+        _parameters[i]->update_gradient(gradients[i]);
+    }
+    return values[_loss_slot];
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../neural_network/mlp.h"
+#include "../numa/numa.h"
+
+/**
+ * @enum PlanOp
+ * The operations an execution plan can replay.
+ */
+enum class PlanOp : uint8_t
+{
+    DotProduct, // output = sum(lhs[i] * rhs[i]) for i < size.
+    Add,        // output = lhs + rhs.
+    Relu,       // output = relu(lhs).
+    Sigmoid,    // output = sigmoid(lhs).
+    Tanh,       // output = tanh(lhs).
+    Identity,   // output = lhs.
+    MSELoss,    // output = sum((lhs[i] - rhs[i])^2) / size for i < size.
+};
+
+/**
+ * @struct Instruction
+ * A single operation of an execution plan, addressing value slots by index.
+ */
+struct Instruction
+{
+    PlanOp op;     // The operation.
+    size_t output; // The slot of the result.
+    size_t lhs;    // The slot of the first operand.
+    size_t rhs;    // The slot of the second operand.
+    size_t size;   // The number of operand slots for n-ary operations.
+};
+
+/**
+ * @class ExecutionPlan
+ * This class captures the forward and backward pass of an MLP with MSELoss
+ * into a flat list of instructions over preallocated value and gradient
+ * slots. Replaying the plan for new inputs and targets builds no graph and
+ * performs no allocation; gradients are accumulated into the parameters of
+ * the captured MLP exactly as `loss.backward()` would.
+ * @note The plan keeps pointers to the parameters of the MLP, so it has to
+ * be captured again if the MLP is moved or destroyed.
+ */
+class ExecutionPlan
+{
+private:
+    using Buffer = std::vector<double, MappedAllocator<double>>;
+
+    std::vector<Instruction> _instructions; // The captured operations.
+    std::vector<Variable *> _parameters;    // The captured parameters.
+    Buffer _values;                         // The value of each slot.
+    Buffer _gradients;                      // The gradient of each slot.
+    MemoryOptions _memory_options;          // How the slots are mapped.
+    size_t _n_inputs = 0;                   // The number of inputs.
+    size_t _n_targets = 0;                  // The number of targets.
+    size_t _inputs_offset = 0;              // The first input slot.
+    size_t _targets_offset = 0;             // The first target slot.
+    size_t _outputs_offset = 0;             // The first prediction slot.
+    size_t _loss_slot = 0;                  // The slot of the loss.
+
+public:
+    /**
+     * Constructs an empty plan.
+     */
+    ExecutionPlan() = default;
+
+    /**
+     * Constructs a plan captured from an MLP.
+     * @param mlp The MLP to capture.
+     * @param n_targets The number of targets of the loss.
+     */
+    ExecutionPlan(MLP &mlp, size_t n_targets)
+    {
+        capture(mlp, n_targets);
+    }
+
+    /**
+     * Records the forward pass of the MLP followed by MSELoss.
+     * Any previously captured plan is replaced.
+     * @param mlp The MLP to capture.
+     * @param n_targets The number of targets of the loss.
+     */
+    void capture(MLP &mlp, size_t n_targets);
+
+    /**
+     * Drops the captured plan and releases its buffers.
+     */
+    void invalidate();
+
+    /**
+     * Sets how the value and gradient slots are mapped, e.g. on hugepages
+     * for large MLPs. Applies from the next capture.
+     * @param options The memory options.
+     */
+    void set_memory_options(const MemoryOptions &options)
+    {
+        _memory_options = options;
+    }
+
+    /**
+     * Returns how the value and gradient slots are mapped.
+     * @return The memory options.
+     */
+    const MemoryOptions &memory_options() const
+    {
+        return _memory_options;
+    }
+
+    /**
+     * Returns whether a plan has been captured.
+     * @return True if the plan can be replayed.
+     */
+    bool captured() const
+    {
+        return !_instructions.empty();
+    }
+
+    /**
+     * Returns whether the plan was captured for the given shapes.
+     * @param n_inputs The number of inputs.
+     * @param n_targets The number of targets.
+     * @return True if the plan can be replayed with these shapes.
+     */
+    bool matches(size_t n_inputs, size_t n_targets) const
+    {
+        return captured() && n_inputs == _n_inputs && n_targets == _n_targets;
+    }
+
+    /**
+     * Returns the captured instructions.
+     * @return The instructions in forward order.
+     */
+    const std::vector<Instruction> &instructions() const
+    {
+        return _instructions;
+    }
+
+    /**
+     * Returns a prediction of the last replay.
+     * @param i The index of the output.
+     * @return The predicted value.
+     */
+    double prediction(size_t i) const
+    {
+        return _values[_outputs_offset + i];
+    }
+
+    /**
+     * Replays the forward and backward pass for new inputs and targets.
+     * Gradients are accumulated into the parameters of the captured MLP.
+     * @param inputs The input values.
+     * @param targets The target values.
+     * @return The value of the loss.
+     */
+    double replay(const std::vector<double> &inputs,
+                  const std::vector<double> &targets);
+};
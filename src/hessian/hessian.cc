@@ -0,0 +1,171 @@
+#include "hessian.h"
+
+#include <cmath>
+#include <stdexcept>
+
+
+namespace
+{
+// The derivative of the activation as a dual number, so that its tangent
+// carries the second derivative along the seeded direction.
+Dual activation_slope(ActivationFunction activation,
+                      const Dual &preactivation,
+                      const Dual &activated)
+{
+    switch (activation)
+    {
+    case ActivationFunction::Relu:
+        return Dual(preactivation.value() > 0 ? 1 : 0);
+    case ActivationFunction::Sigmoid:
+        return activated * (1.0 - activated);
+    case ActivationFunction::Tanh:
+        return 1.0 - activated * activated;
+    case ActivationFunction::Identity:
+        return Dual(1);
+    case ActivationFunction::Gelu:
+    {
+        const double x = preactivation.value();
+        const double pdf = kInvSqrt2Pi * std::exp(-0.5 * x * x);
+        return Dual(activation_derivative(activation, x, activated.value()),
+                    preactivation.tangent() * pdf * (2 - x * x));
+    }
+    case ActivationFunction::Silu:
+    {
+        const Dual s = preactivation.sigmoid();
+        return s * (1.0 + preactivation * (1.0 - s));
+    }
+    case ActivationFunction::Softplus:
+        return preactivation.sigmoid();
+    }
+    throw std::runtime_error("unknown activation function");
+}
+
+
+void accumulate(const MLP &mlp,
+                const std::vector<double> &inputs,
+                const std::vector<double> &targets,
+                const std::vector<double> &v,
+                HessianVectorProduct &result)
+{
+    const std::vector<Layer> &layers = mlp.layers();
+    if (inputs.size() != layers.front().n_in())
+    {
+        throw std::invalid_argument("invalid number of inputs");
+    }
+    if (targets.size() != layers.back().n_out())
+    {
+        throw std::invalid_argument("invalid number of targets");
+    }
+
+    // Forward pass with the parameter tangents seeded by v. Parameters are
+    // laid out per neuron as its weights followed by its bias.
+    std::vector<std::vector<Dual>> activations(layers.size() + 1);
+    std::vector<std::vector<Dual>> preactivations(layers.size());
+    activations[0] = make_duals(inputs, std::vector<double>(inputs.size()));
+    size_t offset = 0;
+    for (size_t l = 0; l < layers.size(); l++)
+    {
+        const ActivationFunction activation =
+            parse_activation(layers[l].activate_function());
+        const std::vector<Dual> &in = activations[l];
+        std::vector<Dual> &z = preactivations[l];
+        z.resize(layers[l].n_out());
+        activations[l + 1].resize(layers[l].n_out());
+        const std::vector<Neuron> &neurons = layers[l].neurons();
+        for (size_t o = 0; o < neurons.size(); o++)
+        {
+            const std::vector<Variable> &weights = neurons[o].weights();
+            Dual sum(neurons[o].bias().value(), v[offset + weights.size()]);
+            for (size_t i = 0; i < weights.size(); i++)
+            {
+                sum += Dual(weights[i].value(), v[offset + i]) * in[i];
+            }
+            z[o] = sum;
+            activations[l + 1][o] = sum.activate(activation);
+            offset += weights.size() + 1;
+        }
+    }
+
+    // Backward pass on dual numbers: the values are the gradient and the
+    // tangents are H v.
+    const std::vector<Dual> &outputs = activations.back();
+    std::vector<Dual> grad(outputs.size());
+    double loss = 0;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        const Dual diff = outputs[i] - Dual(targets[i]);
+        loss += diff.value() * diff.value();
+        grad[i] = 2.0 * diff;
+    }
+    result.loss += loss / static_cast<double>(outputs.size());
+
+    for (size_t l = layers.size(); l-- > 0;)
+    {
+        const ActivationFunction activation =
+            parse_activation(layers[l].activate_function());
+        const std::vector<Neuron> &neurons = layers[l].neurons();
+        const std::vector<Dual> &in = activations[l];
+        std::vector<Dual> grad_in(in.size());
+        offset -= neurons.size() * (in.size() + 1);
+        size_t neuron_offset = offset;
+        for (size_t o = 0; o < neurons.size(); o++)
+        {
+            const Dual delta =
+                grad[o] * activation_slope(activation,
+                                           preactivations[l][o],
+                                           activations[l + 1][o]);
+            const std::vector<Variable> &weights = neurons[o].weights();
+            for (size_t i = 0; i < weights.size(); i++)
+            {
+                const Dual g = delta * in[i];
+                result.gradient[neuron_offset + i] += g.value();
+                result.product[neuron_offset + i] += g.tangent();
+                grad_in[i] += delta * Dual(weights[i].value(),
+                                           v[neuron_offset + i]);
+            }
+            result.gradient[neuron_offset + weights.size()] += delta.value();
+            result.product[neuron_offset + weights.size()] += delta.tangent();
+            neuron_offset += weights.size() + 1;
+        }
+        grad = std::move(grad_in);
+    }
+}
+} // namespace
+
+
+HessianVectorProduct hessian_vector_product(const MLP &mlp,
+                                            const std::vector<double> &inputs,
+                                            const std::vector<double> &targets,
+                                            const std::vector<double> &v)
+{
+    return hessian_vector_product(mlp,
+                                  std::vector<std::vector<double>>{inputs},
+                                  std::vector<std::vector<double>>{targets},
+                                  v);
+}
+
+
+HessianVectorProduct
+hessian_vector_product(const MLP &mlp,
+                       const std::vector<std::vector<double>> &inputs,
+                       const std::vector<std::vector<double>> &targets,
+                       const std::vector<double> &v)
+{
+    if (v.size() != mlp.parameters().size())
+    {
+        throw std::invalid_argument("invalid size of the vector");
+    }
+    if (inputs.size() != targets.size())
+    {
+        throw std::invalid_argument(
+            "inputs and targets should have same size");
+    }
+    HessianVectorProduct result;
+    result.gradient.assign(v.size(), 0.0);
+    result.product.assign(v.size(), 0.0);
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        accumulate(mlp, inputs[i], targets[i], v, result);
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "../dual/dual.h"
+#include "../neural_network/mlp.h"
+
+/**
+ * @struct HessianVectorProduct
+ * The loss, its gradient and a Hessian-vector product at the current
+ * parameters of an MLP. Gradients are ordered like `MLP::parameters()`.
+ */
+struct HessianVectorProduct
+{
+    double loss = 0;              // The value of the MSE loss.
+    std::vector<double> gradient; // The gradient of the loss.
+    std::vector<double> product;  // The Hessian of the loss times v.
+};
+
+/**
+ * Computes the exact Hessian-vector product of the MSE loss of an MLP with
+ * respect to its parameters by forward-over-reverse differentiation: the
+ * backward pass is evaluated on dual numbers whose tangents are seeded with
+ * v, so the tangent of the gradient is H v. The cost is about two gradient
+ * evaluations and no graph is built.
+ * @param mlp The MLP.
+ * @param inputs The input values.
+ * @param targets The target values.
+ * @param v The vector, one entry per parameter.
+ * @return The loss, the gradient and H v.
+ * @note The gradient matches the one `MSELoss(...).backward()` accumulates,
+ * so H is the derivative of that gradient.
+ * @throw std::invalid_argument if the sizes do not match the MLP.
+ */
+HessianVectorProduct hessian_vector_product(const MLP &mlp,
+                                            const std::vector<double> &inputs,
+                                            const std::vector<double> &targets,
+                                            const std::vector<double> &v);
+
+/**
+ * Computes the Hessian-vector product of the summed MSE loss over a batch.
+ * @param mlp The MLP.
+ * @param inputs The input values of each sample.
+ * @param targets The target values of each sample.
+ * @param v The vector, one entry per parameter.
+ * @return The summed loss, gradient and H v.
+ * @throw std::invalid_argument if the sizes do not match the MLP.
+ */
+HessianVectorProduct
+hessian_vector_product(const MLP &mlp,
+                       const std::vector<std::vector<double>> &inputs,
+                       const std::vector<std::vector<double>> &targets,
+                       const std::vector<double> &v);
@@ -0,0 +1,204 @@
+#include "initializer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+
+#include "../activation/activation.h"
+#include "../determinism/determinism.h"
+
+
+namespace
+{
+// Draws the weight at a position of the stream.
+double draw(const CounterRng &rng,
+            uint64_t counter,
+            InitScheme scheme,
+            size_t n_in,
+            size_t n_out)
+{
+    const double fan_in = static_cast<double>(n_in);
+    const double fan_sum = static_cast<double>(n_in + n_out);
+    switch (scheme)
+    {
+    case InitScheme::Uniform:
+        return 2.0 * rng.uniform(counter) - 1.0;
+    case InitScheme::XavierUniform:
+        return std::sqrt(6.0 / fan_sum) * (2.0 * rng.uniform(counter) - 1.0);
+    case InitScheme::XavierNormal:
+        return std::sqrt(2.0 / fan_sum) * rng.normal(counter);
+    case InitScheme::HeUniform:
+        return std::sqrt(6.0 / fan_in) * (2.0 * rng.uniform(counter) - 1.0);
+    case InitScheme::HeNormal:
+        return std::sqrt(2.0 / fan_in) * rng.normal(counter);
+    case InitScheme::Orthogonal:
+        return rng.normal(counter);
+    }
+    return 0.0;
+}
+
+
+// Fills the parameters of the neurons [begin, end).
+void fill(double *parameters,
+          size_t begin,
+          size_t end,
+          size_t n_in,
+          size_t n_out,
+          InitScheme scheme,
+          const CounterRng &rng)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const size_t offset = i * (n_in + 1);
+        for (size_t j = 0; j < n_in; j++)
+        {
+            parameters[offset + j] = draw(rng, offset + j, scheme, n_in, n_out);
+        }
+        parameters[offset + n_in] =
+            scheme == InitScheme::Uniform
+                ? 2.0 * rng.uniform(offset + n_in) - 1.0
+                : 0.0;
+    }
+}
+
+
+// Orthonormalizes `count` vectors of `length` elements with modified
+// Gram-Schmidt. Element j of vector i is at data[i * step + j * stride].
+void orthonormalize(double *data,
+                    size_t count,
+                    size_t length,
+                    size_t step,
+                    size_t stride)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double *v = data + i * step;
+        for (size_t k = 0; k < i; k++)
+        {
+            const double *u = data + k * step;
+            double dot = 0.0;
+            for (size_t j = 0; j < length; j++)
+            {
+                dot += u[j * stride] * v[j * stride];
+            }
+            for (size_t j = 0; j < length; j++)
+            {
+                v[j * stride] -= dot * u[j * stride];
+            }
+        }
+        double norm = 0.0;
+        for (size_t j = 0; j < length; j++)
+        {
+            norm += v[j * stride] * v[j * stride];
+        }
+        norm = std::sqrt(norm);
+        if (norm == 0.0)
+        {
+            throw std::runtime_error("degenerate orthogonal initialization");
+        }
+        for (size_t j = 0; j < length; j++)
+        {
+            v[j * stride] /= norm;
+        }
+    }
+}
+} // namespace
+
+
+InitScheme parse_init_scheme(const std::string &name)
+{
+    if (name == "uniform")
+    {
+        return InitScheme::Uniform;
+    }
+    if (name == "xavier_uniform")
+    {
+        return InitScheme::XavierUniform;
+    }
+    if (name == "xavier_normal")
+    {
+        return InitScheme::XavierNormal;
+    }
+    if (name == "he_uniform")
+    {
+        return InitScheme::HeUniform;
+    }
+    if (name == "he_normal")
+    {
+        return InitScheme::HeNormal;
+    }
+    if (name == "orthogonal")
+    {
+        return InitScheme::Orthogonal;
+    }
+    throw std::invalid_argument("unknown initialization scheme: " + name);
+}
+
+
+uint64_t CounterRng::bits(uint64_t counter) const
+{
+    return splitmix64(_key ^ splitmix64(counter));
+}
+
+
+double CounterRng::uniform(uint64_t counter) const
+{
+    // The top 53 bits fill the mantissa of a double exactly.
+    return static_cast<double>(bits(counter) >> 11) * 0x1.0p-53;
+}
+
+
+double CounterRng::normal(uint64_t counter) const
+{
+    // Box-Muller on (0, 1] x [0, 1), keeping the cosine branch only so that
+    // every position is independent of the others.
+    const double u = 1.0 - uniform(2 * counter);
+    const double v = uniform(2 * counter + 1);
+    return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * kPi * v);
+}
+
+
+void initialize_layer(double *parameters,
+                      size_t n_in,
+                      size_t n_out,
+                      InitScheme scheme,
+                      uint64_t stream,
+                      ThreadPool *pool)
+{
+    const CounterRng rng(stream);
+    if (pool == nullptr || pool->size() < 2 || n_out < 2)
+    {
+        fill(parameters, 0, n_out, n_in, n_out, scheme, rng);
+    }
+    else
+    {
+        const size_t chunks = std::min(pool->size(), n_out);
+        const size_t share = (n_out + chunks - 1) / chunks;
+        std::vector<std::future<void>> done;
+        done.reserve(chunks);
+        for (size_t begin = 0; begin < n_out; begin += share)
+        {
+            const size_t end = std::min(n_out, begin + share);
+            done.push_back(pool->submit([=, &rng]() {
+                fill(parameters, begin, end, n_in, n_out, scheme, rng);
+            }));
+        }
+        for (auto &future : done)
+        {
+            future.get();
+        }
+    }
+
+    if (scheme == InitScheme::Orthogonal && n_in > 0 && n_out > 0)
+    {
+        if (n_out <= n_in)
+        {
+            orthonormalize(parameters, n_out, n_in, n_in + 1, 1);
+        }
+        else
+        {
+            orthonormalize(parameters, n_in, n_out, 1, n_in + 1);
+        }
+    }
+}
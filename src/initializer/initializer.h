@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../parallel/parallel.h"
+
+/**
+ * @enum InitScheme
+ * How the weights of a layer with n_in inputs and n_out outputs are drawn.
+ */
+enum class InitScheme
+{
+    Uniform,       // Weights and biases from U(-1, 1).
+    XavierUniform, // U(-a, a) with a = sqrt(6 / (n_in + n_out)).
+    XavierNormal,  // N(0, 2 / (n_in + n_out)).
+    HeUniform,     // U(-a, a) with a = sqrt(6 / n_in).
+    HeNormal,      // N(0, 2 / n_in).
+    Orthogonal,    // Orthonormal rows, or columns if n_out > n_in.
+};
+
+/**
+ * Parses the name of an initialization scheme, e.g. "xavier_uniform".
+ * @param name The name in snake case.
+ * @return The scheme.
+ * @throw std::invalid_argument if the name is unknown.
+ */
+InitScheme parse_init_scheme(const std::string &name);
+
+/**
+ * @class CounterRng
+ * This class represents a counter-based random number generator: the n-th
+ * number of a stream is a hash of the stream key and n, so any range of a
+ * stream can be drawn by any thread without shared state.
+ */
+class CounterRng
+{
+private:
+    uint64_t _key; // The stream key.
+
+public:
+    /**
+     * Constructs a stream.
+     * @param key The stream key.
+     */
+    explicit CounterRng(uint64_t key) : _key(key){};
+
+    /**
+     * Returns the random bits at a position of the stream.
+     * @param counter The position.
+     * @return 64 random bits.
+     */
+    uint64_t bits(uint64_t counter) const;
+
+    /**
+     * Returns a uniform number at a position of the stream.
+     * @param counter The position.
+     * @return A number in [0, 1).
+     */
+    double uniform(uint64_t counter) const;
+
+    /**
+     * Returns a standard normal number at a position of the stream.
+     * @param counter The position; uses the bits of 2 * counter and
+     * 2 * counter + 1.
+     * @return A number drawn from N(0, 1).
+     */
+    double normal(uint64_t counter) const;
+};
+
+/**
+ * Fills the parameters of a layer, laid out per neuron as its weights
+ * followed by its bias. Every value depends only on the stream and its
+ * position, so the result is the same with or without a pool. Biases are
+ * zero except for `InitScheme::Uniform`.
+ * @param parameters The n_out * (n_in + 1) parameters.
+ * @param n_in The number of inputs.
+ * @param n_out The number of outputs.
+ * @param scheme The initialization scheme.
+ * @param stream The key of the layer's random stream, e.g. `next_seed()`.
+ * @param pool Fills the neurons in parallel if given. The orthogonalization
+ * of `InitScheme::Orthogonal` runs on the calling thread.
+ */
+void initialize_layer(double *parameters,
+                      size_t n_in,
+                      size_t n_out,
+                      InitScheme scheme,
+                      uint64_t stream,
+                      ThreadPool *pool = nullptr);
@@ -1,9 +1,66 @@
 #include "layer.h"
 
 
+namespace
+{
+// Moves the output of each neuron into place. Outputs of the right size are
+// assigned, so their vector and the child arrays they free are reused.
+template <typename Inputs>
+void forward_neurons(std::vector<Neuron> &neurons,
+                     const Inputs &inputs,
+                     std::vector<Variable> &outputs)
+{
+    if (outputs.size() != neurons.size())
+    {
+        outputs.clear();
+        outputs.reserve(neurons.size());
+        for (auto &neuron : neurons)
+        {
+            outputs.push_back(neuron.forward(inputs));
+        }
+        return;
+    }
+    for (size_t i = 0; i < neurons.size(); ++i)
+    {
+        outputs[i] = neurons[i].forward(inputs);
+    }
+}
+} // namespace
+
+
 std::vector<Variable> Layer::forward(const std::vector<double> &inputs)
 {
-    std::vector<Variable> result(_n_out);
+    std::vector<Variable> result;
+    forward_neurons(_neurons, inputs, result);
+    return result;
+}
+
+
+std::vector<Variable> Layer::forward(const std::vector<Variable> &variables)
+{
+    std::vector<Variable> result;
+    forward_neurons(_neurons, variables, result);
+    return result;
+}
+
+
+void Layer::forward(const std::vector<double> &inputs,
+                    std::vector<Variable> &outputs)
+{
+    forward_neurons(_neurons, inputs, outputs);
+}
+
+
+void Layer::forward(const std::vector<Variable> &variables,
+                    std::vector<Variable> &outputs)
+{
+    forward_neurons(_neurons, variables, outputs);
+}
+
+
+std::vector<Dual> Layer::forward(const std::vector<Dual> &inputs) const
+{
+    std::vector<Dual> result(_n_out);
     for (size_t i = 0; i < _n_out; ++i)
     {
         result[i] = _neurons[i].forward(inputs);
@@ -12,12 +69,100 @@ std::vector<Variable> Layer::forward(const std::vector<double> &inputs)
 }
 
 
-std::vector<Variable> Layer::forward(const std::vector<Variable> &variables)
+std::vector<Variable> Layer::forward(const SparseVector &inputs)
+{
+    std::vector<Variable> result;
+    forward_neurons(_neurons, inputs, result);
+    return result;
+}
+
+
+void Layer::set_activation_mode(ActivationMode mode)
+{
+    _activation_mode = mode;
+    for (auto &neuron : _neurons)
+    {
+        neuron.set_activation_mode(mode);
+    }
+}
+
+
+std::vector<double> Layer::predict(const std::vector<double> &inputs) const
 {
-    std::vector<Variable> result(_n_out);
+    if (inputs.size() != _n_in)
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    std::vector<double> result(_n_out);
+    for (size_t i = 0; i < _n_out; ++i)
+    {
+        const std::vector<Variable> &weights = _neurons[i].weights();
+        double preactivation = _neurons[i].bias().value();
+        for (size_t j = 0; j < _n_in; ++j)
+        {
+            preactivation += weights[j].value() * inputs[j];
+        }
+        result[i] = preactivation;
+    }
+    batch_activate(
+        parse_activation(_activate_function), result, _activation_mode);
+    return result;
+}
+
+
+std::vector<double> Layer::predict(const SparseVector &inputs) const
+{
+    if (inputs.size() != _n_in)
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    const std::vector<size_t> &indices = inputs.indices();
+    const std::vector<double> &values = inputs.values();
+    std::vector<double> result(_n_out);
+    for (size_t i = 0; i < _n_out; ++i)
+    {
+        const std::vector<Variable> &weights = _neurons[i].weights();
+        double preactivation = _neurons[i].bias().value();
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+            preactivation += weights[indices[k]].value() * values[k];
+        }
+        result[i] = preactivation;
+    }
+    batch_activate(
+        parse_activation(_activate_function), result, _activation_mode);
+    return result;
+}
+
+
+std::vector<double> Layer::predict(const std::vector<double> &inputs,
+                                   size_t n) const
+{
+    if (inputs.size() != _n_in * n)
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    std::vector<double> result(_n_out * n);
+    std::vector<double> weights(_n_in);
     for (size_t i = 0; i < _n_out; ++i)
     {
-        result[i] = _neurons[i].forward(variables);
+        for (size_t j = 0; j < _n_in; ++j)
+        {
+            weights[j] = _neurons[i].weights()[j].value();
+        }
+        const double bias = _neurons[i].bias().value();
+        for (size_t b = 0; b < n; ++b)
+        {
+            const double *sample = inputs.data() + b * _n_in;
+            double preactivation = bias;
+            for (size_t j = 0; j < _n_in; ++j)
+            {
+                preactivation += weights[j] * sample[j];
+            }
+            result[b * _n_out + i] = preactivation;
+        }
     }
+    batch_activate(
+        parse_activation(_activate_function), result, _activation_mode);
     return result;
 }
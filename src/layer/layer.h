@@ -17,27 +17,66 @@ private:
         "tanh";                        // The activation function of the layer.
     std::vector<Neuron> _neurons;      // The neurons in the layer.
     std::vector<Variable> _parameters; // All parameters of the layer.
+    ActivationMode _activation_mode = ActivationMode::Exact; // The kernel mode.
 
-public:
     /**
-     * Constructs a layer with the specified number of input and output connections, and activation function.
-     * @param n_in The number of input connections.
-     * @param n_out The number of output connections.
-     * @param activate_function The activation function of the layer. Default is "tanh".
+     * Builds the neurons from their parameters.
+     * @param values The weights and the bias of each neuron in turn.
      */
-    Layer(size_t n_in, size_t n_out, std::string activate_function = "tanh")
-        : _n_in(n_in), _n_out(n_out), _activate_function(activate_function)
+    void add_neurons(const double *values)
     {
-        _parameters.reserve((n_in + 1) * n_out);
-        _neurons.reserve(n_out);
-        for (size_t i = 0; i < n_out; i++)
+        _parameters.reserve((_n_in + 1) * _n_out);
+        _neurons.reserve(_n_out);
+        for (size_t i = 0; i < _n_out; i++)
         {
-            _neurons.emplace_back(n_in, _activate_function);
+            const double *neuron_values = values + i * (_n_in + 1);
+            _neurons.emplace_back(
+                neuron_values, _n_in, neuron_values[_n_in], _activate_function);
             for (size_t j = 0; j < _neurons[i].parameters().size(); j++)
             {
                 _parameters.push_back(_neurons[i].parameters()[j]);
             }
         }
+    }
+
+public:
+    /**
+     * Constructs a layer with the specified number of input and output connections, and activation function.
+     * @param n_in The number of input connections.
+     * @param n_out The number of output connections.
+     * @param activate_function The activation function of the layer. Default is "tanh".
+     * @param scheme The initialization of the parameters, drawn from one
+     * `next_seed()` stream per layer. Default is U(-1, 1).
+     * @param pool Draws the parameters in parallel if given.
+     */
+    Layer(size_t n_in,
+          size_t n_out,
+          std::string activate_function = "tanh",
+          InitScheme scheme = InitScheme::Uniform,
+          ThreadPool *pool = nullptr)
+        : _n_in(n_in), _n_out(n_out), _activate_function(activate_function)
+    {
+        std::vector<double> values((n_in + 1) * n_out);
+        initialize_layer(values.data(), n_in, n_out, scheme, next_seed(), pool);
+        add_neurons(values.data());
+    };
+
+    /**
+     * Constructs a layer with the given parameters, e.g. from a checkpoint,
+     * without drawing random weights.
+     * @param n_in The number of input connections.
+     * @param n_out The number of output connections.
+     * @param values The (n_in + 1) * n_out parameters, the weights and the
+     * bias of each neuron in turn.
+     * @param activate_function The activation function of the layer.
+     */
+    Layer(size_t n_in,
+          size_t n_out,
+          const double *values,
+          std::string activate_function = "tanh")
+        : _n_in(n_in), _n_out(n_out), _activate_function(activate_function)
+    {
+        add_neurons(values);
     };
 
     /**
@@ -47,7 +86,7 @@ public:
     Layer(const Layer &other)
         : _n_in(other._n_in), _n_out(other._n_out),
           _activate_function(other._activate_function),
-          _neurons(other._neurons){};
+          _neurons(other._neurons), _activation_mode(other._activation_mode){};
 
     /**
      * Copy assignment operator.
@@ -60,12 +99,15 @@ public:
         _n_out = other._n_out;
         _activate_function = other._activate_function;
         _neurons = other._neurons;
+        _activation_mode = other._activation_mode;
         return *this;
     }
 
     /**
-     * Move constructor.
-     * @param other The layer to be moved.
+     * Move assignment operator. The neurons keep their addresses, so the
+     * parameters stay valid.
+     * @param other The layer to be assigned.
+     * @return A reference to the assigned layer.
      */
     Layer &operator=(Layer &&other) noexcept
     {
@@ -73,22 +115,66 @@ public:
         _n_out = other._n_out;
         _activate_function = std::move(other._activate_function);
         _neurons = std::move(other._neurons);
+        _parameters = std::move(other._parameters);
+        _activation_mode = other._activation_mode;
         return *this;
     }
 
     /**
-     * Move assignment operator.
-     * @param other The layer to be assigned.
-     * @return A reference to the assigned layer.
+     * Move constructor. The neurons keep their addresses, so the parameters
+     * stay valid.
+     * @param other The layer to be moved.
      */
     Layer(Layer &&other) noexcept
+        : _n_in(other._n_in), _n_out(other._n_out),
+          _activate_function(std::move(other._activate_function)),
+          _neurons(std::move(other._neurons)),
+          _parameters(std::move(other._parameters)),
+          _activation_mode(other._activation_mode){};
+
+    /**
+     * Returns the number of input connections to the layer.
+     * @return The number of inputs.
+     */
+    size_t n_in() const
     {
-        _n_in = other._n_in;
-        _n_out = other._n_out;
-        _activate_function = std::move(other._activate_function);
-        _neurons = std::move(other._neurons);
+        return _n_in;
+    }
+
+    /**
+     * Returns the number of output connections from the layer.
+     * @return The number of outputs.
+     */
+    size_t n_out() const
+    {
+        return _n_out;
     }
 
+    /**
+     * Returns the activation function of the layer.
+     * @return The name of the activation function.
+     */
+    const std::string &activate_function() const
+    {
+        return _activate_function;
+    }
+
+    /**
+     * Returns whether the layer uses the exact or the fast activation kernel.
+     * @return The activation mode.
+     */
+    ActivationMode activation_mode() const
+    {
+        return _activation_mode;
+    }
+
+    /**
+     * Sets whether the layer and all its neurons use the exact or the fast
+     * activation kernel.
+     * @param mode The activation mode.
+     */
+    void set_activation_mode(ActivationMode mode);
+
     /**
      * Returns all parameters of the layer, including parameters of all neurons.
      * @return The parameters.
@@ -120,4 +206,62 @@ public:
      * @return The output values of the layer as a vector of Variables.
      */
     std::vector<Variable> forward(const std::vector<Variable> &variables);
+
+    /**
+     * Computes the forward pass of the layer into the outputs of a previous
+     * pass, reusing their storage.
+     * @param inputs The input values.
+     * @param outputs The output values of the layer, resized if needed.
+     */
+    void forward(const std::vector<double> &inputs,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the forward pass of the layer into the outputs of a previous
+     * pass, reusing their storage.
+     * @param variables The input variables.
+     * @param outputs The output values of the layer, resized if needed.
+     */
+    void forward(const std::vector<Variable> &variables,
+                 std::vector<Variable> &outputs);
+
+    /**
+     * Computes the forward pass of the layer on dual numbers.
+     * @param inputs The input dual numbers.
+     * @return The output dual numbers of the layer.
+     */
+    std::vector<Dual> forward(const std::vector<Dual> &inputs) const;
+
+    /**
+     * Computes the forward pass of the layer given a sparse input.
+     * @param inputs The sparse input.
+     * @return The output values of the layer as a vector of Variables.
+     */
+    std::vector<Variable> forward(const SparseVector &inputs);
+
+    /**
+     * Computes the output values of the layer without building a graph.
+     * The activation is applied to all outputs at once with batch_activate.
+     * @param inputs The input values.
+     * @return The output values of the layer.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+
+    /**
+     * Computes the output values of the layer for a sparse input without
+     * building a graph.
+     * @param inputs The sparse input.
+     * @return The output values of the layer.
+     */
+    std::vector<double> predict(const SparseVector &inputs) const;
+
+    /**
+     * Computes the output values of the layer for a batch of inputs without
+     * building a graph. The weights of each neuron are read once per batch.
+     * @param inputs The row-major input values, n x n_in.
+     * @param n The number of samples.
+     * @return The row-major output values, n x n_out.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs,
+                                size_t n) const;
 };
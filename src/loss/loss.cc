@@ -1,28 +1,299 @@
 #include "loss.h"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
-Variable MSELoss(const std::vector<Variable> &predictions,
-                 const std::vector<double> &targets)
+
+namespace
+{
+// The coefficients captured by a loss node, kept in the node pool.
+using Coefficients = std::vector<double, PoolAllocator<double>>;
+
+
+// Builds a loss node whose backward pass scales precomputed coefficients,
+// so the closure keeps neither the targets nor any intermediate values. The
+// name is a literal, so it is interned rather than copied into each node.
+template <size_t N>
+Variable loss_node(double value,
+                   Variable::Children children,
+                   Coefficients coefficients,
+                   const char (&name)[N])
+{
+    Variable result(value, 0.0, "", name);
+    result.mutable_children() = std::move(children);
+    result.set_backward([coefficients = std::move(coefficients)](
+                            Variable *node) {
+        Variable::Children &inputs = node->mutable_children();
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i].update_gradient(node->gradient() * coefficients[i]);
+        }
+    });
+    return result;
+}
+
+
+void check_sizes(size_t predictions, size_t targets)
 {
-    size_t n = predictions.size();
+    if (predictions != targets)
+    {
+        throw std::invalid_argument(
+            "predictions and targets should have same size");
+    }
+}
+
+
+// Each per-sample kernel returns the loss of the sample and appends the
+// derivative of `scale` times that loss to `coefficients`.
+double mse_terms(const std::vector<Variable> &predictions,
+                 const std::vector<double> &targets,
+                 double scale,
+                 Coefficients &coefficients)
+{
+    check_sizes(predictions.size(), targets.size());
     double value = 0;
+    for (size_t i = 0; i < predictions.size(); i++)
+    {
+        const double diff = predictions[i].value() - targets[i];
+        value += diff * diff;
+        // Matches the original MSELoss, whose gradient is not scaled by 1 / n.
+        coefficients.push_back(scale * 2.0 * diff);
+    }
+    return value / static_cast<double>(predictions.size());
+}
+
+
+double softmax_cross_entropy_terms(const std::vector<Variable> &logits,
+                                   size_t target,
+                                   double scale,
+                                   Coefficients &coefficients)
+{
+    if (target >= logits.size())
+    {
+        throw std::invalid_argument("target class out of range");
+    }
+    const size_t n = logits.size();
+    const size_t first = coefficients.size();
+    coefficients.resize(first + n);
+    double *shifted = coefficients.data() + first;
+
+    double max_logit = logits[0].value();
+    for (size_t i = 1; i < n; i++)
+    {
+        max_logit = std::max(max_logit, logits[i].value());
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        shifted[i] = logits[i].value() - max_logit;
+    }
+    batch_exp(shifted, shifted, n);
+    double sum = 0;
     for (size_t i = 0; i < n; i++)
     {
-        value += (predictions[i].value() - targets[i]) *
-                 (predictions[i].value() - targets[i]);
+        sum += shifted[i];
+    }
+
+    const double log_sum_exp = max_logit + std::log(sum);
+    for (size_t i = 0; i < n; i++)
+    {
+        shifted[i] = scale * (shifted[i] / sum - (i == target ? 1.0 : 0.0));
+    }
+    return log_sum_exp - logits[target].value();
+}
+
+
+double bce_with_logits_terms(const std::vector<Variable> &logits,
+                             const std::vector<double> &targets,
+                             double scale,
+                             Coefficients &coefficients)
+{
+    check_sizes(logits.size(), targets.size());
+    const double n = static_cast<double>(logits.size());
+    double value = 0;
+    for (size_t i = 0; i < logits.size(); i++)
+    {
+        const double x = logits[i].value();
+        value += std::max(x, 0.0) - x * targets[i] +
+                 std::log1p(std::exp(-std::fabs(x)));
+        const double probability = activate(ActivationFunction::Sigmoid, x);
+        coefficients.push_back(scale * (probability - targets[i]) / n);
     }
-    value /= static_cast<double>(n);
+    return value / n;
+}
+
 
-    Variable result(value, 0.0, "", "MSELoss");
-    result.set_children(predictions);
-    result.set_backward([targets](Variable *result) {
-        for (size_t i = 0; i < result->children().size(); i++)
+double huber_terms(const std::vector<Variable> &predictions,
+                   const std::vector<double> &targets,
+                   double delta,
+                   double scale,
+                   Coefficients &coefficients)
+{
+    check_sizes(predictions.size(), targets.size());
+    const double n = static_cast<double>(predictions.size());
+    double value = 0;
+    for (size_t i = 0; i < predictions.size(); i++)
+    {
+        const double diff = predictions[i].value() - targets[i];
+        const double magnitude = std::fabs(diff);
+        if (magnitude <= delta)
         {
-            Variable &child = result->mutable_children()[i];
-            child.update_gradient(result->gradient() * 2.0 *
-                                  (child.value() - targets[i]));
+            value += 0.5 * diff * diff;
+            coefficients.push_back(scale * diff / n);
         }
-    });
+        else
+        {
+            value += delta * (magnitude - 0.5 * delta);
+            coefficients.push_back(scale * std::copysign(delta, diff) / n);
+        }
+    }
+    return value / n;
+}
 
-    return result;
+
+void check_delta(double delta)
+{
+    if (!(delta > 0))
+    {
+        throw std::invalid_argument("delta should be positive");
+    }
+}
+
+
+template <typename Target, typename Terms, size_t N>
+Variable batch_loss(const std::vector<std::vector<Variable>> &predictions,
+                    const std::vector<Target> &targets,
+                    Terms terms,
+                    const char (&name)[N])
+{
+    if (predictions.empty() || predictions.size() != targets.size())
+    {
+        throw std::invalid_argument(
+            "batch of predictions and targets should have same nonzero size");
+    }
+    size_t total = 0;
+    for (const auto &sample : predictions)
+    {
+        total += sample.size();
+    }
+    Variable::Children children;
+    Coefficients coefficients;
+    children.reserve(total);
+    coefficients.reserve(total);
+
+    const double scale = 1.0 / static_cast<double>(predictions.size());
+    double value = 0;
+    for (size_t b = 0; b < predictions.size(); b++)
+    {
+        value += terms(predictions[b], targets[b], scale, coefficients);
+        children.append(predictions[b].begin(), predictions[b].end());
+    }
+    return loss_node(value * scale,
+                     std::move(children),
+                     std::move(coefficients),
+                     name);
+}
+} // namespace
+
+
+Variable MSELoss(const std::vector<Variable> &predictions,
+                 const std::vector<double> &targets)
+{
+    Coefficients coefficients;
+    coefficients.reserve(predictions.size());
+    const double value = mse_terms(predictions, targets, 1.0, coefficients);
+    return loss_node(value,
+                     Variable::Children(predictions.begin(), predictions.end()),
+                     std::move(coefficients),
+                     "MSELoss");
+}
+
+
+Variable MSELoss(const std::vector<std::vector<Variable>> &predictions,
+                 const std::vector<std::vector<double>> &targets)
+{
+    return batch_loss(predictions, targets, mse_terms, "MSELoss");
+}
+
+
+Variable SoftmaxCrossEntropyLoss(const std::vector<Variable> &logits,
+                                 size_t target)
+{
+    Coefficients coefficients;
+    coefficients.reserve(logits.size());
+    const double value =
+        softmax_cross_entropy_terms(logits, target, 1.0, coefficients);
+    return loss_node(value,
+                     Variable::Children(logits.begin(), logits.end()),
+                     std::move(coefficients),
+                     "SoftmaxCrossEntropyLoss");
+}
+
+
+Variable
+SoftmaxCrossEntropyLoss(const std::vector<std::vector<Variable>> &logits,
+                        const std::vector<size_t> &targets)
+{
+    return batch_loss(logits,
+                      targets,
+                      softmax_cross_entropy_terms,
+                      "SoftmaxCrossEntropyLoss");
+}
+
+
+Variable BCEWithLogitsLoss(const std::vector<Variable> &logits,
+                           const std::vector<double> &targets)
+{
+    Coefficients coefficients;
+    coefficients.reserve(logits.size());
+    const double value =
+        bce_with_logits_terms(logits, targets, 1.0, coefficients);
+    return loss_node(value,
+                     Variable::Children(logits.begin(), logits.end()),
+                     std::move(coefficients),
+                     "BCEWithLogitsLoss");
+}
+
+
+Variable BCEWithLogitsLoss(const std::vector<std::vector<Variable>> &logits,
+                           const std::vector<std::vector<double>> &targets)
+{
+    return batch_loss(logits,
+                      targets,
+                      bce_with_logits_terms,
+                      "BCEWithLogitsLoss");
+}
+
+
+Variable HuberLoss(const std::vector<Variable> &predictions,
+                   const std::vector<double> &targets,
+                   double delta)
+{
+    check_delta(delta);
+    Coefficients coefficients;
+    coefficients.reserve(predictions.size());
+    const double value =
+        huber_terms(predictions, targets, delta, 1.0, coefficients);
+    return loss_node(value,
+                     Variable::Children(predictions.begin(), predictions.end()),
+                     std::move(coefficients),
+                     "HuberLoss");
+}
+
+
+Variable HuberLoss(const std::vector<std::vector<Variable>> &predictions,
+                   const std::vector<std::vector<double>> &targets,
+                   double delta)
+{
+    check_delta(delta);
+    return batch_loss(
+        predictions,
+        targets,
+        [delta](const std::vector<Variable> &sample,
+                const std::vector<double> &target,
+                double scale,
+                Coefficients &coefficients) {
+            return huber_terms(sample, target, delta, scale, coefficients);
+        },
+        "HuberLoss");
 }
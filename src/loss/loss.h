@@ -11,3 +11,83 @@
  */
 Variable MSELoss(const std::vector<Variable> &predictions,
                  const std::vector<double> &targets);
+
+/**
+ * Calculates the MSE loss of a batch as the mean of the per-sample MSELoss.
+ * @param predictions The predicted values of each sample.
+ * @param targets The target values of each sample.
+ * @return The mean loss, one Variable over all predictions of the batch.
+ * @throw std::invalid_argument if the shapes do not match.
+ */
+Variable MSELoss(const std::vector<std::vector<Variable>> &predictions,
+                 const std::vector<std::vector<double>> &targets);
+
+/**
+ * Calculates the softmax cross-entropy loss of a vector of logits.
+ * The value uses a numerically stable log-sum-exp and the backward pass is a
+ * single fused step, gradient * (softmax(logits) - onehot(target)).
+ * @param logits The unnormalized log-probabilities.
+ * @param target The index of the true class.
+ * @return The calculated loss as a Variable.
+ * @throw std::invalid_argument if the target is out of range.
+ */
+Variable SoftmaxCrossEntropyLoss(const std::vector<Variable> &logits,
+                                 size_t target);
+
+/**
+ * Calculates the mean softmax cross-entropy loss of a batch of logits.
+ * @param logits The logits of each sample.
+ * @param targets The index of the true class of each sample.
+ * @return The mean loss as a single Variable whose children are all logits.
+ * @throw std::invalid_argument if the shapes do not match.
+ */
+Variable
+SoftmaxCrossEntropyLoss(const std::vector<std::vector<Variable>> &logits,
+                        const std::vector<size_t> &targets);
+
+/**
+ * Calculates the mean binary cross-entropy of sigmoid(logits) and targets.
+ * Computed from the logits as max(x, 0) - x * t + log(1 + exp(-|x|)), which
+ * never overflows, with the fused gradient (sigmoid(x) - t) / n.
+ * @param logits The logits.
+ * @param targets The target probabilities in [0, 1].
+ * @return The calculated loss as a Variable.
+ * @throw std::invalid_argument if the sizes do not match.
+ */
+Variable BCEWithLogitsLoss(const std::vector<Variable> &logits,
+                           const std::vector<double> &targets);
+
+/**
+ * Calculates the mean binary cross-entropy with logits of a batch.
+ * @param logits The logits of each sample.
+ * @param targets The target probabilities of each sample.
+ * @return The mean loss as a single Variable whose children are all logits.
+ * @throw std::invalid_argument if the shapes do not match.
+ */
+Variable BCEWithLogitsLoss(const std::vector<std::vector<Variable>> &logits,
+                           const std::vector<std::vector<double>> &targets);
+
+/**
+ * Calculates the mean Huber loss, quadratic for errors below delta and linear
+ * above it.
+ * @param predictions The predicted values.
+ * @param targets The target values.
+ * @param delta The threshold between the quadratic and the linear part.
+ * @return The calculated loss as a Variable.
+ * @throw std::invalid_argument if the sizes do not match or delta <= 0.
+ */
+Variable HuberLoss(const std::vector<Variable> &predictions,
+                   const std::vector<double> &targets,
+                   double delta = 1.0);
+
+/**
+ * Calculates the mean Huber loss of a batch.
+ * @param predictions The predicted values of each sample.
+ * @param targets The target values of each sample.
+ * @param delta The threshold between the quadratic and the linear part.
+ * @return The mean loss, one Variable over all predictions of the batch.
+ * @throw std::invalid_argument if the shapes do not match or delta <= 0.
+ */
+Variable HuberLoss(const std::vector<std::vector<Variable>> &predictions,
+                   const std::vector<std::vector<double>> &targets,
+                   double delta = 1.0);
@@ -0,0 +1,122 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+size_t LatencyHistogram::bucket(uint64_t nanoseconds)
+{
+    if (nanoseconds < _sub_buckets)
+    {
+        return static_cast<size_t>(nanoseconds);
+    }
+    // The leading bit selects the power of two and the next three bits the
+    // linear bucket inside it.
+    const auto exponent =
+        static_cast<size_t>(63 - __builtin_clzll(nanoseconds));
+    const auto linear =
+        static_cast<size_t>(nanoseconds >> (exponent - 3)) & (_sub_buckets - 1);
+    return (exponent - 2) * _sub_buckets + linear;
+}
+
+
+uint64_t LatencyHistogram::upper_bound(size_t index)
+{
+    if (index < _sub_buckets)
+    {
+        return index;
+    }
+    const size_t shift = index / _sub_buckets - 1;
+    const uint64_t lower = (_sub_buckets + index % _sub_buckets) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+    const auto nanoseconds =
+        static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    _counts[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+std::chrono::nanoseconds LatencyHistogram::mean() const
+{
+    const uint64_t n = count();
+    return std::chrono::nanoseconds(
+        n == 0 ? 0 : static_cast<int64_t>(_sum.load() / n));
+}
+
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double p) const
+{
+    if (!(p >= 0 && p <= 100))
+    {
+        throw std::invalid_argument("percentile should be in [0, 100]");
+    }
+    // The counts are read once so that a concurrent record cannot move the
+    // rank past the last bucket.
+    std::array<uint64_t, _num_buckets> counts{};
+    uint64_t total = 0;
+    for (size_t i = 0; i < _num_buckets; i++)
+    {
+        counts[i] = _counts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto rank = std::max<uint64_t>(
+        1,
+        static_cast<uint64_t>(
+            std::ceil(p / 100 * static_cast<double>(total))));
+    uint64_t seen = 0;
+    size_t index = 0;
+    for (; index + 1 < _num_buckets; index++)
+    {
+        seen += counts[index];
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(upper_bound(index)));
+}
+
+
+void LatencyHistogram::reset()
+{
+    for (auto &count : _counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    _sum.store(0);
+    _count.store(0);
+}
+
+
+ThroughputCounter::ThroughputCounter()
+    : _start(std::chrono::steady_clock::now().time_since_epoch().count())
+{
+}
+
+
+double ThroughputCounter::rate() const
+{
+    const std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now().time_since_epoch() -
+        std::chrono::steady_clock::duration(_start.load());
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(count()) / seconds : 0.0;
+}
+
+
+void ThroughputCounter::reset()
+{
+    _count.store(0);
+    _start.store(std::chrono::steady_clock::now().time_since_epoch().count());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * This class represents a lock-free histogram of latencies in nanoseconds.
+ * Buckets are log-linear, eight per power of two, so percentiles are exact
+ * below 8ns and within 12.5% above.
+ */
+class LatencyHistogram
+{
+private:
+    static constexpr size_t _sub_buckets = 8;    // Buckets per power of two.
+    static constexpr size_t _num_buckets = 496; // Covers all 64-bit values.
+
+    std::array<std::atomic<uint64_t>, _num_buckets> _counts{}; // The counts.
+    std::atomic<uint64_t> _count{0}; // The number of recorded latencies.
+    std::atomic<uint64_t> _sum{0};   // The sum of recorded latencies.
+
+    /**
+     * Returns the bucket of a latency.
+     * @param nanoseconds The latency.
+     * @return The index of the bucket.
+     */
+    static size_t bucket(uint64_t nanoseconds);
+
+    /**
+     * Returns the largest latency of a bucket.
+     * @param index The index of the bucket.
+     * @return The upper bound in nanoseconds.
+     */
+    static uint64_t upper_bound(size_t index);
+
+public:
+    /**
+     * Records a latency. Safe to call from several threads.
+     * @param latency The latency.
+     */
+    void record(std::chrono::nanoseconds latency);
+
+    /**
+     * Returns the number of recorded latencies.
+     * @return The count.
+     */
+    uint64_t count() const
+    {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the mean of the recorded latencies.
+     * @return The mean, or zero if nothing was recorded.
+     */
+    std::chrono::nanoseconds mean() const;
+
+    /**
+     * Returns a percentile of the recorded latencies, rounded up to the
+     * upper bound of its bucket.
+     * @param p The percentile, in [0, 100].
+     * @return The latency, or zero if nothing was recorded.
+     * @throw std::invalid_argument if p is out of range.
+     */
+    std::chrono::nanoseconds percentile(double p) const;
+
+    /**
+     * Clears all recorded latencies.
+     */
+    void reset();
+};
+
+/**
+ * @class ThroughputCounter
+ * This class represents a lock-free event counter with its rate since the
+ * last reset.
+ */
+class ThroughputCounter
+{
+private:
+    std::atomic<uint64_t> _count{0}; // The number of events.
+    std::atomic<std::chrono::steady_clock::rep> _start; // The start time.
+
+public:
+    /**
+     * Constructs a counter that starts now.
+     */
+    ThroughputCounter();
+
+    /**
+     * Adds events. Safe to call from several threads.
+     * @param n The number of events.
+     */
+    void add(uint64_t n = 1)
+    {
+        _count.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the number of events.
+     * @return The count.
+     */
+    uint64_t count() const
+    {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the number of events per second since the last reset.
+     * @return The rate.
+     */
+    double rate() const;
+
+    /**
+     * Clears the count and restarts the clock.
+     */
+    void reset();
+};
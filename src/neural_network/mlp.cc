@@ -1,13 +1,382 @@
 #include "mlp.h"
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace
+{
+const char magic[4] = {'M', 'L', 'P', 'B'};
+const uint32_t version = 1;
+
+
+// Unmaps a file mapping when it goes out of scope.
+struct FileMapping
+{
+    void *data = MAP_FAILED;
+    size_t bytes = 0;
+
+    ~FileMapping()
+    {
+        if (data != MAP_FAILED)
+        {
+            munmap(data, bytes);
+        }
+    }
+};
+
+
+uint64_t read_u64(const char *data, size_t bytes, size_t &offset)
+{
+    if (offset + sizeof(uint64_t) > bytes)
+    {
+        throw std::runtime_error("truncated MLP file");
+    }
+    uint64_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    offset += sizeof(value);
+    return value;
+}
+} // namespace
+
+
+MLP MLP::load(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+    struct stat status;
+    FileMapping mapping;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        mapping.bytes = static_cast<size_t>(status.st_size);
+        mapping.data =
+            mmap(nullptr, mapping.bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping.data == MAP_FAILED)
+    {
+        throw std::runtime_error("failed to map " + path);
+    }
+
+    const char *data = static_cast<const char *>(mapping.data);
+    uint32_t file_version = 0;
+    if (mapping.bytes < sizeof(magic) + sizeof(file_version) ||
+        std::memcmp(data, magic, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error(path + " is not an MLP file");
+    }
+    std::memcpy(&file_version, data + sizeof(magic), sizeof(file_version));
+    if (file_version != version)
+    {
+        throw std::runtime_error("unsupported MLP file version");
+    }
+    size_t offset = sizeof(magic) + sizeof(file_version);
+    const size_t n_in = read_u64(data, mapping.bytes, offset);
+    const uint64_t num_layers = read_u64(data, mapping.bytes, offset);
+    if (num_layers == 0)
+    {
+        throw std::runtime_error("an MLP file should have layers");
+    }
+    // Check the counts against the file size before allocating for them, so
+    // that a corrupt header cannot request an arbitrary amount of memory.
+    if (num_layers > (mapping.bytes - offset) / sizeof(uint64_t))
+    {
+        throw std::runtime_error("truncated MLP file");
+    }
+    std::vector<size_t> n_outs(num_layers);
+    for (auto &n_out : n_outs)
+    {
+        n_out = read_u64(data, mapping.bytes, offset);
+    }
+    const size_t num_values = (mapping.bytes - offset) / sizeof(double);
+    size_t n_prev = n_in;
+    size_t num_parameters = 0;
+    for (size_t n_out : n_outs)
+    {
+        if (n_prev >= num_values ||
+            n_out > (num_values - num_parameters) / (n_prev + 1))
+        {
+            throw std::runtime_error("invalid number of parameters in " +
+                                     path);
+        }
+        num_parameters += n_out * (n_prev + 1);
+        n_prev = n_out;
+    }
+
+    MLP mlp = deferred(n_in, n_outs);
+    if (mapping.bytes - offset != mlp.num_parameters() * sizeof(double))
+    {
+        throw std::runtime_error("invalid number of parameters in " + path);
+    }
+    // The header is a whole number of 8-byte words, so the values are
+    // aligned in the page-aligned mapping.
+    mlp.materialize(reinterpret_cast<const double *>(data + offset));
+    return mlp;
+}
+
+
+void MLP::save(const std::string &path) const
+{
+    require_materialized();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+    const uint64_t n_in = _n_in;
+    const uint64_t num_layers = _n_outs.size();
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char *>(&n_in), sizeof(n_in));
+    file.write(reinterpret_cast<const char *>(&num_layers), sizeof(num_layers));
+    for (size_t n_out : _n_outs)
+    {
+        const uint64_t value = n_out;
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    std::vector<double> values;
+    values.reserve(_parameters.size());
+    for (const auto &parameter : _parameters)
+    {
+        values.push_back(parameter.reference()->value());
+    }
+    file.write(reinterpret_cast<const char *>(values.data()),
+               static_cast<std::streamsize>(values.size() * sizeof(double)));
+    if (!file)
+    {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+
+size_t MLP::num_parameters() const
+{
+    size_t n_prev = _n_in;
+    size_t result = 0;
+    for (size_t n_out : _n_outs)
+    {
+        result += n_out * (n_prev + 1);
+        n_prev = n_out;
+    }
+    return result;
+}
+
+
+void MLP::materialize(ThreadPool *pool)
+{
+    if (_materialized)
+    {
+        return;
+    }
+    _layers.reserve(_n_outs.size());
+    size_t n_prev = _n_in;
+    for (size_t n_out : _n_outs)
+    {
+        _layers.emplace_back(n_prev, n_out, "tanh", _scheme, pool);
+        n_prev = n_out;
+    }
+    collect_parameters();
+}
+
+
+void MLP::materialize(const double *values)
+{
+    release_results();
+    _layers.clear();
+    _layers.reserve(_n_outs.size());
+    size_t n_prev = _n_in;
+    for (size_t n_out : _n_outs)
+    {
+        _layers.emplace_back(n_prev, n_out, values, "tanh");
+        values += n_out * (n_prev + 1);
+        n_prev = n_out;
+    }
+    collect_parameters();
+}
+
+
+void MLP::collect_parameters()
+{
+    _parameters.clear();
+    _parameters.reserve(num_parameters());
+    for (auto &layer : _layers)
+    {
+        layer.set_activation_mode(_activation_mode);
+        for (const auto &parameter : layer.parameters())
+        {
+            _parameters.push_back(parameter);
+        }
+    }
+    _materialized = true;
+}
+
+
+void MLP::require_materialized() const
+{
+    if (!_materialized)
+    {
+        throw std::runtime_error("the MLP is not materialized");
+    }
+}
+
 
 std::vector<Variable> &MLP::forward(const std::vector<double> &inputs)
 {
+    if (!_materialized)
+    {
+        materialize();
+    }
+    // The graph of the previous pass is freed before the next one is built,
+    // so the two are never held at once.
+    release_results();
+    _layers[0].forward(inputs, _results[0]);
+    for (size_t i = 1; i < _layers.size(); i++)
+    {
+        _layers[i].forward(_results[i - 1], _results[i]);
+    }
+
+    return _results.back();
+}
+
+
+std::vector<Variable> &MLP::forward(const SparseVector &inputs)
+{
+    if (!_materialized)
+    {
+        materialize();
+    }
+    release_results();
     _results[0] = _layers[0].forward(inputs);
     for (size_t i = 1; i < _layers.size(); i++)
     {
-        _results[i] = _layers[i].forward(_results[i - 1]);
+        _layers[i].forward(_results[i - 1], _results[i]);
     }
 
     return _results.back();
 }
+
+
+std::vector<std::vector<Variable>> MLP::forward(const SparseMatrix &batch)
+{
+    if (!_materialized)
+    {
+        materialize();
+    }
+    release_results();
+    _batch_results.resize(batch.rows());
+    std::vector<std::vector<Variable>> outputs(batch.rows());
+    for (size_t r = 0; r < batch.rows(); r++)
+    {
+        // The graph of each layer refers to the results of the previous
+        // one, so every layer of every row is kept until the next pass.
+        std::vector<std::vector<Variable>> &results = _batch_results[r];
+        results.resize(_layers.size());
+        results[0] = _layers[0].forward(batch.row(r));
+        for (size_t i = 1; i < _layers.size(); i++)
+        {
+            _layers[i].forward(results[i - 1], results[i]);
+        }
+        outputs[r] = results.back();
+    }
+    return outputs;
+}
+
+
+void MLP::release_results()
+{
+    // The results stay in place since the graphs built on them refer to
+    // them; only their own graphs are freed.
+    for (auto &result : _results)
+    {
+        for (auto &output : result)
+        {
+            output.release_graph();
+        }
+    }
+    for (auto &row : _batch_results)
+    {
+        for (auto &result : row)
+        {
+            for (auto &output : result)
+            {
+                output.release_graph();
+            }
+        }
+    }
+}
+
+
+std::vector<Dual> MLP::forward(const std::vector<Dual> &inputs) const
+{
+    require_materialized();
+    std::vector<Dual> values = _layers[0].forward(inputs);
+    for (size_t i = 1; i < _layers.size(); i++)
+    {
+        values = _layers[i].forward(values);
+    }
+    return values;
+}
+
+
+std::vector<double> MLP::jvp(const std::vector<double> &inputs,
+                             const std::vector<double> &direction) const
+{
+    return tangents(forward(make_duals(inputs, direction)));
+}
+
+
+void MLP::set_activation_mode(ActivationMode mode)
+{
+    _activation_mode = mode;
+    for (auto &layer : _layers)
+    {
+        layer.set_activation_mode(mode);
+    }
+}
+
+
+std::vector<double> MLP::predict(const std::vector<double> &inputs) const
+{
+    require_materialized();
+    std::vector<double> values = _layers[0].predict(inputs);
+    for (size_t i = 1; i < _layers.size(); i++)
+    {
+        values = _layers[i].predict(values);
+    }
+    return values;
+}
+
+
+std::vector<double> MLP::predict(const SparseVector &inputs) const
+{
+    require_materialized();
+    std::vector<double> values = _layers[0].predict(inputs);
+    for (size_t i = 1; i < _layers.size(); i++)
+    {
+        values = _layers[i].predict(values);
+    }
+    return values;
+}
+
+
+std::vector<double> MLP::predict(const std::vector<double> &inputs,
+                                 size_t n) const
+{
+    require_materialized();
+    std::vector<double> values = _layers[0].predict(inputs, n);
+    for (size_t i = 1; i < _layers.size(); i++)
+    {
+        values = _layers[i].predict(values, n);
+    }
+    return values;
+}
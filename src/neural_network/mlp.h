@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "../layer/layer.h"
@@ -17,37 +18,137 @@ private:
     std::vector<Layer> _layers; // The layers in the MLP.
     std::vector<std::vector<Variable>>
         _results; // The output results for each layer in the MLP.
+    std::vector<std::vector<std::vector<Variable>>>
+        _batch_results; // The results of each row of the last sparse batch.
     std::vector<Variable> _parameters; // All parameters of the MLP.
+    InitScheme _scheme = InitScheme::Uniform; // The initialization scheme.
+    bool _materialized = false;               // Whether the layers exist.
+    ActivationMode _activation_mode = ActivationMode::Exact; // The kernel mode.
+
+    struct Deferred
+    {
+    };
+
+    /**
+     * Declares the architecture of an MLP without building its layers.
+     */
+    MLP(Deferred, size_t n_in, std::vector<size_t> n_outs, InitScheme scheme)
+        : _n_in(n_in), _n_outs(n_outs), _results(n_outs.size()),
+          _batch_results(), _scheme(scheme){};
+
+    /**
+     * Collects the parameters of the layers once they are built.
+     */
+    void collect_parameters();
+
+    /**
+     * Throws unless the layers have been built.
+     * @throw std::runtime_error if the MLP is not materialized.
+     */
+    void require_materialized() const;
 
 public:
     /**
      * Constructs an MLP with the specified number of input connections and output connections for each layer.
      * @param n_in The number of input connections.
      * @param n_outs The number of output connections for each layer.
+     * @param scheme The initialization of the parameters. Default is U(-1, 1).
+     * @param pool Draws the parameters of each layer in parallel if given.
      */
-    MLP(size_t n_in, std::vector<size_t> n_outs) : _n_in(n_in), _n_outs(n_outs)
+    MLP(size_t n_in,
+        std::vector<size_t> n_outs,
+        InitScheme scheme = InitScheme::Uniform,
+        ThreadPool *pool = nullptr)
+        : MLP(Deferred{}, n_in, n_outs, scheme)
     {
-        _layers.reserve(n_outs.size());
-        _results.resize(n_outs.size());
-        size_t n_prev = n_in;
-        size_t num_parameters = 0;
-        for (size_t n_out : n_outs)
-        {
-            num_parameters += n_out * (n_prev + 1);
-        }
-        _parameters.reserve(num_parameters);
+        materialize(pool);
+    }
 
-        for (size_t i = 0; i < n_outs.size(); i++)
-        {
-            _layers.emplace_back(n_prev, n_outs[i], "tanh");
-            n_prev = n_outs[i];
-            for (size_t j = 0; j < _layers[i].parameters().size(); j++)
-            {
-                _parameters.push_back(_layers[i].parameters()[j]);
-            }
-        }
+    /**
+     * Declares an MLP whose parameters are neither allocated nor drawn
+     * until `materialize` is called, either explicitly, e.g. with the
+     * values of a checkpoint, or on the first call of `forward` or
+     * `mutable_parameters`. Until then `layers()` and `parameters()` are
+     * empty and `predict` throws.
+     * @param n_in The number of input connections.
+     * @param n_outs The number of output connections for each layer.
+     * @param scheme The initialization used by `materialize()`.
+     * @return The deferred MLP.
+     */
+    static MLP deferred(size_t n_in,
+                        std::vector<size_t> n_outs,
+                        InitScheme scheme = InitScheme::Uniform)
+    {
+        return MLP(Deferred{}, n_in, std::move(n_outs), scheme);
+    }
+
+    /**
+     * Loads an MLP saved by `save`. The file is mapped and its values are
+     * copied straight into the parameters, without a random initialization.
+     * @param path The path of the file.
+     * @return The MLP.
+     * @throw std::runtime_error if the file cannot be read or is invalid.
+     */
+    static MLP load(const std::string &path);
+
+    /**
+     * Saves the architecture and the parameters of the MLP to a binary file:
+     * the magic "MLPB", a uint32 version, the uint64 number of inputs and of
+     * layers, the uint64 outputs of each layer, and then the parameters as
+     * doubles in `parameters()` order, all in native byte order.
+     * @param path The path of the file.
+     * @throw std::runtime_error if the MLP is not materialized or the file
+     * cannot be written.
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * Returns whether the layers and parameters have been built.
+     * @return True once materialized.
+     */
+    bool materialized() const
+    {
+        return _materialized;
+    }
+
+    /**
+     * Returns the number of inputs of the declared architecture.
+     * @return The number of input connections.
+     */
+    size_t n_in() const
+    {
+        return _n_in;
+    }
+
+    /**
+     * Returns the layer sizes of the declared architecture.
+     * @return The number of output connections for each layer.
+     */
+    const std::vector<size_t> &n_outs() const
+    {
+        return _n_outs;
     }
 
+    /**
+     * Returns the number of parameters of the declared architecture.
+     * @return The number of weights and biases of all layers.
+     */
+    size_t num_parameters() const;
+
+    /**
+     * Builds the layers with parameters drawn from the initialization
+     * scheme. Does nothing if the MLP is already materialized.
+     * @param pool Draws the parameters of each layer in parallel if given.
+     */
+    void materialize(ThreadPool *pool = nullptr);
+
+    /**
+     * Builds the layers with the given parameters, replacing any existing
+     * ones, e.g. straight from a loaded or mapped checkpoint.
+     * @param values The `num_parameters()` values in `parameters()` order.
+     */
+    void materialize(const double *values);
+
     /**
      * Returns the layers in the MLP.
      * @return The layers.
@@ -66,6 +167,15 @@ public:
         return _results;
     }
 
+    /**
+     * Releases the graphs held by the output results of each layer, and of
+     * each row of the last sparse batch, which stay in place as leaves.
+     * `forward` calls it before building the next graph. The loss keeps its
+     * own copy of the graph, so calling this after the loss has been built
+     * also lets `loss.backward()` free the graph as it goes.
+     */
+    void release_results();
+
     /**
      * Returns all parameters of the MLP, including parameters of all layers.
      * @return The parameters.
@@ -81,6 +191,10 @@ public:
      */
     std::vector<Variable> &mutable_parameters()
     {
+        if (!_materialized)
+        {
+            materialize();
+        }
         return _parameters;
     }
 
@@ -90,4 +204,70 @@ public:
      * @return The output values of the MLP as a vector of Variables.
      */
     std::vector<Variable> &forward(const std::vector<double> &inputs);
+
+    /**
+     * Computes the forward pass of the MLP given a sparse input. The first
+     * layer only touches the weights at the non-zero indices.
+     * @param inputs The sparse input.
+     * @return The output values of the MLP as a vector of Variables.
+     */
+    std::vector<Variable> &forward(const SparseVector &inputs);
+
+    /**
+     * Computes the forward pass of the MLP for each row of a sparse batch.
+     * The results of the layers are not stored in `results()`, but the MLP
+     * keeps those of every row, which the returned graphs refer to, until
+     * the next forward pass.
+     * @param batch The sparse inputs, one sample per row.
+     * @return The output values of the MLP for each sample.
+     */
+    std::vector<std::vector<Variable>> forward(const SparseMatrix &batch);
+
+    /**
+     * Computes the forward pass of the MLP on dual numbers.
+     * @param inputs The input dual numbers.
+     * @return The output dual numbers of the MLP.
+     */
+    std::vector<Dual> forward(const std::vector<Dual> &inputs) const;
+
+    /**
+     * Computes the Jacobian-vector product J v of the outputs with respect to
+     * the inputs in a single forward pass.
+     * @param inputs The input values.
+     * @param direction The direction v, one entry per input.
+     * @return The directional derivative of each output.
+     */
+    std::vector<double> jvp(const std::vector<double> &inputs,
+                            const std::vector<double> &direction) const;
+
+    /**
+     * Sets whether all layers use the exact or the fast activation kernel.
+     * @param mode The activation mode.
+     */
+    void set_activation_mode(ActivationMode mode);
+
+    /**
+     * Computes the output values of the MLP without building a graph.
+     * @param inputs The input values.
+     * @return The output values of the MLP.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+
+    /**
+     * Computes the output values of the MLP for a sparse input without
+     * building a graph.
+     * @param inputs The sparse input.
+     * @return The output values of the MLP.
+     */
+    std::vector<double> predict(const SparseVector &inputs) const;
+
+    /**
+     * Computes the output values of the MLP for a batch of inputs without
+     * building a graph.
+     * @param inputs The row-major input values, n x n_in.
+     * @param n The number of samples.
+     * @return The row-major output values, n x n_out of the last layer.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs,
+                                size_t n) const;
 };
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "mlp.h"
+
+/**
+ * @struct TanhActivation
+ * Hyperbolic tangent activation policy.
+ */
+struct TanhActivation
+{
+    static constexpr const char *name = "tanh";
+
+    static double forward(double x)
+    {
+        return std::tanh(x);
+    }
+
+    /**
+     * Computes the derivative from the activated value.
+     * @param y The activated value.
+     * @return The derivative of the activation.
+     */
+    static constexpr double derivative(double y)
+    {
+        return 1 - y * y;
+    }
+};
+
+/**
+ * @struct SigmoidActivation
+ * Sigmoid activation policy.
+ */
+struct SigmoidActivation
+{
+    static constexpr const char *name = "sigmoid";
+
+    static double forward(double x)
+    {
+        return 1 / (1 + std::exp(-x));
+    }
+
+    static constexpr double derivative(double y)
+    {
+        return y * (1 - y);
+    }
+};
+
+/**
+ * @struct ReluActivation
+ * Rectified linear unit activation policy.
+ */
+struct ReluActivation
+{
+    static constexpr const char *name = "relu";
+
+    static constexpr double forward(double x)
+    {
+        return x > 0 ? x : 0;
+    }
+
+    static constexpr double derivative(double y)
+    {
+        return y > 0 ? 1 : 0;
+    }
+};
+
+/**
+ * @struct IdentityActivation
+ * Identity activation policy.
+ */
+struct IdentityActivation
+{
+    static constexpr const char *name = "identity";
+
+    static constexpr double forward(double x)
+    {
+        return x;
+    }
+
+    static constexpr double derivative(double)
+    {
+        return 1;
+    }
+};
+
+/**
+ * @struct StaticLayer
+ * A fully connected layer whose sizes are known at compile time.
+ * @tparam In The number of inputs.
+ * @tparam Out The number of outputs.
+ * @tparam Activation The activation policy.
+ */
+template <size_t In, size_t Out, typename Activation>
+struct StaticLayer
+{
+    std::array<double, In * Out> weights{};          // Row-major weights.
+    std::array<double, Out> bias{};                  // The bias of each output.
+    std::array<double, In * Out> weight_gradients{}; // Gradients of weights.
+    std::array<double, Out> bias_gradients{};        // Gradients of bias.
+
+    /**
+     * Computes the activated outputs of the layer.
+     * @param x The inputs.
+     * @param y The activated outputs.
+     */
+    void forward(const std::array<double, In> &x,
+                 std::array<double, Out> &y) const
+    {
+        for (size_t o = 0; o < Out; o++)
+        {
+            double z = bias[o];
+            for (size_t i = 0; i < In; i++)
+            {
+                z += weights[o * In + i] * x[i];
+            }
+            y[o] = Activation::forward(z);
+        }
+    }
+
+    /**
+     * Accumulates parameter gradients and computes the input gradients.
+     * @param x The inputs of the forward pass.
+     * @param y The outputs of the forward pass.
+     * @param dy The gradients of the outputs.
+     * @param dx The gradients of the inputs.
+     */
+    void backward(const std::array<double, In> &x,
+                  const std::array<double, Out> &y,
+                  const std::array<double, Out> &dy,
+                  std::array<double, In> &dx)
+    {
+        dx.fill(0.0);
+        for (size_t o = 0; o < Out; o++)
+        {
+            const double dz = dy[o] * Activation::derivative(y[o]);
+            bias_gradients[o] += dz;
+            for (size_t i = 0; i < In; i++)
+            {
+                weight_gradients[o * In + i] += dz * x[i];
+                dx[i] += dz * weights[o * In + i];
+            }
+        }
+    }
+};
+
+/**
+ * @class BasicStaticMLP
+ * A Multi-Layer Perceptron with a compile-time topology.
+ * Weights, activations and gradients live in std::arrays, so forward and
+ * backward passes perform no heap allocation and no activation dispatch.
+ * @tparam Activation The activation policy shared by all layers.
+ * @tparam Sizes The number of inputs followed by the outputs of each layer.
+ */
+template <typename Activation, size_t... Sizes>
+class BasicStaticMLP
+{
+    static_assert(sizeof...(Sizes) >= 2,
+                  "StaticMLP needs an input size and at least one layer");
+
+public:
+    static constexpr size_t num_layers = sizeof...(Sizes) - 1;
+    static constexpr std::array<size_t, sizeof...(Sizes)> sizes{Sizes...};
+    static constexpr size_t n_in = sizes.front();
+    static constexpr size_t n_out = sizes.back();
+
+    using Input = std::array<double, n_in>;
+    using Output = std::array<double, n_out>;
+
+private:
+    template <size_t... I>
+    static auto make_layers(std::index_sequence<I...>)
+        -> std::tuple<StaticLayer<sizes[I], sizes[I + 1], Activation>...>;
+
+    using Layers =
+        decltype(make_layers(std::make_index_sequence<num_layers>{}));
+    using Buffers = std::tuple<std::array<double, Sizes>...>;
+
+    Layers _layers;       // The layers of the MLP.
+    Buffers _activations; // The inputs followed by the output of each layer.
+    Buffers _gradients;   // The gradients of each entry of _activations.
+
+    template <size_t I>
+    void forward_layer()
+    {
+        std::get<I>(_layers).forward(std::get<I>(_activations),
+                                     std::get<I + 1>(_activations));
+    }
+
+    template <size_t I>
+    void backward_layer()
+    {
+        std::get<I>(_layers).backward(std::get<I>(_activations),
+                                      std::get<I + 1>(_activations),
+                                      std::get<I + 1>(_gradients),
+                                      std::get<I>(_gradients));
+    }
+
+    template <size_t... I>
+    void forward_layers(std::index_sequence<I...>)
+    {
+        (forward_layer<I>(), ...);
+    }
+
+    template <size_t... I>
+    void backward_layers(std::index_sequence<I...>)
+    {
+        (backward_layer<num_layers - 1 - I>(), ...);
+    }
+
+    template <typename Function, size_t... I>
+    void for_each_layer(Function &&function, std::index_sequence<I...>)
+    {
+        (function(std::get<I>(_layers), I), ...);
+    }
+
+    template <typename Function>
+    void for_each_layer(Function &&function)
+    {
+        for_each_layer(std::forward<Function>(function),
+                       std::make_index_sequence<num_layers>{});
+    }
+
+public:
+    /**
+     * Constructs a StaticMLP with weights drawn uniformly from [-1, 1].
+     * @param seed The seed of the random engine.
+     */
+    explicit BasicStaticMLP(unsigned seed = 0)
+        : _layers(), _activations(), _gradients()
+    {
+        std::default_random_engine generator(seed);
+        std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+        for_each_layer([&](auto &layer, size_t) {
+            for (auto &weight : layer.weights)
+            {
+                weight = distribution(generator);
+            }
+            for (auto &bias : layer.bias)
+            {
+                bias = distribution(generator);
+            }
+        });
+    }
+
+    /**
+     * Returns the layer at index I.
+     * @return The layer.
+     */
+    template <size_t I>
+    const auto &layer() const
+    {
+        return std::get<I>(_layers);
+    }
+
+    /**
+     * Returns the mutable layer at index I.
+     * @return The mutable layer.
+     */
+    template <size_t I>
+    auto &mutable_layer()
+    {
+        return std::get<I>(_layers);
+    }
+
+    /**
+     * Copies the parameters of a dynamic MLP with the same topology.
+     * @param mlp The MLP to copy from.
+     * @throw std::invalid_argument if the topologies differ, in which case
+     * the parameters are left unchanged.
+     */
+    void load(const MLP &mlp)
+    {
+        const auto &layers = mlp.layers();
+        if (layers.size() != num_layers)
+        {
+            throw std::invalid_argument("mlp has a different number of layers");
+        }
+        for (size_t l = 0; l < num_layers; l++)
+        {
+            const Layer &source = layers[l];
+            if (source.n_in() != sizes[l] || source.n_out() != sizes[l + 1])
+            {
+                throw std::invalid_argument("mlp has a different layer size");
+            }
+            if (source.activate_function() != Activation::name)
+            {
+                throw std::invalid_argument("mlp has a different activation");
+            }
+        }
+        for_each_layer([&](auto &layer, size_t l) {
+            const Layer &source = layers[l];
+            for (size_t o = 0; o < sizes[l + 1]; o++)
+            {
+                const Neuron &neuron = source.neurons()[o];
+                for (size_t i = 0; i < sizes[l]; i++)
+                {
+                    layer.weights[o * sizes[l] + i] =
+                        neuron.weights()[i].value();
+                }
+                layer.bias[o] = neuron.bias().value();
+            }
+        });
+    }
+
+    /**
+     * Computes the forward pass.
+     * @param inputs The input values.
+     * @return The output values, valid until the next forward pass.
+     */
+    const Output &forward(const Input &inputs)
+    {
+        std::get<0>(_activations) = inputs;
+        forward_layers(std::make_index_sequence<num_layers>{});
+        return std::get<num_layers>(_activations);
+    }
+
+    /**
+     * Accumulates parameter gradients for the last forward pass.
+     * @param output_gradients The gradients of the outputs.
+     * @return The gradients of the inputs.
+     */
+    const Input &backward(const Output &output_gradients)
+    {
+        std::get<num_layers>(_gradients) = output_gradients;
+        backward_layers(std::make_index_sequence<num_layers>{});
+        return std::get<0>(_gradients);
+    }
+
+    /**
+     * Resets all parameter gradients to zero.
+     */
+    void zero_grad()
+    {
+        for_each_layer([](auto &layer, size_t) {
+            layer.weight_gradients.fill(0.0);
+            layer.bias_gradients.fill(0.0);
+        });
+    }
+
+    /**
+     * Performs gradient descent on all parameters.
+     * @param lr The learning rate.
+     */
+    void gradient_descent(double lr)
+    {
+        for_each_layer([lr](auto &layer, size_t) {
+            for (size_t i = 0; i < layer.weights.size(); i++)
+            {
+                layer.weights[i] -= lr * layer.weight_gradients[i];
+            }
+            for (size_t i = 0; i < layer.bias.size(); i++)
+            {
+                layer.bias[i] -= lr * layer.bias_gradients[i];
+            }
+        });
+    }
+};
+
+/**
+ * A compile-time MLP with tanh activations, matching the dynamic MLP.
+ * For example, `StaticMLP<3, 4, 4, 1>` has 3 inputs and layers of 4, 4 and 1.
+ */
+template <size_t... Sizes>
+using StaticMLP = BasicStaticMLP<TanhActivation, Sizes...>;
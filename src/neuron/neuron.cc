@@ -8,10 +8,8 @@ Variable Neuron::forward(const std::vector<double> &inputs)
     {
         throw std::runtime_error("invalid number of inputs");
     }
-    Variable result = dot_product(_weights, inputs) + _bias;
-    result.set_ref(nullptr);
-
-    return result.activate(_activate_function);
+    return fused_neuron(
+        _weights, inputs, _bias, _activate_function, _activation_mode);
 }
 
 
@@ -21,9 +19,33 @@ Variable Neuron::forward(const std::vector<Variable> &variables)
     {
         throw std::runtime_error("invalid number of inputs");
     }
+    return fused_neuron(
+        _weights, variables, _bias, _activate_function, _activation_mode);
+}
+
 
-    Variable result = dot_product(_weights, variables) + _bias;
-    result.set_ref(nullptr);
+Variable Neuron::forward(const SparseVector &inputs)
+{
+    if (inputs.size() != _weights.size())
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    return fused_neuron(
+        _weights, inputs, _bias, _activate_function, _activation_mode);
+}
 
-    return result.activate(_activate_function);
+
+Dual Neuron::forward(const std::vector<Dual> &inputs) const
+{
+    if (inputs.size() != _weights.size())
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+    Dual preactivation(_bias.value());
+    for (size_t i = 0; i < _weights.size(); i++)
+    {
+        preactivation += _weights[i].value() * inputs[i];
+    }
+    return preactivation.activate(parse_activation(_activate_function),
+                                  _activation_mode);
 }
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <chrono>
-#include <random>
 #include <vector>
 
+#include "../determinism/determinism.h"
+#include "../dual/dual.h"
+#include "../initializer/initializer.h"
+#include "../sparse/sparse.h"
 #include "../variable/variable.h"
 
 /**
@@ -17,6 +19,7 @@ private:
     Variable _bias;                    // The bias of the neuron.
     std::string _activate_function;    // The activation function of the neuron.
     std::vector<Variable> _parameters; // All parameters of the neuron.
+    ActivationMode _activation_mode = ActivationMode::Exact; // The kernel mode.
 
 public:
     /**
@@ -28,17 +31,38 @@ public:
         : _weights(n_in), _activate_function(activate_function)
     {
         _parameters.reserve(n_in + 1);
-        unsigned seed = static_cast<unsigned>(
-            std::chrono::system_clock::now().time_since_epoch().count());
-        std::default_random_engine generator(seed);
-        std::uniform_real_distribution<double> distribution(-1.0, 1.0);
-        distribution.reset();
+        const CounterRng rng(next_seed());
         for (size_t i = 0; i < n_in; i++)
         {
-            _weights[i] = Variable(distribution(generator), 0.0, "", "weights");
+            _weights[i] =
+                Variable(2.0 * rng.uniform(i) - 1.0, 0.0, "", "weights");
             _parameters.push_back(_weights[i]);
         }
-        _bias = Variable(distribution(generator), 0, "", "bias");
+        _bias = Variable(2.0 * rng.uniform(n_in) - 1.0, 0, "", "bias");
+        _parameters.push_back(_bias);
+    }
+
+    /**
+     * Constructs a neuron with the given weights and bias, e.g. filled by
+     * `initialize_layer`.
+     * @param weights The weights, one per input connection.
+     * @param n_in The number of input connections.
+     * @param bias The bias.
+     * @param activate_function The activation function of the neuron.
+     */
+    Neuron(const double *weights,
+           size_t n_in,
+           double bias,
+           std::string activate_function = "tanh")
+        : _weights(n_in), _activate_function(activate_function)
+    {
+        _parameters.reserve(n_in + 1);
+        for (size_t i = 0; i < n_in; i++)
+        {
+            _weights[i] = Variable(weights[i], 0.0, "", "weights");
+            _parameters.push_back(_weights[i]);
+        }
+        _bias = Variable(bias, 0, "", "bias");
         _parameters.push_back(_bias);
     }
 
@@ -48,7 +72,8 @@ public:
      */
     Neuron(const Neuron &other)
         : _weights(other._weights), _bias(other._bias),
-          _activate_function(other._activate_function){};
+          _activate_function(other._activate_function),
+          _activation_mode(other._activation_mode){};
 
     /**
      * Copy assignment operator.
@@ -60,28 +85,27 @@ public:
         _weights = other._weights;
         _bias = other._bias;
         _activate_function = other._activate_function;
+        _activation_mode = other._activation_mode;
         return *this;
     }
 
     /**
-     * Move constructor.
+     * Move constructor. The weights keep their addresses, so references to
+     * them, e.g. from `parameters()`, stay valid; only the bias moves.
      * @param other The neuron to be moved.
      */
     Neuron(Neuron &&other) noexcept
-        : _weights(other._weights), _bias(other._bias),
-          _activate_function(other._activate_function)
+        : _weights(std::move(other._weights)), _bias(std::move(other._bias)),
+          _activate_function(std::move(other._activate_function)),
+          _parameters(std::move(other._parameters)),
+          _activation_mode(other._activation_mode)
     {
-        for (auto &weight : other._weights)
-        {
-            weight.set_ref(nullptr);
-        }
         other._weights.clear();
-        other._bias.set_ref(nullptr);
-        for (auto &weight : _weights)
+        other._parameters.clear();
+        if (!_parameters.empty())
         {
-            weight.set_ref(&weight);
+            _parameters.back().set_ref(&_bias);
         }
-        _bias.set_ref(&_bias);
     }
 
     /**
@@ -91,21 +115,21 @@ public:
      */
     Neuron &operator=(Neuron &&other) noexcept
     {
-        _weights = other._weights;
-        _bias = other._bias;
-        _activate_function = other._activate_function;
-        for (auto &weight : other._weights)
+        if (this == &other)
         {
-            weight.set_ref(nullptr);
+            return *this;
         }
+        _weights = std::move(other._weights);
+        _bias = std::move(other._bias);
+        _activate_function = std::move(other._activate_function);
+        _parameters = std::move(other._parameters);
+        _activation_mode = other._activation_mode;
         other._weights.clear();
-        other._bias.set_ref(nullptr);
-
-        for (auto &weight : _weights)
+        other._parameters.clear();
+        if (!_parameters.empty())
         {
-            weight.set_ref(&weight);
+            _parameters.back().set_ref(&_bias);
         }
-        _bias.set_ref(&_bias);
         return *this;
     }
 
@@ -139,6 +163,33 @@ public:
         return _bias;
     }
 
+    /**
+     * Returns the activation function of the neuron.
+     * @return The name of the activation function.
+     */
+    const std::string &activate_function() const
+    {
+        return _activate_function;
+    }
+
+    /**
+     * Returns whether the neuron uses the exact or the fast activation kernel.
+     * @return The activation mode.
+     */
+    ActivationMode activation_mode() const
+    {
+        return _activation_mode;
+    }
+
+    /**
+     * Sets whether the neuron uses the exact or the fast activation kernel.
+     * @param mode The activation mode.
+     */
+    void set_activation_mode(ActivationMode mode)
+    {
+        _activation_mode = mode;
+    }
+
     /**
      * Returns all parameters of the neuron, including weights and bias.
      * @return The parameters.
@@ -161,4 +212,21 @@ public:
      * @return The output value of the neuron.
      */
     Variable forward(const std::vector<Variable> &variables);
+
+    /**
+     * Computes the forward pass of the neuron given a sparse input. Only the
+     * weights at the non-zero indices are touched and receive gradients.
+     * @param inputs The sparse input.
+     * @return The output value of the neuron.
+     */
+    Variable forward(const SparseVector &inputs);
+
+    /**
+     * Computes the forward pass of the neuron on dual numbers. The weights
+     * are treated as constants, so the tangent of the result is the
+     * directional derivative with respect to the inputs. No graph is built.
+     * @param inputs The input dual numbers.
+     * @return The output dual number of the neuron.
+     */
+    Dual forward(const std::vector<Dual> &inputs) const;
 };
@@ -0,0 +1,284 @@
+#include "numa.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+namespace
+{
+const size_t huge_page_size = size_t{2} << 20;
+const int mpol_interleave = 3; // MPOL_INTERLEAVE from linux/mempolicy.h.
+const size_t max_nodes = 64;
+
+
+size_t page_size()
+{
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+
+size_t round_up(size_t bytes, size_t multiple)
+{
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+
+// Parses a cpulist such as "0-3,8,10-11".
+std::vector<int> parse_cpulist(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty() || range == "\n")
+        {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos
+                             ? first
+                             : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(static_cast<size_t>(cpu), &set))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+
+// Applies an interleave policy over the given nodes. This is a hint, so
+// failures such as a seccomp-denied mbind are ignored.
+void interleave(void *data, size_t bytes, const std::vector<int> &node_ids)
+{
+#ifdef SYS_mbind
+    unsigned long mask = 0;
+    for (int node : node_ids)
+    {
+        if (node >= 0 && static_cast<size_t>(node) < max_nodes)
+        {
+            mask |= 1UL << node;
+        }
+    }
+    syscall(SYS_mbind, data, bytes, mpol_interleave, &mask, max_nodes + 1, 0);
+#else
+    (void)data;
+    (void)bytes;
+    (void)node_ids;
+#endif
+}
+} // namespace
+
+
+CpuTopology CpuTopology::detect()
+{
+    const std::vector<int> allowed = allowed_cpus();
+    CpuTopology topology;
+    for (size_t node = 0; node < max_nodes; node++)
+    {
+        std::ifstream file("/sys/devices/system/node/node" +
+                           std::to_string(node) + "/cpulist");
+        if (!file)
+        {
+            continue;
+        }
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus;
+        for (int cpu : parse_cpulist(list))
+        {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty())
+        {
+            topology.nodes.push_back(std::move(cpus));
+            topology.node_ids.push_back(static_cast<int>(node));
+        }
+    }
+    if (topology.nodes.empty() && !allowed.empty())
+    {
+        topology.nodes.push_back(allowed);
+        topology.node_ids.push_back(0);
+    }
+    return topology;
+}
+
+
+size_t CpuTopology::num_cpus() const
+{
+    size_t n = 0;
+    for (const auto &node : nodes)
+    {
+        n += node.size();
+    }
+    return n;
+}
+
+
+std::vector<int> assign_cpus(const CpuTopology &topology,
+                             size_t num_threads,
+                             PinningPolicy policy)
+{
+    std::vector<int> order;
+    if (policy == PinningPolicy::Compact)
+    {
+        for (const auto &node : topology.nodes)
+        {
+            order.insert(order.end(), node.begin(), node.end());
+        }
+    }
+    else if (policy == PinningPolicy::Scatter)
+    {
+        for (size_t i = 0; order.size() < topology.num_cpus(); i++)
+        {
+            for (const auto &node : topology.nodes)
+            {
+                if (i < node.size())
+                {
+                    order.push_back(node[i]);
+                }
+            }
+        }
+    }
+    if (order.empty())
+    {
+        return std::vector<int>(num_threads, -1);
+    }
+
+    std::vector<int> cpus(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        cpus[i] = order[i % order.size()];
+    }
+    return cpus;
+}
+
+
+bool pin_current_thread(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<size_t>(cpu), &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+
+size_t mapping_size(size_t bytes, const MemoryOptions &options)
+{
+    const size_t unit = options.huge_pages == HugePages::Explicit
+                            ? huge_page_size
+                            : page_size();
+    return round_up(std::max<size_t>(bytes, 1), unit);
+}
+
+
+Mapping map_memory(size_t bytes, const MemoryOptions &options)
+{
+    Mapping mapping;
+    mapping.bytes = mapping_size(bytes, options);
+    const int protection = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (options.huge_pages == HugePages::Explicit)
+    {
+        data = mmap(nullptr,
+                    mapping.bytes,
+                    protection,
+                    flags | MAP_HUGETLB,
+                    -1,
+                    0);
+        if (data != MAP_FAILED)
+        {
+            mapping.huge_pages = HugePages::Explicit;
+        }
+    }
+#endif
+    if (data == MAP_FAILED)
+    {
+        data = mmap(nullptr, mapping.bytes, protection, flags, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        // Without reserved hugepages, explicit requests fall back to THP.
+        if (options.huge_pages != HugePages::None &&
+            madvise(data, mapping.bytes, MADV_HUGEPAGE) == 0)
+        {
+            mapping.huge_pages = HugePages::Transparent;
+        }
+#endif
+    }
+    mapping.data = data;
+
+    if (options.numa_policy == NumaPolicy::Interleave)
+    {
+        static const std::vector<int> node_ids =
+            CpuTopology::detect().node_ids;
+        if (node_ids.size() > 1)
+        {
+            interleave(data, mapping.bytes, node_ids);
+        }
+    }
+    return mapping;
+}
+
+
+void unmap_memory(const Mapping &mapping)
+{
+    if (mapping.data)
+    {
+        munmap(mapping.data, mapping.bytes);
+    }
+}
+
+
+void *Arena::allocate(size_t bytes, size_t alignment)
+{
+    const size_t start = round_up(_used, alignment);
+    if (start > _mapping.bytes || bytes > _mapping.bytes - start)
+    {
+        throw std::bad_alloc();
+    }
+    _used = start + bytes;
+    return static_cast<char *>(_mapping.data) + start;
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct CpuTopology
+ * The CPUs this process may run on, grouped by NUMA node.
+ */
+struct CpuTopology
+{
+    std::vector<std::vector<int>> nodes{}; // The CPUs of each node.
+    std::vector<int> node_ids{};           // The id of each node.
+
+    /**
+     * Reads the nodes from /sys/devices/system/node, keeping only the CPUs
+     * in the affinity mask of the process. Nodes without allowed CPUs are
+     * skipped, so the ids of the kept nodes may have gaps. Without NUMA
+     * information all allowed CPUs form a single node 0.
+     * @return The topology.
+     */
+    static CpuTopology detect();
+
+    /**
+     * Returns the number of CPUs over all nodes.
+     * @return The number of CPUs.
+     */
+    size_t num_cpus() const;
+};
+
+/**
+ * @enum PinningPolicy
+ * How worker threads are placed on CPUs.
+ */
+enum class PinningPolicy
+{
+    None,    // Threads are not pinned.
+    Compact, // Fill the CPUs of one node before moving to the next.
+    Scatter, // Alternate between nodes, e.g. to spread memory bandwidth.
+};
+
+/**
+ * Chooses a CPU for each thread; threads wrap around when there are more
+ * threads than CPUs.
+ * @param topology The topology.
+ * @param num_threads The number of threads.
+ * @param policy The pinning policy.
+ * @return The CPU of each thread, or -1 for every thread with
+ * `PinningPolicy::None` or an empty topology.
+ */
+std::vector<int> assign_cpus(const CpuTopology &topology,
+                             size_t num_threads,
+                             PinningPolicy policy);
+
+/**
+ * Pins the calling thread to a CPU with sched_setaffinity.
+ * @param cpu The CPU; a negative value leaves the thread unpinned.
+ * @return Whether the thread was pinned.
+ */
+bool pin_current_thread(int cpu);
+
+/**
+ * @enum HugePages
+ * Which pages back a mapping.
+ */
+enum class HugePages
+{
+    None,        // Regular pages.
+    Transparent, // Transparent hugepages requested with madvise.
+    Explicit,    // Reserved hugetlbfs pages, with a fallback to Transparent.
+};
+
+/**
+ * @enum NumaPolicy
+ * Where the pages of a mapping are placed.
+ */
+enum class NumaPolicy
+{
+    FirstTouch, // On the node of the thread that first writes each page.
+    Interleave, // Round-robin over all nodes, e.g. for shared weights.
+};
+
+/**
+ * @struct MemoryOptions
+ * How large buffers are mapped.
+ */
+struct MemoryOptions
+{
+    HugePages huge_pages = HugePages::None;          // The page kind.
+    NumaPolicy numa_policy = NumaPolicy::FirstTouch; // The placement.
+};
+
+/**
+ * @struct Mapping
+ * An anonymous memory mapping.
+ */
+struct Mapping
+{
+    void *data = nullptr;                   // The first byte.
+    size_t bytes = 0;                       // The mapped size.
+    HugePages huge_pages = HugePages::None; // The pages actually used.
+};
+
+/**
+ * Returns the size mapped for a request, rounded up to whole pages, or to
+ * whole 2 MiB hugepages for `HugePages::Explicit`.
+ * @param bytes The requested size.
+ * @param options The memory options.
+ * @return The mapped size.
+ */
+size_t mapping_size(size_t bytes, const MemoryOptions &options);
+
+/**
+ * Maps zeroed anonymous memory with mmap, then applies the hugepage advice
+ * with madvise and the NUMA policy with mbind. The NUMA policy is best
+ * effort: it is skipped on single-node machines and where mbind is denied.
+ * @param bytes The requested size.
+ * @param options The memory options.
+ * @return The mapping.
+ * @throw std::bad_alloc if the memory cannot be mapped.
+ */
+Mapping map_memory(size_t bytes, const MemoryOptions &options = {});
+
+/**
+ * Unmaps a mapping returned by `map_memory`.
+ * @param mapping The mapping.
+ */
+void unmap_memory(const Mapping &mapping);
+
+/**
+ * @class Arena
+ * This class represents a bump allocator over one mapping, e.g. for the
+ * parameters, gradients and activations of a large static MLP.
+ */
+class Arena
+{
+private:
+    Mapping _mapping; // The backing memory.
+    size_t _used = 0; // The number of allocated bytes.
+
+public:
+    /**
+     * Maps an arena.
+     * @param bytes The capacity.
+     * @param options The memory options.
+     * @throw std::bad_alloc if the memory cannot be mapped.
+     */
+    explicit Arena(size_t bytes, const MemoryOptions &options = {})
+        : _mapping(map_memory(bytes, options)){};
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * Unmaps the arena.
+     */
+    ~Arena()
+    {
+        unmap_memory(_mapping);
+    }
+
+    /**
+     * Returns the capacity.
+     * @return The size of the mapping in bytes.
+     */
+    size_t capacity() const
+    {
+        return _mapping.bytes;
+    }
+
+    /**
+     * Returns the number of allocated bytes, including alignment padding.
+     * @return The used size in bytes.
+     */
+    size_t used() const
+    {
+        return _used;
+    }
+
+    /**
+     * Returns which pages back the arena.
+     * @return The page kind.
+     */
+    HugePages huge_pages() const
+    {
+        return _mapping.huge_pages;
+    }
+
+    /**
+     * Returns the first byte of the arena.
+     * @return The start of the mapping.
+     */
+    void *data() const
+    {
+        return _mapping.data;
+    }
+
+    /**
+     * Allocates memory from the arena.
+     * @param bytes The size.
+     * @param alignment The alignment, a power of two.
+     * @return The memory, zeroed unless it was used before a `reset`.
+     * @throw std::bad_alloc if the arena is full.
+     */
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Allocates an array from the arena.
+     * @param n The number of elements.
+     * @return The first element.
+     * @throw std::bad_alloc if the arena is full.
+     */
+    template <typename T> T *allocate_array(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Constructs an object in the arena. It is never destroyed, so the type
+     * must be trivially destructible.
+     * @param args The constructor arguments.
+     * @return The object.
+     * @throw std::bad_alloc if the arena is full.
+     */
+    template <typename T, typename... Args> T *create(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Makes the whole arena available again.
+     */
+    void reset()
+    {
+        _used = 0;
+    }
+};
+
+/**
+ * @class MappedAllocator
+ * This class represents a standard allocator that maps each allocation with
+ * `map_memory`, so that containers can use hugepages and NUMA policies. With
+ * the default options it forwards to operator new.
+ */
+template <typename T> class MappedAllocator
+{
+private:
+    MemoryOptions _options{}; // How allocations are mapped.
+
+    template <typename U> friend class MappedAllocator;
+
+    bool uses_new() const
+    {
+        return _options.huge_pages == HugePages::None &&
+               _options.numa_policy == NumaPolicy::FirstTouch;
+    }
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    MappedAllocator() = default;
+
+    explicit MappedAllocator(const MemoryOptions &options)
+        : _options(options){};
+
+    template <typename U>
+    MappedAllocator(const MappedAllocator<U> &other) noexcept
+        : _options(other._options)
+    {
+    }
+
+    /**
+     * Returns the memory options.
+     * @return The options.
+     */
+    const MemoryOptions &options() const
+    {
+        return _options;
+    }
+
+    T *allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        if (uses_new())
+        {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(map_memory(n * sizeof(T), _options).data);
+    }
+
+    void deallocate(T *data, size_t n) noexcept
+    {
+        if (uses_new())
+        {
+            ::operator delete(data);
+            return;
+        }
+        unmap_memory({data, mapping_size(n * sizeof(T), _options)});
+    }
+
+    template <typename U>
+    bool operator==(const MappedAllocator<U> &other) const noexcept
+    {
+        return _options.huge_pages == other._options.huge_pages &&
+               _options.numa_policy == other._options.numa_policy;
+    }
+
+    template <typename U>
+    bool operator!=(const MappedAllocator<U> &other) const noexcept
+    {
+        return !(*this == other);
+    }
+};
@@ -0,0 +1,300 @@
+#include "parallel.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+
+namespace
+{
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+thread_local const WorkStealingPool *current_stealing_pool = nullptr;
+thread_local size_t current_stealing_index = 0;
+} // namespace
+
+
+ThreadPool::ThreadPool(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    _cpus.assign(num_threads, -1);
+    _threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        _threads.emplace_back([this, i]() { work(i); });
+    }
+}
+
+
+ThreadPool::ThreadPool(size_t num_threads,
+                       PinningPolicy policy,
+                       const CpuTopology &topology)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(1, topology.num_cpus());
+    }
+    _cpus = assign_cpus(topology, num_threads, policy);
+    _threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        _threads.emplace_back([this, i]() {
+            pin_current_thread(_cpus[i]);
+            work(i);
+        });
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for (auto &thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+
+size_t ThreadPool::worker_index() const
+{
+    return current_pool == this ? current_index : size();
+}
+
+
+void ThreadPool::run_on_each(const std::function<void(size_t)> &task)
+{
+    // Every call waits until all workers have started one, so that no
+    // worker can run two of them.
+    std::mutex mutex;
+    std::condition_variable started;
+    size_t waiting = size();
+    std::vector<std::future<void>> done;
+    done.reserve(size());
+    for (size_t i = 0; i < size(); i++)
+    {
+        done.push_back(submit([&]() {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (--waiting == 0)
+                {
+                    started.notify_all();
+                }
+                started.wait(lock, [&waiting]() { return waiting == 0; });
+            }
+            task(worker_index());
+        }));
+    }
+    std::exception_ptr error;
+    for (auto &future : done)
+    {
+        try
+        {
+            future.get();
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+
+void ThreadPool::work(size_t index)
+{
+    current_pool = this;
+    current_index = index;
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.wait(lock,
+                        [this]() { return _stopping || !_tasks.empty(); });
+            if (_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
+
+
+void first_touch(ThreadPool &pool, void *data, size_t bytes)
+{
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t pages = (bytes + page - 1) / page;
+    const size_t share = (pages + pool.size() - 1) / pool.size();
+    pool.run_on_each([&](size_t index) {
+        const size_t begin = std::min(bytes, index * share * page);
+        const size_t end = std::min(bytes, (index + 1) * share * page);
+        std::memset(static_cast<char *>(data) + begin, 0, end - begin);
+    });
+}
+
+
+WorkStealingPool::WorkStealingPool(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    start(std::vector<int>(num_threads, -1));
+}
+
+
+WorkStealingPool::WorkStealingPool(size_t num_threads,
+                                   PinningPolicy policy,
+                                   const CpuTopology &topology)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(1, topology.num_cpus());
+    }
+    start(assign_cpus(topology, num_threads, policy));
+}
+
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for (auto &thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+
+void WorkStealingPool::start(std::vector<int> cpus)
+{
+    _cpus = std::move(cpus);
+    _workers.reserve(_cpus.size());
+    for (size_t i = 0; i < _cpus.size(); i++)
+    {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    _threads.reserve(_cpus.size());
+    for (size_t i = 0; i < _cpus.size(); i++)
+    {
+        _threads.emplace_back([this, i]() {
+            pin_current_thread(_cpus[i]);
+            work(i);
+        });
+    }
+}
+
+
+size_t WorkStealingPool::worker_index() const
+{
+    return current_stealing_pool == this ? current_stealing_index : size();
+}
+
+
+size_t WorkStealingPool::local_size() const
+{
+    const size_t index = worker_index();
+    if (index == size())
+    {
+        return 0;
+    }
+    return _workers[index]->size.load(std::memory_order_relaxed);
+}
+
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    size_t index = worker_index();
+    if (index == size())
+    {
+        index = _next.fetch_add(1, std::memory_order_relaxed) % size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(_workers[index]->mutex);
+        _workers[index]->tasks.push_back(std::move(task));
+        _workers[index]->size.store(_workers[index]->tasks.size(),
+                                    std::memory_order_relaxed);
+    }
+    {
+        // Counting under the lock keeps a worker from missing the wake-up
+        // between its last check and its wait.
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queued.fetch_add(1);
+    }
+    _ready.notify_one();
+}
+
+
+bool WorkStealingPool::take(size_t index, std::function<void()> &task)
+{
+    {
+        Worker &own = *_workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            own.size.store(own.tasks.size(), std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (size_t k = 1; k < _workers.size(); k++)
+    {
+        Worker &victim = *_workers[(index + k) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            victim.size.store(victim.tasks.size(), std::memory_order_relaxed);
+            _steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void WorkStealingPool::work(size_t index)
+{
+    current_stealing_pool = this;
+    current_stealing_index = index;
+    while (true)
+    {
+        std::function<void()> task;
+        if (take(index, task))
+        {
+            _queued.fetch_sub(1);
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _ready.wait(lock, [this]() { return _stopping || _queued > 0; });
+        if (_stopping && _queued == 0)
+        {
+            return;
+        }
+    }
+}
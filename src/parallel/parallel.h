@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "../numa/numa.h"
+
+/**
+ * @class ThreadPool
+ * This class represents a fixed set of worker threads that run submitted
+ * tasks in FIFO order.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> _threads;        // The worker threads.
+    std::vector<int> _cpus;                   // The CPU of each worker.
+    std::queue<std::function<void()>> _tasks; // The pending tasks.
+    std::mutex _mutex;                        // Guards the tasks.
+    std::condition_variable _ready;           // Signals a task or stop.
+    bool _stopping = false;                   // Whether the pool stops.
+
+    /**
+     * Runs tasks until the pool stops and no task is pending.
+     * @param index The index of the worker.
+     */
+    void work(size_t index);
+
+public:
+    /**
+     * Constructs a thread pool.
+     * @param num_threads The number of worker threads; zero uses the number
+     * of hardware threads.
+     */
+    explicit ThreadPool(size_t num_threads = 0);
+
+    /**
+     * Constructs a thread pool whose workers pin themselves to CPUs.
+     * @param num_threads The number of worker threads; zero uses one per
+     * CPU of the topology.
+     * @param policy How the workers are placed on the CPUs.
+     * @param topology The CPUs to place the workers on.
+     */
+    ThreadPool(size_t num_threads,
+               PinningPolicy policy,
+               const CpuTopology &topology = CpuTopology::detect());
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * Runs the pending tasks and joins the worker threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * Returns the number of worker threads.
+     * @return The number of threads.
+     */
+    size_t size() const
+    {
+        return _threads.size();
+    }
+
+    /**
+     * Returns the CPU assigned to each worker. Pinning is best effort, e.g.
+     * a CPU outside a container's cpuset leaves its worker unpinned.
+     * @return The CPUs, -1 for unpinned workers.
+     */
+    const std::vector<int> &cpus() const
+    {
+        return _cpus;
+    }
+
+    /**
+     * Returns the index of the worker running the calling thread.
+     * @return The index, or `size()` if called from outside the pool.
+     */
+    size_t worker_index() const;
+
+    /**
+     * Runs a task once on every worker and waits for all of them. Each call
+     * occupies all workers at once, so no other task may block the pool.
+     * @param task Called with the index of the worker.
+     * @throw The first exception thrown by a call.
+     */
+    void run_on_each(const std::function<void(size_t)> &task);
+
+    /**
+     * Schedules a task.
+     * @param task The task.
+     * @return A future that becomes ready when the task has finished, and
+     * rethrows its exception.
+     */
+    template <typename F> std::future<void> submit(F &&task)
+    {
+        auto packaged =
+            std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        _ready.notify_one();
+        return result;
+    }
+};
+
+/**
+ * @class WorkStealingPool
+ * This class represents a set of worker threads with one task deque each.
+ * Tasks submitted by a worker go to its own deque, which it runs newest
+ * first; idle workers steal the oldest tasks of the others. This suits
+ * recursive work such as graph traversals, where tasks spawn tasks.
+ * @note Tasks must not throw, and must not block on other tasks of the
+ * same pool.
+ */
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        std::mutex mutex;                        // Guards the deque.
+        std::deque<std::function<void()>> tasks; // The pending tasks.
+        std::atomic<size_t> size{0};             // The size of the deque.
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers; // The deques.
+    std::vector<std::thread> _threads;             // The worker threads.
+    std::vector<int> _cpus;                        // The CPU of each worker.
+    std::atomic<size_t> _queued{0};                // The pending tasks.
+    std::atomic<size_t> _next{0};                  // The next outside deque.
+    std::atomic<size_t> _steals{0};                // The stolen tasks.
+    std::mutex _mutex;                             // Guards sleeping.
+    std::condition_variable _ready;                // Signals a task or stop.
+    bool _stopping = false;                        // Whether the pool stops.
+
+    /**
+     * Starts the worker threads.
+     * @param cpus The CPU of each worker, -1 for unpinned workers.
+     */
+    void start(std::vector<int> cpus);
+
+    /**
+     * Takes the newest task of a worker's own deque, or steals the oldest
+     * task of another deque.
+     * @param index The index of the worker.
+     * @param task Receives the task.
+     * @return Whether a task was found.
+     */
+    bool take(size_t index, std::function<void()> &task);
+
+    /**
+     * Runs tasks until the pool stops and no task is pending.
+     * @param index The index of the worker.
+     */
+    void work(size_t index);
+
+public:
+    /**
+     * Constructs a work-stealing pool.
+     * @param num_threads The number of worker threads; zero uses the number
+     * of hardware threads.
+     */
+    explicit WorkStealingPool(size_t num_threads = 0);
+
+    /**
+     * Constructs a work-stealing pool whose workers pin themselves to CPUs.
+     * @param num_threads The number of worker threads; zero uses one per
+     * CPU of the topology.
+     * @param policy How the workers are placed on the CPUs.
+     * @param topology The CPUs to place the workers on.
+     */
+    WorkStealingPool(size_t num_threads,
+                     PinningPolicy policy,
+                     const CpuTopology &topology = CpuTopology::detect());
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /**
+     * Runs the pending tasks and joins the worker threads.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Returns the number of worker threads.
+     * @return The number of threads.
+     */
+    size_t size() const
+    {
+        return _threads.size();
+    }
+
+    /**
+     * Returns the CPU assigned to each worker.
+     * @return The CPUs, -1 for unpinned workers.
+     */
+    const std::vector<int> &cpus() const
+    {
+        return _cpus;
+    }
+
+    /**
+     * Returns the number of tasks taken from another worker's deque.
+     * @return The number of steals.
+     */
+    size_t steals() const
+    {
+        return _steals.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the index of the worker running the calling thread.
+     * @return The index, or `size()` if called from outside the pool.
+     */
+    size_t worker_index() const;
+
+    /**
+     * Returns the number of tasks in the calling worker's deque, e.g. to run
+     * work inline instead of spawning it once enough is queued.
+     * @return The number of tasks, zero outside the pool.
+     */
+    size_t local_size() const;
+
+    /**
+     * Schedules a task on the calling worker's deque, or round-robin over
+     * the deques when called from outside the pool.
+     * @param task The task.
+     */
+    void submit(std::function<void()> task);
+};
+
+/**
+ * Writes zeros to a buffer from the workers of a pool, each worker touching
+ * a contiguous share of the pages. With the first-touch policy the pages of
+ * each share are placed on the NUMA node of its worker, so pinned workers
+ * that later process the same shares read local memory.
+ * @param pool The pool.
+ * @param data The buffer, not yet touched.
+ * @param bytes The size of the buffer.
+ */
+void first_touch(ThreadPool &pool, void *data, size_t bytes);
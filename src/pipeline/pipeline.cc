@@ -0,0 +1,311 @@
+#include "pipeline.h"
+
+#include <chrono>
+#include <condition_variable>
+
+#include "../loss/loss.h"
+
+
+namespace
+{
+// Counts finished tasks and keeps the first exception.
+class WaitGroup
+{
+private:
+    std::mutex _mutex{};
+    std::condition_variable _finished{};
+    size_t _pending;
+    std::exception_ptr _error{};
+
+public:
+    explicit WaitGroup(size_t pending) : _pending(pending){};
+
+    void done(std::exception_ptr error)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (error && !_error)
+        {
+            _error = error;
+        }
+        if (--_pending == 0)
+        {
+            _finished.notify_all();
+        }
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finished.wait(lock, [this]() { return _pending == 0; });
+        if (_error)
+        {
+            std::rethrow_exception(_error);
+        }
+    }
+};
+
+
+// A coroutine that starts eagerly and frees itself when it finishes.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+
+Detached run_detached(Executor &executor, Task<void> task, WaitGroup &group)
+{
+    co_await executor.schedule();
+    std::exception_ptr error;
+    try
+    {
+        co_await task;
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    {
+        // Free the task before the waiting thread may return.
+        Task<void> finished = std::move(task);
+    }
+    group.done(error);
+}
+
+
+// Runs forward, backward and the update for one batch and returns the sum
+// of the losses.
+double train_batch(MLP &mlp, const std::vector<Sample> &batch, double lr)
+{
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+    double loss_sum = 0;
+    for (const auto &sample : batch)
+    {
+        Variable loss = MSELoss(mlp.forward(sample.inputs), sample.targets);
+        loss_sum += loss.value();
+        loss.set_gradient(1.0);
+        loss.backward();
+    }
+    const double step = lr / static_cast<double>(batch.size());
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.gradient_descent(step);
+    }
+    return loss_sum;
+}
+
+
+// Trains a batch and adds it to the statistics.
+void train_and_record(MLP &mlp,
+                      const std::vector<Sample> &batch,
+                      double lr,
+                      PipelineStats &stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    stats.loss += train_batch(mlp, batch, lr);
+    stats.samples += batch.size();
+    stats.batches++;
+    stats.compute_seconds += std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+}
+
+
+Task<void> read_stage(const std::function<std::optional<std::string>()> &read,
+                      Channel<std::string> &records)
+{
+    try
+    {
+        while (std::optional<std::string> record = read())
+        {
+            co_await records.send(std::move(*record));
+        }
+    }
+    catch (...)
+    {
+        records.close();
+        throw;
+    }
+    records.close();
+}
+
+
+Task<void>
+decode_stage(const std::function<Sample(const std::string &)> &decode,
+             Channel<std::string> &records,
+             Channel<Sample> &samples)
+{
+    try
+    {
+        while (std::optional<std::string> record = co_await records.receive())
+        {
+            co_await samples.send(decode(*record));
+        }
+    }
+    catch (...)
+    {
+        records.close();
+        samples.close();
+        throw;
+    }
+    samples.close();
+}
+
+
+Task<void> batch_stage(Channel<Sample> &samples,
+                       Channel<std::vector<Sample>> &batches,
+                       size_t batch_size)
+{
+    try
+    {
+        std::vector<Sample> batch;
+        while (std::optional<Sample> sample = co_await samples.receive())
+        {
+            batch.push_back(std::move(*sample));
+            if (batch.size() == batch_size)
+            {
+                co_await batches.send(std::move(batch));
+                batch.clear();
+            }
+        }
+        if (!batch.empty())
+        {
+            co_await batches.send(std::move(batch));
+        }
+    }
+    catch (...)
+    {
+        samples.close();
+        batches.close();
+        throw;
+    }
+    batches.close();
+}
+
+
+Task<void> train_stage(MLP &mlp,
+                       Channel<std::vector<Sample>> &batches,
+                       double lr,
+                       PipelineStats &stats)
+{
+    try
+    {
+        while (std::optional<std::vector<Sample>> batch =
+                   co_await batches.receive())
+        {
+            train_and_record(mlp, *batch, lr, stats);
+        }
+    }
+    catch (...)
+    {
+        batches.close();
+        throw;
+    }
+}
+
+
+void finish(PipelineStats &stats)
+{
+    if (stats.samples > 0)
+    {
+        stats.loss /= static_cast<double>(stats.samples);
+    }
+}
+} // namespace
+
+
+void run_all(Executor &executor, std::vector<Task<void>> tasks)
+{
+    WaitGroup group(tasks.size());
+    for (auto &task : tasks)
+    {
+        run_detached(executor, std::move(task), group);
+    }
+    group.wait();
+}
+
+
+PipelineStats
+train_pipelined(MLP &mlp,
+                Executor &executor,
+                const std::function<std::optional<std::string>()> &read,
+                const std::function<Sample(const std::string &)> &decode,
+                const PipelineOptions &options)
+{
+    if (options.batch_size == 0)
+    {
+        throw std::invalid_argument("batch size should be > 0");
+    }
+    Channel<std::string> records(executor, options.channel_capacity);
+    Channel<Sample> samples(executor, options.channel_capacity);
+    Channel<std::vector<Sample>> batches(executor, options.channel_capacity);
+    PipelineStats stats;
+
+    std::vector<Task<void>> stages;
+    stages.push_back(read_stage(read, records));
+    stages.push_back(decode_stage(decode, records, samples));
+    stages.push_back(batch_stage(samples, batches, options.batch_size));
+    stages.push_back(train_stage(mlp, batches, options.lr, stats));
+    run_all(executor, std::move(stages));
+
+    finish(stats);
+    return stats;
+}
+
+
+PipelineStats
+train_synchronous(MLP &mlp,
+                  const std::function<std::optional<std::string>()> &read,
+                  const std::function<Sample(const std::string &)> &decode,
+                  const PipelineOptions &options)
+{
+    if (options.batch_size == 0)
+    {
+        throw std::invalid_argument("batch size should be > 0");
+    }
+    PipelineStats stats;
+    std::vector<Sample> batch;
+    while (std::optional<std::string> record = read())
+    {
+        batch.push_back(decode(*record));
+        if (batch.size() == options.batch_size)
+        {
+            train_and_record(mlp, batch, options.lr, stats);
+            batch.clear();
+        }
+    }
+    if (!batch.empty())
+    {
+        train_and_record(mlp, batch, options.lr, stats);
+    }
+
+    finish(stats);
+    return stats;
+}
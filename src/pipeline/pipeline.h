@@ -0,0 +1,491 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../neural_network/mlp.h"
+#include "../parallel/parallel.h"
+
+/**
+ * @class Executor
+ * This class represents a shared set of threads that resume coroutines, so
+ * that pipeline stages do not need a thread each.
+ */
+class Executor
+{
+private:
+    ThreadPool _pool; // Resumes the scheduled coroutines.
+
+public:
+    /**
+     * Constructs an executor.
+     * @param num_threads The number of threads; zero uses the number of
+     * hardware threads.
+     */
+    explicit Executor(size_t num_threads = 0) : _pool(num_threads){};
+
+    /**
+     * Resumes a suspended coroutine on one of the threads.
+     * @param handle The coroutine.
+     */
+    void post(std::coroutine_handle<> handle)
+    {
+        _pool.submit([handle]() { handle.resume(); });
+    }
+
+    /**
+     * Returns an awaitable that moves the awaiting coroutine onto the
+     * executor.
+     * @return The awaitable.
+     */
+    auto schedule()
+    {
+        struct ScheduleAwaiter
+        {
+            Executor &executor;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                executor.post(handle);
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return ScheduleAwaiter{*this};
+    }
+};
+
+template <typename T> class Task;
+
+/**
+ * @class TaskPromiseBase
+ * The part of a task's promise that does not depend on its result: the
+ * exception and the coroutine to resume when the task finishes.
+ */
+class TaskPromiseBase
+{
+private:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename P>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<P> handle) noexcept
+        {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+public:
+    std::coroutine_handle<> continuation{}; // Resumed when the task ends.
+    std::exception_ptr error{};             // The exception of the task.
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        error = std::current_exception();
+    }
+};
+
+/**
+ * @class TaskPromise
+ * The promise of a task that produces a value.
+ */
+template <typename T> class TaskPromise : public TaskPromiseBase
+{
+public:
+    std::optional<T> value{}; // The result of the task.
+
+    Task<T> get_return_object();
+
+    void return_value(T result)
+    {
+        value = std::move(result);
+    }
+};
+
+/**
+ * @class TaskPromise<void>
+ * The promise of a task that produces no value.
+ */
+template <> class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object();
+
+    void return_void() const noexcept
+    {
+    }
+};
+
+/**
+ * @class Task
+ * This class represents a lazily started coroutine. It runs when awaited and
+ * resumes the awaiting coroutine when it finishes, rethrowing its exception.
+ */
+template <typename T = void> class Task
+{
+public:
+    using promise_type = TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> _handle; // The coroutine.
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : _handle(handle){};
+
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, {})){};
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_handle)
+            {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        _handle.promise().continuation = awaiting;
+        return _handle;
+    }
+
+    T await_resume()
+    {
+        if (_handle.promise().error)
+        {
+            std::rethrow_exception(_handle.promise().error);
+        }
+        if constexpr (!std::is_void_v<T>)
+        {
+            return std::move(*_handle.promise().value);
+        }
+    }
+};
+
+template <typename T> Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(
+        std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @class Channel
+ * This class represents a bounded queue between coroutines. Sending to a
+ * full channel and receiving from an empty one suspend the coroutine instead
+ * of blocking its thread; it is resumed on the executor.
+ */
+template <typename T> class Channel
+{
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> handle; // The suspended coroutine.
+        std::optional<T> *slot;         // The value to send or receive.
+        bool *closed;                   // Set if a sender's channel closed.
+    };
+
+    Executor &_executor;           // Resumes the waiting coroutines.
+    size_t _capacity;              // The number of buffered values.
+    std::mutex _mutex{};             // Guards the state below.
+    std::deque<T> _items{};          // The buffered values.
+    std::deque<Waiter> _senders{};   // The senders waiting for space.
+    std::deque<Waiter> _receivers{}; // The receivers waiting for a value.
+    bool _closed = false;            // Whether the channel is closed.
+
+public:
+    class SendAwaiter
+    {
+    private:
+        Channel &_channel;
+        std::optional<T> _value{};
+        bool _closed = false;
+
+    public:
+        SendAwaiter(Channel &channel, T value)
+            : _channel(channel), _value(std::move(value)){};
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::unique_lock<std::mutex> lock(_channel._mutex);
+            if (_channel._closed)
+            {
+                _closed = true;
+                return false;
+            }
+            if (!_channel._receivers.empty())
+            {
+                Waiter receiver = _channel._receivers.front();
+                _channel._receivers.pop_front();
+                *receiver.slot = std::move(_value);
+                lock.unlock();
+                _channel._executor.post(receiver.handle);
+                return false;
+            }
+            if (_channel._items.size() < _channel._capacity)
+            {
+                _channel._items.push_back(std::move(*_value));
+                return false;
+            }
+            _channel._senders.push_back({handle, &_value, &_closed});
+            return true;
+        }
+
+        void await_resume() const
+        {
+            if (_closed)
+            {
+                throw std::runtime_error("the channel is closed");
+            }
+        }
+    };
+
+    class ReceiveAwaiter
+    {
+    private:
+        Channel &_channel;
+        std::optional<T> _value{};
+
+    public:
+        explicit ReceiveAwaiter(Channel &channel) : _channel(channel){};
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::unique_lock<std::mutex> lock(_channel._mutex);
+            if (!_channel._items.empty())
+            {
+                _value = std::move(_channel._items.front());
+                _channel._items.pop_front();
+                if (!_channel._senders.empty())
+                {
+                    Waiter sender = _channel._senders.front();
+                    _channel._senders.pop_front();
+                    _channel._items.push_back(std::move(**sender.slot));
+                    lock.unlock();
+                    _channel._executor.post(sender.handle);
+                }
+                return false;
+            }
+            if (_channel._closed)
+            {
+                return false;
+            }
+            _channel._receivers.push_back({handle, &_value, nullptr});
+            return true;
+        }
+
+        std::optional<T> await_resume()
+        {
+            return std::move(_value);
+        }
+    };
+
+    /**
+     * Constructs a channel.
+     * @param executor Resumes the waiting coroutines.
+     * @param capacity The number of buffered values, at least one.
+     * @throw std::invalid_argument if the capacity is zero.
+     */
+    Channel(Executor &executor, size_t capacity)
+        : _executor(executor), _capacity(capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("capacity should be > 0");
+        }
+    }
+
+    /**
+     * Sends a value, suspending while the channel is full.
+     * @param value The value.
+     * @return An awaitable that throws std::runtime_error if the channel
+     * is closed.
+     */
+    SendAwaiter send(T value)
+    {
+        return SendAwaiter(*this, std::move(value));
+    }
+
+    /**
+     * Receives a value, suspending while the channel is empty.
+     * @return An awaitable that yields the value, or nothing once the
+     * channel is closed and drained.
+     */
+    ReceiveAwaiter receive()
+    {
+        return ReceiveAwaiter(*this);
+    }
+
+    /**
+     * Closes the channel. Waiting receivers get nothing and waiting senders
+     * throw, so a failed stage unblocks its neighbours.
+     */
+    void close()
+    {
+        std::deque<Waiter> waiting;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+            waiting.swap(_receivers);
+            for (const auto &sender : _senders)
+            {
+                *sender.closed = true;
+                waiting.push_back(sender);
+            }
+            _senders.clear();
+        }
+        for (const auto &waiter : waiting)
+        {
+            _executor.post(waiter.handle);
+        }
+    }
+};
+
+/**
+ * Runs tasks concurrently on an executor and blocks until all of them have
+ * finished.
+ * @param executor The executor.
+ * @param tasks The tasks.
+ * @throw The first exception thrown by a task.
+ */
+void run_all(Executor &executor, std::vector<Task<void>> tasks);
+
+/**
+ * @struct Sample
+ * A decoded training sample.
+ */
+struct Sample
+{
+    std::vector<double> inputs{};  // The input values.
+    std::vector<double> targets{}; // The target values.
+};
+
+/**
+ * @struct PipelineOptions
+ * The configuration of a training pipeline.
+ */
+struct PipelineOptions
+{
+    size_t batch_size = 8;        // The number of samples per update.
+    double lr = 0.01;             // The learning rate.
+    size_t channel_capacity = 64; // The values buffered between stages.
+};
+
+/**
+ * @struct PipelineStats
+ * What a training run did and how long it computed.
+ */
+struct PipelineStats
+{
+    size_t samples = 0;         // The number of trained samples.
+    size_t batches = 0;         // The number of parameter updates.
+    double loss = 0;            // The mean MSE loss over all samples.
+    double compute_seconds = 0; // The time spent in forward to update.
+};
+
+/**
+ * Trains an MLP with a read -> decode -> batch -> train pipeline of
+ * coroutines on an executor. Records are read and decoded while earlier
+ * batches run forward, backward and the update, which stay in order since
+ * each depends on the previous one. Samples are trained in read order, so
+ * the result equals `train_synchronous`.
+ * @param mlp The MLP to train.
+ * @param executor Runs the stages.
+ * @param read Returns the next record, or nothing at the end; may block.
+ * @param decode Converts a record into a sample.
+ * @param options The configuration.
+ * @return The statistics of the run.
+ */
+PipelineStats
+train_pipelined(MLP &mlp,
+                Executor &executor,
+                const std::function<std::optional<std::string>()> &read,
+                const std::function<Sample(const std::string &)> &decode,
+                const PipelineOptions &options = {});
+
+/**
+ * Trains an MLP with the same stages as `train_pipelined`, one after the
+ * other on the calling thread.
+ * @param mlp The MLP to train.
+ * @param read Returns the next record, or nothing at the end; may block.
+ * @param decode Converts a record into a sample.
+ * @param options The configuration.
+ * @return The statistics of the run.
+ */
+PipelineStats
+train_synchronous(MLP &mlp,
+                  const std::function<std::optional<std::string>()> &read,
+                  const std::function<Sample(const std::string &)> &decode,
+                  const PipelineOptions &options = {});
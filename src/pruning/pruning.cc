@@ -0,0 +1,308 @@
+#include "pruning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace
+{
+// Returns the indices of the weights of each layer in `MLP::parameters()`.
+// Parameters are laid out per neuron as its weights followed by its bias.
+std::vector<std::vector<size_t>> weight_indices(const MLP &mlp)
+{
+    std::vector<std::vector<size_t>> indices;
+    size_t parameter = 0;
+    for (const auto &layer : mlp.layers())
+    {
+        indices.emplace_back();
+        indices.back().reserve(layer.n_in() * layer.n_out());
+        for (size_t o = 0; o < layer.n_out(); o++)
+        {
+            for (size_t i = 0; i < layer.n_in(); i++)
+            {
+                indices.back().push_back(parameter++);
+            }
+            parameter++;
+        }
+    }
+    return indices;
+}
+
+
+void prune_parameter(MLP &mlp, size_t index)
+{
+    Variable &parameter = mlp.mutable_parameters()[index];
+    parameter.set_value(0);
+    parameter.set_gradient(0);
+    Variable *weight = parameter.reference();
+    if (weight != nullptr && weight != &parameter)
+    {
+        weight->set_value(0);
+        weight->set_gradient(0);
+    }
+}
+
+
+double weight_value(const MLP &mlp, size_t index)
+{
+    const Variable &parameter = mlp.parameters()[index];
+    const Variable *weight = parameter.reference();
+    return weight != nullptr ? weight->value() : parameter.value();
+}
+} // namespace
+
+
+double PruningMask::sparsity() const
+{
+    size_t pruned = 0;
+    for (bool kept : keep)
+    {
+        pruned += kept ? 0 : 1;
+    }
+    return keep.empty() ? 0.0
+                        : static_cast<double>(pruned) /
+                              static_cast<double>(keep.size());
+}
+
+
+PruningMask magnitude_prune(MLP &mlp, double sparsity, PruningScope scope)
+{
+    if (!(sparsity >= 0 && sparsity <= 1))
+    {
+        throw std::invalid_argument("sparsity should be in [0, 1]");
+    }
+    std::vector<std::vector<size_t>> groups = weight_indices(mlp);
+    if (scope == PruningScope::Global)
+    {
+        std::vector<size_t> all;
+        for (const auto &group : groups)
+        {
+            all.insert(all.end(), group.begin(), group.end());
+        }
+        groups.assign(1, std::move(all));
+    }
+
+    PruningMask mask;
+    mask.keep.assign(mlp.parameters().size(), true);
+    for (auto &group : groups)
+    {
+        const auto count = static_cast<size_t>(
+            std::floor(sparsity * static_cast<double>(group.size())));
+        if (count == 0)
+        {
+            continue;
+        }
+        // Ties are broken by position so that pruning is deterministic.
+        const auto smaller = [&mlp](size_t a, size_t b) {
+            const double lhs = std::fabs(weight_value(mlp, a));
+            const double rhs = std::fabs(weight_value(mlp, b));
+            return lhs < rhs || (lhs == rhs && a < b);
+        };
+        const auto nth = group.begin() + static_cast<std::ptrdiff_t>(count);
+        std::nth_element(group.begin(), nth - 1, group.end(), smaller);
+        for (auto it = group.begin(); it != nth; ++it)
+        {
+            mask.keep[*it] = false;
+            prune_parameter(mlp, *it);
+        }
+    }
+    return mask;
+}
+
+
+void apply_mask(MLP &mlp, const PruningMask &mask)
+{
+    if (mask.keep.size() != mlp.parameters().size())
+    {
+        throw std::invalid_argument("mask does not match the MLP");
+    }
+    for (size_t i = 0; i < mask.keep.size(); i++)
+    {
+        if (!mask.keep[i])
+        {
+            prune_parameter(mlp, i);
+        }
+    }
+}
+
+
+PruningSchedule::PruningSchedule(double initial_sparsity,
+                                 double final_sparsity,
+                                 size_t steps)
+    : _initial_sparsity(initial_sparsity), _final_sparsity(final_sparsity),
+      _steps(steps)
+{
+    if (!(initial_sparsity >= 0 && initial_sparsity <= final_sparsity &&
+          final_sparsity <= 1) ||
+        steps == 0)
+    {
+        throw std::invalid_argument("invalid pruning schedule");
+    }
+}
+
+
+double PruningSchedule::sparsity(size_t step) const
+{
+    if (_steps == 1 || step + 1 >= _steps)
+    {
+        return _final_sparsity;
+    }
+    const double remaining =
+        1.0 - static_cast<double>(step) / static_cast<double>(_steps - 1);
+    return _final_sparsity + (_initial_sparsity - _final_sparsity) *
+                                 remaining * remaining * remaining;
+}
+
+
+PruningMask prune_and_finetune(
+    MLP &mlp,
+    const PruningSchedule &schedule,
+    const std::function<void(MLP &, const PruningMask &)> &finetune,
+    PruningScope scope)
+{
+    PruningMask mask;
+    for (size_t step = 0; step < schedule.steps(); step++)
+    {
+        mask = magnitude_prune(mlp, schedule.sparsity(step), scope);
+        finetune(mlp, mask);
+        apply_mask(mlp, mask);
+    }
+    return mask;
+}
+
+
+SparseMLP::SparseMLP(const MLP &mlp)
+{
+    _layers.reserve(mlp.layers().size());
+    for (const auto &layer : mlp.layers())
+    {
+        std::vector<size_t> row_offsets{0};
+        std::vector<size_t> columns;
+        std::vector<double> values;
+        SparseLayer sparse;
+        sparse.bias.reserve(layer.n_out());
+        for (const auto &neuron : layer.neurons())
+        {
+            const std::vector<Variable> &weights = neuron.weights();
+            for (size_t i = 0; i < weights.size(); i++)
+            {
+                if (weights[i].value() != 0)
+                {
+                    columns.push_back(i);
+                    values.push_back(weights[i].value());
+                }
+            }
+            row_offsets.push_back(values.size());
+            sparse.bias.push_back(neuron.bias().value());
+        }
+        sparse.weights = SparseMatrix(layer.n_out(),
+                                      layer.n_in(),
+                                      std::move(row_offsets),
+                                      std::move(columns),
+                                      std::move(values));
+        sparse.activate_function = layer.activate_function();
+        sparse.activation_mode = layer.activation_mode();
+        _layers.push_back(std::move(sparse));
+    }
+}
+
+
+size_t SparseMLP::nnz() const
+{
+    size_t count = 0;
+    for (const auto &layer : _layers)
+    {
+        count += layer.weights.nnz();
+    }
+    return count;
+}
+
+
+size_t SparseMLP::size_bytes() const
+{
+    size_t size = 0;
+    for (const auto &layer : _layers)
+    {
+        size += layer.weights.values().size() * sizeof(double);
+        size += layer.weights.columns().size() * sizeof(size_t);
+        size += layer.weights.row_offsets().size() * sizeof(size_t);
+        size += layer.bias.size() * sizeof(double);
+    }
+    return size;
+}
+
+
+std::vector<double> SparseMLP::predict(const std::vector<double> &inputs) const
+{
+    if (_layers.empty() || inputs.size() != _layers.front().weights.cols())
+    {
+        throw std::invalid_argument("invalid number of inputs");
+    }
+    std::vector<double> values = inputs;
+    for (const auto &layer : _layers)
+    {
+        values = layer.weights.multiply(values);
+        for (size_t o = 0; o < values.size(); o++)
+        {
+            values[o] += layer.bias[o];
+        }
+        batch_activate(parse_activation(layer.activate_function),
+                       values,
+                       layer.activation_mode);
+    }
+    return values;
+}
+
+
+std::vector<std::vector<double>>
+SparseMLP::predict(const std::vector<std::vector<double>> &batch) const
+{
+    if (_layers.empty())
+    {
+        throw std::invalid_argument("invalid number of inputs");
+    }
+    const size_t n = batch.size();
+    const size_t n_in = _layers.front().weights.cols();
+
+    // Activations are kept feature-major, n_features x n, so that the SpMM
+    // inner loop runs over contiguous samples.
+    std::vector<double> values(n_in * n);
+    for (size_t b = 0; b < n; b++)
+    {
+        if (batch[b].size() != n_in)
+        {
+            throw std::invalid_argument("invalid number of inputs");
+        }
+        for (size_t i = 0; i < n_in; i++)
+        {
+            values[i * n + b] = batch[b][i];
+        }
+    }
+    for (const auto &layer : _layers)
+    {
+        values = layer.weights.multiply(values, n);
+        for (size_t o = 0; o < layer.bias.size(); o++)
+        {
+            double *row = values.data() + o * n;
+            for (size_t b = 0; b < n; b++)
+            {
+                row[b] += layer.bias[o];
+            }
+        }
+        batch_activate(parse_activation(layer.activate_function),
+                       values,
+                       layer.activation_mode);
+    }
+
+    const size_t n_out = _layers.back().weights.rows();
+    std::vector<std::vector<double>> outputs(n, std::vector<double>(n_out));
+    for (size_t b = 0; b < n; b++)
+    {
+        for (size_t o = 0; o < n_out; o++)
+        {
+            outputs[b][o] = values[o * n + b];
+        }
+    }
+    return outputs;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../neural_network/mlp.h"
+#include "../sparse/sparse.h"
+
+/**
+ * @enum PruningScope
+ * How the magnitude threshold of pruning is chosen.
+ */
+enum class PruningScope
+{
+    PerLayer, // Every layer is pruned to the target sparsity.
+    Global,   // One threshold over the weights of all layers.
+};
+
+/**
+ * @struct PruningMask
+ * Which parameters of an MLP survive pruning, ordered like
+ * `MLP::parameters()`. Biases are never pruned.
+ */
+struct PruningMask
+{
+    std::vector<bool> keep; // Whether each parameter is kept.
+
+    /**
+     * Returns the fraction of parameters, biases included, that are pruned.
+     * @return The sparsity of the parameters.
+     */
+    double sparsity() const;
+};
+
+/**
+ * Zeroes the smallest-magnitude weights of an MLP.
+ * @param mlp The MLP to prune in place.
+ * @param sparsity The target fraction of zero weights, in [0, 1].
+ * @param scope Whether the threshold is chosen per layer or globally.
+ * @return The mask of the kept parameters.
+ * @throw std::invalid_argument if the sparsity is out of range.
+ */
+PruningMask magnitude_prune(MLP &mlp,
+                            double sparsity,
+                            PruningScope scope = PruningScope::PerLayer);
+
+/**
+ * Zeroes the value and the gradient of every pruned parameter again, e.g.
+ * after an optimizer step during fine-tuning.
+ * @param mlp The MLP.
+ * @param mask The mask returned by `magnitude_prune`.
+ * @throw std::invalid_argument if the mask does not match the MLP.
+ */
+void apply_mask(MLP &mlp, const PruningMask &mask);
+
+/**
+ * @class PruningSchedule
+ * This class represents a gradual pruning schedule, where the sparsity grows
+ * from an initial to a final value as s_f + (s_i - s_f) * (1 - t / (n - 1))^3.
+ */
+class PruningSchedule
+{
+private:
+    double _initial_sparsity; // The sparsity of the first step.
+    double _final_sparsity;   // The sparsity of the last step.
+    size_t _steps;            // The number of pruning steps.
+
+public:
+    /**
+     * Constructs a pruning schedule.
+     * @param initial_sparsity The sparsity of the first step.
+     * @param final_sparsity The sparsity of the last step.
+     * @param steps The number of pruning steps.
+     * @throw std::invalid_argument if the arguments are out of range.
+     */
+    PruningSchedule(double initial_sparsity,
+                    double final_sparsity,
+                    size_t steps);
+
+    /**
+     * Returns the number of pruning steps.
+     * @return The number of steps.
+     */
+    size_t steps() const
+    {
+        return _steps;
+    }
+
+    /**
+     * Returns the target sparsity of a step.
+     * @param step The step, in [0, steps).
+     * @return The target sparsity.
+     */
+    double sparsity(size_t step) const;
+};
+
+/**
+ * Alternates pruning and fine-tuning along a schedule. The fine-tuning
+ * callback trains the MLP and should call `apply_mask` after each update;
+ * the mask is applied once more after every callback.
+ * @param mlp The MLP to prune in place.
+ * @param schedule The pruning schedule.
+ * @param finetune The fine-tuning callback.
+ * @param scope Whether the threshold is chosen per layer or globally.
+ * @return The mask of the last step.
+ */
+PruningMask prune_and_finetune(
+    MLP &mlp,
+    const PruningSchedule &schedule,
+    const std::function<void(MLP &, const PruningMask &)> &finetune,
+    PruningScope scope = PruningScope::PerLayer);
+
+/**
+ * @struct SparseLayer
+ * A frozen fully connected layer whose weights are stored in CSR format.
+ */
+struct SparseLayer
+{
+    SparseMatrix weights;          // The n_out x n_in weights.
+    std::vector<double> bias;      // The bias of each output.
+    std::string activate_function; // The activation function.
+    ActivationMode activation_mode = ActivationMode::Exact; // The kernel mode.
+};
+
+/**
+ * @class SparseMLP
+ * This class represents a pruned Multi-Layer Perceptron for inference, with
+ * the weights of every layer stored in CSR format. Single inputs run an
+ * SpMV per layer and batches run an SpMM per layer.
+ */
+class SparseMLP
+{
+private:
+    std::vector<SparseLayer> _layers; // The sparse layers.
+
+public:
+    /**
+     * Converts the non-zero weights of an MLP into CSR layers.
+     * @param mlp The pruned MLP.
+     */
+    explicit SparseMLP(const MLP &mlp);
+
+    /**
+     * Returns the sparse layers.
+     * @return The sparse layers.
+     */
+    const std::vector<SparseLayer> &layers() const
+    {
+        return _layers;
+    }
+
+    /**
+     * Returns the number of stored weights.
+     * @return The number of non-zero weights.
+     */
+    size_t nnz() const;
+
+    /**
+     * Returns the storage size of the weights, indices and biases.
+     * @return The size in bytes.
+     */
+    size_t size_bytes() const;
+
+    /**
+     * Computes the output values for an input.
+     * @param inputs The input values.
+     * @return The output values.
+     * @throw std::invalid_argument if the number of inputs does not match.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs) const;
+
+    /**
+     * Computes the output values for a batch of inputs.
+     * @param batch The input values of each sample.
+     * @return The output values of each sample.
+     * @throw std::invalid_argument if the number of inputs does not match.
+     */
+    std::vector<std::vector<double>>
+    predict(const std::vector<std::vector<double>> &batch) const;
+};
@@ -0,0 +1,297 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace
+{
+constexpr double kInt8Max = 127.0;
+
+// Pre-activations beyond this bound saturate the activation function, so the
+// int8 range is spent on the part of the curve that matters.
+double saturation_bound(const std::string &activate_function)
+{
+    if (activate_function == "tanh")
+    {
+        return 4.0;
+    }
+    if (activate_function == "sigmoid")
+    {
+        return 8.0;
+    }
+    return HUGE_VAL;
+}
+
+
+double scale_of(double max_abs)
+{
+    return max_abs > 0 ? max_abs / kInt8Max : 1.0;
+}
+
+
+int8_t saturate(double value)
+{
+    const double clamped = std::min(std::max(value, -kInt8Max), kInt8Max);
+    return static_cast<int8_t>(std::lround(clamped));
+}
+
+
+std::vector<int8_t> quantize_inputs(const std::vector<double> &inputs,
+                                    float scale)
+{
+    std::vector<int8_t> result(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        result[i] = saturate(inputs[i] / static_cast<double>(scale));
+    }
+    return result;
+}
+
+
+// Integer GEMM: every weight row is loaded once and applied to the whole
+// batch, accumulating in int32 before the fused requantize + activation.
+void gemm(const QuantizedLayer &layer,
+          const std::vector<int8_t> &inputs,
+          size_t batch_size,
+          std::vector<int8_t> &outputs)
+{
+    const size_t n_in = layer.n_in;
+    const size_t n_out = layer.n_out;
+    outputs.resize(batch_size * n_out);
+    for (size_t o = 0; o < n_out; o++)
+    {
+        const int8_t *row = layer.weights.data() + o * n_in;
+        const float requantize = layer.requantize[o];
+        for (size_t b = 0; b < batch_size; b++)
+        {
+            const int8_t *x = inputs.data() + b * n_in;
+            int32_t acc = layer.bias[o];
+            for (size_t i = 0; i < n_in; i++)
+            {
+                acc += static_cast<int32_t>(row[i]) *
+                       static_cast<int32_t>(x[i]);
+            }
+            const int8_t z = saturate(static_cast<double>(
+                static_cast<float>(acc) * requantize));
+            outputs[b * n_out + o] =
+                layer.table[static_cast<size_t>(static_cast<int>(z) + 128)];
+        }
+    }
+}
+} // namespace
+
+
+QuantizedMLP::QuantizedMLP(
+    const MLP &mlp,
+    const std::vector<std::vector<double>> &calibration_data,
+    QuantizationGranularity granularity)
+{
+    if (calibration_data.empty())
+    {
+        throw std::invalid_argument("calibration data should not be empty");
+    }
+    const std::vector<Layer> &layers = mlp.layers();
+    const size_t n_layers = layers.size();
+
+    // Float forward pass over the calibration set to record activation ranges.
+    double max_input = 0;
+    std::vector<double> max_preactivation(n_layers, 0.0);
+    for (const auto &sample : calibration_data)
+    {
+        if (sample.size() != layers[0].n_in())
+        {
+            throw std::invalid_argument("invalid number of inputs");
+        }
+        for (double value : sample)
+        {
+            max_input = std::max(max_input, std::fabs(value));
+        }
+        std::vector<double> activations = sample;
+        for (size_t l = 0; l < n_layers; l++)
+        {
+            const auto &neurons = layers[l].neurons();
+            const ActivationFunction activation =
+                parse_activation(layers[l].activate_function());
+            std::vector<double> next(neurons.size());
+            for (size_t o = 0; o < neurons.size(); o++)
+            {
+                double z = neurons[o].bias().value();
+                const auto &weights = neurons[o].weights();
+                for (size_t i = 0; i < weights.size(); i++)
+                {
+                    z += weights[i].value() * activations[i];
+                }
+                max_preactivation[l] =
+                    std::max(max_preactivation[l], std::fabs(z));
+                next[o] = activate(activation, z);
+            }
+            activations = std::move(next);
+        }
+    }
+
+    _layers.resize(n_layers);
+    float input_scale = static_cast<float>(scale_of(max_input));
+    for (size_t l = 0; l < n_layers; l++)
+    {
+        const Layer &layer = layers[l];
+        QuantizedLayer &q = _layers[l];
+        q.n_in = layer.n_in();
+        q.n_out = layer.n_out();
+        q.activate_function = layer.activate_function();
+        q.input_scale = input_scale;
+
+        // Symmetric weight scales.
+        const auto &neurons = layer.neurons();
+        std::vector<double> max_weight(q.n_out, 0.0);
+        for (size_t o = 0; o < q.n_out; o++)
+        {
+            for (const auto &weight : neurons[o].weights())
+            {
+                max_weight[o] =
+                    std::max(max_weight[o], std::fabs(weight.value()));
+            }
+        }
+        if (granularity == QuantizationGranularity::PerLayer)
+        {
+            const double layer_max =
+                *std::max_element(max_weight.begin(), max_weight.end());
+            std::fill(max_weight.begin(), max_weight.end(), layer_max);
+        }
+
+        const double bound = std::min(max_preactivation[l],
+                                      saturation_bound(q.activate_function));
+        q.preactivation_scale = static_cast<float>(scale_of(bound));
+
+        q.weights.resize(q.n_out * q.n_in);
+        q.bias.resize(q.n_out);
+        q.weight_scales.resize(q.n_out);
+        q.requantize.resize(q.n_out);
+        for (size_t o = 0; o < q.n_out; o++)
+        {
+            const double weight_scale = scale_of(max_weight[o]);
+            const double acc_scale =
+                weight_scale * static_cast<double>(q.input_scale);
+            const auto &weights = neurons[o].weights();
+            for (size_t i = 0; i < q.n_in; i++)
+            {
+                q.weights[o * q.n_in + i] =
+                    saturate(weights[i].value() / weight_scale);
+            }
+            q.bias[o] = static_cast<int32_t>(
+                std::lround(neurons[o].bias().value() / acc_scale));
+            q.weight_scales[o] = static_cast<float>(weight_scale);
+            q.requantize[o] = static_cast<float>(
+                acc_scale / static_cast<double>(q.preactivation_scale));
+        }
+
+        // The lookup table maps an int8 pre-activation to an int8 output.
+        const bool bounded = q.activate_function == "tanh" ||
+                             q.activate_function == "sigmoid";
+        q.output_scale = bounded ? static_cast<float>(1.0 / kInt8Max)
+                                 : q.preactivation_scale;
+        for (int z = -128; z < 128; z++)
+        {
+            const double value =
+                activate(parse_activation(q.activate_function),
+                         z * static_cast<double>(q.preactivation_scale));
+            q.table[static_cast<size_t>(z + 128)] =
+                saturate(value / static_cast<double>(q.output_scale));
+        }
+        input_scale = q.output_scale;
+    }
+}
+
+
+size_t QuantizedMLP::size_bytes() const
+{
+    size_t size = 0;
+    for (const auto &layer : _layers)
+    {
+        size += layer.weights.size() * sizeof(int8_t);
+        size += layer.bias.size() * sizeof(int32_t);
+        size += layer.weight_scales.size() * sizeof(float);
+        size += layer.requantize.size() * sizeof(float);
+        size += layer.table.size() * sizeof(int8_t);
+    }
+    return size;
+}
+
+
+std::vector<double> QuantizedMLP::forward(
+    const std::vector<double> &inputs) const
+{
+    return forward(std::vector<std::vector<double>>{inputs})[0];
+}
+
+
+std::vector<std::vector<double>> QuantizedMLP::forward(
+    const std::vector<std::vector<double>> &batch) const
+{
+    const size_t batch_size = batch.size();
+    const size_t n_in = _layers.front().n_in;
+    std::vector<int8_t> activations(batch_size * n_in);
+    for (size_t b = 0; b < batch_size; b++)
+    {
+        if (batch[b].size() != n_in)
+        {
+            throw std::runtime_error("invalid number of inputs");
+        }
+        const std::vector<int8_t> sample =
+            quantize_inputs(batch[b], _layers.front().input_scale);
+        std::copy(sample.begin(),
+                  sample.end(),
+                  activations.begin() + static_cast<std::ptrdiff_t>(b * n_in));
+    }
+
+    std::vector<int8_t> next;
+    for (const auto &layer : _layers)
+    {
+        gemm(layer, activations, batch_size, next);
+        std::swap(activations, next);
+    }
+
+    const QuantizedLayer &last = _layers.back();
+    std::vector<std::vector<double>> result(batch_size,
+                                            std::vector<double>(last.n_out));
+    for (size_t b = 0; b < batch_size; b++)
+    {
+        for (size_t o = 0; o < last.n_out; o++)
+        {
+            result[b][o] = static_cast<double>(last.output_scale) *
+                           activations[b * last.n_out + o];
+        }
+    }
+    return result;
+}
+
+
+QuantizationReport QuantizedMLP::evaluate(
+    MLP &mlp,
+    const std::vector<std::vector<double>> &dataset) const
+{
+    QuantizationReport report;
+    report.num_samples = dataset.size();
+    report.float_bytes = mlp.parameters().size() * sizeof(double);
+    report.quantized_bytes = size_bytes();
+
+    const std::vector<std::vector<double>> quantized = forward(dataset);
+    double total_error = 0;
+    size_t count = 0;
+    for (size_t b = 0; b < dataset.size(); b++)
+    {
+        const std::vector<Variable> &expected = mlp.forward(dataset[b]);
+        for (size_t o = 0; o < expected.size(); o++)
+        {
+            const double error =
+                std::fabs(expected[o].value() - quantized[b][o]);
+            report.max_abs_error = std::max(report.max_abs_error, error);
+            total_error += error;
+            count++;
+        }
+    }
+    report.mean_abs_error =
+        count > 0 ? total_error / static_cast<double>(count) : 0;
+    return report;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../neural_network/mlp.h"
+
+/**
+ * @enum QuantizationGranularity
+ * How the weight scales of a quantized layer are shared.
+ */
+enum class QuantizationGranularity
+{
+    PerLayer,   // One scale for all weights of a layer.
+    PerChannel, // One scale for each neuron (output channel) of a layer.
+};
+
+/**
+ * @struct QuantizedLayer
+ * A frozen int8 fully connected layer.
+ * Real values are recovered as `real = scale * quantized`.
+ */
+struct QuantizedLayer
+{
+    size_t n_in = 0;                  // The number of inputs.
+    size_t n_out = 0;                 // The number of outputs.
+    std::string activate_function;    // The activation function.
+    std::vector<int8_t> weights;      // Row-major weights, n_out x n_in.
+    std::vector<int32_t> bias;        // Bias in accumulator units.
+    std::vector<float> weight_scales; // Weight scale of each output channel.
+    std::vector<float> requantize;    // Accumulator to pre-activation scale.
+    float input_scale = 1.0f;         // Scale of the int8 inputs.
+    float preactivation_scale = 1.0f; // Scale of the int8 pre-activations.
+    float output_scale = 1.0f;        // Scale of the int8 outputs.
+    std::array<int8_t, 256> table{};  // Activation lookup table.
+};
+
+/**
+ * @struct QuantizationReport
+ * The accuracy drift of a quantized model against the floating point path.
+ */
+struct QuantizationReport
+{
+    size_t num_samples = 0;     // The number of evaluated samples.
+    double max_abs_error = 0;   // The largest absolute output difference.
+    double mean_abs_error = 0;  // The mean absolute output difference.
+    size_t float_bytes = 0;     // The parameter size of the float model.
+    size_t quantized_bytes = 0; // The parameter size of the quantized model.
+};
+
+/**
+ * @class QuantizedMLP
+ * This class represents an int8 post-training quantized Multi-Layer Perceptron.
+ * Inference runs integer kernels with int32 accumulation, followed by a fused
+ * requantize and activation step; tanh and sigmoid use a lookup table.
+ */
+class QuantizedMLP
+{
+private:
+    std::vector<QuantizedLayer> _layers; // The quantized layers.
+
+public:
+    /**
+     * Quantizes a trained MLP.
+     * @param mlp The trained MLP.
+     * @param calibration_data Sample inputs used to calibrate the activation scales.
+     * @param granularity The granularity of the weight scales.
+     */
+    QuantizedMLP(const MLP &mlp,
+                 const std::vector<std::vector<double>> &calibration_data,
+                 QuantizationGranularity granularity =
+                     QuantizationGranularity::PerChannel);
+
+    /**
+     * Returns the quantized layers.
+     * @return The quantized layers.
+     */
+    const std::vector<QuantizedLayer> &layers() const
+    {
+        return _layers;
+    }
+
+    /**
+     * Returns the size of the quantized parameters in bytes.
+     * @return The size in bytes.
+     */
+    size_t size_bytes() const;
+
+    /**
+     * Runs quantized inference on a single sample.
+     * @param inputs The input values.
+     * @return The dequantized output values.
+     */
+    std::vector<double> forward(const std::vector<double> &inputs) const;
+
+    /**
+     * Runs quantized inference on a batch of samples.
+     * @param batch The input values of each sample.
+     * @return The dequantized output values of each sample.
+     */
+    std::vector<std::vector<double>> forward(
+        const std::vector<std::vector<double>> &batch) const;
+
+    /**
+     * Measures the accuracy drift against the floating point model.
+     * @param mlp The floating point MLP this model was quantized from.
+     * @param dataset The inputs to evaluate.
+     * @return The drift report.
+     */
+    QuantizationReport evaluate(
+        MLP &mlp,
+        const std::vector<std::vector<double>> &dataset) const;
+};
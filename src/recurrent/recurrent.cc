@@ -0,0 +1,580 @@
+#include "recurrent.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+#include "../determinism/determinism.h"
+
+
+namespace
+{
+// The number of steps per block of the input projection.
+const size_t block_steps = 64;
+
+
+// The name of the nodes of a recurrent layer, a literal so it is interned.
+const char node_name[] = "recurrent";
+
+
+using Coefficients = std::vector<double, PoolAllocator<double>>;
+
+
+double sigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+
+// Builds a node whose local derivative with respect to each child is known
+// when it is built, so its backward pass scales the gradient by them.
+Variable local_node(double value,
+                    Variable::Children children,
+                    Coefficients coefficients)
+{
+    Variable result(value, 0.0, "", node_name);
+    result.mutable_children() = std::move(children);
+    result.set_backward([coefficients = std::move(coefficients)](
+                            Variable *node) {
+        Variable::Children &inputs = node->mutable_children();
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i].update_gradient(node->gradient() * coefficients[i]);
+        }
+    });
+    // The node is copied into its parent, which must not refer back to it.
+    result.set_ref(nullptr);
+    return result;
+}
+
+
+// The input part W x + b of a neuron, whose value comes from the projection
+// of the whole sequence. The input is read from the layer at backward time.
+Variable input_part(const Neuron &neuron,
+                    size_t n_in,
+                    const double *input,
+                    double projected)
+{
+    Variable result(projected, 0.0, "", node_name);
+    Variable::Children &children = result.mutable_children();
+    children.reserve(n_in + 1);
+    children.append(neuron.weights().begin(),
+                    neuron.weights().begin() + static_cast<long>(n_in));
+    children.push_back(neuron.bias());
+    result.set_backward([n_in, input](Variable *node) {
+        Variable::Children &inputs = node->mutable_children();
+        const double grad = node->gradient();
+        for (size_t i = 0; i < n_in; i++)
+        {
+            inputs[i].update_gradient(grad * input[i]);
+        }
+        inputs[n_in].update_gradient(grad);
+    });
+    result.set_ref(nullptr);
+    return result;
+}
+
+
+// The recurrent part U h of a neuron on the leaves of the previous state.
+Variable hidden_part(const Neuron &neuron,
+                     size_t n_in,
+                     const std::deque<Variable> &leaves,
+                     size_t first)
+{
+    const size_t n_hidden = neuron.weights().size() - n_in;
+    double value = 0;
+    for (size_t j = 0; j < n_hidden; j++)
+    {
+        value +=
+            neuron.weights()[n_in + j].value() * leaves[first + j].value();
+    }
+    Variable result(value, 0.0, "", node_name);
+    Variable::Children &children = result.mutable_children();
+    children.reserve(2 * n_hidden);
+    children.append(neuron.weights().begin() + static_cast<long>(n_in),
+                    neuron.weights().end());
+    for (size_t j = 0; j < n_hidden; j++)
+    {
+        // Copies of the leaves pass their gradient on to the leaves.
+        children.push_back(leaves[first + j]);
+    }
+    result.set_backward([n_hidden](Variable *node) {
+        Variable::Children &inputs = node->mutable_children();
+        const double grad = node->gradient();
+        for (size_t j = 0; j < n_hidden; j++)
+        {
+            inputs[j].update_gradient(grad * inputs[n_hidden + j].value());
+            inputs[n_hidden + j].update_gradient(grad * inputs[j].value());
+        }
+    });
+    result.set_ref(nullptr);
+    return result;
+}
+
+
+// A gate, activate(W x + b + U h), with a sigmoid or a tanh.
+Variable gate(const Variable &input, const Variable &hidden, bool logistic)
+{
+    const double preactivation = input.value() + hidden.value();
+    const double value =
+        logistic ? sigmoid(preactivation) : std::tanh(preactivation);
+    const double derivative =
+        logistic ? value * (1.0 - value) : 1.0 - value * value;
+    Variable::Children children;
+    children.reserve(2);
+    children.push_back(input);
+    children.push_back(hidden);
+    return local_node(value, std::move(children), {derivative, derivative});
+}
+} // namespace
+
+
+Recurrent::Recurrent(CellKind kind,
+                     size_t n_in,
+                     size_t n_hidden,
+                     size_t bptt_window,
+                     InitScheme scheme,
+                     ThreadPool *pool)
+    : _kind(kind), _n_in(n_in), _n_hidden(n_hidden),
+      _n_gates(kind == CellKind::RNN ? 1 : kind == CellKind::GRU ? 3 : 4),
+      _bptt_window(bptt_window)
+{
+    if (n_in == 0 || n_hidden == 0)
+    {
+        throw std::invalid_argument("sizes should be positive");
+    }
+    const size_t n_neurons = _n_gates * n_hidden;
+    const size_t fan_in = n_in + n_hidden;
+    std::vector<double> values((fan_in + 1) * n_neurons);
+    initialize_layer(
+        values.data(), fan_in, n_neurons, scheme, next_seed(), pool);
+    if (kind == CellKind::LSTM)
+    {
+        // The forget gates start open, so that the cell state is kept.
+        for (size_t j = 0; j < n_hidden; j++)
+        {
+            values[(n_hidden + j) * (fan_in + 1) + fan_in] = 1.0;
+        }
+    }
+
+    _neurons.reserve(n_neurons);
+    _parameters.reserve(values.size());
+    for (size_t k = 0; k < n_neurons; k++)
+    {
+        const double *neuron_values = values.data() + k * (fan_in + 1);
+        _neurons.emplace_back(
+            neuron_values, fan_in, neuron_values[fan_in], "identity");
+        for (const auto &parameter : _neurons[k].parameters())
+        {
+            _parameters.push_back(parameter);
+        }
+    }
+    _state.assign(state_size(), 0.0);
+}
+
+
+Recurrent::Packed Recurrent::pack() const
+{
+    Packed packed;
+    packed.input.reserve(_neurons.size() * _n_in);
+    packed.hidden.reserve(_neurons.size() * _n_hidden);
+    packed.bias.reserve(_neurons.size());
+    for (const auto &neuron : _neurons)
+    {
+        for (size_t i = 0; i < _n_in; i++)
+        {
+            packed.input.push_back(neuron.weights()[i].value());
+        }
+        for (size_t j = 0; j < _n_hidden; j++)
+        {
+            packed.hidden.push_back(neuron.weights()[_n_in + j].value());
+        }
+        packed.bias.push_back(neuron.bias().value());
+    }
+    return packed;
+}
+
+
+std::vector<double> Recurrent::project(const Packed &packed,
+                                       const double *inputs,
+                                       size_t n_steps) const
+{
+    const size_t n_neurons = _neurons.size();
+    std::vector<double> result(n_steps * n_neurons);
+    for (size_t first = 0; first < n_steps; first += block_steps)
+    {
+        const size_t last = std::min(n_steps, first + block_steps);
+        for (size_t k = 0; k < n_neurons; k++)
+        {
+            const double *weights = packed.input.data() + k * _n_in;
+            for (size_t t = first; t < last; t++)
+            {
+                const double *input = inputs + t * _n_in;
+                double sum = packed.bias[k];
+                for (size_t i = 0; i < _n_in; i++)
+                {
+                    sum += weights[i] * input[i];
+                }
+                result[t * n_neurons + k] = sum;
+            }
+        }
+    }
+    return result;
+}
+
+
+void Recurrent::advance(const Packed &packed,
+                        const double *projected,
+                        std::vector<double> &state) const
+{
+    const size_t H = _n_hidden;
+    std::vector<double> hidden(_neurons.size());
+    for (size_t k = 0; k < hidden.size(); k++)
+    {
+        const double *weights = packed.hidden.data() + k * H;
+        double sum = 0;
+        for (size_t j = 0; j < H; j++)
+        {
+            sum += weights[j] * state[j];
+        }
+        hidden[k] = sum;
+    }
+
+    for (size_t j = 0; j < H; j++)
+    {
+        switch (_kind)
+        {
+        case CellKind::RNN:
+            state[j] = std::tanh(projected[j] + hidden[j]);
+            break;
+        case CellKind::GRU:
+        {
+            const double r = sigmoid(projected[j] + hidden[j]);
+            const double z = sigmoid(projected[H + j] + hidden[H + j]);
+            const double n =
+                std::tanh(projected[2 * H + j] + r * hidden[2 * H + j]);
+            state[j] = (1.0 - z) * n + z * state[j];
+            break;
+        }
+        case CellKind::LSTM:
+        {
+            const double i = sigmoid(projected[j] + hidden[j]);
+            const double f = sigmoid(projected[H + j] + hidden[H + j]);
+            const double g =
+                std::tanh(projected[2 * H + j] + hidden[2 * H + j]);
+            const double o = sigmoid(projected[3 * H + j] + hidden[3 * H + j]);
+            state[H + j] = f * state[H + j] + i * g;
+            state[j] = o * std::tanh(state[H + j]);
+            break;
+        }
+        }
+    }
+}
+
+
+void Recurrent::build_step(size_t step,
+                           const double *input,
+                           const double *projected)
+{
+    const size_t H = _n_hidden;
+    const size_t size = state_size();
+    // The leaves start with the state before the first kept step.
+    const size_t previous = (step - 1 - _first_kept) * size;
+    const auto input_gate = [&](size_t k) {
+        return input_part(_neurons[k], _n_in, input, projected[k]);
+    };
+    const auto hidden_gate = [&](size_t k) {
+        return hidden_part(_neurons[k], _n_in, _leaves, previous);
+    };
+
+    std::vector<Variable> nodes;
+    nodes.reserve(size);
+    for (size_t j = 0; j < H; j++)
+    {
+        switch (_kind)
+        {
+        case CellKind::RNN:
+            nodes.push_back(gate(input_gate(j), hidden_gate(j), false));
+            break;
+        case CellKind::GRU:
+        {
+            const Variable r = gate(input_gate(j), hidden_gate(j), true);
+            const Variable z =
+                gate(input_gate(H + j), hidden_gate(H + j), true);
+            const Variable a = input_gate(2 * H + j);
+            const Variable u = hidden_gate(2 * H + j);
+            const double n = std::tanh(a.value() + r.value() * u.value());
+            const double dn = 1.0 - n * n;
+            Variable::Children candidate_children;
+            candidate_children.reserve(3);
+            candidate_children.push_back(a);
+            candidate_children.push_back(r);
+            candidate_children.push_back(u);
+            const Variable candidate =
+                local_node(n,
+                           std::move(candidate_children),
+                           {dn, dn * u.value(), dn * r.value()});
+
+            const Variable &h = _leaves[previous + j];
+            const double value = (1.0 - z.value()) * n + z.value() * h.value();
+            Variable::Children children;
+            children.reserve(3);
+            children.push_back(z);
+            children.push_back(candidate);
+            children.push_back(h);
+            nodes.push_back(local_node(value,
+                                       std::move(children),
+                                       {h.value() - n, 1.0 - z.value(),
+                                        z.value()}));
+            break;
+        }
+        case CellKind::LSTM:
+        {
+            // `nodes` collects the cell states; the hidden states are built
+            // below, once the leaves of the cell states exist.
+            const Variable i = gate(input_gate(j), hidden_gate(j), true);
+            const Variable f =
+                gate(input_gate(H + j), hidden_gate(H + j), true);
+            const Variable g =
+                gate(input_gate(2 * H + j), hidden_gate(2 * H + j), false);
+            const Variable &c = _leaves[previous + H + j];
+            Variable::Children children;
+            children.reserve(4);
+            children.push_back(f);
+            children.push_back(c);
+            children.push_back(i);
+            children.push_back(g);
+            nodes.push_back(
+                local_node(f.value() * c.value() + i.value() * g.value(),
+                           std::move(children),
+                           {c.value(), f.value(), g.value(), i.value()}));
+            break;
+        }
+        }
+    }
+
+    if (_kind != CellKind::LSTM)
+    {
+        for (const auto &node : nodes)
+        {
+            _leaves.emplace_back(node.value());
+        }
+        _nodes.insert(_nodes.end(),
+                      std::make_move_iterator(nodes.begin()),
+                      std::make_move_iterator(nodes.end()));
+        return;
+    }
+
+    // The hidden state of an LSTM, o * tanh(c), refers to the leaf of the
+    // new cell state, so the leaves are added before its nodes.
+    const size_t current = previous + size;
+    std::vector<Variable> outputs;
+    outputs.reserve(H);
+    for (size_t j = 0; j < H; j++)
+    {
+        outputs.push_back(
+            gate(input_gate(3 * H + j), hidden_gate(3 * H + j), true));
+        // A moved node refers to itself, which its parent must not.
+        outputs[j].set_ref(nullptr);
+        const double cell = std::tanh(nodes[j].value());
+        _leaves.emplace_back(outputs[j].value() * cell);
+    }
+    for (size_t j = 0; j < H; j++)
+    {
+        _leaves.emplace_back(nodes[j].value());
+    }
+    for (size_t j = 0; j < H; j++)
+    {
+        const Variable &o = outputs[j];
+        const Variable &c = _leaves[current + H + j];
+        const double cell = std::tanh(c.value());
+        Variable::Children children;
+        children.reserve(2);
+        children.push_back(o);
+        children.push_back(c);
+        _nodes.push_back(local_node(_leaves[current + j].value(),
+                                    std::move(children),
+                                    {cell, o.value() * (1.0 - cell * cell)}));
+    }
+    _nodes.insert(_nodes.end(),
+                  std::make_move_iterator(nodes.begin()),
+                  std::make_move_iterator(nodes.end()));
+}
+
+
+void Recurrent::check_input(size_t size) const
+{
+    if (size != _n_in)
+    {
+        throw std::runtime_error("invalid number of inputs");
+    }
+}
+
+
+void Recurrent::reset_state()
+{
+    std::fill(_state.begin(), _state.end(), 0.0);
+    _packed_valid = false;
+}
+
+
+void Recurrent::set_state(const std::vector<double> &state)
+{
+    if (state.size() != state_size())
+    {
+        throw std::invalid_argument("invalid size of the state");
+    }
+    _state = state;
+    _packed_valid = false;
+}
+
+
+std::vector<std::vector<Variable>>
+Recurrent::forward(const std::vector<std::vector<double>> &sequence)
+{
+    for (const auto &input : sequence)
+    {
+        check_input(input.size());
+    }
+    // The nodes of the previous pass read its inputs, so they go first.
+    _nodes.clear();
+    _leaves.clear();
+    _first_kept = 0;
+    // The parameters are about to be trained, so `step` packs them again.
+    _packed_valid = false;
+
+    // The inputs of the kept steps are held in a ring with a slot more than
+    // the window, since a step is built before the oldest one is released.
+    const size_t n_steps = sequence.size();
+    const size_t n_slots =
+        _bptt_window == 0 ? n_steps : std::min(n_steps, _bptt_window + 1);
+    _inputs.assign(n_slots * _n_in, 0.0);
+
+    const size_t size = state_size();
+    const size_t n_neurons = _neurons.size();
+    const Packed packed = pack();
+    for (const double value : _state)
+    {
+        _leaves.emplace_back(value);
+    }
+    std::vector<std::vector<Variable>> result;
+    result.reserve(n_steps);
+    std::vector<double> block;
+    block.reserve(std::min(n_steps, block_steps) * _n_in);
+    for (size_t first = 0; first < n_steps; first += block_steps)
+    {
+        const size_t last = std::min(n_steps, first + block_steps);
+        block.clear();
+        for (size_t t = first; t < last; t++)
+        {
+            block.insert(block.end(), sequence[t].begin(), sequence[t].end());
+        }
+        const std::vector<double> projected =
+            project(packed, block.data(), last - first);
+
+        for (size_t t = first; t < last; t++)
+        {
+            double *input = _inputs.data() + t % n_slots * _n_in;
+            std::copy(sequence[t].begin(), sequence[t].end(), input);
+            build_step(
+                t + 1, input, projected.data() + (t - first) * n_neurons);
+
+            const size_t current = (t + 1 - _first_kept) * size;
+            std::vector<Variable> outputs;
+            outputs.reserve(_n_hidden);
+            for (size_t j = 0; j < _n_hidden; j++)
+            {
+                outputs.push_back(_leaves[current + j]);
+            }
+            result.push_back(std::move(outputs));
+
+            if (_bptt_window != 0 && t + 1 - _first_kept > _bptt_window)
+            {
+                // The state before the oldest step goes with its nodes, and
+                // its outputs become plain values.
+                _nodes.erase(_nodes.begin(),
+                             _nodes.begin() + static_cast<long>(size));
+                _leaves.erase(_leaves.begin(),
+                              _leaves.begin() + static_cast<long>(size));
+                if (_first_kept > 0)
+                {
+                    for (auto &output : result[_first_kept - 1])
+                    {
+                        output.set_ref(nullptr);
+                    }
+                }
+                _first_kept++;
+            }
+        }
+    }
+
+    const size_t last = (n_steps - _first_kept) * size;
+    for (size_t s = 0; s < size; s++)
+    {
+        _state[s] = _leaves[last + s].value();
+    }
+    return result;
+}
+
+
+void Recurrent::backward()
+{
+    const size_t size = state_size();
+    const size_t n_kept = num_kept_steps();
+    // The hidden nodes of an LSTM step come before its cell nodes, so the
+    // gradient of the cell leaf is complete when its nodes run.
+    for (size_t kept = n_kept; kept-- > 0;)
+    {
+        for (size_t s = 0; s < size; s++)
+        {
+            Variable &node = _nodes[kept * size + s];
+            node.set_gradient(_leaves[(kept + 1) * size + s].gradient());
+            node.backward();
+        }
+    }
+    _nodes.clear();
+    _packed_valid = false;
+}
+
+
+std::vector<std::vector<double>>
+Recurrent::predict(const std::vector<std::vector<double>> &sequence) const
+{
+    std::vector<double> inputs;
+    inputs.reserve(sequence.size() * _n_in);
+    for (const auto &input : sequence)
+    {
+        check_input(input.size());
+        inputs.insert(inputs.end(), input.begin(), input.end());
+    }
+    const Packed packed = pack();
+    const std::vector<double> projected =
+        project(packed, inputs.data(), sequence.size());
+
+    std::vector<double> state(state_size(), 0.0);
+    std::vector<std::vector<double>> result;
+    result.reserve(sequence.size());
+    for (size_t step = 0; step < sequence.size(); step++)
+    {
+        advance(packed, projected.data() + step * _neurons.size(), state);
+        result.emplace_back(state.begin(),
+                            state.begin() + static_cast<long>(_n_hidden));
+    }
+    return result;
+}
+
+
+std::vector<double> Recurrent::step(const std::vector<double> &input)
+{
+    check_input(input.size());
+    if (!_packed_valid)
+    {
+        _packed = pack();
+        _packed_valid = true;
+    }
+    const std::vector<double> projected = project(_packed, input.data(), 1);
+    advance(_packed, projected.data(), _state);
+    return std::vector<double>(_state.begin(),
+                               _state.begin() + static_cast<long>(_n_hidden));
+}
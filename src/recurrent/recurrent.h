@@ -0,0 +1,367 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "../initializer/initializer.h"
+#include "../neuron/neuron.h"
+
+/**
+ * The cells of a recurrent layer.
+ */
+enum class CellKind
+{
+    RNN,  // h' = tanh(W x + U h + b).
+    GRU,  // Reset, update and candidate gates.
+    LSTM, // Input, forget, cell and output gates with a cell state.
+};
+
+/**
+ * @class Recurrent
+ * This class represents a recurrent layer, the base of `RNN`, `GRU` and
+ * `LSTM`. Each gate of each hidden unit is a neuron over the input followed
+ * by the hidden state, and the neurons are laid out gate by gate. The GRU
+ * follows PyTorch, n = tanh(W_n x + b_n + r * U_n h), except that the bias of
+ * the candidate is not split.
+ *
+ * Unrolled naively, every node of a step would copy the nodes of all earlier
+ * steps into its children. On a graph, the state of each step is instead a
+ * leaf held by the layer, and the nodes of the step refer to the leaves of
+ * the previous one. `backward` then runs the steps in reverse, each passing
+ * its gradient to the previous leaves, so the graph of a step stays of size
+ * gates * hidden * (inputs + hidden) whatever the length of the sequence.
+ * Only the graphs of the last `bptt_window` steps are kept, with their inputs
+ * and the state they start from, which bounds the memory of a pass to the
+ * window and truncates backpropagation through time.
+ *
+ * The input projections of all steps of a sequence are computed up front
+ * with one matrix product. The layer carries its state from one call of
+ * `forward` or `step` to the next until `reset_state`, so a long sequence
+ * can be trained window by window and streamed step by step. A stream
+ * packs the parameters once, on its first `step`.
+ */
+class Recurrent
+{
+protected:
+    /**
+     * Constructs a recurrent layer.
+     * @param kind The cell.
+     * @param n_in The number of inputs of a step.
+     * @param n_hidden The number of hidden units.
+     * @param bptt_window The number of steps whose graph is kept, or 0 to
+     * keep the whole sequence.
+     * @param scheme The initialization of the neurons.
+     * @param pool Draws the neurons in parallel if given.
+     * @throw std::invalid_argument if a size is zero.
+     */
+    Recurrent(CellKind kind,
+              size_t n_in,
+              size_t n_hidden,
+              size_t bptt_window,
+              InitScheme scheme,
+              ThreadPool *pool);
+
+private:
+    /**
+     * @struct Packed
+     * The values of the parameters as dense row-major matrices, one row
+     * per neuron.
+     */
+    struct Packed
+    {
+        std::vector<double> input{};  // W, gates * hidden rows of n_in.
+        std::vector<double> hidden{}; // U, gates * hidden rows of n_hidden.
+        std::vector<double> bias{};   // b, gates * hidden.
+    };
+
+    CellKind _kind;                      // The cell.
+    size_t _n_in;                        // The number of inputs of a step.
+    size_t _n_hidden;                    // The number of hidden units.
+    size_t _n_gates;                     // The number of gates per unit.
+    size_t _bptt_window;                 // The steps with a graph, 0 for all.
+    std::vector<Neuron> _neurons{};      // The neurons, gate by gate.
+    std::vector<Variable> _parameters{}; // The views of all parameters.
+    std::vector<double> _state{}; // The hidden state, then the cell state.
+
+    // The graph of the last forward pass.
+    std::vector<double> _inputs{};  // A ring of the inputs of the kept steps.
+    std::deque<Variable> _leaves{}; // The state before and after kept steps.
+    std::deque<Variable> _nodes{};  // The nodes of each kept step.
+    size_t _first_kept = 0;         // The steps whose nodes were released.
+
+    Packed _packed{};           // The parameters packed for `step`.
+    bool _packed_valid = false; // Whether `_packed` is up to date.
+
+    /**
+     * Returns the size of the state.
+     * @return n_hidden, or 2 * n_hidden for an LSTM.
+     */
+    size_t state_size() const
+    {
+        return _kind == CellKind::LSTM ? 2 * _n_hidden : _n_hidden;
+    }
+
+    /**
+     * Packs the current values of the parameters.
+     * @return The packed parameters.
+     */
+    Packed pack() const;
+
+    /**
+     * Computes the input projections W x + b of a sequence with one matrix
+     * product, blocked over the steps so that a row of W is reused while
+     * it is in cache.
+     * @param packed The packed parameters.
+     * @param inputs The steps, n_in values each.
+     * @param n_steps The number of steps.
+     * @return The gates * hidden projections of each step.
+     */
+    std::vector<double> project(const Packed &packed,
+                                const double *inputs,
+                                size_t n_steps) const;
+
+    /**
+     * Advances a state by one step.
+     * @param packed The packed parameters.
+     * @param projected The input projections of the step.
+     * @param state The state, updated in place.
+     */
+    void advance(const Packed &packed,
+                 const double *projected,
+                 std::vector<double> &state) const;
+
+    /**
+     * Builds the nodes of one step on the leaves of the previous one and
+     * appends the leaves of the step.
+     * @param step The index of the step, from 1.
+     * @param input The inputs of the step, read again by `backward`.
+     * @param projected The input projections of the step.
+     */
+    void build_step(size_t step, const double *input, const double *projected);
+
+    /**
+     * Checks the number of inputs of a step.
+     * @param size The number of inputs.
+     * @throw std::runtime_error if it differs from n_in.
+     */
+    void check_input(size_t size) const;
+
+public:
+    Recurrent(const Recurrent &) = delete;
+    Recurrent &operator=(const Recurrent &) = delete;
+    Recurrent(Recurrent &&) = default;
+    Recurrent &operator=(Recurrent &&) = default;
+
+    /**
+     * Returns the cell.
+     * @return The cell.
+     */
+    CellKind kind() const
+    {
+        return _kind;
+    }
+
+    /**
+     * Returns the number of inputs of a step.
+     * @return The number of inputs.
+     */
+    size_t n_in() const
+    {
+        return _n_in;
+    }
+
+    /**
+     * Returns the number of hidden units, the outputs of a step.
+     * @return The number of hidden units.
+     */
+    size_t n_hidden() const
+    {
+        return _n_hidden;
+    }
+
+    /**
+     * Returns the number of steps whose graph is kept.
+     * @return The window, 0 for the whole sequence.
+     */
+    size_t bptt_window() const
+    {
+        return _bptt_window;
+    }
+
+    /**
+     * Returns the parameters, neuron by neuron.
+     * @return The views of the parameters.
+     */
+    const std::vector<Variable> &parameters() const
+    {
+        return _parameters;
+    }
+
+    /**
+     * Returns the neurons, gate by gate.
+     * @return The neurons.
+     */
+    const std::vector<Neuron> &neurons() const
+    {
+        return _neurons;
+    }
+
+    /**
+     * Returns the carried state.
+     * @return The hidden state, followed by the cell state of an LSTM.
+     */
+    const std::vector<double> &state() const
+    {
+        return _state;
+    }
+
+    /**
+     * Returns the number of steps of the last forward pass whose graph is
+     * still kept.
+     * @return At most the window.
+     */
+    size_t num_kept_steps() const
+    {
+        return _nodes.size() / state_size();
+    }
+
+    /**
+     * Resets the carried state to zero.
+     */
+    void reset_state();
+
+    /**
+     * Replaces the carried state, e.g. to resume a stream.
+     * @param state The hidden state, followed by the cell state of an LSTM.
+     * @throw std::invalid_argument if the size of the state is wrong.
+     */
+    void set_state(const std::vector<double> &state);
+
+    /**
+     * Runs a sequence on the graph from the carried state, which then holds
+     * the last state. The graph of the previous pass is released.
+     * @param sequence The steps, n_in values each.
+     * @return The hidden state of each step.
+     * @throw std::runtime_error if a step has the wrong number of inputs.
+     * @note The outputs of the kept steps refer to leaves held by the layer
+     * and are valid until the next forward pass. The outputs of the released
+     * steps are plain values, whose gradients go nowhere.
+     */
+    std::vector<std::vector<Variable>>
+    forward(const std::vector<std::vector<double>> &sequence);
+
+    /**
+     * Propagates the gradients that reached the outputs of the last forward
+     * pass back through time, over the kept steps, to the parameters. Call
+     * it after the backward pass of the loss; it releases the graph.
+     */
+    void backward();
+
+    /**
+     * Runs a sequence from the zero state without building a graph.
+     * @param sequence The steps, n_in values each.
+     * @return The hidden state of each step.
+     * @throw std::runtime_error if a step has the wrong number of inputs.
+     */
+    std::vector<std::vector<double>>
+    predict(const std::vector<std::vector<double>> &sequence) const;
+
+    /**
+     * Drops the parameters packed for `step`, so that the next step packs
+     * their current values. Call it after changing the parameters in the
+     * middle of a stream; `forward`, `backward`, `reset_state` and
+     * `set_state` drop them too.
+     */
+    void invalidate_weights()
+    {
+        _packed_valid = false;
+    }
+
+    /**
+     * Runs one step from the carried state without building a graph, for
+     * streaming inference.
+     * @param input The n_in inputs of the step.
+     * @return The new hidden state.
+     * @throw std::runtime_error if the number of inputs is wrong.
+     * @note The parameters packed by an earlier step are reused until they
+     * are dropped, see `invalidate_weights`.
+     */
+    std::vector<double> step(const std::vector<double> &input);
+};
+
+/**
+ * @class RNN
+ * This class represents an Elman recurrent layer, h' = tanh(W x + U h + b).
+ */
+class RNN : public Recurrent
+{
+public:
+    /**
+     * Constructs an RNN layer.
+     * @param n_in The number of inputs of a step.
+     * @param n_hidden The number of hidden units.
+     * @param bptt_window The number of steps whose graph is kept, or 0 to
+     * keep the whole sequence.
+     * @param scheme The initialization of the neurons.
+     * @param pool Draws the neurons in parallel if given.
+     * @throw std::invalid_argument if a size is zero.
+     */
+    RNN(size_t n_in,
+        size_t n_hidden,
+        size_t bptt_window = 0,
+        InitScheme scheme = InitScheme::XavierUniform,
+        ThreadPool *pool = nullptr)
+        : Recurrent(CellKind::RNN, n_in, n_hidden, bptt_window, scheme, pool){};
+};
+
+/**
+ * @class GRU
+ * This class represents a gated recurrent unit layer.
+ */
+class GRU : public Recurrent
+{
+public:
+    /**
+     * Constructs a GRU layer.
+     * @param n_in The number of inputs of a step.
+     * @param n_hidden The number of hidden units.
+     * @param bptt_window The number of steps whose graph is kept, or 0 to
+     * keep the whole sequence.
+     * @param scheme The initialization of the neurons.
+     * @param pool Draws the neurons in parallel if given.
+     * @throw std::invalid_argument if a size is zero.
+     */
+    GRU(size_t n_in,
+        size_t n_hidden,
+        size_t bptt_window = 0,
+        InitScheme scheme = InitScheme::XavierUniform,
+        ThreadPool *pool = nullptr)
+        : Recurrent(CellKind::GRU, n_in, n_hidden, bptt_window, scheme, pool){};
+};
+
+/**
+ * @class LSTM
+ * This class represents a long short-term memory layer, whose state is the
+ * hidden state followed by the cell state.
+ */
+class LSTM : public Recurrent
+{
+public:
+    /**
+     * Constructs an LSTM layer.
+     * @param n_in The number of inputs of a step.
+     * @param n_hidden The number of hidden units.
+     * @param bptt_window The number of steps whose graph is kept, or 0 to
+     * keep the whole sequence.
+     * @param scheme The initialization of the neurons.
+     * @param pool Draws the neurons in parallel if given.
+     * @throw std::invalid_argument if a size is zero.
+     */
+    LSTM(size_t n_in,
+         size_t n_hidden,
+         size_t bptt_window = 0,
+         InitScheme scheme = InitScheme::XavierUniform,
+         ThreadPool *pool = nullptr)
+        : Recurrent(
+              CellKind::LSTM, n_in, n_hidden, bptt_window, scheme, pool){};
+};
@@ -0,0 +1,263 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+
+
+namespace
+{
+// Above this many tasks in its deque a worker walks subgraphs inline.
+const size_t max_local_tasks = 4;
+
+// The number of subgraphs per lane in deterministic mode.
+const size_t units_per_lane = 4;
+
+// The sinks of the passes started by this thread. Flushed sinks keep their
+// tables, so repeated passes do not grow them again.
+thread_local std::vector<GradientSink> cached_sinks;
+
+
+std::vector<GradientSink> &sinks(size_t n)
+{
+    if (cached_sinks.size() < n)
+    {
+        cached_sinks.resize(n);
+    }
+    return cached_sinks;
+}
+
+
+void visit_serial(Variable *node)
+{
+    node->propagate();
+    for (auto &child : node->mutable_children())
+    {
+        visit_serial(&child);
+    }
+}
+
+
+// Counts running tasks, keeps the first exception and lets a thread outside
+// the pool wait for all of them.
+class TaskGroup
+{
+private:
+    WorkStealingPool &_pool;
+    std::atomic<size_t> _pending{0};
+    std::mutex _mutex{};
+    std::condition_variable _finished{};
+    std::exception_ptr _error{};
+
+public:
+    explicit TaskGroup(WorkStealingPool &pool) : _pool(pool){};
+
+    void spawn(std::function<void()> task)
+    {
+        _pending.fetch_add(1);
+        _pool.submit([this, task = std::move(task)]() {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error)
+                {
+                    _error = std::current_exception();
+                }
+            }
+            // The last decrement and the notification happen under the
+            // lock: `wait` cannot see zero, return and destroy the group
+            // until this task no longer touches it.
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_pending.fetch_sub(1) == 1)
+            {
+                _finished.notify_all();
+            }
+        });
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finished.wait(lock, [this]() { return _pending == 0; });
+    }
+
+    void rethrow()
+    {
+        if (_error)
+        {
+            std::rethrow_exception(_error);
+        }
+    }
+};
+
+
+// Spawns ready nodes while the worker's deque is short and sums the
+// reference updates in one sink per worker.
+class AdaptiveBackwardPass
+{
+private:
+    WorkStealingPool &_pool;
+    TaskGroup _group;
+    std::vector<GradientSink> &_sinks;
+
+    void run(Variable *node)
+    {
+        GradientSink::set_active(&_sinks[_pool.worker_index()]);
+        try
+        {
+            visit(node);
+        }
+        catch (...)
+        {
+            GradientSink::set_active(nullptr);
+            throw;
+        }
+        GradientSink::set_active(nullptr);
+    }
+
+    void visit(Variable *node)
+    {
+        node->propagate();
+        for (auto &child : node->mutable_children())
+        {
+            if (child.children().empty())
+            {
+                child.propagate();
+            }
+            else if (_pool.local_size() < max_local_tasks)
+            {
+                Variable *ready = &child;
+                _group.spawn([this, ready]() { run(ready); });
+            }
+            else
+            {
+                visit(&child);
+            }
+        }
+    }
+
+public:
+    explicit AdaptiveBackwardPass(WorkStealingPool &pool)
+        : _pool(pool), _group(pool), _sinks(sinks(pool.size())){};
+
+    void run_from(Variable &root)
+    {
+        _group.spawn([this, &root]() { run(&root); });
+        _group.wait();
+        for (size_t i = 0; i < _pool.size(); i++)
+        {
+            _sinks[i].flush();
+        }
+        _group.rethrow();
+    }
+};
+
+
+// Splits the graph into a fixed list of subgraphs, walks them in a fixed
+// number of lanes with one sink each and merges the sinks in a fixed binary
+// tree, so the sums depend neither on the pool size nor on scheduling.
+class DeterministicBackwardPass
+{
+private:
+    TaskGroup _group;
+    size_t _lanes;
+    std::vector<GradientSink> &_sinks; // The sink above the units, then lanes.
+
+    // Propagates the nodes above the subgraphs on the calling thread, in
+    // breadth-first order until there are enough subgraphs.
+    std::vector<Variable *> split(Variable &root)
+    {
+        std::deque<Variable *> frontier{&root};
+        GradientSink::set_active(&_sinks[0]);
+        while (!frontier.empty() &&
+               frontier.size() < _lanes * units_per_lane)
+        {
+            Variable *node = frontier.front();
+            frontier.pop_front();
+            node->propagate();
+            for (auto &child : node->mutable_children())
+            {
+                if (child.children().empty())
+                {
+                    child.propagate();
+                }
+                else
+                {
+                    frontier.push_back(&child);
+                }
+            }
+        }
+        GradientSink::set_active(nullptr);
+        return std::vector<Variable *>(frontier.begin(), frontier.end());
+    }
+
+    void run_lane(const std::vector<Variable *> &units, size_t lane)
+    {
+        GradientSink::set_active(&_sinks[1 + lane]);
+        try
+        {
+            for (size_t i = lane; i < units.size(); i += _lanes)
+            {
+                visit_serial(units[i]);
+            }
+        }
+        catch (...)
+        {
+            GradientSink::set_active(nullptr);
+            throw;
+        }
+        GradientSink::set_active(nullptr);
+    }
+
+public:
+    explicit DeterministicBackwardPass(WorkStealingPool &pool)
+        : _group(pool), _lanes(deterministic_lanes()),
+          _sinks(sinks(_lanes + 1)){};
+
+    void run_from(Variable &root)
+    {
+        const std::vector<Variable *> units = split(root);
+        for (size_t lane = 0; lane < std::min(_lanes, units.size()); lane++)
+        {
+            _group.spawn([this, &units, lane]() { run_lane(units, lane); });
+        }
+        _group.wait();
+        for (size_t stride = 1; stride < _lanes + 1; stride *= 2)
+        {
+            for (size_t i = 0; i + stride < _lanes + 1; i += 2 * stride)
+            {
+                _sinks[i].merge(_sinks[i + stride]);
+            }
+        }
+        _sinks[0].flush();
+        _group.rethrow();
+    }
+};
+} // namespace
+
+
+void parallel_backward(Variable &root,
+                       WorkStealingPool &pool,
+                       bool retain_graph)
+{
+    if (root.children().empty())
+    {
+        root.propagate();
+    }
+    else if (deterministic())
+    {
+        DeterministicBackwardPass(pool).run_from(root);
+    }
+    else
+    {
+        AdaptiveBackwardPass(pool).run_from(root);
+    }
+    if (!retain_graph)
+    {
+        root.release_graph();
+    }
+}
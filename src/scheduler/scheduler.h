@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../determinism/determinism.h"
+#include "../parallel/parallel.h"
+#include "../variable/variable.h"
+
+/**
+ * Performs the backward pass of a graph on a work-stealing pool. A node is
+ * ready once its parent has propagated its gradient, since the graph stores
+ * children by value and each node has a single parent; the children of a
+ * node, e.g. the per-neuron subgraphs built by `Layer::forward`, then run
+ * concurrently. Each worker spawns ready nodes while its deque is short and
+ * walks them inline otherwise, which bounds the scheduling overhead for
+ * graphs of small nodes.
+ *
+ * Updates of shared variables such as parameters, reached through the
+ * references of the nodes, are collected in one `GradientSink` per worker
+ * and added on the calling thread when the pass has finished, so the pass
+ * is race-free. Gradients equal those of `Variable::backward` up to the
+ * order of floating point additions.
+ *
+ * In deterministic mode, see `set_deterministic`, the nodes near the root
+ * are propagated on the calling thread until the graph splits into a fixed
+ * list of subgraphs. These are walked in `deterministic_lanes()` lanes with
+ * one sink each, and the sinks are merged in a fixed binary tree, so the
+ * gradients are identical for every pool size and schedule.
+ * @param root The output of the graph, with its gradient already set.
+ * @param pool The pool; must not be called from one of its tasks.
+ * @param retain_graph Whether to keep the graph after the pass.
+ * @throw The first exception thrown by a backward function.
+ */
+void parallel_backward(Variable &root,
+                       WorkStealingPool &pool,
+                       bool retain_graph = false);
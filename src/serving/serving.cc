@@ -0,0 +1,614 @@
+#include "serving.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace
+{
+constexpr uint32_t stats_request = std::numeric_limits<uint32_t>::max();
+// The attempts of an idle worker to pop a request before it sleeps.
+constexpr int spin_attempts = 64;
+
+
+bool read_all(int socket, void *data, size_t bytes)
+{
+    auto *out = static_cast<char *>(data);
+    while (bytes > 0)
+    {
+        const ssize_t n = recv(socket, out, bytes, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        out += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+
+// Reads and drops the payload of a rejected request, in chunks of bounded
+// size whatever its announced length.
+bool skip_all(int socket, size_t bytes)
+{
+    char buffer[4096];
+    while (bytes > 0)
+    {
+        const size_t chunk = std::min(bytes, sizeof(buffer));
+        if (!read_all(socket, buffer, chunk))
+        {
+            return false;
+        }
+        bytes -= chunk;
+    }
+    return true;
+}
+
+
+bool write_all(int socket, const void *data, size_t bytes)
+{
+    const auto *in = static_cast<const char *>(data);
+    while (bytes > 0)
+    {
+        const ssize_t n = send(socket, in, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        in += n;
+        bytes -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+
+// Sends a count followed by the values.
+bool write_message(int socket, const std::vector<double> &values)
+{
+    const auto count = static_cast<uint32_t>(values.size());
+    return write_all(socket, &count, sizeof(count)) &&
+           write_all(socket, values.data(), values.size() * sizeof(double));
+}
+
+
+sockaddr_un unix_address(const std::string &path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("socket path is too long");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+
+sockaddr_in tcp_address(uint16_t port)
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+
+// Binds and listens, closing the socket on failure.
+int listen_on(int socket, const sockaddr *address, socklen_t length)
+{
+    if (socket < 0 || bind(socket, address, length) != 0 ||
+        listen(socket, SOMAXCONN) != 0)
+    {
+        if (socket >= 0)
+        {
+            close(socket);
+        }
+        throw std::runtime_error("failed to listen on the socket");
+    }
+    return socket;
+}
+
+
+// Connects, closing the socket on failure.
+int connect_to(int socket, const sockaddr *address, socklen_t length)
+{
+    if (socket < 0 || connect(socket, address, length) != 0)
+    {
+        if (socket >= 0)
+        {
+            close(socket);
+        }
+        throw std::runtime_error("failed to connect to the server");
+    }
+    return socket;
+}
+
+
+void disable_nagle(int socket)
+{
+    const int flag = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+} // namespace
+
+
+InferenceServer::InferenceServer(const MLP &mlp, ServerOptions options)
+    : _mlp(mlp), _options(options), _queue(options.queue_capacity),
+      _pool(std::max<size_t>(1, options.num_workers))
+{
+    if (options.max_batch_size == 0 || options.num_workers == 0)
+    {
+        throw std::invalid_argument(
+            "batch size and number of workers should be > 0");
+    }
+    _workers.reserve(options.num_workers);
+    for (size_t i = 0; i < options.num_workers; i++)
+    {
+        _workers.push_back(_pool.submit([this]() { work(); }));
+    }
+}
+
+
+InferenceServer::~InferenceServer()
+{
+    stop();
+}
+
+
+std::future<std::vector<double>>
+InferenceServer::submit(std::vector<double> inputs)
+{
+    if (inputs.size() != n_in())
+    {
+        throw std::invalid_argument("invalid number of inputs");
+    }
+    auto request = std::make_unique<InferenceRequest>();
+    request->inputs = std::move(inputs);
+    request->start = std::chrono::steady_clock::now();
+    std::future<std::vector<double>> outputs = request->outputs.get_future();
+
+    // stop() clears _running and then waits for the submissions in
+    // progress, so a request is either rejected here or queued before stop
+    // drains the queue.
+    _submitting.fetch_add(1);
+    const bool running = _running.load();
+    const bool pushed = running && _queue.try_push(request);
+    if (pushed)
+    {
+        // Pairs with the fence of a worker going to sleep, so that either
+        // the worker sees the request or this sees the worker.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleeping.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            _wake.notify_one();
+        }
+    }
+    _submitting.fetch_sub(1);
+    if (!running)
+    {
+        throw std::runtime_error("the server has stopped");
+    }
+    if (!pushed)
+    {
+        throw std::runtime_error("the request queue is full");
+    }
+    return outputs;
+}
+
+
+void InferenceServer::stop()
+{
+    _running.store(false);
+    while (_submitting.load() > 0)
+    {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(_wake_mutex);
+        _wake.notify_all();
+    }
+    for (auto &worker : _workers)
+    {
+        worker.wait();
+    }
+    _workers.clear();
+
+    // A request pushed after the workers found the queue empty is never
+    // batched.
+    std::unique_ptr<InferenceRequest> request;
+    while (_queue.try_pop(request))
+    {
+        request->outputs.set_exception(std::make_exception_ptr(
+            std::runtime_error("the server has stopped")));
+    }
+}
+
+
+bool InferenceServer::pop(std::unique_ptr<InferenceRequest> &request,
+                          std::chrono::steady_clock::time_point deadline)
+{
+    for (int attempt = 0; attempt < spin_attempts; attempt++)
+    {
+        if (_queue.try_pop(request))
+        {
+            return true;
+        }
+        if (!_running.load(std::memory_order_acquire) ||
+            std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(_wake_mutex);
+    _sleeping.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    const auto ready = [&]() {
+        popped = _queue.try_pop(request);
+        return popped || !_running.load();
+    };
+    if (deadline == std::chrono::steady_clock::time_point::max())
+    {
+        _wake.wait(lock, ready);
+    }
+    else
+    {
+        _wake.wait_until(lock, deadline, ready);
+    }
+    _sleeping.fetch_sub(1);
+    return popped;
+}
+
+
+void InferenceServer::work()
+{
+    std::vector<std::unique_ptr<InferenceRequest>> batch;
+    batch.reserve(_options.max_batch_size);
+    std::vector<double> inputs;
+    std::unique_ptr<InferenceRequest> request;
+    while (true)
+    {
+        if (!pop(request, std::chrono::steady_clock::time_point::max()))
+        {
+            // The queue is drained before the worker exits.
+            return;
+        }
+
+        // Wait for more requests until the batch is full or the oldest
+        // request has waited long enough.
+        const auto deadline = request->start + _options.max_wait;
+        batch.push_back(std::move(request));
+        while (batch.size() < _options.max_batch_size &&
+               pop(request, deadline))
+        {
+            batch.push_back(std::move(request));
+        }
+
+        inputs.clear();
+        for (const auto &queued : batch)
+        {
+            inputs.insert(
+                inputs.end(), queued->inputs.begin(), queued->inputs.end());
+        }
+        std::vector<double> outputs;
+        std::exception_ptr error;
+        try
+        {
+            outputs = _mlp.predict(inputs, batch.size());
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto &queued : batch)
+        {
+            _latency.record(now - queued->start);
+        }
+        _requests.add(batch.size());
+        _batches.add();
+
+        const size_t n_out = outputs.size() / batch.size();
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            if (error)
+            {
+                batch[i]->outputs.set_exception(error);
+                continue;
+            }
+            const auto first = outputs.begin() +
+                               static_cast<std::ptrdiff_t>(i * n_out);
+            batch[i]->outputs.set_value(std::vector<double>(
+                first, first + static_cast<std::ptrdiff_t>(n_out)));
+        }
+        batch.clear();
+    }
+}
+
+
+SocketServer::SocketServer(InferenceServer &server, const std::string &path)
+    : _server(server), _listener(-1), _path(path)
+{
+    const sockaddr_un address = unix_address(path);
+    unlink(path.c_str());
+    _listener = listen_on(socket(AF_UNIX, SOCK_STREAM, 0),
+                          reinterpret_cast<const sockaddr *>(&address),
+                          sizeof(address));
+}
+
+
+SocketServer::SocketServer(InferenceServer &server, uint16_t port)
+    : _server(server), _listener(-1)
+{
+    const sockaddr_in address = tcp_address(port);
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int reuse = 1;
+    if (listener >= 0)
+    {
+        setsockopt(
+            listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    _listener = listen_on(listener,
+                          reinterpret_cast<const sockaddr *>(&address),
+                          sizeof(address));
+}
+
+
+SocketServer::~SocketServer()
+{
+    stop();
+    if (_listener >= 0)
+    {
+        close(_listener);
+    }
+    if (!_path.empty())
+    {
+        unlink(_path.c_str());
+    }
+}
+
+
+uint16_t SocketServer::port() const
+{
+    if (!_path.empty())
+    {
+        return 0;
+    }
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    getsockname(
+        _listener, reinterpret_cast<sockaddr *>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+
+void SocketServer::start()
+{
+    if (!_running.exchange(true))
+    {
+        _acceptor = std::thread([this]() { accept_connections(); });
+    }
+}
+
+
+void SocketServer::stop()
+{
+    _running.store(false);
+    if (_acceptor.joinable())
+    {
+        _acceptor.join();
+    }
+    {
+        // Unblock the handlers; each closes its own connection.
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int connection : _connections)
+        {
+            shutdown(connection, SHUT_RDWR);
+        }
+    }
+    for (auto &handler : _handlers)
+    {
+        handler.join();
+    }
+    _handlers.clear();
+    _finished.clear();
+}
+
+
+size_t SocketServer::num_handlers()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _handlers.size();
+}
+
+
+void SocketServer::reap_handlers()
+{
+    for (const std::thread::id id : _finished)
+    {
+        const auto handler = std::find_if(
+            _handlers.begin(), _handlers.end(), [id](const std::thread &t) {
+                return t.get_id() == id;
+            });
+        // The handler has returned from serve and only has to exit.
+        handler->join();
+        _handlers.erase(handler);
+    }
+    _finished.clear();
+}
+
+
+void SocketServer::accept_connections()
+{
+    pollfd listener{_listener, POLLIN, 0};
+    while (_running.load())
+    {
+        if (poll(&listener, 1, 100) <= 0)
+        {
+            continue;
+        }
+        const int connection = accept(_listener, nullptr, nullptr);
+        if (connection < 0)
+        {
+            continue;
+        }
+        if (_path.empty())
+        {
+            disable_nagle(connection);
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        reap_handlers();
+        _connections.push_back(connection);
+        _handlers.emplace_back([this, connection]() { serve(connection); });
+    }
+}
+
+
+void SocketServer::serve(int connection)
+{
+    std::vector<double> inputs;
+    uint32_t count = 0;
+    while (read_all(connection, &count, sizeof(count)) && count != 0)
+    {
+        std::vector<double> outputs;
+        if (count == stats_request)
+        {
+            const LatencyHistogram &latency = _server.latency();
+            const auto microseconds = [](std::chrono::nanoseconds ns) {
+                return std::chrono::duration<double, std::micro>(ns).count();
+            };
+            outputs = {static_cast<double>(_server.requests().count()),
+                       _server.requests().rate(),
+                       microseconds(latency.percentile(50)),
+                       microseconds(latency.percentile(99))};
+        }
+        else if (count != _server.n_in())
+        {
+            // Reject the request before allocating for its announced size,
+            // which a malformed request may set to anything.
+            if (!skip_all(connection, size_t{count} * sizeof(double)))
+            {
+                break;
+            }
+        }
+        else
+        {
+            inputs.resize(count);
+            if (!read_all(connection, inputs.data(), count * sizeof(double)))
+            {
+                break;
+            }
+            try
+            {
+                outputs = _server.submit(inputs).get();
+            }
+            catch (const std::exception &)
+            {
+                outputs.clear();
+            }
+        }
+        if (!write_message(connection, outputs))
+        {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _connections.erase(
+        std::find(_connections.begin(), _connections.end(), connection));
+    close(connection);
+    _finished.push_back(std::this_thread::get_id());
+}
+
+
+InferenceClient::InferenceClient(const std::string &path)
+{
+    const sockaddr_un address = unix_address(path);
+    _socket = connect_to(socket(AF_UNIX, SOCK_STREAM, 0),
+                         reinterpret_cast<const sockaddr *>(&address),
+                         sizeof(address));
+}
+
+
+InferenceClient::InferenceClient(uint16_t port)
+{
+    const sockaddr_in address = tcp_address(port);
+    _socket = connect_to(socket(AF_INET, SOCK_STREAM, 0),
+                         reinterpret_cast<const sockaddr *>(&address),
+                         sizeof(address));
+    disable_nagle(_socket);
+}
+
+
+InferenceClient::~InferenceClient()
+{
+    const uint32_t count = 0;
+    write_all(_socket, &count, sizeof(count));
+    close(_socket);
+}
+
+
+std::vector<double> InferenceClient::predict(const std::vector<double> &inputs)
+{
+    if (inputs.empty() || inputs.size() >= stats_request ||
+        !write_message(_socket, inputs))
+    {
+        throw std::runtime_error("failed to send the request");
+    }
+    uint32_t count = 0;
+    if (!read_all(_socket, &count, sizeof(count)))
+    {
+        throw std::runtime_error("failed to receive the response");
+    }
+    if (count == 0)
+    {
+        throw std::runtime_error("the request was rejected");
+    }
+    std::vector<double> outputs(count);
+    if (!read_all(_socket, outputs.data(), count * sizeof(double)))
+    {
+        throw std::runtime_error("failed to receive the response");
+    }
+    return outputs;
+}
+
+
+std::vector<double> InferenceClient::stats()
+{
+    uint32_t count = stats_request;
+    if (!write_all(_socket, &count, sizeof(count)) ||
+        !read_all(_socket, &count, sizeof(count)))
+    {
+        throw std::runtime_error("failed to request the statistics");
+    }
+    std::vector<double> values(count);
+    if (!read_all(_socket, values.data(), count * sizeof(double)))
+    {
+        throw std::runtime_error("failed to receive the statistics");
+    }
+    return values;
+}
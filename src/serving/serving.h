@@ -0,0 +1,402 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "../neural_network/mlp.h"
+#include "../parallel/parallel.h"
+
+/**
+ * @class MPMCQueue
+ * This class represents a bounded lock-free multi-producer multi-consumer
+ * queue (D. Vyukov). Every cell carries a sequence number that tells
+ * producers and consumers whether it is free or filled for their turn.
+ */
+template <typename T> class MPMCQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence; // The turn the cell is ready for.
+        T data;                       // The stored value.
+    };
+
+    std::unique_ptr<Cell[]> _cells;           // The ring of cells.
+    size_t _mask;                             // The capacity minus one.
+    alignas(64) std::atomic<size_t> _head{0}; // The next cell to push.
+    alignas(64) std::atomic<size_t> _tail{0}; // The next cell to pop.
+
+public:
+    /**
+     * Constructs a queue.
+     * @param capacity The number of cells, a power of two.
+     * @throw std::invalid_argument if the capacity is not a power of two.
+     */
+    explicit MPMCQueue(size_t capacity)
+        : _cells(new Cell[capacity]), _mask(capacity - 1)
+    {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        {
+            throw std::invalid_argument("capacity should be a power of two");
+        }
+        for (size_t i = 0; i < capacity; i++)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Pushes a value unless the queue is full.
+     * @param value The value, moved from on success.
+     * @return Whether the value was pushed.
+     */
+    bool try_push(T &value)
+    {
+        size_t position = _head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = _cells[position & _mask];
+            const size_t sequence =
+                cell.sequence.load(std::memory_order_acquire);
+            if (sequence == position)
+            {
+                if (_head.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(value);
+                    cell.sequence.store(position + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < position)
+            {
+                return false;
+            }
+            else
+            {
+                position = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Pops a value unless the queue is empty.
+     * @param value Receives the value on success.
+     * @return Whether a value was popped.
+     */
+    bool try_pop(T &value)
+    {
+        size_t position = _tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = _cells[position & _mask];
+            const size_t sequence =
+                cell.sequence.load(std::memory_order_acquire);
+            if (sequence == position + 1)
+            {
+                if (_tail.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.data);
+                    cell.sequence.store(position + _mask + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < position + 1)
+            {
+                return false;
+            }
+            else
+            {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/**
+ * @struct ServerOptions
+ * The batching and threading configuration of an inference server.
+ */
+struct ServerOptions
+{
+    size_t max_batch_size = 32;   // The largest batch of requests.
+    std::chrono::microseconds max_wait{500}; // The longest wait for a batch.
+    size_t num_workers = 1;       // The number of batching workers.
+    size_t queue_capacity = 1024; // The queue size, a power of two.
+};
+
+/**
+ * @struct InferenceRequest
+ * A queued request of an inference server.
+ */
+struct InferenceRequest
+{
+    std::vector<double> inputs;                  // The input values.
+    std::promise<std::vector<double>> outputs;   // Receives the outputs.
+    std::chrono::steady_clock::time_point start; // When it was submitted.
+};
+
+/**
+ * @class InferenceServer
+ * This class represents an in-process inference service that coalesces
+ * concurrent requests into batches. Workers pop requests from a lock-free
+ * queue until a batch is full or the oldest request has waited max_wait,
+ * then run a single batched `MLP::predict`. An idle worker spins briefly
+ * and then sleeps until a request is submitted.
+ */
+class InferenceServer
+{
+private:
+    const MLP &_mlp;        // The served MLP, which must outlive the server.
+    ServerOptions _options; // The batching configuration.
+    MPMCQueue<std::unique_ptr<InferenceRequest>> _queue; // The requests.
+    std::atomic<bool> _running{true};   // Whether the workers keep running.
+    std::atomic<size_t> _submitting{0}; // The submissions in progress.
+    std::atomic<size_t> _sleeping{0};   // The workers waiting on _wake.
+    std::mutex _wake_mutex;             // Guards the sleep of the workers.
+    std::condition_variable _wake;      // Wakes the sleeping workers.
+    LatencyHistogram _latency;          // The latency of each request.
+    ThroughputCounter _requests;        // The number of answered requests.
+    ThroughputCounter _batches;         // The number of batches.
+    ThreadPool _pool;                   // Runs the workers.
+    std::vector<std::future<void>> _workers; // The running workers.
+
+    /**
+     * Forms and runs batches until the server stops.
+     */
+    void work();
+
+    /**
+     * Pops a request, spinning briefly and then sleeping until one is
+     * submitted, the server stops or the deadline passes.
+     * @param request Receives the request on success.
+     * @param deadline The time to give up, or `time_point::max()`.
+     * @return Whether a request was popped.
+     */
+    bool pop(std::unique_ptr<InferenceRequest> &request,
+             std::chrono::steady_clock::time_point deadline);
+
+public:
+    /**
+     * Constructs a server and starts its workers.
+     * @param mlp The served MLP, which must outlive the server.
+     * @param options The batching configuration.
+     * @throw std::invalid_argument if the options are invalid.
+     */
+    explicit InferenceServer(const MLP &mlp, ServerOptions options = {});
+
+    InferenceServer(const InferenceServer &) = delete;
+    InferenceServer &operator=(const InferenceServer &) = delete;
+
+    /**
+     * Stops the server.
+     */
+    ~InferenceServer();
+
+    /**
+     * Queues a request.
+     * @param inputs The input values.
+     * @return A future that receives the output values.
+     * @throw std::invalid_argument if the number of inputs does not match.
+     * @throw std::runtime_error if the queue is full or the server stopped.
+     */
+    std::future<std::vector<double>> submit(std::vector<double> inputs);
+
+    /**
+     * Answers the queued requests and joins the workers. Later submissions
+     * throw, and a request queued while the workers were exiting receives
+     * an exception.
+     */
+    void stop();
+
+    /**
+     * Returns the number of inputs of the served MLP.
+     * @return The number of inputs.
+     */
+    size_t n_in() const
+    {
+        return _mlp.layers().front().n_in();
+    }
+
+    /**
+     * Returns the histogram of request latencies, from submit to answer.
+     * @return The latency histogram.
+     */
+    const LatencyHistogram &latency() const
+    {
+        return _latency;
+    }
+
+    /**
+     * Returns the counter of answered requests.
+     * @return The request counter.
+     */
+    const ThroughputCounter &requests() const
+    {
+        return _requests;
+    }
+
+    /**
+     * Returns the counter of executed batches.
+     * @return The batch counter.
+     */
+    const ThroughputCounter &batches() const
+    {
+        return _batches;
+    }
+};
+
+/**
+ * @class SocketServer
+ * This class represents a socket front end of an inference server, on a
+ * Unix domain socket or a localhost TCP port. Each connection sends
+ * requests as a uint32 count followed by that many doubles, and receives
+ * responses in the same format. A count of 0 closes the connection and a
+ * count of UINT32_MAX requests the statistics: the number of requests, the
+ * requests per second, and the p50 and p99 latencies in microseconds. An
+ * empty response reports a rejected request; a request whose count is not
+ * the number of inputs is rejected without buffering its values. Values
+ * use the byte order of the host.
+ */
+class SocketServer
+{
+private:
+    InferenceServer &_server;               // Answers the requests.
+    int _listener;                          // The listening socket.
+    std::string _path;                      // The Unix socket path, if any.
+    std::atomic<bool> _running{false};      // Whether connections are served.
+    std::thread _acceptor;                  // Accepts connections.
+    std::mutex _mutex;                      // Guards the handler state.
+    std::vector<int> _connections;          // The open connections.
+    std::vector<std::thread> _handlers;     // Serve the connections.
+    std::vector<std::thread::id> _finished; // The handlers that returned.
+
+    /**
+     * Accepts connections until the front end stops.
+     */
+    void accept_connections();
+
+    /**
+     * Serves the requests of a connection until it closes.
+     * @param connection The connected socket.
+     */
+    void serve(int connection);
+
+    /**
+     * Joins the handlers whose connection closed, so that a long-running
+     * front end does not keep a thread per past connection. The caller
+     * holds the mutex.
+     */
+    void reap_handlers();
+
+public:
+    /**
+     * Listens on a Unix domain socket.
+     * @param server The inference server.
+     * @param path The socket path, replaced if it exists.
+     * @throw std::runtime_error if the socket cannot be bound.
+     */
+    SocketServer(InferenceServer &server, const std::string &path);
+
+    /**
+     * Listens on a localhost TCP port.
+     * @param server The inference server.
+     * @param port The port; zero picks a free port.
+     * @throw std::runtime_error if the socket cannot be bound.
+     */
+    SocketServer(InferenceServer &server, uint16_t port);
+
+    SocketServer(const SocketServer &) = delete;
+    SocketServer &operator=(const SocketServer &) = delete;
+
+    /**
+     * Stops the front end.
+     */
+    ~SocketServer();
+
+    /**
+     * Returns the bound TCP port.
+     * @return The port, or zero for a Unix socket.
+     */
+    uint16_t port() const;
+
+    /**
+     * Starts accepting connections in a background thread.
+     */
+    void start();
+
+    /**
+     * Returns the number of handler threads not yet joined. Handlers of
+     * closed connections are joined when the next connection is accepted.
+     * @return The number of handlers.
+     */
+    size_t num_handlers();
+
+    /**
+     * Closes the listener and all connections and joins their threads.
+     */
+    void stop();
+};
+
+/**
+ * @class InferenceClient
+ * This class represents a blocking client of a socket server.
+ */
+class InferenceClient
+{
+private:
+    int _socket; // The connected socket.
+
+public:
+    /**
+     * Connects to a Unix domain socket.
+     * @param path The socket path.
+     * @throw std::runtime_error if the connection fails.
+     */
+    explicit InferenceClient(const std::string &path);
+
+    /**
+     * Connects to a localhost TCP port.
+     * @param port The port.
+     * @throw std::runtime_error if the connection fails.
+     */
+    explicit InferenceClient(uint16_t port);
+
+    InferenceClient(const InferenceClient &) = delete;
+    InferenceClient &operator=(const InferenceClient &) = delete;
+
+    /**
+     * Closes the connection.
+     */
+    ~InferenceClient();
+
+    /**
+     * Sends a request and waits for the response.
+     * @param inputs The input values.
+     * @return The output values.
+     * @throw std::runtime_error if the connection fails or the request is
+     * rejected.
+     */
+    std::vector<double> predict(const std::vector<double> &inputs);
+
+    /**
+     * Requests the statistics of the server.
+     * @return The number of requests, the requests per second, and the p50
+     * and p99 latencies in microseconds.
+     * @throw std::runtime_error if the connection fails.
+     */
+    std::vector<double> stats();
+};
@@ -0,0 +1,269 @@
+#include "sparse.h"
+
+#include <stdexcept>
+
+
+namespace
+{
+void check_indices(const size_t *indices, size_t n, size_t size)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (indices[i] >= size || (i > 0 && indices[i] <= indices[i - 1]))
+        {
+            throw std::invalid_argument(
+                "sparse indices should be increasing and in range");
+        }
+    }
+}
+
+
+// Builds activate(preactivation) as a node over the touched weights and an
+// optional bias. The backward pass only visits the non-zeros.
+Variable sparse_node(const std::vector<Variable> &weights,
+                     const SparseVector &inputs,
+                     const Variable *bias,
+                     const std::string &op,
+                     ActivationFunction activation,
+                     double preactivation,
+                     ActivationMode mode)
+{
+    const double value = activate(activation, preactivation, mode);
+    const std::vector<size_t> &indices = inputs.indices();
+    Variable result(value, 0.0, op);
+    Variable::Children &children = result.mutable_children();
+    children.reserve(indices.size() + 1);
+    for (size_t index : indices)
+    {
+        children.push_back(weights[index]);
+    }
+    if (bias != nullptr)
+    {
+        children.push_back(*bias);
+    }
+    result.set_backward([values = inputs.values(),
+                         activation,
+                         preactivation](Variable *node) {
+        const double grad =
+            node->gradient() *
+            activation_derivative(activation, preactivation, node->value());
+        Variable::Children &touched = node->mutable_children();
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            touched[i].update_gradient(grad * values[i]);
+        }
+        if (touched.size() > values.size())
+        {
+            touched[values.size()].update_gradient(grad);
+        }
+    });
+    return result;
+}
+} // namespace
+
+
+SparseVector::SparseVector(size_t size,
+                           std::vector<size_t> indices,
+                           std::vector<double> values)
+    : _size(size), _indices(std::move(indices)), _values(std::move(values))
+{
+    if (_indices.size() != _values.size())
+    {
+        throw std::invalid_argument(
+            "indices and values should have same size");
+    }
+    check_indices(_indices.data(), _indices.size(), _size);
+}
+
+
+SparseVector SparseVector::from_dense(const std::vector<double> &dense)
+{
+    std::vector<size_t> indices;
+    std::vector<double> values;
+    for (size_t i = 0; i < dense.size(); i++)
+    {
+        if (dense[i] != 0)
+        {
+            indices.push_back(i);
+            values.push_back(dense[i]);
+        }
+    }
+    return SparseVector(dense.size(), std::move(indices), std::move(values));
+}
+
+
+std::vector<double> SparseVector::to_dense() const
+{
+    std::vector<double> dense(_size, 0.0);
+    for (size_t i = 0; i < _indices.size(); i++)
+    {
+        dense[_indices[i]] = _values[i];
+    }
+    return dense;
+}
+
+
+SparseMatrix::SparseMatrix(size_t rows,
+                           size_t cols,
+                           std::vector<size_t> row_offsets,
+                           std::vector<size_t> columns,
+                           std::vector<double> values)
+    : _rows(rows), _cols(cols), _row_offsets(std::move(row_offsets)),
+      _columns(std::move(columns)), _values(std::move(values))
+{
+    if (_row_offsets.size() != _rows + 1 || _row_offsets.front() != 0 ||
+        _row_offsets.back() != _values.size() ||
+        _columns.size() != _values.size())
+    {
+        throw std::invalid_argument("inconsistent CSR arrays");
+    }
+    for (size_t r = 0; r < _rows; r++)
+    {
+        if (_row_offsets[r] > _row_offsets[r + 1])
+        {
+            throw std::invalid_argument("inconsistent CSR arrays");
+        }
+        check_indices(_columns.data() + _row_offsets[r],
+                      _row_offsets[r + 1] - _row_offsets[r],
+                      _cols);
+    }
+}
+
+
+SparseMatrix SparseMatrix::from_rows(const std::vector<SparseVector> &rows)
+{
+    const size_t cols = rows.empty() ? 0 : rows.front().size();
+    SparseMatrix result(rows.size(), cols);
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        if (rows[r].size() != cols)
+        {
+            throw std::invalid_argument("rows should have same size");
+        }
+        result._columns.insert(result._columns.end(),
+                               rows[r].indices().begin(),
+                               rows[r].indices().end());
+        result._values.insert(result._values.end(),
+                              rows[r].values().begin(),
+                              rows[r].values().end());
+        result._row_offsets[r + 1] = result._values.size();
+    }
+    return result;
+}
+
+
+SparseMatrix
+SparseMatrix::from_dense(const std::vector<std::vector<double>> &dense)
+{
+    std::vector<SparseVector> rows;
+    rows.reserve(dense.size());
+    for (const auto &row : dense)
+    {
+        rows.push_back(SparseVector::from_dense(row));
+    }
+    return from_rows(rows);
+}
+
+
+SparseVector SparseMatrix::row(size_t i) const
+{
+    const auto first = static_cast<std::ptrdiff_t>(_row_offsets[i]);
+    const auto last = static_cast<std::ptrdiff_t>(_row_offsets[i + 1]);
+    return SparseVector(
+        _cols,
+        std::vector<size_t>(_columns.begin() + first, _columns.begin() + last),
+        std::vector<double>(_values.begin() + first, _values.begin() + last));
+}
+
+
+std::vector<double> SparseMatrix::multiply(const std::vector<double> &x) const
+{
+    if (x.size() != _cols)
+    {
+        throw std::invalid_argument("invalid size of the vector");
+    }
+    std::vector<double> y(_rows, 0.0);
+    for (size_t r = 0; r < _rows; r++)
+    {
+        double sum = 0;
+        for (size_t k = _row_offsets[r]; k < _row_offsets[r + 1]; k++)
+        {
+            sum += _values[k] * x[_columns[k]];
+        }
+        y[r] = sum;
+    }
+    return y;
+}
+
+
+std::vector<double> SparseMatrix::multiply(const std::vector<double> &x,
+                                           size_t n) const
+{
+    if (x.size() != _cols * n)
+    {
+        throw std::invalid_argument("invalid size of the matrix");
+    }
+    std::vector<double> y(_rows * n, 0.0);
+    for (size_t r = 0; r < _rows; r++)
+    {
+        double *out = y.data() + r * n;
+        for (size_t k = _row_offsets[r]; k < _row_offsets[r + 1]; k++)
+        {
+            const double value = _values[k];
+            const double *in = x.data() + _columns[k] * n;
+            for (size_t j = 0; j < n; j++)
+            {
+                out[j] += value * in[j];
+            }
+        }
+    }
+    return y;
+}
+
+
+Variable dot_product(const std::vector<Variable> &a, const SparseVector &b)
+{
+    if (a.size() != b.size())
+    {
+        throw std::invalid_argument("a and b should have same size");
+    }
+    double value = 0;
+    for (size_t i = 0; i < b.nnz(); i++)
+    {
+        value += a[b.indices()[i]].value() * b.values()[i];
+    }
+    return sparse_node(a,
+                       b,
+                       nullptr,
+                       "dot_product",
+                       ActivationFunction::Identity,
+                       value,
+                       ActivationMode::Exact);
+}
+
+
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const SparseVector &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode)
+{
+    if (weights.size() != inputs.size())
+    {
+        throw std::invalid_argument("weights and inputs should have same size");
+    }
+    const ActivationFunction activation = parse_activation(activate_function);
+    double preactivation = bias.value();
+    for (size_t i = 0; i < inputs.nnz(); i++)
+    {
+        preactivation += weights[inputs.indices()[i]].value() *
+                         inputs.values()[i];
+    }
+    return sparse_node(weights,
+                       inputs,
+                       &bias,
+                       "fused_neuron",
+                       activation,
+                       preactivation,
+                       mode);
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../variable/variable.h"
+
+/**
+ * @class SparseVector
+ * This class represents a sparse vector as sorted index/value pairs.
+ */
+class SparseVector
+{
+private:
+    size_t _size;                 // The dimension of the vector.
+    std::vector<size_t> _indices; // The sorted indices of the non-zeros.
+    std::vector<double> _values;  // The values of the non-zeros.
+
+public:
+    /**
+     * Constructs an empty sparse vector.
+     * @param size The dimension of the vector.
+     */
+    explicit SparseVector(size_t size = 0) : _size(size){};
+
+    /**
+     * Constructs a sparse vector from index/value pairs.
+     * @param size The dimension of the vector.
+     * @param indices The strictly increasing indices of the non-zeros.
+     * @param values The values of the non-zeros.
+     * @throw std::invalid_argument if the indices are unsorted, repeated or
+     * out of range, or if the sizes of indices and values differ.
+     */
+    SparseVector(size_t size,
+                 std::vector<size_t> indices,
+                 std::vector<double> values);
+
+    /**
+     * Constructs a sparse vector from the non-zeros of a dense vector.
+     * @param dense The dense vector.
+     * @return The sparse vector.
+     */
+    static SparseVector from_dense(const std::vector<double> &dense);
+
+    /**
+     * Returns the dimension of the vector.
+     * @return The dimension.
+     */
+    size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * Returns the number of stored non-zeros.
+     * @return The number of non-zeros.
+     */
+    size_t nnz() const
+    {
+        return _indices.size();
+    }
+
+    /**
+     * Returns the indices of the non-zeros.
+     * @return The indices.
+     */
+    const std::vector<size_t> &indices() const
+    {
+        return _indices;
+    }
+
+    /**
+     * Returns the values of the non-zeros.
+     * @return The values.
+     */
+    const std::vector<double> &values() const
+    {
+        return _values;
+    }
+
+    /**
+     * Expands the vector into a dense vector.
+     * @return The dense vector.
+     */
+    std::vector<double> to_dense() const;
+};
+
+/**
+ * @class SparseMatrix
+ * This class represents a sparse matrix in compressed sparse row (CSR)
+ * format, e.g. a batch of sparse inputs with one sample per row.
+ */
+class SparseMatrix
+{
+private:
+    size_t _rows;                     // The number of rows.
+    size_t _cols;                     // The number of columns.
+    std::vector<size_t> _row_offsets; // The first non-zero of each row.
+    std::vector<size_t> _columns;     // The column of each non-zero.
+    std::vector<double> _values;      // The value of each non-zero.
+
+public:
+    /**
+     * Constructs an empty matrix.
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     */
+    SparseMatrix(size_t rows = 0, size_t cols = 0)
+        : _rows(rows), _cols(cols), _row_offsets(rows + 1, 0){};
+
+    /**
+     * Constructs a matrix from CSR arrays.
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param row_offsets The first non-zero of each row, followed by nnz.
+     * @param columns The strictly increasing columns of each row.
+     * @param values The value of each non-zero.
+     * @throw std::invalid_argument if the arrays are inconsistent.
+     */
+    SparseMatrix(size_t rows,
+                 size_t cols,
+                 std::vector<size_t> row_offsets,
+                 std::vector<size_t> columns,
+                 std::vector<double> values);
+
+    /**
+     * Stacks sparse vectors of the same dimension as the rows of a matrix.
+     * @param rows The rows.
+     * @return The matrix.
+     * @throw std::invalid_argument if the dimensions differ.
+     */
+    static SparseMatrix from_rows(const std::vector<SparseVector> &rows);
+
+    /**
+     * Constructs a matrix from the non-zeros of a dense row-major matrix.
+     * @param dense The rows of the dense matrix.
+     * @return The matrix.
+     * @throw std::invalid_argument if the rows have different sizes.
+     */
+    static SparseMatrix
+    from_dense(const std::vector<std::vector<double>> &dense);
+
+    /**
+     * Returns the number of rows.
+     * @return The number of rows.
+     */
+    size_t rows() const
+    {
+        return _rows;
+    }
+
+    /**
+     * Returns the number of columns.
+     * @return The number of columns.
+     */
+    size_t cols() const
+    {
+        return _cols;
+    }
+
+    /**
+     * Returns the number of stored non-zeros.
+     * @return The number of non-zeros.
+     */
+    size_t nnz() const
+    {
+        return _values.size();
+    }
+
+    /**
+     * Returns the first non-zero of each row, followed by nnz.
+     * @return The row offsets.
+     */
+    const std::vector<size_t> &row_offsets() const
+    {
+        return _row_offsets;
+    }
+
+    /**
+     * Returns the column of each non-zero.
+     * @return The columns.
+     */
+    const std::vector<size_t> &columns() const
+    {
+        return _columns;
+    }
+
+    /**
+     * Returns the value of each non-zero.
+     * @return The values.
+     */
+    const std::vector<double> &values() const
+    {
+        return _values;
+    }
+
+    /**
+     * Returns a row of the matrix.
+     * @param i The index of the row.
+     * @return The row as a sparse vector.
+     */
+    SparseVector row(size_t i) const;
+
+    /**
+     * Multiplies the matrix with a dense vector.
+     * @param x The dense vector, one entry per column.
+     * @return The dense product, one entry per row.
+     * @throw std::invalid_argument if the size of x does not match.
+     */
+    std::vector<double> multiply(const std::vector<double> &x) const;
+
+    /**
+     * Multiplies the matrix with a dense matrix.
+     * @param x The dense row-major matrix, cols x n.
+     * @param n The number of columns of x, e.g. the batch size.
+     * @return The dense row-major product, rows x n.
+     * @throw std::invalid_argument if the size of x does not match.
+     * @note The inner loop runs over the n contiguous columns of x.
+     */
+    std::vector<double> multiply(const std::vector<double> &x, size_t n) const;
+};
+
+/**
+ * Calculates the dot product of a vector of variables and a sparse vector.
+ * Only the variables at the non-zero indices become children, so the work
+ * and the gradients are proportional to the number of non-zeros.
+ * @param a The vector of variables.
+ * @param b The sparse vector.
+ * @return The dot product of the two vectors.
+ * @throw std::invalid_argument if the dimensions differ.
+ */
+Variable dot_product(const std::vector<Variable> &a, const SparseVector &b);
+
+/**
+ * Computes a neuron, activate(weights * inputs + bias), for a sparse input as
+ * a single node whose children are the touched weights followed by the bias.
+ * @param weights The weights of the neuron.
+ * @param inputs The sparse input.
+ * @param bias The bias of the neuron.
+ * @param activate_function The name of the activation function.
+ * @param mode Whether to use the exact or the fast activation kernel.
+ * @return The activated output of the neuron.
+ * @throw std::invalid_argument if the dimensions differ.
+ */
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const SparseVector &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode = ActivationMode::Exact);
@@ -0,0 +1,390 @@
+#include "trainer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+#include "../determinism/determinism.h"
+#include "../loss/loss.h"
+
+
+namespace
+{
+// Parses one CSV line into values, reusing their storage.
+void parse_line(const std::string &line,
+                size_t line_number,
+                std::vector<double> &values)
+{
+    values.clear();
+    std::istringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ','))
+    {
+        const char *begin = field.c_str();
+        char *end = nullptr;
+        errno = 0;
+        const double value = std::strtod(begin, &end);
+        while (*end == ' ' || *end == '\r')
+        {
+            end++;
+        }
+        if (end == begin || *end != '\0' || errno == ERANGE)
+        {
+            throw std::runtime_error("line " + std::to_string(line_number) +
+                                     ": not a number: " + field);
+        }
+        values.push_back(value);
+    }
+}
+
+
+size_t peak_rss_bytes()
+{
+    struct rusage usage
+    {
+    };
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    // Linux reports kilobytes.
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+
+size_t class_index(const std::vector<double> &target, size_t n_classes)
+{
+    if (target.size() != 1 || !(target[0] >= 0) ||
+        target[0] >= static_cast<double>(n_classes) ||
+        target[0] != std::floor(target[0]))
+    {
+        throw std::invalid_argument(
+            "cross entropy targets should be one class index");
+    }
+    return static_cast<size_t>(target[0]);
+}
+
+
+// The loss of a single sample.
+Variable sample_loss(LossKind kind,
+                     const std::vector<Variable> &outputs,
+                     const std::vector<double> &target)
+{
+    switch (kind)
+    {
+    case LossKind::MSE:
+        return MSELoss(outputs, target);
+    case LossKind::CrossEntropy:
+        return SoftmaxCrossEntropyLoss(outputs,
+                                       class_index(target, outputs.size()));
+    case LossKind::BCEWithLogits:
+        return BCEWithLogitsLoss(outputs, target);
+    case LossKind::Huber:
+        return HuberLoss(outputs, target);
+    }
+    throw std::invalid_argument("unknown loss");
+}
+} // namespace
+
+
+Dataset load_csv(const std::string &path, size_t n_in)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    Dataset data;
+    std::string line;
+    std::vector<double> values;
+    size_t width = 0;
+    for (size_t line_number = 1; std::getline(file, line); line_number++)
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        parse_line(line, line_number, values);
+        if (width == 0)
+        {
+            width = values.size();
+        }
+        if (values.size() != width || width <= n_in)
+        {
+            throw std::runtime_error(
+                "line " + std::to_string(line_number) + ": expected " +
+                std::to_string(std::max(width, n_in + 1)) + " values");
+        }
+        const auto split = values.begin() + static_cast<long>(n_in);
+        data.inputs.emplace_back(values.begin(), split);
+        data.targets.emplace_back(split, values.end());
+    }
+    return data;
+}
+
+
+std::pair<Dataset, Dataset> split_dataset(const Dataset &data,
+                                          double validation_fraction)
+{
+    if (!(validation_fraction >= 0 && validation_fraction < 1))
+    {
+        throw std::invalid_argument("validation fraction should be in [0, 1)");
+    }
+    const auto n_train = data.size() - static_cast<size_t>(
+        validation_fraction * static_cast<double>(data.size()));
+    Dataset train;
+    Dataset validation;
+    const auto offset = static_cast<long>(n_train);
+    train.inputs.assign(data.inputs.begin(), data.inputs.begin() + offset);
+    train.targets.assign(data.targets.begin(), data.targets.begin() + offset);
+    validation.inputs.assign(data.inputs.begin() + offset, data.inputs.end());
+    validation.targets.assign(data.targets.begin() + offset,
+                              data.targets.end());
+    return {std::move(train), std::move(validation)};
+}
+
+
+LossKind parse_loss(const std::string &name)
+{
+    if (name == "mse")
+    {
+        return LossKind::MSE;
+    }
+    if (name == "cross_entropy")
+    {
+        return LossKind::CrossEntropy;
+    }
+    if (name == "bce_with_logits")
+    {
+        return LossKind::BCEWithLogits;
+    }
+    if (name == "huber")
+    {
+        return LossKind::Huber;
+    }
+    throw std::invalid_argument("unknown loss: " + name);
+}
+
+
+Trainer::Trainer(MLP &mlp, TrainerOptions options)
+    : _mlp(mlp), _options(options), _engine(next_seed())
+{
+    if (_options.batch_size == 0)
+    {
+        throw std::invalid_argument("batch size should be positive");
+    }
+    if (_options.num_threads == 0)
+    {
+        throw std::invalid_argument("number of threads should be positive");
+    }
+    if (!(_options.learning_rate > 0))
+    {
+        throw std::invalid_argument("learning rate should be positive");
+    }
+    if (_options.num_threads > 1)
+    {
+        _pool = std::make_unique<WorkStealingPool>(_options.num_threads);
+    }
+}
+
+
+WorkStealingPool *Trainer::backward_pool()
+{
+    // The serial pass sums in another order than the lanes of the
+    // deterministic one, so deterministic mode takes the lanes even on a
+    // single thread.
+    if (!_pool && deterministic())
+    {
+        _pool = std::make_unique<WorkStealingPool>(1);
+    }
+    return _pool.get();
+}
+
+
+double Trainer::step(const Dataset &data, const std::vector<size_t> &batch)
+{
+    if (batch.empty())
+    {
+        throw std::invalid_argument("batch should not be empty");
+    }
+    if (data.targets.size() != data.size())
+    {
+        throw std::invalid_argument("dataset should have one target per "
+                                    "sample");
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // The outputs are swapped out of the model so both keep their storage.
+    _predictions.resize(batch.size());
+    _targets.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        const size_t sample = batch[i];
+        if (sample >= data.size())
+        {
+            throw std::invalid_argument("sample out of range");
+        }
+        _predictions[i].swap(_mlp.forward(data.inputs[sample]));
+        _targets[i].assign(data.targets[sample].begin(),
+                           data.targets[sample].end());
+    }
+
+    Variable loss;
+    switch (_options.loss)
+    {
+    case LossKind::MSE:
+        loss = MSELoss(_predictions, _targets);
+        break;
+    case LossKind::CrossEntropy:
+        _classes.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            _classes[i] = class_index(_targets[i], _predictions[i].size());
+        }
+        loss = SoftmaxCrossEntropyLoss(_predictions, _classes);
+        break;
+    case LossKind::BCEWithLogits:
+        loss = BCEWithLogitsLoss(_predictions, _targets);
+        break;
+    case LossKind::Huber:
+        loss = HuberLoss(_predictions, _targets);
+        break;
+    }
+
+    // The loss holds its own copy of the graph, which the backward pass
+    // frees as it goes.
+    for (auto &outputs : _predictions)
+    {
+        for (auto &output : outputs)
+        {
+            output.release_graph();
+        }
+    }
+    _mlp.release_results();
+
+    std::vector<Variable> &parameters = _mlp.mutable_parameters();
+    for (auto &parameter : parameters)
+    {
+        parameter.zero_grad();
+    }
+    loss.set_gradient(1.0);
+    if (WorkStealingPool *pool = backward_pool())
+    {
+        parallel_backward(loss, *pool);
+    }
+    else
+    {
+        loss.backward();
+    }
+    for (auto &parameter : parameters)
+    {
+        parameter.gradient_descent(_options.learning_rate);
+    }
+
+    _step_latency.record(std::chrono::steady_clock::now() - start);
+    return loss.value();
+}
+
+
+double Trainer::evaluate(const Dataset &data) const
+{
+    if (data.size() == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double sum = 0;
+    std::vector<Variable> outputs;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        const std::vector<double> values = _mlp.predict(data.inputs[i]);
+        outputs.clear();
+        for (const double value : values)
+        {
+            outputs.emplace_back(value);
+        }
+        sum += sample_loss(_options.loss, outputs, data.targets[i]).value();
+    }
+    return sum / static_cast<double>(data.size());
+}
+
+
+std::vector<EpochStats> Trainer::fit(const Dataset &train,
+                                     const Dataset &validation)
+{
+    if (train.size() == 0 || train.targets.size() != train.size())
+    {
+        throw std::invalid_argument(
+            "training set should have one target per sample");
+    }
+    _order.resize(train.size());
+    std::iota(_order.begin(), _order.end(), 0);
+
+    std::vector<EpochStats> history;
+    double best_validation_loss = std::numeric_limits<double>::infinity();
+    size_t epochs_without_improvement = 0;
+    for (size_t epoch = 0; epoch < _options.epochs; epoch++)
+    {
+        if (_options.shuffle)
+        {
+            std::shuffle(_order.begin(), _order.end(), _engine);
+        }
+        _step_latency.reset();
+        const auto start = std::chrono::steady_clock::now();
+        double loss_sum = 0;
+        for (size_t first = 0; first < _order.size();
+             first += _options.batch_size)
+        {
+            const size_t last =
+                std::min(first + _options.batch_size, _order.size());
+            _batch.assign(_order.begin() + static_cast<long>(first),
+                          _order.begin() + static_cast<long>(last));
+            loss_sum +=
+                step(train, _batch) * static_cast<double>(_batch.size());
+        }
+        const double seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+
+        EpochStats stats;
+        stats.epoch = epoch;
+        stats.train_loss = loss_sum / static_cast<double>(train.size());
+        stats.validation_loss = evaluate(validation);
+        stats.samples_per_second =
+            seconds > 0 ? static_cast<double>(train.size()) / seconds : 0;
+        stats.step_p50 = _step_latency.percentile(50);
+        stats.step_p90 = _step_latency.percentile(90);
+        stats.step_p99 = _step_latency.percentile(99);
+        stats.peak_rss_bytes = peak_rss_bytes();
+        stats.node_pool_bytes = NodePool::cached_bytes();
+        history.push_back(stats);
+
+        bool proceed = true;
+        for (const auto &hook : _hooks)
+        {
+            proceed = hook(stats) && proceed;
+        }
+        if (stats.validation_loss < best_validation_loss)
+        {
+            best_validation_loss = stats.validation_loss;
+            epochs_without_improvement = 0;
+        }
+        else if (validation.size() > 0)
+        {
+            epochs_without_improvement++;
+        }
+        if (!proceed || (_options.patience > 0 &&
+                         epochs_without_improvement >= _options.patience))
+        {
+            break;
+        }
+    }
+    return history;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "../neural_network/mlp.h"
+#include "../scheduler/scheduler.h"
+
+/**
+ * @struct Dataset
+ * The samples of a supervised task, one row per sample.
+ */
+struct Dataset
+{
+    std::vector<std::vector<double>> inputs;  // The input values.
+    std::vector<std::vector<double>> targets; // The target values.
+
+    /**
+     * Returns the number of samples.
+     * @return The size.
+     */
+    size_t size() const
+    {
+        return inputs.size();
+    }
+};
+
+/**
+ * Loads a dataset from a CSV file without a header, one sample per line, the
+ * inputs followed by the targets. Empty lines are skipped.
+ * @param path The path of the file.
+ * @param n_in The number of inputs per sample.
+ * @return The dataset.
+ * @throw std::runtime_error if the file cannot be read, a value is not a
+ * number or the lines have different numbers of values.
+ */
+Dataset load_csv(const std::string &path, size_t n_in);
+
+/**
+ * Splits a dataset into a training and a validation set.
+ * @param data The dataset.
+ * @param validation_fraction The fraction of the samples, taken from the
+ * end, that goes to the validation set.
+ * @return The training and the validation set.
+ * @throw std::invalid_argument if the fraction is not in [0, 1).
+ */
+std::pair<Dataset, Dataset> split_dataset(const Dataset &data,
+                                          double validation_fraction);
+
+/**
+ * The loss functions a `Trainer` can minimize.
+ */
+enum class LossKind
+{
+    MSE,           // MSELoss.
+    CrossEntropy,  // SoftmaxCrossEntropyLoss, the target is the class index.
+    BCEWithLogits, // BCEWithLogitsLoss.
+    Huber,         // HuberLoss with delta 1.
+};
+
+/**
+ * Parses the name of a loss function: "mse", "cross_entropy",
+ * "bce_with_logits" or "huber".
+ * @param name The name.
+ * @return The loss function.
+ * @throw std::invalid_argument if the name is unknown.
+ */
+LossKind parse_loss(const std::string &name);
+
+/**
+ * @struct TrainerOptions
+ * The configuration of a training run.
+ */
+struct TrainerOptions
+{
+    size_t epochs = 10;            // The maximum number of epochs.
+    size_t batch_size = 32;        // The number of samples per step.
+    double learning_rate = 0.01;   // The step size of gradient descent.
+    LossKind loss = LossKind::MSE; // The minimized loss.
+    bool shuffle = true;           // Whether to shuffle every epoch.
+    size_t patience = 0; // Epochs without a better validation loss before
+                         // stopping, or 0 to never stop early.
+    size_t num_threads = 1; // The threads of the backward pass; results
+                            // are the same for any in deterministic mode.
+};
+
+/**
+ * @struct EpochStats
+ * The loss, throughput, step latencies and memory of one epoch.
+ */
+struct EpochStats
+{
+    size_t epoch = 0;              // The epoch, counting from 0.
+    double train_loss = 0;         // The mean loss of the steps.
+    double validation_loss = 0;    // The validation loss, NaN without one.
+    double samples_per_second = 0; // The training throughput.
+    std::chrono::nanoseconds step_p50{0}; // The median step latency.
+    std::chrono::nanoseconds step_p90{0}; // The 90th percentile.
+    std::chrono::nanoseconds step_p99{0}; // The 99th percentile.
+    size_t peak_rss_bytes = 0;  // The peak resident memory of the process.
+    size_t node_pool_bytes = 0; // The graph memory cached by this thread.
+};
+
+/**
+ * @class Trainer
+ * This class trains an MLP with minibatch gradient descent. Each step builds
+ * one graph over the samples of a batch, runs the backward pass, serially or
+ * on a work-stealing pool, and updates the parameters. After each epoch the
+ * trainer evaluates the validation set, records the statistics and calls
+ * the epoch hooks.
+ * @note The shuffle order is seeded with `next_seed()`, so training is
+ * reproducible after `set_seed` or in deterministic mode.
+ */
+class Trainer
+{
+private:
+    MLP &_mlp;                                       // The trained model.
+    TrainerOptions _options;                         // The configuration.
+    std::unique_ptr<WorkStealingPool> _pool;         // The backward pool.
+    std::mt19937_64 _engine;                         // The shuffle engine.
+    std::vector<size_t> _order;                      // The sample order.
+    std::vector<std::vector<Variable>> _predictions; // The batch outputs.
+    std::vector<std::vector<double>> _targets;       // The batch targets.
+    std::vector<size_t> _classes;                    // The batch classes.
+    std::vector<size_t> _batch;                      // The batch indices.
+    LatencyHistogram _step_latency;                  // The step latencies.
+    std::vector<std::function<bool(const EpochStats &)>> _hooks; // Hooks.
+
+    /**
+     * Returns the pool of the backward pass, created with one thread in
+     * deterministic mode so that every number of threads runs the same
+     * lanes.
+     * @return The pool, or null for the serial pass.
+     */
+    WorkStealingPool *backward_pool();
+
+public:
+    /**
+     * Constructs a trainer.
+     * @param mlp The model, which must outlive the trainer.
+     * @param options The configuration.
+     * @throw std::invalid_argument if the batch size or the number of
+     * threads is zero or the learning rate is not positive.
+     */
+    explicit Trainer(MLP &mlp, TrainerOptions options = TrainerOptions());
+
+    /**
+     * Adds a hook called with the statistics of every epoch, e.g. to log
+     * them or to save a checkpoint. Training stops after the epoch if a
+     * hook returns false.
+     * @param hook The hook.
+     */
+    void add_epoch_hook(std::function<bool(const EpochStats &)> hook)
+    {
+        _hooks.push_back(std::move(hook));
+    }
+
+    /**
+     * Performs one step of gradient descent on a batch.
+     * @param data The dataset.
+     * @param batch The indices of the samples of the batch.
+     * @return The loss of the batch before the update.
+     * @throw std::invalid_argument if the batch is empty or the shapes do
+     * not match.
+     */
+    double step(const Dataset &data, const std::vector<size_t> &batch);
+
+    /**
+     * Computes the mean loss of a dataset without building a graph.
+     * @param data The dataset.
+     * @return The mean loss of the samples, or NaN if the set is empty.
+     */
+    double evaluate(const Dataset &data) const;
+
+    /**
+     * Trains until the last epoch, until the validation loss has not
+     * improved for `patience` epochs, or until a hook returns false.
+     * @param train The training set.
+     * @param validation The validation set, may be empty.
+     * @return The statistics of each epoch.
+     * @throw std::invalid_argument if the training set is empty or its
+     * inputs and targets differ in number.
+     */
+    std::vector<EpochStats> fit(const Dataset &train,
+                                const Dataset &validation = Dataset());
+};
@@ -0,0 +1,138 @@
+#include "node_pool.h"
+
+#include <array>
+
+
+namespace
+{
+// Blocks of up to 1 KiB come in 16-byte steps, larger ones in powers of two
+// up to 8 MiB; even larger blocks bypass the pool.
+constexpr size_t step_bytes = 16;
+constexpr size_t num_small_classes = 64;
+constexpr size_t small_limit = step_bytes * num_small_classes;
+constexpr size_t first_large_shift = 11;
+constexpr size_t last_large_shift = 23;
+constexpr size_t num_classes =
+    num_small_classes + last_large_shift - first_large_shift + 1;
+
+
+// Set once the free lists of the thread are destroyed, so that blocks freed
+// later by other thread-local destructors go straight to the allocator.
+thread_local bool free_lists_destroyed = false;
+
+
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+
+struct FreeLists
+{
+    std::array<FreeBlock *, num_classes> heads{};
+    size_t bytes = 0;
+
+    void release() noexcept;
+
+    ~FreeLists()
+    {
+        release();
+        free_lists_destroyed = true;
+    }
+};
+
+
+thread_local FreeLists free_lists;
+
+
+size_t size_class(size_t bytes)
+{
+    if (bytes <= small_limit)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / step_bytes;
+    }
+    size_t shift = first_large_shift;
+    while ((size_t{1} << shift) < bytes)
+    {
+        shift++;
+    }
+    return num_small_classes + shift - first_large_shift;
+}
+
+
+size_t class_bytes(size_t index)
+{
+    if (index < num_small_classes)
+    {
+        return step_bytes * (index + 1);
+    }
+    return size_t{1} << (index - num_small_classes + first_large_shift);
+}
+
+
+void FreeLists::release() noexcept
+{
+    for (auto &head : heads)
+    {
+        while (head != nullptr)
+        {
+            FreeBlock *next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+    bytes = 0;
+}
+} // namespace
+
+
+void *NodePool::allocate(size_t bytes)
+{
+    if (bytes > (size_t{1} << last_large_shift) || free_lists_destroyed)
+    {
+        return ::operator new(bytes);
+    }
+    const size_t index = size_class(bytes);
+    FreeBlock *&head = free_lists.heads[index];
+    if (head == nullptr)
+    {
+        return ::operator new(class_bytes(index));
+    }
+    FreeBlock *block = head;
+    head = block->next;
+    free_lists.bytes -= class_bytes(index);
+    return block;
+}
+
+
+void NodePool::deallocate(void *block, size_t bytes) noexcept
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+    if (bytes > (size_t{1} << last_large_shift) || free_lists_destroyed)
+    {
+        ::operator delete(block);
+        return;
+    }
+    const size_t index = size_class(bytes);
+    FreeBlock *&head = free_lists.heads[index];
+    head = new (block) FreeBlock{head};
+    free_lists.bytes += class_bytes(index);
+}
+
+
+void NodePool::trim() noexcept
+{
+    if (!free_lists_destroyed)
+    {
+        free_lists.release();
+    }
+}
+
+
+size_t NodePool::cached_bytes() noexcept
+{
+    return free_lists_destroyed ? 0 : free_lists.bytes;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+/**
+ * @class NodePool
+ * This class caches the memory blocks of graph nodes, such as child arrays
+ * and large backward closures, in per-thread free lists of fixed size
+ * classes. A training step frees the graph of the previous step before or
+ * while it builds the next one, so once the lists are warm building and
+ * releasing graphs no longer calls the global allocator.
+ * @note A block may be freed on another thread than the one that allocated
+ * it; it then joins the free lists of the freeing thread.
+ */
+class NodePool
+{
+public:
+    /**
+     * Allocates a block of at least the given size, aligned for any
+     * fundamental type.
+     * @param bytes The size of the block.
+     * @return The block.
+     * @throw std::bad_alloc if the allocation fails.
+     */
+    static void *allocate(size_t bytes);
+
+    /**
+     * Returns a block to the free lists of the calling thread.
+     * @param block The block, allocated by `allocate`.
+     * @param bytes The size passed to `allocate`.
+     */
+    static void deallocate(void *block, size_t bytes) noexcept;
+
+    /**
+     * Releases the cached blocks of the calling thread to the global
+     * allocator, e.g. after a graph much larger than the usual one.
+     */
+    static void trim() noexcept;
+
+    /**
+     * Returns the number of bytes cached by the calling thread.
+     * @return The bytes in the free lists.
+     */
+    static size_t cached_bytes() noexcept;
+};
+
+/**
+ * @class PoolAllocator
+ * An allocator over the `NodePool`, for containers owned by graph nodes.
+ */
+template <typename T> class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U> PoolAllocator(const PoolAllocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T *>(NodePool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *block, size_t n) noexcept
+    {
+        NodePool::deallocate(block, n * sizeof(T));
+    }
+
+    template <typename U> bool operator==(const PoolAllocator<U> &) const
+    {
+        return true;
+    }
+
+    template <typename U> bool operator!=(const PoolAllocator<U> &) const
+    {
+        return false;
+    }
+};
@@ -2,13 +2,174 @@
 #include <fmt/format.h>
 #include <math.h>
 
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace
+{
+// The constants captured by backward functions, kept in the node pool.
+using Values = std::vector<double, PoolAllocator<double>>;
+} // namespace
+
+
+void ChildList::reallocate(size_t capacity)
+{
+    if (capacity > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("too many children");
+    }
+    auto *data = static_cast<Variable *>(
+        NodePool::allocate(capacity * sizeof(Variable)));
+    for (size_t i = 0; i < _size; i++)
+    {
+        Variable *reference = _data[i].reference();
+        new (data + i) Variable(std::move(_data[i]));
+        data[i].set_ref(reference == &_data[i] ? &data[i] : reference);
+        _data[i].~Variable();
+    }
+    NodePool::deallocate(_data, _capacity * sizeof(Variable));
+    _data = data;
+    _capacity = static_cast<uint32_t>(capacity);
+}
+
+
+ChildList::ChildList(std::initializer_list<Variable> children)
+{
+    append(children.begin(), children.end());
+}
+
+
+ChildList::ChildList(const ChildList &other)
+{
+    append(other.begin(), other.end());
+}
+
+
+ChildList &ChildList::operator=(const ChildList &other)
+{
+    if (this != &other)
+    {
+        ChildList(other).swap(*this);
+    }
+    return *this;
+}
+
+
+ChildList::~ChildList()
+{
+    clear();
+    NodePool::deallocate(_data, _capacity * sizeof(Variable));
+}
+
+
+void ChildList::reserve(size_t capacity)
+{
+    if (capacity > _capacity)
+    {
+        reallocate(capacity);
+    }
+}
+
+
+void ChildList::resize(size_t size)
+{
+    reserve(size);
+    while (_size > size)
+    {
+        _data[--_size].~Variable();
+    }
+    while (_size < size)
+    {
+        new (_data + _size) Variable();
+        _size++;
+    }
+}
+
+
+void ChildList::clear() noexcept
+{
+    while (_size > 0)
+    {
+        _data[--_size].~Variable();
+    }
+}
+
+
+const std::string *Variable::intern_symbol(const std::string &text)
+{
+    // Each thread caches the symbols it has looked up, so the shared table
+    // is only locked the first time.
+    thread_local std::unordered_map<std::string, const std::string *> cache;
+    const auto cached = cache.find(text);
+    if (cached != cache.end())
+    {
+        return cached->second;
+    }
+    static std::mutex mutex;
+    static std::unordered_set<std::string> symbols;
+    const std::string *symbol;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        symbol = &*symbols.insert(text).first;
+    }
+    cache.emplace(text, symbol);
+    return symbol;
+}
+
+
+void GradientSink::grow()
+{
+    std::vector<Variable *> targets(std::max<size_t>(64, 2 * _targets.size()),
+                                    nullptr);
+    std::vector<double> gradients(targets.size(), 0.0);
+    std::vector<size_t> order;
+    order.reserve(targets.size() / 2);
+    targets.swap(_targets);
+    gradients.swap(_gradients);
+    order.swap(_order);
+    for (size_t i : order)
+    {
+        add(targets[i], gradients[i]);
+    }
+}
+
+
+void GradientSink::merge(GradientSink &other)
+{
+    for (size_t i : other._order)
+    {
+        add(other._targets[i], other._gradients[i]);
+        other._targets[i] = nullptr;
+        other._gradients[i] = 0;
+    }
+    other._order.clear();
+}
+
+
+void GradientSink::flush()
+{
+    for (size_t i : _order)
+    {
+        _targets[i]->update_gradient(_gradients[i]);
+        _targets[i] = nullptr;
+        _gradients[i] = 0;
+    }
+    _order.clear();
+}
+
+
 std::ostream &operator<<(std::ostream &os, const Variable &var)
 {
     os << fmt::format("Variable(name: {}, value: {}, gradient: {}, op: {})",
-                      var._name,
+                      var.name(),
                       var._value,
                       var._gradient,
-                      var._op);
+                      var.op());
     return os;
 }
 
@@ -16,11 +177,11 @@ Variable Variable::operator+(const Variable &other)
 {
     Variable result;
     result._value = _value + other._value;
-    result._op = "+";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("+");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this, other};
+    result._children = Variable::Children(*this, other);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient);
         result->_children[1].update_gradient(result->_gradient);
@@ -33,11 +194,11 @@ Variable Variable::operator-(const Variable &other)
 {
     Variable result;
     result._value = _value - other._value;
-    result._op = "-";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("-");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this, other};
+    result._children = Variable::Children(*this, other);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient);
         result->_children[1].update_gradient(-result->_gradient);
@@ -50,11 +211,11 @@ Variable Variable::operator*(const Variable &other)
 {
     Variable result;
     result._value = _value * other._value;
-    result._op = "*";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("*");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this, other};
+    result._children = Variable::Children(*this, other);
     result._backward = [](Variable *result) {
         Variable &left = result->_children[0];
         Variable &right = result->_children[1];
@@ -73,11 +234,11 @@ Variable Variable::operator/(const Variable &other)
     }
     Variable result;
     result._value = _value / other._value;
-    result._op = "/";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("/");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this, other};
+    result._children = Variable::Children(*this, other);
     result._backward = [](Variable *result) {
         const Variable &left = result->_children[0];
         const Variable &right = result->_children[1];
@@ -92,11 +253,11 @@ Variable Variable::operator-() const
 {
     Variable result;
     result._value = -_value;
-    result._op = "-";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("-");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(-result->_gradient);
     };
@@ -107,11 +268,11 @@ Variable Variable::identity() const
 {
     Variable result;
     result._value = _value;
-    result._op = "identity";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("identity");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient);
     };
@@ -123,11 +284,11 @@ Variable Variable::operator+(const double other) const
 {
     Variable result;
     result._value = _value + other;
-    result._op = "+";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("+");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient);
     };
@@ -139,11 +300,11 @@ Variable Variable::operator-(const double other) const
 {
     Variable result;
     result._value = _value - other;
-    result._op = "-";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("-");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient);
     };
@@ -155,11 +316,11 @@ Variable Variable::operator*(const double other) const
 {
     Variable result;
     result._value = _value * other;
-    result._op = "*";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("*");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [other](Variable *result) {
         result->_children[0].update_gradient(result->_gradient * other);
     };
@@ -175,11 +336,11 @@ Variable Variable::operator/(const double other) const
     }
     Variable result;
     result._value = _value / other;
-    result._op = "/";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("/");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [other](Variable *result) {
         result->_children[0].update_gradient(result->_gradient / other);
     };
@@ -225,9 +386,9 @@ Variable dot_product(const std::vector<Variable> &a,
     }
     Variable result;
     result._value = result_val;
-    result._op = "dot_product";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("dot_product");
+    result._op = symbol;
     result.ref = nullptr;
     result._children.resize(2 * size);
     for (size_t i = 0; i < size; i++)
@@ -263,12 +424,13 @@ Variable dot_product(const std::vector<Variable> &a,
     }
     Variable result;
     result._value = result_val;
-    result._op = "dot_product";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("dot_product");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = a;
-    result._backward = [size, b](Variable *result) {
+    result._children.assign(a.begin(), a.end());
+    result._backward = [size, b = Values(b.begin(), b.end())](
+                           Variable *result) {
         for (size_t i = 0; i < size; i++)
         {
             result->_children[i].update_gradient(result->_gradient * b[i]);
@@ -277,6 +439,92 @@ Variable dot_product(const std::vector<Variable> &a,
     return result;
 }
 
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const std::vector<double> &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode)
+{
+    if (weights.size() != inputs.size())
+    {
+        throw std::invalid_argument("weights and inputs should have same size");
+    }
+    const ActivationFunction activation = parse_activation(activate_function);
+    const size_t size = weights.size();
+    double preactivation = bias.value();
+    for (size_t i = 0; i < size; i++)
+    {
+        preactivation += weights[i].value() * inputs[i];
+    }
+    Variable result;
+    result._value = activate(activation, preactivation, mode);
+    static const std::string *const symbol =
+        Variable::intern_symbol("fused_neuron");
+    result._op = symbol;
+    result.ref = nullptr;
+    result._children.reserve(size + 1);
+    result._children.append(weights.begin(), weights.end());
+    result._children.push_back(bias);
+    result._backward = [inputs = Values(inputs.begin(), inputs.end()),
+                        activation,
+                        preactivation](Variable *result) {
+        const size_t size = inputs.size();
+        const double grad =
+            result->_gradient *
+            activation_derivative(activation, preactivation, result->_value);
+        for (size_t i = 0; i < size; i++)
+        {
+            result->_children[i].update_gradient(grad * inputs[i]);
+        }
+        result->_children[size].update_gradient(grad);
+    };
+    return result;
+}
+
+
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const std::vector<Variable> &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode)
+{
+    if (weights.size() != inputs.size())
+    {
+        throw std::invalid_argument("weights and inputs should have same size");
+    }
+    const ActivationFunction activation = parse_activation(activate_function);
+    const size_t size = weights.size();
+    double preactivation = bias.value();
+    for (size_t i = 0; i < size; i++)
+    {
+        preactivation += weights[i].value() * inputs[i].value();
+    }
+    Variable result;
+    result._value = activate(activation, preactivation, mode);
+    static const std::string *const symbol =
+        Variable::intern_symbol("fused_neuron");
+    result._op = symbol;
+    result.ref = nullptr;
+    result._children.reserve(2 * size + 1);
+    result._children.append(weights.begin(), weights.end());
+    result._children.append(inputs.begin(), inputs.end());
+    result._children.push_back(bias);
+    result._backward = [size, activation, preactivation](Variable *result) {
+        const double grad =
+            result->_gradient *
+            activation_derivative(activation, preactivation, result->_value);
+        for (size_t i = 0; i < size; i++)
+        {
+            result->_children[i].update_gradient(
+                grad * result->_children[i + size].value());
+            result->_children[i + size].update_gradient(
+                grad * result->_children[i].value());
+        }
+        result->_children[2 * size].update_gradient(grad);
+    };
+    return result;
+}
+
 Variable Variable::pow(const double other) const
 {
     if (this->value() == 0 && other < 0)
@@ -285,11 +533,11 @@ Variable Variable::pow(const double other) const
     }
     Variable result;
     result._value = std::pow(_value, other);
-    result._op = "pow";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("pow");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     double value = this->value();
     result._backward = [value, other](Variable *result) {
         result->_children[0].update_gradient(result->_gradient * other *
@@ -302,11 +550,11 @@ Variable Variable::exp() const
 {
     Variable result;
     result._value = std::exp(_value);
-    result._op = "exp";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("exp");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(result->_gradient *
                                              result->_value);
@@ -321,11 +569,11 @@ Variable Variable::log() const
     }
     Variable result;
     result._value = std::log(_value);
-    result._op = "log";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("log");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient / input.value());
@@ -336,11 +584,11 @@ Variable Variable::sin() const
 {
     Variable result;
     result._value = std::sin(_value);
-    result._op = "sin";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("sin");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient *
@@ -352,11 +600,11 @@ Variable Variable::cos() const
 {
     Variable result;
     result._value = std::cos(_value);
-    result._op = "cos";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("cos");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient *
@@ -372,11 +620,11 @@ Variable Variable::tan() const
     }
     Variable result;
     result._value = std::tan(_value);
-    result._op = "tan";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("tan");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(
@@ -389,11 +637,11 @@ Variable Variable::sinh() const
 {
     Variable result;
     result._value = std::sinh(_value);
-    result._op = "sinh";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("sinh");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient *
@@ -405,11 +653,11 @@ Variable Variable::cosh() const
 {
     Variable result;
     result._value = std::cosh(_value);
-    result._op = "cosh";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("cosh");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient *
@@ -422,11 +670,11 @@ Variable Variable::tanh() const
 {
     Variable result;
     result._value = std::tanh(_value);
-    result._op = "tanh";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("tanh");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(
             result->_gradient * (1 - result->_value * result->_value));
@@ -437,11 +685,11 @@ Variable Variable::relu() const
 {
     Variable result;
     result._value = _value > 0 ? _value : 0;
-    result._op = "relu";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("relu");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         const Variable &input = result->_children[0];
         result->_children[0].update_gradient(result->_gradient *
@@ -453,11 +701,11 @@ Variable Variable::sigmoid() const
 {
     Variable result;
     result._value = 1 / (1 + std::exp(-_value));
-    result._op = "sigmoid";
-    result._name =
-        fmt::format("Variable({}, {})", result.value(), result.gradient());
+    static const std::string *const symbol =
+        Variable::intern_symbol("sigmoid");
+    result._op = symbol;
     result.ref = nullptr;
-    result._children = std::vector<Variable>{*this};
+    result._children = Variable::Children(*this);
     result._backward = [](Variable *result) {
         result->_children[0].update_gradient(
             result->_gradient * result->_value * (1 - result->_value));
@@ -466,6 +714,67 @@ Variable Variable::sigmoid() const
 }
 
 
+Variable Variable::gelu() const
+{
+    Variable result;
+    result._value = ::gelu(_value);
+    static const std::string *const symbol =
+        Variable::intern_symbol("gelu");
+    result._op = symbol;
+    result.ref = nullptr;
+    result._children = Variable::Children(*this);
+    result._backward = [](Variable *result) {
+        const Variable &input = result->_children[0];
+        result->_children[0].update_gradient(
+            result->_gradient * activation_derivative(ActivationFunction::Gelu,
+                                                      input.value(),
+                                                      result->_value));
+    };
+    return result;
+}
+
+
+Variable Variable::silu() const
+{
+    Variable result;
+    result._value = ::silu(_value);
+    static const std::string *const symbol =
+        Variable::intern_symbol("silu");
+    result._op = symbol;
+    result.ref = nullptr;
+    result._children = Variable::Children(*this);
+    result._backward = [](Variable *result) {
+        const Variable &input = result->_children[0];
+        result->_children[0].update_gradient(
+            result->_gradient * activation_derivative(ActivationFunction::Silu,
+                                                      input.value(),
+                                                      result->_value));
+    };
+    return result;
+}
+
+
+Variable Variable::softplus() const
+{
+    Variable result;
+    result._value = ::softplus(_value);
+    static const std::string *const symbol =
+        Variable::intern_symbol("softplus");
+    result._op = symbol;
+    result.ref = nullptr;
+    result._children = Variable::Children(*this);
+    result._backward = [](Variable *result) {
+        const Variable &input = result->_children[0];
+        result->_children[0].update_gradient(
+            result->_gradient *
+            activation_derivative(ActivationFunction::Softplus,
+                                  input.value(),
+                                  result->_value));
+    };
+    return result;
+}
+
+
 Variable Variable::activate(std::string activate_function)
 {
     if (activate_function == "relu")
@@ -484,5 +793,17 @@ Variable Variable::activate(std::string activate_function)
     {
         return this->identity();
     }
+    if (activate_function == "gelu")
+    {
+        return this->gelu();
+    }
+    if (activate_function == "silu")
+    {
+        return this->silu();
+    }
+    if (activate_function == "softplus")
+    {
+        return this->softplus();
+    }
     throw std::runtime_error("unknown activation function");
 }
@@ -1,10 +1,638 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "../activation/activation.h"
+#include "node_pool.h"
+
+class Variable;
+
+/**
+ * @class BackwardFunction
+ * This class holds the backward function of a node. Closures of up to three
+ * pointers are stored inline and larger ones in the `NodePool`, so copying
+ * and releasing nodes does not call the global allocator. An empty function
+ * does nothing.
+ */
+class BackwardFunction
+{
+private:
+    static constexpr size_t inline_bytes = 3 * sizeof(void *);
+
+    struct Operations
+    {
+        void (*invoke)(const void *storage, Variable *node);
+        void (*copy)(void *to, const void *from);
+        void (*move)(void *to, void *from) noexcept; // Also destroys from.
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template <typename F> struct InlineOperations
+    {
+        static void invoke(const void *storage, Variable *node)
+        {
+            (*static_cast<const F *>(storage))(node);
+        }
+
+        static void copy(void *to, const void *from)
+        {
+            new (to) F(*static_cast<const F *>(from));
+        }
+
+        static void move(void *to, void *from) noexcept
+        {
+            new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
+        }
+
+        static void destroy(void *storage) noexcept
+        {
+            static_cast<F *>(storage)->~F();
+        }
+
+        static constexpr Operations operations{invoke, copy, move, destroy};
+    };
+
+    template <typename F> struct PooledOperations
+    {
+        static void invoke(const void *storage, Variable *node)
+        {
+            (**static_cast<F *const *>(storage))(node);
+        }
+
+        static void copy(void *to, const void *from)
+        {
+            void *block = NodePool::allocate(sizeof(F));
+            try
+            {
+                *static_cast<F **>(to) =
+                    new (block) F(**static_cast<F *const *>(from));
+            }
+            catch (...)
+            {
+                NodePool::deallocate(block, sizeof(F));
+                throw;
+            }
+        }
+
+        static void move(void *to, void *from) noexcept
+        {
+            *static_cast<F **>(to) = *static_cast<F **>(from);
+        }
+
+        static void destroy(void *storage) noexcept
+        {
+            F *closure = *static_cast<F **>(storage);
+            closure->~F();
+            NodePool::deallocate(closure, sizeof(F));
+        }
+
+        static constexpr Operations operations{invoke, copy, move, destroy};
+    };
+
+    alignas(void *) unsigned char _storage[inline_bytes]; // The closure.
+    const Operations *_operations = nullptr; // Null if empty.
+
+public:
+    /**
+     * Constructs an empty function.
+     */
+    BackwardFunction() noexcept = default;
+
+    /**
+     * Constructs a function from a closure.
+     * @param closure A callable taking the node, e.g. a lambda.
+     */
+    template <typename F,
+              typename = std::enable_if_t<
+                  !std::is_same<std::decay_t<F>, BackwardFunction>::value>>
+    BackwardFunction(F &&closure)
+    {
+        using Closure = std::decay_t<F>;
+        static_assert(alignof(Closure) <= alignof(std::max_align_t),
+                      "over-aligned closure");
+        if constexpr (sizeof(Closure) <= inline_bytes &&
+                      alignof(Closure) <= alignof(void *) &&
+                      std::is_nothrow_move_constructible<Closure>::value)
+        {
+            new (_storage) Closure(std::forward<F>(closure));
+            _operations = &InlineOperations<Closure>::operations;
+        }
+        else
+        {
+            void *block = NodePool::allocate(sizeof(Closure));
+            try
+            {
+                *reinterpret_cast<Closure **>(_storage) =
+                    new (block) Closure(std::forward<F>(closure));
+            }
+            catch (...)
+            {
+                NodePool::deallocate(block, sizeof(Closure));
+                throw;
+            }
+            _operations = &PooledOperations<Closure>::operations;
+        }
+    }
+
+    /**
+     * Copy constructor.
+     * @param other The function to copy.
+     */
+    BackwardFunction(const BackwardFunction &other)
+    {
+        if (other._operations != nullptr)
+        {
+            other._operations->copy(_storage, other._storage);
+            _operations = other._operations;
+        }
+    }
+
+    /**
+     * Move constructor.
+     * @param other The function to move, left empty.
+     */
+    BackwardFunction(BackwardFunction &&other) noexcept
+    {
+        if (other._operations != nullptr)
+        {
+            other._operations->move(_storage, other._storage);
+            _operations = other._operations;
+            other._operations = nullptr;
+        }
+    }
+
+    /**
+     * Copy assignment operator.
+     * @param other The function to copy.
+     * @return A reference to this function.
+     */
+    BackwardFunction &operator=(const BackwardFunction &other)
+    {
+        if (this != &other)
+        {
+            BackwardFunction copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    /**
+     * Move assignment operator.
+     * @param other The function to move, left empty.
+     * @return A reference to this function.
+     */
+    BackwardFunction &operator=(BackwardFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other._operations != nullptr)
+            {
+                other._operations->move(_storage, other._storage);
+                _operations = other._operations;
+                other._operations = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~BackwardFunction()
+    {
+        reset();
+    }
+
+    /**
+     * Destroys the closure, leaving the function empty.
+     */
+    void reset() noexcept
+    {
+        if (_operations != nullptr)
+        {
+            _operations->destroy(_storage);
+            _operations = nullptr;
+        }
+    }
+
+    /**
+     * Returns whether the function holds a closure.
+     * @return True unless empty.
+     */
+    explicit operator bool() const
+    {
+        return _operations != nullptr;
+    }
+
+    /**
+     * Calls the closure, if any.
+     * @param node The node whose gradient is propagated.
+     */
+    void operator()(Variable *node) const
+    {
+        if (_operations != nullptr)
+        {
+            _operations->invoke(_storage, node);
+        }
+    }
+};
+
+/**
+ * @class GradientSink
+ * This class collects the gradients that nodes pass on to the variables
+ * they reference, e.g. parameters shared by many nodes. While a sink is
+ * active on a thread, those updates are summed in the sink instead of being
+ * written to the shared variables, so that several threads can run parts of
+ * a backward pass at once. `flush` applies the sums afterwards, in the
+ * order in which the variables were first updated.
+ */
+class GradientSink
+{
+private:
+    // An open-addressing table with linear probing, since a backward pass
+    // adds to it once per reference update.
+    std::vector<Variable *> _targets; // The variables, nullptr if empty.
+    std::vector<double> _gradients;   // The pending sum of each variable.
+    std::vector<size_t> _order;       // The used slots in insertion order.
+    inline static thread_local GradientSink *_active = nullptr;
+
+    /**
+     * Doubles the table, keeping the pending sums.
+     */
+    void grow();
+
+public:
+    /**
+     * Returns the sink active on the calling thread.
+     * @return The sink, or nullptr if updates are applied directly.
+     */
+    static GradientSink *active()
+    {
+        return _active;
+    }
+
+    /**
+     * Sets the sink active on the calling thread.
+     * @param sink The sink, or nullptr to apply updates directly.
+     */
+    static void set_active(GradientSink *sink)
+    {
+        _active = sink;
+    }
+
+    /**
+     * Adds a gradient update for a variable.
+     * @param target The variable.
+     * @param gradient The gradient update value.
+     */
+    void add(Variable *target, double gradient)
+    {
+        if (2 * (_order.size() + 1) > _targets.size())
+        {
+            grow();
+        }
+        const size_t mask = _targets.size() - 1;
+        size_t i = static_cast<size_t>(
+                       (reinterpret_cast<uintptr_t>(target) >> 4) *
+                       uintptr_t{0x9E3779B97F4A7C15}) &
+                   mask;
+        while (_targets[i] != target)
+        {
+            if (_targets[i] == nullptr)
+            {
+                _targets[i] = target;
+                _order.push_back(i);
+                break;
+            }
+            i = (i + 1) & mask;
+        }
+        _gradients[i] += gradient;
+    }
+
+    /**
+     * Returns the number of variables with pending updates.
+     * @return The number of variables.
+     */
+    size_t size() const
+    {
+        return _order.size();
+    }
+
+    /**
+     * Moves the pending updates of another sink into this one, in the
+     * insertion order of the other sink, and empties the other sink.
+     * @param other The sink to merge.
+     */
+    void merge(GradientSink &other);
+
+    /**
+     * Applies the pending updates with `Variable::update_gradient` and
+     * empties the sink. Must be called with no sink active.
+     */
+    void flush();
+};
+
+/**
+ * @class ChildList
+ * This class holds the children of a node in one array from the `NodePool`,
+ * behind a 16-byte header instead of the 24 bytes of a vector. Unary and
+ * binary nodes, the vast majority, take their arrays from the pool's
+ * smallest size classes, which warm training steps recycle.
+ * @note Growing the list relocates the children but keeps their
+ * references, unlike moving a `Variable`.
+ */
+class ChildList
+{
+private:
+    Variable *_data = nullptr; // The children.
+    uint32_t _size = 0;        // The number of children.
+    uint32_t _capacity = 0;    // The number of allocated slots.
+
+    /**
+     * Moves the children to an array of the given capacity.
+     * @param capacity The new capacity, at least `size()`.
+     */
+    void reallocate(size_t capacity);
+
+public:
+    /**
+     * Constructs an empty list.
+     */
+    ChildList() noexcept = default;
+
+    /**
+     * Constructs a list with one child.
+     * @param child The child, copied.
+     */
+    explicit ChildList(const Variable &child);
+
+    /**
+     * Constructs a list with two children.
+     * @param first The first child, copied.
+     * @param second The second child, copied.
+     */
+    ChildList(const Variable &first, const Variable &second);
+
+    /**
+     * Constructs a list from copies of the given children.
+     * @param children The children.
+     */
+    ChildList(std::initializer_list<Variable> children);
+
+    /**
+     * Constructs a list from copies of a range of children.
+     * @param first The first child.
+     * @param last The end of the range.
+     */
+    template <typename It,
+              typename = typename std::iterator_traits<It>::iterator_category>
+    ChildList(It first, It last)
+    {
+        assign(first, last);
+    }
+
+    /**
+     * Copy constructor.
+     * @param other The list to copy.
+     */
+    ChildList(const ChildList &other);
+
+    /**
+     * Move constructor.
+     * @param other The list to move, left empty.
+     */
+    ChildList(ChildList &&other) noexcept
+        : _data(other._data), _size(other._size), _capacity(other._capacity)
+    {
+        other._data = nullptr;
+        other._size = 0;
+        other._capacity = 0;
+    }
+
+    /**
+     * Copy assignment operator.
+     * @param other The list to copy.
+     * @return A reference to this list.
+     */
+    ChildList &operator=(const ChildList &other);
+
+    /**
+     * Move assignment operator.
+     * @param other The list to move, left empty.
+     * @return A reference to this list.
+     */
+    ChildList &operator=(ChildList &&other) noexcept
+    {
+        ChildList(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~ChildList();
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    Variable &operator[](size_t i);
+
+    const Variable &operator[](size_t i) const;
+
+    Variable &back();
+
+    const Variable &back() const;
+
+    Variable *begin()
+    {
+        return _data;
+    }
+
+    Variable *end();
+
+    const Variable *begin() const
+    {
+        return _data;
+    }
+
+    const Variable *end() const;
+
+    /**
+     * Makes room for at least the given number of children.
+     * @param capacity The number of children.
+     */
+    void reserve(size_t capacity);
+
+    /**
+     * Adds default-constructed children or removes the last ones.
+     * @param size The new number of children.
+     */
+    void resize(size_t size);
+
+    /**
+     * Appends a copy of a child.
+     * @param child The child.
+     */
+    void push_back(const Variable &child);
+
+    /**
+     * Appends copies of a range of children.
+     * @param first The first child.
+     * @param last The end of the range.
+     */
+    template <typename It> void append(It first, It last);
+
+    /**
+     * Replaces the children with copies of a range of children.
+     * @param first The first child.
+     * @param last The end of the range.
+     */
+    template <typename It> void assign(It first, It last)
+    {
+        clear();
+        append(first, last);
+    }
+
+    /**
+     * Destroys the children, keeping the array.
+     */
+    void clear() noexcept;
+
+    /**
+     * Swaps the children of two lists.
+     * @param other The other list.
+     */
+    void swap(ChildList &other) noexcept
+    {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+    }
+};
+
+/**
+ * @class NodeName
+ * This class holds the name of a node in the size of a pointer. A name is
+ * either an interned symbol, which lives as long as the program, or a
+ * reference-counted string shared by the copies of the node it names.
+ */
+class NodeName
+{
+private:
+    struct Shared
+    {
+        std::string text;          // The name.
+        std::atomic<size_t> count; // The number of names sharing the text.
+    };
+
+    // An interned symbol, a shared name tagged with the low bit, or 0.
+    uintptr_t _bits = 0;
+
+    Shared *shared() const
+    {
+        return (_bits & 1) != 0
+                   ? reinterpret_cast<Shared *>(_bits & ~uintptr_t{1})
+                   : nullptr;
+    }
+
+    void release() noexcept
+    {
+        Shared *name = shared();
+        if (name != nullptr &&
+            name->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete name;
+        }
+    }
+
+public:
+    NodeName() = default;
+
+    /**
+     * Constructs a name from an interned symbol.
+     * @param symbol The symbol, or nullptr for no name.
+     */
+    explicit NodeName(const std::string *symbol)
+        : _bits(reinterpret_cast<uintptr_t>(symbol)){};
+
+    /**
+     * Constructs a name that owns a copy of a string.
+     * @param text The name, or an empty string for no name.
+     */
+    explicit NodeName(const std::string &text)
+    {
+        if (!text.empty())
+        {
+            _bits = reinterpret_cast<uintptr_t>(new Shared{text, {1}}) | 1;
+        }
+    }
+
+    NodeName(const NodeName &other) : _bits(other._bits)
+    {
+        if (Shared *name = shared())
+        {
+            name->count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    NodeName(NodeName &&other) noexcept : _bits(other._bits)
+    {
+        other._bits = 0;
+    }
+
+    NodeName &operator=(const NodeName &other)
+    {
+        NodeName copy(other);
+        std::swap(_bits, copy._bits);
+        return *this;
+    }
+
+    NodeName &operator=(NodeName &&other) noexcept
+    {
+        std::swap(_bits, other._bits);
+        return *this;
+    }
+
+    ~NodeName()
+    {
+        release();
+    }
+
+    /**
+     * Gets the name.
+     * @return The name, or nullptr if none.
+     */
+    const std::string *get() const
+    {
+        const Shared *name = shared();
+        return name != nullptr ? &name->text
+                               : reinterpret_cast<const std::string *>(_bits);
+    }
+};
+
 /**
  * @class Variable
  * This class represents a variable in a mathematical expression.
@@ -12,36 +640,86 @@
 class Variable
 {
 private:
-    double _value;           // The value of the variable.
-    double _gradient;        // The gradient of the variable.
-    std::string _op;         // The operation associated with the variable.
-    std::string _name;       // The name of the variable.
-    Variable *ref = nullptr; // A reference to the real variable.
-    std::vector<Variable> _children; // The components this variable.
-    std::function<void(Variable *)> _backward = [](Variable *) {
-    }; //The backward function associated with the variable.
+    // The fields are ordered so that a node takes 88 bytes: the operation
+    // is interned, the name is a pointer-sized handle and the children are
+    // a 16-byte handle.
+    double _value;                    // The value of the variable.
+    double _gradient;                 // The gradient of the variable.
+    Variable *ref = nullptr;          // A reference to the real variable.
+    const std::string *_op = nullptr; // The operation, or nullptr if none.
+    NodeName _name{};                 // The name, if any.
+
+public:
+    /**
+     * The children of a node.
+     */
+    using Children = ChildList;
+
+private:
+    Children _children;          // The components this variable.
+    BackwardFunction _backward; // The backward function of the variable.
+
+    inline static const std::string _no_symbol; // The empty op or name.
+
+    /**
+     * Returns the interned copy of a non-empty string, which lives as long
+     * as the program, so that nodes share their operation or literal name.
+     * @param text The string.
+     * @return The interned string.
+     */
+    static const std::string *intern_symbol(const std::string &text);
+
+    static const std::string *intern(const std::string &text)
+    {
+        return text.empty() ? nullptr : intern_symbol(text);
+    }
 
 public:
+    /**
+     * Constructs a new Variable object.
+     * @param value The initial value of the variable.
+     * @param gradient The initial gradient of the variable.
+     */
+    explicit Variable(double value = 0, double gradient = 0)
+        : _value(value), _gradient(gradient), ref(this){};
+
     /**
      * Constructs a new Variable object.
      * @param value The initial value of the variable.
      * @param gradient The initial gradient of the variable.
      * @param op The operation associated with the variable.
+     * @param name The name of the variable, shared by copies of the node.
+     */
+    Variable(double value,
+             double gradient,
+             const std::string &op,
+             const std::string &name = "")
+        : _value(value), _gradient(gradient), ref(this), _op(intern(op)),
+          _name(name){};
+
+    /**
+     * Constructs a new Variable object with a literal name, which is
+     * interned like the operation.
+     * @param value The initial value of the variable.
+     * @param gradient The initial gradient of the variable.
+     * @param op The operation associated with the variable.
      * @param name The name of the variable.
      */
-    explicit Variable(double value = 0,
-                      double gradient = 0,
-                      std::string op = "",
-                      std::string name = "")
-        : _value(value), _gradient(gradient), _op(op), _name(name), ref(this){};
+    template <size_t N>
+    Variable(double value,
+             double gradient,
+             const std::string &op,
+             const char (&name)[N])
+        : _value(value), _gradient(gradient), ref(this), _op(intern(op)),
+          _name(intern(name)){}
 
     /**
      * Copy constructor.
      * @param other The Variable object to copy from.
      */
     Variable(const Variable &other)
-        : _value(other._value), _gradient(other._gradient), _op(other._op),
-          _name(other._name), ref(other.ref), _children(other._children),
+        : _value(other._value), _gradient(other._gradient), ref(other.ref),
+          _op(other._op), _name(other._name), _children(other._children),
           _backward(other._backward){};
 
     /**
@@ -73,9 +751,9 @@ public:
         this->_value = other._value;
         this->_gradient = other._gradient;
         this->_op = other._op;
-        this->_name = other._name;
-        this->_children = other._children;
-        this->_backward = other._backward;
+        this->_name = std::move(other._name);
+        this->_children = std::move(other._children);
+        this->_backward = std::move(other._backward);
         other.ref = nullptr;
         this->ref = this;
         return *this;
@@ -87,9 +765,10 @@ public:
      * @note The reference will be set to this.
      */
     Variable(Variable &&other) noexcept
-        : _value(other._value), _gradient(other._gradient), _op(other._op),
-          _name(other._name), ref(other.ref), _children(other._children),
-          _backward(other._backward)
+        : _value(other._value), _gradient(other._gradient), ref(other.ref),
+          _op(other._op), _name(std::move(other._name)),
+          _children(std::move(other._children)),
+          _backward(std::move(other._backward))
     {
         other.ref = nullptr;
         this->ref = this;
@@ -118,16 +797,27 @@ public:
      */
     const std::string &name() const
     {
-        return _name;
+        const std::string *symbol = _name.get();
+        return symbol != nullptr ? *symbol : _no_symbol;
     }
 
     /**
      * Sets the name of the variable.
-     * @param name The name of the variable.
+     * @param name The name of the variable, shared by copies of the node.
      */
     void set_name(const std::string &name)
     {
-        _name = name;
+        _name = NodeName(name);
+    }
+
+    /**
+     * Sets a literal name of the variable.
+     * @param name The name of the variable.
+     * @note Literal names are interned for the lifetime of the program.
+     */
+    template <size_t N> void set_name(const char (&name)[N])
+    {
+        _name = NodeName(intern(name));
     }
 
     /**
@@ -145,25 +835,26 @@ public:
      */
     const std::string &op() const
     {
-        return _op;
+        return _op != nullptr ? *_op : _no_symbol;
     }
 
     /**
      * Sets the operation associated with the variable.
      * @param op The operation associated with the variable.
+     * @note Operations are interned for the lifetime of the program.
      */
     void set_op(const std::string &op)
     {
-        _op = op;
+        _op = intern(op);
     }
 
     /**
      * Sets the backward function associated with the variable.
      * @param backward The backward function associated with the variable.
      */
-    void set_backward(std::function<void(Variable *)> backward)
+    void set_backward(BackwardFunction backward)
     {
-        _backward = backward;
+        _backward = std::move(backward);
     }
 
     /**
@@ -206,7 +897,7 @@ public:
      * Gets the child variables of this variable.
      * @return The child variables of this variable.
      */
-    const std::vector<Variable> &children() const
+    const Children &children() const
     {
         return _children;
     }
@@ -215,7 +906,7 @@ public:
      * Gets the mutable child variables of this variable.
      * @return The mutable child variables of this variable.
      */
-    std::vector<Variable> &mutable_children()
+    Children &mutable_children()
     {
         return _children;
     }
@@ -226,33 +917,78 @@ public:
      */
     void set_children(const std::vector<Variable> &children)
     {
-        _children = children;
+        _children.assign(children.begin(), children.end());
     }
 
     /**
      * Performs the backward pass for the variable and its children.
+     * @param retain_graph Whether to keep the graph after the pass. By
+     * default each node releases its children and its backward function as
+     * soon as its gradient has been propagated, so memory shrinks during the
+     * pass instead of staying at its peak.
      * @note The backward function is called recursively for each child.
+     * Without a retained graph, calling backward again only runs this node.
      */
-    void backward()
+    void backward(bool retain_graph = false)
     {
         _backward(this);
-        for (auto &child : _children)
+        if (retain_graph)
         {
-            child.backward();
+            for (auto &child : _children)
+            {
+                child.backward(true);
+            }
+            return;
+        }
+        // The node is released before its children run, and each child
+        // releases itself in turn, so a subtree is freed while the rest of
+        // the pass proceeds. Moving the list keeps the children in place.
+        _backward.reset();
+        Children children(std::move(_children));
+        for (auto &child : children)
+        {
+            child.backward(false);
         }
     }
 
+    /**
+     * Runs the backward function of this variable only, passing its
+     * gradient to its children without visiting them.
+     */
+    void propagate()
+    {
+        _backward(this);
+    }
+
+    /**
+     * Releases the children and the backward function of the variable,
+     * turning it into a leaf that keeps its value, gradient and reference.
+     */
+    void release_graph()
+    {
+        Children().swap(_children);
+        _backward.reset();
+    }
+
     /**
      * Updates the gradient of the variable.
      * @param grad The gradient update value.
-     * @note The gradient is synchronized with the reference variable.
+     * @note The gradient is synchronized with the reference variable, or
+     * collected in the active `GradientSink` if there is one.
      */
     void update_gradient(double grad)
     {
         _gradient += grad;
         if (this != ref && ref != nullptr)
         {
-            ref->update_gradient(grad);
+            if (GradientSink *sink = GradientSink::active())
+            {
+                sink->add(ref, grad);
+            }
+            else
+            {
+                ref->update_gradient(grad);
+            }
         }
     }
 
@@ -417,6 +1153,38 @@ public:
     friend Variable dot_product(const std::vector<Variable> &a,
                                 const std::vector<double> &b);
 
+    /**
+     * Computes a neuron, activate(weights * inputs + bias), as a single node.
+     * @param weights The weights of the neuron.
+     * @param inputs The input values.
+     * @param bias The bias of the neuron.
+     * @param activate_function The name of the activation function.
+     * @param mode Whether to use the exact or the fast activation kernel.
+     * @return The activated output of the neuron.
+     * @note The children are the weights followed by the bias.
+     */
+    friend Variable fused_neuron(const std::vector<Variable> &weights,
+                                 const std::vector<double> &inputs,
+                                 const Variable &bias,
+                                 const std::string &activate_function,
+                                 ActivationMode mode);
+
+    /**
+     * Computes a neuron, activate(weights * inputs + bias), as a single node.
+     * @param weights The weights of the neuron.
+     * @param inputs The input variables.
+     * @param bias The bias of the neuron.
+     * @param activate_function The name of the activation function.
+     * @param mode Whether to use the exact or the fast activation kernel.
+     * @return The activated output of the neuron.
+     * @note The children are the weights, then the inputs, then the bias.
+     */
+    friend Variable fused_neuron(const std::vector<Variable> &weights,
+                                 const std::vector<Variable> &inputs,
+                                 const Variable &bias,
+                                 const std::string &activate_function,
+                                 ActivationMode mode);
+
     /**
      * Calculates the power of the variable raised to a scalar exponent.
      * @param other The scalar exponent.
@@ -483,4 +1251,124 @@ public:
      * @return The sigmoid of the variable.
      */
     Variable sigmoid() const;
+
+    /**
+     * Calculates the Gaussian Error Linear Unit (GELU) of the variable.
+     * @return The GELU of the variable.
+     */
+    Variable gelu() const;
+
+    /**
+     * Calculates the Sigmoid Linear Unit (SiLU) of the variable.
+     * @return The SiLU of the variable.
+     */
+    Variable silu() const;
+
+    /**
+     * Calculates the softplus of the variable.
+     * @return The softplus of the variable.
+     */
+    Variable softplus() const;
 };
+
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const std::vector<double> &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode = ActivationMode::Exact);
+
+Variable fused_neuron(const std::vector<Variable> &weights,
+                      const std::vector<Variable> &inputs,
+                      const Variable &bias,
+                      const std::string &activate_function,
+                      ActivationMode mode = ActivationMode::Exact);
+
+
+inline Variable &ChildList::operator[](size_t i)
+{
+    return _data[i];
+}
+
+
+inline const Variable &ChildList::operator[](size_t i) const
+{
+    return _data[i];
+}
+
+
+inline Variable &ChildList::back()
+{
+    return _data[_size - 1];
+}
+
+
+inline const Variable &ChildList::back() const
+{
+    return _data[_size - 1];
+}
+
+
+inline Variable *ChildList::end()
+{
+    return _data + _size;
+}
+
+
+inline const Variable *ChildList::end() const
+{
+    return _data + _size;
+}
+
+
+inline ChildList::ChildList(const Variable &child)
+{
+    reserve(1);
+    new (_data) Variable(child);
+    _size = 1;
+}
+
+
+inline ChildList::ChildList(const Variable &first, const Variable &second)
+{
+    reserve(2);
+    new (_data) Variable(first);
+    _size = 1;
+    new (_data + 1) Variable(second);
+    _size = 2;
+}
+
+
+template <typename It> void ChildList::append(It first, It last)
+{
+    if constexpr (std::is_base_of<
+                      std::forward_iterator_tag,
+                      typename std::iterator_traits<It>::iterator_category>::
+                      value)
+    {
+        reserve(_size + static_cast<size_t>(std::distance(first, last)));
+    }
+    for (; first != last; ++first)
+    {
+        push_back(*first);
+    }
+}
+
+
+inline void ChildList::push_back(const Variable &child)
+{
+    if (_size == _capacity)
+    {
+        // The child may be one of ours, so it is found again after growing.
+        const bool own = std::less_equal<const Variable *>()(_data, &child) &&
+                         std::less<const Variable *>()(&child, end());
+        const size_t index = own ? static_cast<size_t>(&child - _data) : 0;
+        reserve(_capacity == 0 ? 1 : 2 * size_t{_capacity});
+        new (_data + _size) Variable(own ? _data[index] : child);
+    }
+    else
+    {
+        new (_data + _size) Variable(child);
+    }
+    _size++;
+}
+
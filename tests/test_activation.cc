@@ -0,0 +1,150 @@
+#include "activation.h"
+#include "mlp.h"
+#include <catch2/catch.hpp>
+#include <cmath>
+
+
+TEST_CASE("Test activation kernels", "[Activation]")
+{
+    std::vector<double> samples;
+    for (int i = -2000; i <= 2000; i++)
+    {
+        samples.push_back(i * 0.01);
+    }
+
+    SECTION("Test fast kernels stay within their error bounds")
+    {
+        for (double x : samples)
+        {
+            REQUIRE(std::fabs(fast_exp(x) / std::exp(x) - 1) < 1e-8);
+            REQUIRE(std::fabs(fast_tanh(x) - std::tanh(x)) < 1e-8);
+            REQUIRE(std::fabs(fast_sigmoid(x) - 1 / (1 + std::exp(-x))) <
+                    1e-8);
+            REQUIRE(std::fabs(fast_gelu(x) - gelu(x)) < 1e-3);
+            REQUIRE(std::fabs(fast_softplus(x) - softplus(x)) < 1e-8);
+            if (x != 0)
+            {
+                REQUIRE(std::fabs(fast_silu(x) / silu(x) - 1) < 1e-8);
+            }
+            const double positive = std::exp(x * 0.1);
+            REQUIRE(std::fabs(fast_log(positive) - std::log(positive)) <
+                    1e-10);
+        }
+        REQUIRE(fast_exp(-1000.0) >= 0.0);
+        REQUIRE(std::isfinite(fast_exp(1000.0)));
+        REQUIRE(fast_tanh(100.0) == Approx(1.0));
+        REQUIRE(fast_softplus(1000.0) == Approx(1000.0));
+    }
+
+    SECTION("Test batch kernels match the scalar kernels")
+    {
+        const std::vector<ActivationFunction> functions{
+            ActivationFunction::Relu,
+            ActivationFunction::Sigmoid,
+            ActivationFunction::Tanh,
+            ActivationFunction::Identity,
+            ActivationFunction::Gelu,
+            ActivationFunction::Silu,
+            ActivationFunction::Softplus};
+        for (ActivationFunction function : functions)
+        {
+            for (ActivationMode mode :
+                 {ActivationMode::Exact, ActivationMode::Fast})
+            {
+                std::vector<double> values = samples;
+                batch_activate(function, values, mode);
+                for (size_t i = 0; i < samples.size(); i++)
+                {
+                    REQUIRE(values[i] == activate(function, samples[i], mode));
+                }
+            }
+        }
+
+        std::vector<double> exps(samples.size());
+        batch_exp(samples.data(), exps.data(), samples.size());
+        std::vector<double> logs(samples.size());
+        batch_log(exps.data(), logs.data(), exps.size(), ActivationMode::Fast);
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            REQUIRE(logs[i] == Approx(samples[i]).margin(1e-9));
+        }
+    }
+
+    SECTION("Test derivatives match finite differences")
+    {
+        const double h = 1e-6;
+        for (ActivationFunction function : {ActivationFunction::Sigmoid,
+                                            ActivationFunction::Tanh,
+                                            ActivationFunction::Gelu,
+                                            ActivationFunction::Silu,
+                                            ActivationFunction::Softplus})
+        {
+            for (double x : {-3.0, -0.5, 0.0, 0.7, 2.5})
+            {
+                const double numeric = (activate(function, x + h) -
+                                        activate(function, x - h)) /
+                                       (2 * h);
+                REQUIRE(activation_derivative(function,
+                                              x,
+                                              activate(function, x)) ==
+                        Approx(numeric).margin(1e-6));
+            }
+        }
+    }
+
+    SECTION("Test parse activation")
+    {
+        REQUIRE(parse_activation("gelu") == ActivationFunction::Gelu);
+        REQUIRE(parse_activation("identity") == ActivationFunction::Identity);
+        REQUIRE_THROWS(parse_activation("unknown"));
+    }
+
+    SECTION("Test variable activations")
+    {
+        Variable a(0.8);
+        Variable b = a.activate("gelu");
+        REQUIRE(b.value() == Approx(gelu(0.8)));
+        b.set_gradient(1.0);
+        b.backward();
+        REQUIRE(a.gradient() ==
+                Approx(activation_derivative(ActivationFunction::Gelu,
+                                             0.8,
+                                             b.value())));
+
+        Variable c(-1.5);
+        Variable d = c.silu() + c.softplus();
+        d.set_gradient(1.0);
+        d.backward();
+        REQUIRE(c.gradient() ==
+                Approx(activation_derivative(ActivationFunction::Silu,
+                                             -1.5,
+                                             silu(-1.5)) +
+                       activation_derivative(ActivationFunction::Softplus,
+                                             -1.5,
+                                             softplus(-1.5))));
+    }
+
+    SECTION("Test predict matches forward")
+    {
+        std::vector<double> inputs{0.3, -1.2, 2.0};
+        MLP mlp(3, std::vector<size_t>{5, 4, 2});
+        std::vector<Variable> &results = mlp.forward(inputs);
+        std::vector<double> predictions = mlp.predict(inputs);
+        REQUIRE(predictions.size() == 2);
+        REQUIRE(predictions[0] == Approx(results[0].value()));
+        REQUIRE(predictions[1] == Approx(results[1].value()));
+
+        mlp.set_activation_mode(ActivationMode::Fast);
+        REQUIRE(mlp.layers()[0].activation_mode() == ActivationMode::Fast);
+        REQUIRE(mlp.layers()[0].neurons()[0].activation_mode() ==
+                ActivationMode::Fast);
+        std::vector<double> fast = mlp.predict(inputs);
+        std::vector<Variable> &fast_results = mlp.forward(inputs);
+        for (size_t i = 0; i < fast.size(); i++)
+        {
+            REQUIRE(fast[i] == Approx(predictions[i]).margin(1e-7));
+            REQUIRE(fast_results[i].value() == Approx(fast[i]));
+        }
+        REQUIRE_THROWS(mlp.predict(std::vector<double>{1.0}));
+    }
+}
@@ -105,4 +105,38 @@ TEST_CASE("Test active functions", "[Variable-Active-Function]")
         REQUIRE(i.gradient() == 1.0);
         REQUIRE(a.gradient() == 0.031325342296270944);
     }
+
+    SECTION("Test fused neuron")
+    {
+        std::vector<Variable> weights(2);
+        std::vector<Variable> inputs(2);
+        weights[0] = Variable(0.5);
+        weights[1] = Variable(-1.0);
+        inputs[0] = Variable(2.0);
+        inputs[1] = Variable(0.25);
+        Variable bias(0.1);
+
+        Variable sigmoid = fused_neuron(weights, inputs, bias, "sigmoid");
+        Variable expected = (dot_product(weights, inputs) + bias).sigmoid();
+        REQUIRE(sigmoid.value() == Approx(expected.value()));
+        REQUIRE(sigmoid.children().size() == 5);
+        sigmoid.set_gradient(1.0);
+        sigmoid.backward();
+        const double grad = sigmoid.value() * (1 - sigmoid.value());
+        REQUIRE(weights[0].gradient() == Approx(grad * 2.0));
+        REQUIRE(weights[1].gradient() == Approx(grad * 0.25));
+        REQUIRE(inputs[0].gradient() == Approx(grad * 0.5));
+        REQUIRE(inputs[1].gradient() == Approx(grad * -1.0));
+        REQUIRE(bias.gradient() == Approx(grad));
+
+        Variable relu = fused_neuron(weights,
+                                     std::vector<double>{0.0, 1.0},
+                                     bias,
+                                     "relu");
+        REQUIRE(relu.value() == 0.0);
+        REQUIRE(relu.children().size() == 3);
+        REQUIRE_THROWS(fused_neuron(weights, inputs, bias, "unknown"));
+        REQUIRE_THROWS(
+            fused_neuron(weights, std::vector<double>{1.0}, bias, "tanh"));
+    }
 }
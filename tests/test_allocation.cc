@@ -0,0 +1,240 @@
+#include "loss.h"
+#include "mlp.h"
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+// GCC pairs the inlined replacement functions below with the allocations
+// of the standard library and reports a false mismatch.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+
+namespace
+{
+std::atomic<size_t> allocations{0};
+
+
+// Counts an allocation of the test binary, returning null on failure.
+void *allocate(size_t bytes, size_t alignment = 0) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t size = bytes == 0 ? 1 : bytes;
+    if (alignment == 0)
+    {
+        return std::malloc(size);
+    }
+    // aligned_alloc takes a multiple of the alignment.
+    return std::aligned_alloc(
+        alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+
+void *allocate_or_throw(size_t bytes, size_t alignment = 0)
+{
+    if (void *block = allocate(bytes, alignment))
+    {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+} // namespace
+
+
+// Every form of the global operators is replaced, so that each allocation
+// is counted and each deallocation matches the allocation it frees, e.g.
+// for the nothrow allocations of Catch under the address sanitizer.
+void *operator new(size_t bytes)
+{
+    return allocate_or_throw(bytes);
+}
+
+
+void *operator new[](size_t bytes)
+{
+    return allocate_or_throw(bytes);
+}
+
+
+void *operator new(size_t bytes, std::align_val_t alignment)
+{
+    return allocate_or_throw(bytes, static_cast<size_t>(alignment));
+}
+
+
+void *operator new[](size_t bytes, std::align_val_t alignment)
+{
+    return allocate_or_throw(bytes, static_cast<size_t>(alignment));
+}
+
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept
+{
+    return allocate(bytes);
+}
+
+
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept
+{
+    return allocate(bytes);
+}
+
+
+void *operator new(size_t bytes,
+                   std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept
+{
+    return allocate(bytes, static_cast<size_t>(alignment));
+}
+
+
+void *operator new[](size_t bytes,
+                     std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept
+{
+    return allocate(bytes, static_cast<size_t>(alignment));
+}
+
+
+void operator delete(void *block) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void *block, size_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block, size_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void *block, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void *block, size_t, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block, size_t, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void *block, const std::nothrow_t &) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void *block,
+                     std::align_val_t,
+                     const std::nothrow_t &) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void *block,
+                       std::align_val_t,
+                       const std::nothrow_t &) noexcept
+{
+    std::free(block);
+}
+
+
+TEST_CASE("Test allocation-free training step", "[Allocation]")
+{
+    SECTION("Test moves transfer the graph")
+    {
+        Variable a(2.0);
+        Variable b = a * a + a.sin();
+        REQUIRE(b.children().size() == 2);
+        Variable c(std::move(b));
+        REQUIRE(b.children().empty());
+        REQUIRE(c.children().size() == 2);
+        b = std::move(c);
+        REQUIRE(c.children().empty());
+        REQUIRE(b.children().size() == 2);
+
+        Neuron neuron(3);
+        Neuron moved(std::move(neuron));
+        REQUIRE(neuron.parameters().empty());
+        REQUIRE(moved.parameters().size() == 4);
+        REQUIRE(moved.parameters()[0].reference() == &moved.weights()[0]);
+        REQUIRE(moved.parameters()[3].reference() == &moved.bias());
+
+        Layer layer(3, 2);
+        const Variable *weight = &layer.neurons()[1].weights()[2];
+        Layer moved_layer(std::move(layer));
+        REQUIRE(moved_layer.parameters().size() == 8);
+        REQUIRE(moved_layer.parameters()[6].reference() == weight);
+    }
+
+    SECTION("Test a warm step does not allocate")
+    {
+        MLP mlp(4, std::vector<size_t>{8, 8, 2});
+        const std::vector<double> inputs{0.5, -1.0, 0.25, 2.0};
+        const std::vector<double> targets{0.5, -0.5};
+        const auto step = [&]() {
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.zero_grad();
+            }
+            Variable loss = MSELoss(mlp.forward(inputs), targets);
+            loss.set_gradient(1.0);
+            loss.backward();
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.gradient_descent(0.05);
+            }
+            return loss.value();
+        };
+
+        const double first = step();
+        step();
+        const size_t before = allocations.load();
+        double last = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            last = step();
+        }
+        const size_t after = allocations.load();
+        REQUIRE(after == before);
+        REQUIRE(last < first);
+        REQUIRE(NodePool::cached_bytes() > 0);
+    }
+}
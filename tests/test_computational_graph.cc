@@ -1,7 +1,41 @@
 #include "variable.h"
+#include <array>
 #include <catch2/catch.hpp>
 
 
+namespace
+{
+// A chain of nodes whose backward functions are large enough to live in the
+// NodePool. The last node records the bytes cached by the pool when its
+// backward function runs.
+Variable chain(size_t depth, const Variable &leaf, size_t &cached)
+{
+    Variable node(leaf.value(), 0.0, "", "chain");
+    if (depth == 0)
+    {
+        node.mutable_children().push_back(leaf);
+        node.set_backward([&cached](Variable *result) {
+            cached = NodePool::cached_bytes();
+            result->mutable_children()[0].update_gradient(result->gradient());
+        });
+    }
+    else
+    {
+        node.mutable_children().push_back(chain(depth - 1, leaf, cached));
+        std::array<double, 16> scales{};
+        scales.fill(1.0);
+        node.set_backward([scales](Variable *result) {
+            result->mutable_children()[0].update_gradient(result->gradient() *
+                                                          scales[0]);
+        });
+    }
+    // The node is copied into its parent, which must not refer back to it.
+    node.set_ref(nullptr);
+    return node;
+}
+} // namespace
+
+
 TEST_CASE("Test computational graph", "[Computation Graph]")
 {
     Variable x1(2.0);
@@ -16,4 +50,46 @@ TEST_CASE("Test computational graph", "[Computation Graph]")
     REQUIRE(f.gradient() == 1.0);
     REQUIRE(x1.gradient() == 3.5);
     REQUIRE(x2.gradient() == 1.0100075033995546);
+    REQUIRE(f.children().empty());
+    REQUIRE(f.value() == 6.834267188619813);
+}
+
+
+TEST_CASE("Test retaining the graph", "[Computation Graph]")
+{
+    Variable x1(2.0);
+    Variable x2(3.0);
+
+    Variable f = x1 * x2 + x2;
+    f.set_gradient(1.0);
+    f.backward(true);
+    REQUIRE(f.children().size() == 2);
+    REQUIRE(f.children()[0].children().size() == 2);
+    REQUIRE(x1.gradient() == 3.0);
+
+    REQUIRE(x2.gradient() == 3.0);
+
+    f.backward();
+    REQUIRE(f.children().empty());
+    const double x1_gradient = x1.gradient();
+    const double x2_gradient = x2.gradient();
+
+    f.backward();
+    REQUIRE(x1.gradient() == x1_gradient);
+    REQUIRE(x2.gradient() == x2_gradient);
+}
+
+
+TEST_CASE("Test releasing the graph during backward", "[Computation Graph]")
+{
+    Variable x(2.0);
+    size_t cached = 0;
+    Variable f = chain(32, x, cached);
+    f.set_gradient(1.0);
+    NodePool::trim();
+    f.backward();
+    REQUIRE(x.gradient() == 1.0);
+    // The backward functions above the last node were freed before it ran.
+    REQUIRE(cached >= 32 * sizeof(std::array<double, 16>));
+    REQUIRE(NodePool::cached_bytes() > cached);
 }
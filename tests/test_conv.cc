@@ -0,0 +1,284 @@
+#include "conv.h"
+#include "determinism.h"
+#include "loss.h"
+#include <catch2/catch.hpp>
+#include <cmath>
+
+
+namespace
+{
+std::vector<double> wave(size_t n)
+{
+    std::vector<double> values(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        values[i] = std::sin(0.7 * static_cast<double>(i) + 0.3);
+    }
+    return values;
+}
+
+
+// A direct convolution with square kernels, laid out like Conv2D.
+std::vector<double> reference_conv(const Conv2D &conv,
+                                   const std::vector<double> &inputs,
+                                   size_t height,
+                                   size_t width,
+                                   size_t kernel,
+                                   const ConvOptions &options)
+{
+    std::vector<double> result;
+    for (size_t c = 0; c < conv.out_channels(); c++)
+    {
+        const Neuron &filter = conv.filters()[c];
+        for (size_t y = 0; y < conv.out_height(); y++)
+        {
+            for (size_t x = 0; x < conv.out_width(); x++)
+            {
+                double sum = filter.bias().value();
+                for (size_t k = 0; k < conv.in_channels(); k++)
+                {
+                    for (size_t i = 0; i < kernel; i++)
+                    {
+                        for (size_t j = 0; j < kernel; j++)
+                        {
+                            const auto row = static_cast<long>(
+                                y * options.stride + i * options.dilation) -
+                                static_cast<long>(options.padding);
+                            const auto column = static_cast<long>(
+                                x * options.stride + j * options.dilation) -
+                                static_cast<long>(options.padding);
+                            if (row < 0 || column < 0 ||
+                                row >= static_cast<long>(height) ||
+                                column >= static_cast<long>(width))
+                            {
+                                continue;
+                            }
+                            const size_t input =
+                                (k * height + static_cast<size_t>(row)) *
+                                    width +
+                                static_cast<size_t>(column);
+                            sum += filter
+                                       .weights()[(k * kernel + i) * kernel +
+                                                  j]
+                                       .value() *
+                                   inputs[input];
+                        }
+                    }
+                }
+                result.push_back(std::tanh(sum));
+            }
+        }
+    }
+    return result;
+}
+} // namespace
+
+
+TEST_CASE("Test convolution", "[Conv]")
+{
+    SECTION("Test Conv2D against a direct convolution")
+    {
+        ConvOptions options;
+        options.stride = 2;
+        options.padding = 2;
+        options.dilation = 2;
+        Conv2D conv(2, 5, 6, 3, 3, options);
+        REQUIRE(conv.out_height() == 3);
+        REQUIRE(conv.out_width() == 3);
+        REQUIRE(conv.n_in() == 60);
+        REQUIRE(conv.n_out() == 27);
+        REQUIRE(conv.parameters().size() == 3 * (2 * 9 + 1));
+
+        const std::vector<double> inputs = wave(conv.n_in());
+        const std::vector<double> expected =
+            reference_conv(conv, inputs, 5, 6, 3, options);
+        const std::vector<double> predicted = conv.predict(inputs);
+        const std::vector<Variable> outputs = conv.forward(inputs);
+        std::vector<Variable> variables;
+        for (const double input : inputs)
+        {
+            variables.emplace_back(input);
+        }
+        const std::vector<Variable> chained = conv.forward(variables);
+        REQUIRE(outputs.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            REQUIRE(predicted[i] == Approx(expected[i]));
+            REQUIRE(outputs[i].value() == Approx(expected[i]));
+            REQUIRE(chained[i].value() == Approx(expected[i]));
+        }
+
+        std::vector<double> batch = inputs;
+        batch.insert(batch.end(), inputs.rbegin(), inputs.rend());
+        const std::vector<double> batched = conv.predict(batch, 2);
+        REQUIRE(batched.size() == 2 * conv.n_out());
+        for (size_t i = 0; i < conv.n_out(); i++)
+        {
+            REQUIRE(batched[i] == Approx(predicted[i]));
+        }
+
+        REQUIRE_THROWS_AS(Conv2D(1, 3, 3, 1, 5), std::invalid_argument);
+        options.stride = 0;
+        REQUIRE_THROWS_AS(Conv2D(1, 3, 3, 1, 1, options),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(conv.predict(wave(3)), std::runtime_error);
+    }
+
+    SECTION("Test gradients of the filters and the inputs")
+    {
+        ConvOptions options;
+        options.padding = 1;
+        Conv2D conv(2, 4, 4, 2, 3, options);
+        const std::vector<double> x = wave(conv.n_in());
+        std::vector<Variable> inputs;
+        for (const double value : x)
+        {
+            inputs.emplace_back(value);
+        }
+        const std::vector<double> targets(conv.n_out(), 0.25);
+        const std::vector<Variable> outputs = conv.forward(inputs);
+        Variable loss = MSELoss(outputs, targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+
+        // MSELoss does not scale its gradient by 1 / n, so neither does this.
+        const auto numeric_loss = [&](const std::vector<double> &point) {
+            const std::vector<double> values = conv.predict(point);
+            double sum = 0;
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                sum += (values[i] - targets[i]) * (values[i] - targets[i]);
+            }
+            return sum;
+        };
+        const double h = 1e-6;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            std::vector<double> plus = x;
+            std::vector<double> minus = x;
+            plus[i] += h;
+            minus[i] -= h;
+            const double numeric =
+                (numeric_loss(plus) - numeric_loss(minus)) / (2 * h);
+            REQUIRE(inputs[i].gradient() == Approx(numeric).margin(1e-6));
+        }
+
+        const std::vector<Variable> &parameters = conv.parameters();
+        for (size_t i = 0; i < parameters.size(); i += 5)
+        {
+            Variable *parameter = parameters[i].reference();
+            const double value = parameter->value();
+            parameter->set_value(value + h);
+            const double plus = numeric_loss(x);
+            parameter->set_value(value - h);
+            const double minus = numeric_loss(x);
+            parameter->set_value(value);
+            REQUIRE(parameter->gradient() ==
+                    Approx((plus - minus) / (2 * h)).margin(1e-6));
+        }
+    }
+
+    SECTION("Test Conv1D")
+    {
+        ConvOptions options;
+        options.stride = 2;
+        options.padding = 1;
+        Conv1D conv(3, 9, 4, 3, options, "relu");
+        REQUIRE(conv.out_length() == 5);
+        REQUIRE(conv.out_height() == 1);
+        REQUIRE(conv.n_out() == 20);
+        const std::vector<double> inputs = wave(conv.n_in());
+        const std::vector<double> predicted = conv.predict(inputs);
+        const std::vector<Variable> outputs = conv.forward(inputs);
+        for (size_t i = 0; i < predicted.size(); i++)
+        {
+            REQUIRE(predicted[i] >= 0);
+            REQUIRE(outputs[i].value() == Approx(predicted[i]));
+        }
+    }
+}
+
+
+TEST_CASE("Test pooling", "[Conv]")
+{
+    const std::vector<double> values{1, 5, 2, 0, 3, 4, 8, 1, 6, 7, 2, 9};
+    std::vector<Variable> inputs;
+    for (const double value : values)
+    {
+        inputs.emplace_back(value);
+    }
+
+    SECTION("Test max pooling")
+    {
+        Pool2D pool(PoolKind::Max, 1, 3, 4, 2, 1);
+        REQUIRE(pool.out_height() == 2);
+        REQUIRE(pool.out_width() == 3);
+        REQUIRE(pool.parameters().empty());
+        REQUIRE(pool.predict(values) ==
+                std::vector<double>{5, 8, 8, 7, 8, 9});
+
+        std::vector<Variable> outputs = pool.forward(inputs);
+        outputs[0].set_gradient(1.0);
+        outputs[0].backward();
+        REQUIRE(inputs[1].gradient() == 1.0);
+        REQUIRE(inputs[0].gradient() == 0.0);
+    }
+
+    SECTION("Test average pooling")
+    {
+        Pool1D pool(PoolKind::Average, 2, 6, 3);
+        REQUIRE(pool.out_length() == 2);
+        const std::vector<double> expected{8.0 / 3, 7.0 / 3, 5.0, 6.0};
+        std::vector<Variable> outputs = pool.forward(inputs);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            REQUIRE(pool.predict(values)[i] == Approx(expected[i]));
+            REQUIRE(outputs[i].value() == Approx(expected[i]));
+        }
+        outputs[3].set_gradient(3.0);
+        outputs[3].backward();
+        REQUIRE(inputs[9].gradient() == Approx(1.0));
+        REQUIRE(inputs[8].gradient() == 0.0);
+        REQUIRE_THROWS_AS(Pool1D(PoolKind::Max, 1, 2, 3),
+                          std::invalid_argument);
+    }
+}
+
+
+TEST_CASE("Test sequential models", "[Conv]")
+{
+    SeedScope scope(3);
+    Sequential model;
+    model.add(Conv1D(2, 16, 4, 3));
+    model.add(Pool1D(PoolKind::Max, 4, 14, 2));
+    model.add(Conv1D(4, 7, 2, 3, ConvOptions(), "relu"));
+    model.add(Layer(10, 1, "identity"));
+    REQUIRE(model.n_in() == 32);
+    REQUIRE(model.n_out() == 1);
+    REQUIRE(model.parameters().size() == 4 * 7 + 2 * 13 + 11);
+    REQUIRE_THROWS_AS(model.add(Layer(3, 1)), std::invalid_argument);
+    REQUIRE_THROWS_AS(Sequential().forward(wave(3)), std::runtime_error);
+
+    const std::vector<double> inputs = wave(model.n_in());
+    const std::vector<double> targets{0.5};
+    double first_loss = 0;
+    double last_loss = 0;
+    for (size_t step = 0; step < 20; step++)
+    {
+        const std::vector<Variable> &outputs = model.forward(inputs);
+        REQUIRE(outputs[0].value() == Approx(model.predict(inputs)[0]));
+        Variable loss = MSELoss(outputs, targets);
+        (step == 0 ? first_loss : last_loss) = loss.value();
+        for (auto &parameter : model.mutable_parameters())
+        {
+            parameter.zero_grad();
+        }
+        loss.set_gradient(1.0);
+        loss.backward();
+        for (auto &parameter : model.mutable_parameters())
+        {
+            parameter.gradient_descent(0.01);
+        }
+    }
+    REQUIRE(last_loss < first_loss);
+}
@@ -0,0 +1,120 @@
+#include "determinism.h"
+#include "loss.h"
+#include "mlp.h"
+#include "scheduler.h"
+#include <catch2/catch.hpp>
+
+#include <initializer_list>
+
+
+namespace
+{
+std::vector<double> parameter_values(const MLP &mlp)
+{
+    std::vector<double> result;
+    for (const auto &parameter : mlp.parameters())
+    {
+        result.push_back(parameter.reference()->value());
+    }
+    return result;
+}
+
+
+std::vector<double> parallel_gradients(MLP &mlp, size_t num_threads)
+{
+    WorkStealingPool pool(num_threads);
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+    Variable loss =
+        MSELoss(mlp.forward(std::vector<double>{0.5, -1.0, 2.0}),
+                std::vector<double>{0.25, -0.5});
+    loss.set_gradient(1.0);
+    parallel_backward(loss, pool);
+
+    std::vector<double> result;
+    for (const auto &parameter : mlp.parameters())
+    {
+        result.push_back(parameter.reference()->gradient());
+    }
+    return result;
+}
+} // namespace
+
+
+TEST_CASE("Test deterministic mode", "[Determinism]")
+{
+    SECTION("Test seeds")
+    {
+        set_deterministic(true, 7);
+        REQUIRE(deterministic());
+        const uint64_t first = next_seed();
+        REQUIRE(next_seed() != first);
+        MLP a(3, std::vector<size_t>{4, 2});
+
+        set_deterministic(true, 7);
+        REQUIRE(next_seed() == first);
+        next_seed();
+        MLP b(3, std::vector<size_t>{4, 2});
+        REQUIRE(parameter_values(a) == parameter_values(b));
+
+        set_deterministic(true, 8);
+        MLP c(3, std::vector<size_t>{4, 2});
+        REQUIRE(parameter_values(a) != parameter_values(c));
+    }
+
+    SECTION("Test gradients do not depend on the number of threads")
+    {
+        set_deterministic(true, 1);
+        set_deterministic_lanes(4);
+        MLP mlp(3, std::vector<size_t>{8, 6, 2});
+        const std::vector<double> expected = parallel_gradients(mlp, 1);
+        for (size_t num_threads :
+             std::initializer_list<size_t>{2, 3, 4, 2, 3, 4})
+        {
+            REQUIRE(parallel_gradients(mlp, num_threads) == expected);
+        }
+
+        // The deterministic sums only differ in rounding from the serial
+        // pass.
+        for (auto &parameter : mlp.mutable_parameters())
+        {
+            parameter.zero_grad();
+        }
+        Variable loss =
+            MSELoss(mlp.forward(std::vector<double>{0.5, -1.0, 2.0}),
+                    std::vector<double>{0.25, -0.5});
+        loss.set_gradient(1.0);
+        loss.backward();
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            REQUIRE(mlp.parameters()[i].reference()->gradient() ==
+                    Approx(expected[i]));
+        }
+        REQUIRE_THROWS(set_deterministic_lanes(0));
+    }
+
+    SECTION("Test seed scopes restore the previous mode")
+    {
+        set_deterministic(false);
+        {
+            SeedScope scope(7, true);
+            REQUIRE(deterministic());
+        }
+        REQUIRE_FALSE(deterministic());
+
+        set_seed(7);
+        const uint64_t first = next_seed();
+        set_seed(7);
+        {
+            SeedScope scope(8);
+            REQUIRE_FALSE(deterministic());
+            next_seed();
+        }
+        REQUIRE(next_seed() == first);
+    }
+
+    set_deterministic(false);
+    set_deterministic_lanes(8);
+}
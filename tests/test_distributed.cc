@@ -0,0 +1,142 @@
+#include "distributed.h"
+#include "loss.h"
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+
+
+namespace
+{
+// Accumulates the MSE gradients of the samples whose index is congruent to
+// the rank modulo the world size.
+void accumulate_gradients(MLP &mlp,
+                          const std::vector<std::vector<double>> &inputs,
+                          const std::vector<std::vector<double>> &targets,
+                          size_t rank,
+                          size_t world_size)
+{
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+    for (size_t i = rank; i < inputs.size(); i += world_size)
+    {
+        Variable loss = MSELoss(mlp.forward(inputs[i]), targets[i]);
+        loss.set_gradient(1.0);
+        loss.backward();
+    }
+}
+} // namespace
+
+
+TEST_CASE("Test shared memory data parallelism", "[Distributed]")
+{
+    SECTION("Test ring allreduce")
+    {
+        for (size_t world_size : std::initializer_list<size_t>{1, 2, 3, 4})
+        {
+            // 10 values over 4 ranks leaves uneven chunks, and a capacity of
+            // 4 reduces them in pieces.
+            REQUIRE_NOTHROW(launch(
+                world_size, 4, [](SharedMemoryCommunicator &communicator) {
+                    const auto rank = static_cast<double>(communicator.rank());
+                    const auto world =
+                        static_cast<double>(communicator.world_size());
+                    std::vector<double> data(10);
+                    for (size_t i = 0; i < data.size(); i++)
+                    {
+                        data[i] = rank + static_cast<double>(i);
+                    }
+                    communicator.allreduce(data);
+                    for (size_t i = 0; i < data.size(); i++)
+                    {
+                        const double expected =
+                            world * (world - 1) / 2 +
+                            world * static_cast<double>(i);
+                        if (data[i] != expected)
+                        {
+                            throw std::runtime_error("wrong sum");
+                        }
+                    }
+
+                    const size_t root = 1 % communicator.world_size();
+                    std::vector<double> values(5, rank);
+                    communicator.broadcast(values.data(), values.size(), root);
+                    if (values[4] != static_cast<double>(root))
+                    {
+                        throw std::runtime_error("wrong broadcast");
+                    }
+                }));
+        }
+        REQUIRE_THROWS_AS(launch(2,
+                                 4,
+                                 [](SharedMemoryCommunicator &) {
+                                     throw std::runtime_error("failed worker");
+                                 }),
+                          std::runtime_error);
+
+        // A rank that fails after a barrier leaves the others waiting in the
+        // next one, so they must be terminated.
+        REQUIRE_THROWS_AS(
+            launch(3,
+                   4,
+                   [](SharedMemoryCommunicator &communicator) {
+                       communicator.barrier();
+                       if (communicator.rank() == 1)
+                       {
+                           throw std::runtime_error("failed worker");
+                       }
+                       communicator.barrier();
+                   }),
+            std::runtime_error);
+        REQUIRE_THROWS(SharedMemoryCommunicator(0, 4));
+    }
+
+    SECTION("Test data-parallel gradients match a single process")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 2});
+        std::vector<std::vector<double>> inputs{
+            {0.1, 0.2, 0.3}, {-0.5, 0.4, 0.0}, {1.0, -1.0, 0.5}};
+        std::vector<std::vector<double>> targets{
+            {0.5, -0.5}, {0.0, 0.1}, {-0.3, 0.3}};
+
+        accumulate_gradients(mlp, inputs, targets, 0, 1);
+        std::vector<double> expected;
+        for (const auto &parameter : mlp.parameters())
+        {
+            expected.push_back(parameter.reference()->gradient());
+        }
+
+        const auto worker = [&](SharedMemoryCommunicator &communicator) {
+            accumulate_gradients(mlp,
+                                 inputs,
+                                 targets,
+                                 communicator.rank(),
+                                 communicator.world_size());
+            allreduce_gradients(mlp, communicator, false);
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                const Variable &parameter = mlp.parameters()[i];
+                if (std::fabs(parameter.reference()->gradient() -
+                              expected[i]) > 1e-12 ||
+                    parameter.gradient() != parameter.reference()->gradient())
+                {
+                    throw std::runtime_error("wrong gradient");
+                }
+            }
+
+            if (communicator.rank() == 1)
+            {
+                mlp.mutable_parameters()[0].reference()->set_value(42.0);
+            }
+            broadcast_parameters(mlp, communicator, 1);
+            if (mlp.parameters()[0].reference()->value() != 42.0)
+            {
+                throw std::runtime_error("wrong broadcast");
+            }
+        };
+        REQUIRE_NOTHROW(launch(3, 16, worker));
+    }
+}
@@ -0,0 +1,167 @@
+#include "dual.h"
+#include "mlp.h"
+#include <catch2/catch.hpp>
+
+
+TEST_CASE("Test dual numbers", "[Dual]")
+{
+    SECTION("Test arithmetic")
+    {
+        Dual a(2.0, 1.0);
+        Dual b(3.0, -0.5);
+        REQUIRE((a + b).value() == 5.0);
+        REQUIRE((a + b).tangent() == 0.5);
+        REQUIRE((a - b).tangent() == 1.5);
+        REQUIRE((a * b).value() == 6.0);
+        REQUIRE((a * b).tangent() == Approx(1.0 * 3.0 + 2.0 * -0.5));
+        REQUIRE((a / b).tangent() ==
+                Approx((1.0 * 3.0 - 2.0 * -0.5) / (3.0 * 3.0)));
+        REQUIRE((-a).tangent() == -1.0);
+        REQUIRE((1.0 - a).tangent() == -1.0);
+        REQUIRE((4.0 * a).tangent() == 4.0);
+        REQUIRE((1.0 / a).tangent() == Approx(-1.0 / 4.0));
+        REQUIRE_THROWS(a / Dual(0.0));
+        REQUIRE_THROWS(Dual(0.0).pow(-1.0));
+        REQUIRE_THROWS(Dual(-1.0).log());
+    }
+
+    SECTION("Test unary ops match reverse mode")
+    {
+        const std::vector<std::string> names{"pow",
+                                             "exp",
+                                             "log",
+                                             "sin",
+                                             "cos",
+                                             "tan",
+                                             "sinh",
+                                             "cosh",
+                                             "tanh",
+                                             "relu",
+                                             "sigmoid",
+                                             "gelu",
+                                             "silu",
+                                             "softplus",
+                                             "identity"};
+        for (const auto &name : names)
+        {
+            Variable x(0.7);
+            Dual d(0.7, 1.0);
+            Variable y;
+            Dual e;
+            if (name == "pow")
+            {
+                y = x.pow(3.0);
+                e = d.pow(3.0);
+            }
+            else if (name == "exp")
+            {
+                y = x.exp();
+                e = d.exp();
+            }
+            else if (name == "log")
+            {
+                y = x.log();
+                e = d.log();
+            }
+            else if (name == "sin")
+            {
+                y = x.sin();
+                e = d.sin();
+            }
+            else if (name == "cos")
+            {
+                y = x.cos();
+                e = d.cos();
+            }
+            else if (name == "tan")
+            {
+                y = x.tan();
+                e = d.tan();
+            }
+            else if (name == "sinh")
+            {
+                y = x.sinh();
+                e = d.sinh();
+            }
+            else if (name == "cosh")
+            {
+                y = x.cosh();
+                e = d.cosh();
+            }
+            else
+            {
+                y = x.activate(name);
+                e = d.activate(name);
+            }
+            y.set_gradient(1.0);
+            y.backward();
+            REQUIRE(e.value() == Approx(y.value()));
+            REQUIRE(e.tangent() == Approx(x.gradient()));
+        }
+    }
+
+    SECTION("Test dot product")
+    {
+        std::vector<Dual> a = make_duals({1.0, 2.0}, {1.0, 0.0});
+        std::vector<Dual> b = make_duals({3.0, 4.0}, {0.0, 1.0});
+        Dual c = dot_product(a, b);
+        REQUIRE(c.value() == 11.0);
+        REQUIRE(c.tangent() == 5.0);
+        REQUIRE(dot_product(a, std::vector<double>{2.0, 1.0}).tangent() ==
+                2.0);
+        REQUIRE_THROWS(dot_product(a, std::vector<double>{1.0}));
+        REQUIRE_THROWS(make_duals({1.0}, {}));
+    }
+
+    SECTION("Test neuron JVP matches reverse mode")
+    {
+        Neuron neuron(3, "sigmoid");
+        std::vector<Variable> inputs(3);
+        inputs[0] = Variable(0.5);
+        inputs[1] = Variable(-1.0);
+        inputs[2] = Variable(2.0);
+        Variable output = neuron.forward(inputs);
+        output.set_gradient(1.0);
+        output.backward();
+
+        std::vector<double> direction{1.0, -2.0, 0.5};
+        Dual dual = neuron.forward(make_duals({0.5, -1.0, 2.0}, direction));
+        double expected = 0;
+        for (size_t i = 0; i < 3; i++)
+        {
+            expected += inputs[i].gradient() * direction[i];
+        }
+        REQUIRE(dual.value() == Approx(output.value()));
+        REQUIRE(dual.tangent() == Approx(expected));
+    }
+
+    SECTION("Test MLP JVP matches finite differences")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 4, 2});
+        std::vector<double> inputs{0.3, -0.2, 0.8};
+        std::vector<double> direction{0.5, 1.0, -1.0};
+        std::vector<double> jvp = mlp.jvp(inputs, direction);
+        REQUIRE(jvp.size() == 2);
+
+        const double h = 1e-6;
+        std::vector<double> plus = inputs;
+        std::vector<double> minus = inputs;
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            plus[i] += h * direction[i];
+            minus[i] -= h * direction[i];
+        }
+        std::vector<double> high = mlp.predict(plus);
+        std::vector<double> low = mlp.predict(minus);
+        for (size_t o = 0; o < jvp.size(); o++)
+        {
+            const double numeric = (high[o] - low[o]) / (2 * h);
+            REQUIRE(jvp[o] == Approx(numeric).margin(1e-6));
+        }
+
+        std::vector<double> outputs = mlp.predict(inputs);
+        std::vector<Dual> duals = mlp.forward(make_duals(inputs, direction));
+        REQUIRE(duals[0].value() == Approx(outputs[0]));
+        REQUIRE(duals[1].value() == Approx(outputs[1]));
+    }
+}
@@ -0,0 +1,148 @@
+#include "determinism.h"
+#include "embedding.h"
+#include "layer.h"
+#include "loss.h"
+#include <catch2/catch.hpp>
+
+
+TEST_CASE("Test embedding", "[Embedding]")
+{
+    set_seed(5);
+    Embedding embedding(1000, 3);
+
+    SECTION("Test lookups")
+    {
+        REQUIRE(embedding.num_embeddings() == 1000);
+        REQUIRE(embedding.table().size() == 3000);
+        const std::vector<size_t> ids{7, 999, 7};
+        const std::vector<Variable> outputs = embedding.forward(ids);
+        const std::vector<double> predicted = embedding.predict(ids);
+        REQUIRE(outputs.size() == 9);
+        REQUIRE(embedding.num_touched() == 2);
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            REQUIRE(outputs[i].value() == predicted[i]);
+        }
+        REQUIRE(embedding.row(999)[1] == predicted[4]);
+
+        const std::vector<double> sum =
+            embedding.predict(ids, BagPooling::Sum);
+        const std::vector<double> mean =
+            embedding.predict(ids, BagPooling::Mean);
+        const std::vector<Variable> bag =
+            embedding.forward(ids, BagPooling::Mean);
+        for (size_t j = 0; j < 3; j++)
+        {
+            REQUIRE(sum[j] == Approx(2 * predicted[j] + predicted[3 + j]));
+            REQUIRE(mean[j] == Approx(sum[j] / 3));
+            REQUIRE(bag[j].value() == Approx(mean[j]));
+        }
+        REQUIRE(embedding.predict({}, BagPooling::Mean) ==
+                std::vector<double>(3, 0.0));
+
+        REQUIRE_THROWS_AS(embedding.forward(std::vector<size_t>{1000}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(embedding.predict({1000}), std::invalid_argument);
+        REQUIRE_THROWS_AS(Embedding(0, 3), std::invalid_argument);
+    }
+
+    SECTION("Test sparse gradients and lazy updates")
+    {
+        const std::vector<double> before = embedding.table();
+        const std::vector<std::vector<size_t>> bags{{42, 3, 42}, {3}};
+        const auto outputs = embedding.forward(bags, BagPooling::Sum);
+        const std::vector<double> targets{1.0, -1.0, 0.5};
+        Variable first_loss = MSELoss(outputs[0], targets);
+        Variable second_loss = MSELoss(outputs[1], targets);
+        Variable loss = first_loss + second_loss;
+        loss.set_gradient(1.0);
+        loss.backward();
+
+        const SparseRowGradient gradient = embedding.sparse_gradient();
+        REQUIRE(gradient.dim == 3);
+        REQUIRE(gradient.rows == std::vector<size_t>{3, 42});
+        REQUIRE(gradient.values.size() == 6);
+        // MSELoss does not scale its gradient by 1 / n. Row 42 appears twice
+        // in the first bag, row 3 once in each bag.
+        for (size_t j = 0; j < 3; j++)
+        {
+            const double first = 2 * (outputs[0][j].value() - targets[j]);
+            const double second = 2 * (outputs[1][j].value() - targets[j]);
+            REQUIRE(gradient.values[j] == Approx(first + second));
+            REQUIRE(gradient.values[3 + j] == Approx(2 * first));
+        }
+
+        embedding.gradient_descent(0.1);
+        REQUIRE(embedding.num_touched() == 0);
+        for (size_t i = 0; i < before.size(); i++)
+        {
+            const size_t id = i / 3;
+            if (id == 3 || id == 42)
+            {
+                const size_t k = (id == 3 ? 0 : 3) + i % 3;
+                REQUIRE(embedding.table()[i] ==
+                        Approx(before[i] - 0.1 * gradient.values[k]));
+            }
+            else
+            {
+                REQUIRE(embedding.table()[i] == before[i]);
+            }
+        }
+        REQUIRE(embedding.sparse_gradient().rows.empty());
+
+        // A gradient from elsewhere also refreshes the touched leaves.
+        const Variable leaf = embedding.forward(std::vector<size_t>{42})[0];
+        embedding.apply(gradient, 1.0);
+        REQUIRE(leaf.reference()->value() == embedding.row(42)[0]);
+        REQUIRE(embedding.table()[0] == before[0]);
+        SparseRowGradient wrong = gradient;
+        wrong.rows[1] = 1000;
+        REQUIRE_THROWS_AS(embedding.apply(wrong, 1.0),
+                          std::invalid_argument);
+        wrong.dim = 2;
+        REQUIRE_THROWS_AS(embedding.apply(wrong, 1.0),
+                          std::invalid_argument);
+    }
+
+    SECTION("Test training with a dense head")
+    {
+        // The class of a bag is whether it holds an even id.
+        const std::vector<std::vector<size_t>> bags{
+            {2, 5}, {1, 3}, {4}, {7, 9}, {6, 1}, {5}};
+        const std::vector<double> targets{1, 0, 1, 0, 1, 0};
+        Layer head(3, 1, "identity");
+        double first_loss = 0;
+        double last_loss = 0;
+        for (size_t step = 0; step < 50; step++)
+        {
+            const auto features = embedding.forward(bags, BagPooling::Mean);
+            std::vector<std::vector<Variable>> outputs;
+            for (const auto &feature : features)
+            {
+                outputs.push_back(head.forward(feature));
+            }
+            std::vector<std::vector<double>> labels;
+            for (const double target : targets)
+            {
+                labels.push_back({target});
+            }
+            Variable loss = MSELoss(outputs, labels);
+            (step == 0 ? first_loss : last_loss) = loss.value();
+            for (const auto &parameter : head.parameters())
+            {
+                parameter.reference()->zero_grad();
+            }
+            loss.set_gradient(1.0);
+            loss.backward();
+            for (const auto &parameter : head.parameters())
+            {
+                parameter.reference()->gradient_descent(0.05);
+            }
+            embedding.gradient_descent(0.05);
+            REQUIRE(embedding.num_touched() == 0);
+        }
+        REQUIRE(last_loss < first_loss / 2);
+    }
+
+    set_deterministic(false);
+}
@@ -0,0 +1,90 @@
+#include "execution_plan.h"
+#include "loss.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Test execution plan", "[ExecutionPlan]")
+{
+    std::vector<double> inputs{2.0, 3.0, -1.0};
+    std::vector<double> targets{1.0, -0.5};
+
+    SECTION("Test replay matches the graph")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 4, 2});
+        ExecutionPlan plan(mlp, targets.size());
+        REQUIRE(plan.captured());
+        REQUIRE(plan.matches(3, 2));
+        REQUIRE(plan.instructions().size() == 3 * (4 + 4 + 2) + 1);
+
+        for (auto &parameter : mlp.mutable_parameters())
+        {
+            parameter.zero_grad();
+        }
+        std::vector<Variable> &results = mlp.forward(inputs);
+        Variable loss = MSELoss(results, targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+        std::vector<double> expected;
+        for (const auto &parameter : mlp.parameters())
+        {
+            expected.push_back(parameter.reference()->gradient());
+            parameter.reference()->zero_grad();
+        }
+
+        double plan_loss = plan.replay(inputs, targets);
+        REQUIRE(plan_loss == Approx(loss.value()));
+        REQUIRE(plan.prediction(0) == Approx(results[0].value()));
+        REQUIRE(plan.prediction(1) == Approx(results[1].value()));
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            REQUIRE(mlp.parameters()[i].reference()->gradient() ==
+                    Approx(expected[i]));
+        }
+    }
+
+    SECTION("Test training with replay")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 2});
+        ExecutionPlan plan(mlp, targets.size());
+        double first_loss = 0;
+        double last_loss = 0;
+        for (size_t iter = 0; iter < 20; ++iter)
+        {
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.zero_grad();
+            }
+            last_loss = plan.replay(inputs, targets);
+            if (iter == 0)
+            {
+                first_loss = last_loss;
+            }
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.gradient_descent(0.01);
+            }
+        }
+        REQUIRE(last_loss < first_loss);
+
+        Variable loss = MSELoss(mlp.forward(inputs), targets);
+        REQUIRE(plan.replay(inputs, targets) == Approx(loss.value()));
+    }
+
+    SECTION("Test invalidate and recapture")
+    {
+        MLP mlp(3, std::vector<size_t>{2});
+        ExecutionPlan plan;
+        REQUIRE_FALSE(plan.captured());
+        REQUIRE_THROWS(plan.replay(inputs, targets));
+        REQUIRE_THROWS(plan.capture(mlp, 3));
+
+        plan.capture(mlp, 2);
+        REQUIRE_THROWS(plan.replay(std::vector<double>{1.0}, targets));
+        plan.invalidate();
+        REQUIRE_FALSE(plan.captured());
+
+        MLP wider(4, std::vector<size_t>{2});
+        plan.capture(wider, 2);
+        REQUIRE(plan.matches(4, 2));
+        REQUIRE_NOTHROW(plan.replay(std::vector<double>{1, 2, 3, 4}, targets));
+    }
+}
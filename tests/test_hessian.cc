@@ -0,0 +1,111 @@
+#include "hessian.h"
+#include "loss.h"
+#include <catch2/catch.hpp>
+
+
+namespace
+{
+std::vector<double> backward_gradient(MLP &mlp,
+                                      const std::vector<double> &inputs,
+                                      const std::vector<double> &targets)
+{
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+    Variable loss = MSELoss(mlp.forward(inputs), targets);
+    loss.set_gradient(1.0);
+    loss.backward();
+    std::vector<double> gradient;
+    for (const auto &parameter : mlp.parameters())
+    {
+        gradient.push_back(parameter.reference()->gradient());
+    }
+    return gradient;
+}
+
+
+void shift_parameters(MLP &mlp, const std::vector<double> &v, double step)
+{
+    const std::vector<Variable> &parameters = mlp.parameters();
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        Variable *parameter = parameters[i].reference();
+        parameter->set_value(parameter->value() + step * v[i]);
+    }
+}
+} // namespace
+
+
+TEST_CASE("Test Hessian-vector product", "[Hessian]")
+{
+    std::vector<double> inputs{0.5, -1.0, 0.25};
+    std::vector<double> targets{0.3, -0.7};
+    MLP mlp(3, std::vector<size_t>{4, 2});
+    const size_t n = mlp.parameters().size();
+    std::vector<double> v(n);
+    std::vector<double> u(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        v[i] = std::sin(static_cast<double>(i));
+        u[i] = std::cos(static_cast<double>(3 * i));
+    }
+
+    SECTION("Test the gradient matches backward")
+    {
+        HessianVectorProduct hvp =
+            hessian_vector_product(mlp, inputs, targets, v);
+        std::vector<double> gradient = backward_gradient(mlp, inputs, targets);
+        Variable loss = MSELoss(mlp.forward(inputs), targets);
+        REQUIRE(hvp.loss == Approx(loss.value()));
+        for (size_t i = 0; i < n; i++)
+        {
+            REQUIRE(hvp.gradient[i] == Approx(gradient[i]));
+        }
+    }
+
+    SECTION("Test the product matches finite differences")
+    {
+        HessianVectorProduct hvp =
+            hessian_vector_product(mlp, inputs, targets, v);
+        const double h = 1e-5;
+        shift_parameters(mlp, v, h);
+        std::vector<double> high = backward_gradient(mlp, inputs, targets);
+        shift_parameters(mlp, v, -2 * h);
+        std::vector<double> low = backward_gradient(mlp, inputs, targets);
+        shift_parameters(mlp, v, h);
+        for (size_t i = 0; i < n; i++)
+        {
+            const double numeric = (high[i] - low[i]) / (2 * h);
+            REQUIRE(hvp.product[i] == Approx(numeric).margin(1e-5));
+        }
+    }
+
+    SECTION("Test the Hessian is symmetric")
+    {
+        std::vector<std::vector<double>> batch_inputs{inputs, {1.0, 0.0, -2.0}};
+        std::vector<std::vector<double>> batch_targets{targets, {0.1, 0.9}};
+        std::vector<double> hv =
+            hessian_vector_product(mlp, batch_inputs, batch_targets, v).product;
+        std::vector<double> hu =
+            hessian_vector_product(mlp, batch_inputs, batch_targets, u).product;
+        double u_hv = 0;
+        double v_hu = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            u_hv += u[i] * hv[i];
+            v_hu += v[i] * hu[i];
+        }
+        REQUIRE(u_hv == Approx(v_hu));
+    }
+
+    SECTION("Test invalid sizes")
+    {
+        REQUIRE_THROWS(hessian_vector_product(
+            mlp, inputs, targets, std::vector<double>(n - 1)));
+        REQUIRE_THROWS(
+            hessian_vector_product(mlp, std::vector<double>{1.0}, targets, v));
+        REQUIRE_THROWS(
+            hessian_vector_product(mlp, inputs, std::vector<double>{1.0}, v));
+    }
+}
@@ -0,0 +1,172 @@
+#include "initializer.h"
+#include "mlp.h"
+#include <catch2/catch.hpp>
+#include <initializer_list>
+
+
+namespace
+{
+std::vector<double> layer_values(size_t n_in,
+                                 size_t n_out,
+                                 InitScheme scheme,
+                                 ThreadPool *pool = nullptr)
+{
+    std::vector<double> values((n_in + 1) * n_out);
+    initialize_layer(values.data(), n_in, n_out, scheme, 42, pool);
+    return values;
+}
+
+
+std::vector<double> parameter_values(const MLP &mlp)
+{
+    std::vector<double> result;
+    for (const auto &parameter : mlp.parameters())
+    {
+        result.push_back(parameter.reference()->value());
+    }
+    return result;
+}
+
+
+// Returns the dot product of the weights of two neurons, or of two input
+// columns.
+double dot(const std::vector<double> &values,
+           size_t n_in,
+           size_t n,
+           size_t a,
+           size_t b,
+           bool columns)
+{
+    const size_t stride = n_in + 1;
+    double sum = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        sum += columns ? values[k * stride + a] * values[k * stride + b]
+                       : values[a * stride + k] * values[b * stride + k];
+    }
+    return sum;
+}
+} // namespace
+
+
+TEST_CASE("Test weight initializer", "[Initializer]")
+{
+    SECTION("Test counter-based streams")
+    {
+        const CounterRng rng(1);
+        REQUIRE(rng.bits(5) == CounterRng(1).bits(5));
+        REQUIRE(rng.bits(5) != rng.bits(6));
+        REQUIRE(rng.bits(5) != CounterRng(2).bits(5));
+
+        double sum = 0.0;
+        double squares = 0.0;
+        const size_t n = 20000;
+        for (size_t i = 0; i < n; i++)
+        {
+            const double u = rng.uniform(i);
+            REQUIRE(u >= 0.0);
+            REQUIRE(u < 1.0);
+            const double x = rng.normal(i);
+            sum += x;
+            squares += x * x;
+        }
+        REQUIRE(sum / n == Approx(0.0).margin(0.05));
+        REQUIRE(squares / n == Approx(1.0).margin(0.05));
+    }
+
+    SECTION("Test schemes")
+    {
+        const size_t n_in = 30;
+        const size_t n_out = 20;
+        const double xavier = std::sqrt(6.0 / (n_in + n_out));
+        for (double value : layer_values(n_in, n_out, InitScheme::Uniform))
+        {
+            REQUIRE(std::abs(value) <= 1.0);
+        }
+        const std::vector<double> values =
+            layer_values(n_in, n_out, InitScheme::XavierUniform);
+        double squares = 0.0;
+        for (size_t i = 0; i < n_out; i++)
+        {
+            for (size_t j = 0; j < n_in; j++)
+            {
+                const double weight = values[i * (n_in + 1) + j];
+                REQUIRE(std::abs(weight) <= xavier);
+                squares += weight * weight;
+            }
+            REQUIRE(values[i * (n_in + 1) + n_in] == 0.0);
+        }
+        REQUIRE(squares / (n_in * n_out) ==
+                Approx(2.0 / (n_in + n_out)).epsilon(0.15));
+
+        squares = 0.0;
+        for (double value : layer_values(n_in, n_out, InitScheme::HeNormal))
+        {
+            squares += value * value;
+        }
+        REQUIRE(squares / (n_in * n_out) == Approx(2.0 / n_in).epsilon(0.15));
+        REQUIRE(parse_init_scheme("he_uniform") == InitScheme::HeUniform);
+        REQUIRE_THROWS(parse_init_scheme("zeros"));
+    }
+
+    SECTION("Test orthogonal rows and columns")
+    {
+        for (size_t n_out : std::initializer_list<size_t>{4, 12})
+        {
+            const size_t n_in = 8;
+            const bool columns = n_out > n_in;
+            const size_t count = columns ? n_in : n_out;
+            const size_t length = columns ? n_out : n_in;
+            const std::vector<double> values =
+                layer_values(n_in, n_out, InitScheme::Orthogonal);
+            for (size_t a = 0; a < count; a++)
+            {
+                for (size_t b = 0; b < count; b++)
+                {
+                    REQUIRE(dot(values, n_in, length, a, b, columns) ==
+                            Approx(a == b ? 1.0 : 0.0).margin(1e-12));
+                }
+            }
+        }
+    }
+
+    SECTION("Test parallel fill does not depend on the number of threads")
+    {
+        const std::vector<double> expected =
+            layer_values(16, 33, InitScheme::XavierNormal);
+        for (size_t num_threads : std::initializer_list<size_t>{1, 2, 3, 4})
+        {
+            ThreadPool pool(num_threads);
+            REQUIRE(layer_values(16, 33, InitScheme::XavierNormal, &pool) ==
+                    expected);
+        }
+    }
+
+    SECTION("Test global seed")
+    {
+        set_seed(3);
+        MLP a(4, std::vector<size_t>{6, 2}, InitScheme::HeUniform);
+        REQUIRE_FALSE(deterministic());
+
+        ThreadPool pool(3);
+        set_seed(3);
+        MLP b(4, std::vector<size_t>{6, 2}, InitScheme::HeUniform, &pool);
+        REQUIRE(parameter_values(a) == parameter_values(b));
+
+        set_seed(4);
+        MLP c(4, std::vector<size_t>{6, 2}, InitScheme::HeUniform);
+        REQUIRE(parameter_values(a) != parameter_values(c));
+        set_deterministic(false);
+
+        // Unseeded neurons built back to back still differ.
+        Neuron first(5);
+        Neuron second(5);
+        REQUIRE(first.weights()[0].value() != second.weights()[0].value());
+
+        const std::vector<double> weights{0.5, -0.25};
+        Neuron neuron(weights.data(), weights.size(), 0.125);
+        REQUIRE(neuron.weights()[1].value() == -0.25);
+        REQUIRE(neuron.bias().value() == 0.125);
+        REQUIRE(neuron.parameters().size() == 3);
+    }
+}
@@ -14,22 +14,16 @@ TEST_CASE("Test layer", "[Layer]")
         std::vector<Variable> results = layer.forward(inputs);
         REQUIRE(results.size() == 1);
         auto &result = results[0];
-        REQUIRE(result.children().size() == 1);
+        REQUIRE(result.children().size() == 4);
         result.set_gradient(1.0);
-        result.backward();
+        result.backward(true);
         REQUIRE(result.gradient() == Approx(1.0));
-
-        auto &child = result.children()[0];
-        REQUIRE(child.children().size() == 2);
-        REQUIRE(child.gradient() ==
-                Approx(1.0 - result.value() * result.value()));
+        const double grad = 1.0 - result.value() * result.value();
 
         const auto &parameters = layer.parameters();
         const auto &neuron = layer.neurons()[0];
-        REQUIRE(child.children()[1].reference() == &neuron.bias());
-        REQUIRE(neuron.bias().gradient() == Approx(child.gradient()));
-        const auto &product = child.children()[0];
-        REQUIRE(product.gradient() == Approx(child.gradient()));
+        REQUIRE(result.children()[3].reference() == &neuron.bias());
+        REQUIRE(neuron.bias().gradient() == Approx(grad));
         for (size_t i = 0; i < 4; ++i)
         {
             REQUIRE(parameters[i].reference() ==
@@ -40,16 +34,15 @@ TEST_CASE("Test layer", "[Layer]")
             REQUIRE(parameters[i].reference() == &neuron.weights()[i]);
         }
         REQUIRE(parameters[3].reference() == &neuron.bias());
-        REQUIRE(product.children().size() == 3);
         for (size_t i = 0; i < 3; ++i)
         {
-            REQUIRE(product.children()[i].reference() == &neuron.weights()[i]);
+            REQUIRE(result.children()[i].reference() == &neuron.weights()[i]);
         }
 
         for (size_t i = 0; i < 3; ++i)
         {
             REQUIRE(neuron.weights()[i].gradient() ==
-                    Approx(product.gradient() * inputs[i]));
+                    Approx(grad * inputs[i]));
         }
     }
 
@@ -69,22 +62,16 @@ TEST_CASE("Test layer", "[Layer]")
         std::vector<Variable> results = layer.forward(inputs);
         REQUIRE(results.size() == 1);
         auto &result = results[0];
-        REQUIRE(result.children().size() == 1);
+        REQUIRE(result.children().size() == 7);
         result.set_gradient(1.0);
-        result.backward();
+        result.backward(true);
         REQUIRE(result.gradient() == Approx(1.0));
-
-        auto &child = result.children()[0];
-        REQUIRE(child.children().size() == 2);
-        REQUIRE(child.gradient() ==
-                Approx(1.0 - result.value() * result.value()));
+        const double grad = 1.0 - result.value() * result.value();
 
         const auto &parameters = layer.parameters();
         const auto &neuron = layer.neurons()[0];
-        REQUIRE(child.children()[1].reference() == &neuron.bias());
-        REQUIRE(neuron.bias().gradient() == Approx(child.gradient()));
-        const auto &product = child.children()[0];
-        REQUIRE(product.gradient() == Approx(child.gradient()));
+        REQUIRE(result.children()[6].reference() == &neuron.bias());
+        REQUIRE(neuron.bias().gradient() == Approx(grad));
         for (size_t i = 0; i < 4; ++i)
         {
             REQUIRE(parameters[i].reference() ==
@@ -95,17 +82,16 @@ TEST_CASE("Test layer", "[Layer]")
             REQUIRE(parameters[i].reference() == &neuron.weights()[i]);
         }
         REQUIRE(parameters[3].reference() == &neuron.bias());
-        REQUIRE(product.children().size() == 6);
         for (size_t i = 0; i < 3; ++i)
         {
-            REQUIRE(product.children()[i].reference() == &neuron.weights()[i]);
-            REQUIRE(product.children()[i + 3].reference() == &inputs[i]);
+            REQUIRE(result.children()[i].reference() == &neuron.weights()[i]);
+            REQUIRE(result.children()[i + 3].reference() == &inputs[i]);
         }
 
         for (size_t i = 0; i < 3; ++i)
         {
             REQUIRE(neuron.weights()[i].gradient() ==
-                    Approx(product.gradient() * inputs[i].value()));
+                    Approx(grad * inputs[i].value()));
         }
     }
 }
@@ -1,5 +1,6 @@
 #include "loss.h"
 #include <catch2/catch.hpp>
+#include <cmath>
 
 TEST_CASE("Test loss", "[Loss]")
 {
@@ -31,4 +32,125 @@ TEST_CASE("Test loss", "[Loss]")
                            (predictions[i].value() - targets[i])));
         }
     }
+
+    SECTION("Test batched MSE loss")
+    {
+        std::vector<std::vector<Variable>> predictions(2);
+        predictions[0] = std::vector<Variable>(2);
+        predictions[1] = std::vector<Variable>(2);
+        predictions[0][0] = Variable(1.0);
+        predictions[0][1] = Variable(2.0);
+        predictions[1][0] = Variable(0.5);
+        predictions[1][1] = Variable(-1.0);
+        std::vector<std::vector<double>> targets{{0.0, 0.0}, {1.0, 1.0}};
+
+        Variable loss = MSELoss(predictions, targets);
+        REQUIRE(loss.value() ==
+                Approx(((1.0 + 4.0) / 2 + (0.25 + 4.0) / 2) / 2));
+        REQUIRE(loss.children().size() == 4);
+        loss.set_gradient(1.0);
+        loss.backward();
+        REQUIRE(predictions[0][1].gradient() == Approx(2.0 * 2.0 / 2));
+        REQUIRE(predictions[1][1].gradient() == Approx(2.0 * -2.0 / 2));
+        REQUIRE_THROWS(MSELoss(predictions, {{0.0, 0.0}}));
+    }
+
+    SECTION("Test softmax cross-entropy loss")
+    {
+        std::vector<Variable> logits(3);
+        logits[0] = Variable(1.0);
+        logits[1] = Variable(2.0);
+        logits[2] = Variable(0.5);
+        Variable loss = SoftmaxCrossEntropyLoss(logits, 1);
+
+        const double sum = std::exp(1.0) + std::exp(2.0) + std::exp(0.5);
+        REQUIRE(loss.value() == Approx(std::log(sum) - 2.0));
+        REQUIRE(loss.children().size() == 3);
+        loss.set_gradient(1.0);
+        loss.backward();
+        REQUIRE(logits[0].gradient() == Approx(std::exp(1.0) / sum));
+        REQUIRE(logits[1].gradient() == Approx(std::exp(2.0) / sum - 1));
+        REQUIRE(logits[2].gradient() == Approx(std::exp(0.5) / sum));
+
+        std::vector<Variable> large(2);
+        large[0] = Variable(1000.0);
+        large[1] = Variable(-1000.0);
+        REQUIRE(SoftmaxCrossEntropyLoss(large, 0).value() == Approx(0.0));
+        REQUIRE(SoftmaxCrossEntropyLoss(large, 1).value() == Approx(2000.0));
+        REQUIRE_THROWS(SoftmaxCrossEntropyLoss(large, 2));
+    }
+
+    SECTION("Test batched softmax cross-entropy loss")
+    {
+        std::vector<std::vector<Variable>> logits(2);
+        logits[0] = std::vector<Variable>(2);
+        logits[1] = std::vector<Variable>(2);
+        logits[0][0] = Variable(0.0);
+        logits[0][1] = Variable(0.0);
+        logits[1][0] = Variable(3.0);
+        logits[1][1] = Variable(1.0);
+        Variable loss = SoftmaxCrossEntropyLoss(logits, {0, 1});
+
+        const double second = std::log(std::exp(3.0) + std::exp(1.0)) - 1.0;
+        REQUIRE(loss.value() == Approx((std::log(2.0) + second) / 2));
+        loss.set_gradient(1.0);
+        loss.backward();
+        REQUIRE(logits[0][0].gradient() == Approx((0.5 - 1) / 2));
+        REQUIRE(logits[0][1].gradient() == Approx(0.5 / 2));
+        REQUIRE(logits[1][0].gradient() + logits[1][1].gradient() ==
+                Approx(0.0).margin(1e-12));
+    }
+
+    SECTION("Test BCE with logits loss")
+    {
+        std::vector<Variable> logits(2);
+        logits[0] = Variable(0.5);
+        logits[1] = Variable(-2.0);
+        std::vector<double> targets{1.0, 0.25};
+        Variable loss = BCEWithLogitsLoss(logits, targets);
+
+        double expected = 0;
+        for (size_t i = 0; i < 2; ++i)
+        {
+            const double p = 1 / (1 + std::exp(-logits[i].value()));
+            expected -= targets[i] * std::log(p) +
+                        (1 - targets[i]) * std::log(1 - p);
+        }
+        REQUIRE(loss.value() == Approx(expected / 2));
+        loss.set_gradient(1.0);
+        loss.backward();
+        for (size_t i = 0; i < 2; ++i)
+        {
+            const double p = 1 / (1 + std::exp(-logits[i].value()));
+            REQUIRE(logits[i].gradient() == Approx((p - targets[i]) / 2));
+        }
+
+        std::vector<Variable> large(1);
+        large[0] = Variable(-800.0);
+        REQUIRE(BCEWithLogitsLoss(large, {1.0}).value() == Approx(800.0));
+        REQUIRE_THROWS(BCEWithLogitsLoss(large, {1.0, 0.0}));
+
+        std::vector<std::vector<Variable>> batch{logits, logits};
+        REQUIRE(BCEWithLogitsLoss(batch, {targets, targets}).value() ==
+                Approx(expected / 2));
+    }
+
+    SECTION("Test Huber loss")
+    {
+        std::vector<Variable> predictions(2);
+        predictions[0] = Variable(0.5);
+        predictions[1] = Variable(4.0);
+        std::vector<double> targets{0.0, 1.0};
+        Variable loss = HuberLoss(predictions, targets, 1.0);
+        REQUIRE(loss.value() == Approx((0.125 + 2.5) / 2));
+        loss.set_gradient(1.0);
+        loss.backward();
+        REQUIRE(predictions[0].gradient() == Approx(0.5 / 2));
+        REQUIRE(predictions[1].gradient() == Approx(1.0 / 2));
+        REQUIRE_THROWS(HuberLoss(predictions, targets, 0.0));
+
+        std::vector<std::vector<Variable>> batch{predictions};
+        REQUIRE(HuberLoss(batch, {targets}, 2.0).value() ==
+                Approx((0.125 + 2.0 * (3.0 - 1.0)) / 2));
+    }
 }
@@ -1,6 +1,10 @@
 #include "loss.h"
 #include "mlp.h"
 #include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
 
 TEST_CASE("Test mlp", "[MLP]")
 {
@@ -18,27 +22,24 @@ TEST_CASE("Test mlp", "[MLP]")
         REQUIRE(results.size() == 1);
         Variable loss = MSELoss(results, targets);
         loss.set_gradient(1.0);
-        loss.backward();
+        loss.backward(true);
 
         REQUIRE(loss.children().size() == 1);
         const auto &child = loss.children()[0];
         REQUIRE(child.reference() == &results[0]);
         REQUIRE(child.gradient() ==
                 Approx(loss.gradient() * 2 * (child.value() - targets[0])));
-        REQUIRE(child.children().size() == 1);
-        const auto &grandson = child.children()[0];
-        REQUIRE(
-            grandson.gradient() ==
-            Approx(child.gradient() * (1.0 - child.value() * child.value())));
+        REQUIRE(child.children().size() == 4);
+        const double grad =
+            child.gradient() * (1.0 - child.value() * child.value());
         const auto &layer = mlp.layers()[0];
         const auto &parameters = layer.parameters();
         for (size_t i = 0; i < 3; ++i)
         {
             REQUIRE(parameters[i].reference()->gradient() ==
-                    Approx(grandson.gradient() * inputs[i]));
+                    Approx(grad * inputs[i]));
         }
-        REQUIRE(parameters[3].reference()->gradient() ==
-                Approx(grandson.gradient()));
+        REQUIRE(parameters[3].reference()->gradient() == Approx(grad));
 
         std::vector<double> old_values(4);
         for (size_t i = 0; i < 4; ++i)
@@ -80,68 +81,55 @@ TEST_CASE("Test mlp", "[MLP]")
         REQUIRE(results.size() == 1);
         Variable loss = MSELoss(results, targets);
         loss.set_gradient(1.0);
-        loss.backward();
+        loss.backward(true);
 
         REQUIRE(loss.children().size() == 1);
         const auto &child = loss.children()[0];
         REQUIRE(child.reference() == &results[0]);
         REQUIRE(child.gradient() ==
                 Approx(loss.gradient() * 2 * (child.value() - targets[0])));
-        REQUIRE(child.children().size() == 1);
-        const auto &grandson = child.children()[0];
-        REQUIRE(grandson.children().size() == 2);
-        REQUIRE(
-            grandson.gradient() ==
-            Approx(child.gradient() * (1.0 - child.value() * child.value())));
-        REQUIRE(grandson.children()[0].gradient() ==
-                Approx(grandson.gradient()));
-        REQUIRE(grandson.children()[1].gradient() ==
-                Approx(grandson.gradient()));
-        REQUIRE(grandson.children()[1].reference() ==
+        REQUIRE(child.op() == "fused_neuron");
+        REQUIRE(child.children().size() == 5);
+        const double grad =
+            child.gradient() * (1.0 - child.value() * child.value());
+        REQUIRE(child.children()[4].gradient() == Approx(grad));
+        REQUIRE(child.children()[4].reference() ==
                 mlp.layers()[1].parameters()[2].reference());
-
-        const auto &layer1_product = grandson.children()[0];
-        REQUIRE(layer1_product.children().size() == 4);
         for (size_t i = 0; i < 2; ++i)
         {
-            REQUIRE(layer1_product.children()[i + 2].reference() ==
+            REQUIRE(child.children()[i + 2].reference() ==
                     mlp.results()[0][i].reference());
         }
         for (size_t i = 0; i < 2; ++i)
         {
-            REQUIRE(layer1_product.children()[i].gradient() ==
-                    Approx(layer1_product.gradient() *
-                           layer1_product.children()[i + 2].value()));
-            REQUIRE(layer1_product.children()[i + 2].gradient() ==
-                    Approx(layer1_product.gradient() *
-                           layer1_product.children()[i].value()));
+            REQUIRE(child.children()[i].gradient() ==
+                    Approx(grad * child.children()[i + 2].value()));
+            REQUIRE(child.children()[i + 2].gradient() ==
+                    Approx(grad * child.children()[i].value()));
         }
 
         const auto &layer0_results = mlp.results()[0];
         for (const auto &result : layer0_results)
         {
             REQUIRE(result.reference() == &result);
+            REQUIRE(result.children().size() == 4);
         }
-        const auto &neuron0_result = layer0_results[0];
-        const auto &neuron1_result = layer0_results[1];
-        REQUIRE(neuron0_result.reference() == &neuron0_result);
-        REQUIRE(neuron1_result.reference() == &neuron1_result);
-        REQUIRE(neuron0_result.children().size() == 1);
-        REQUIRE(neuron1_result.children().size() == 1);
-        const auto &layer0_activated = neuron0_result.children()[0];
-        REQUIRE(layer0_activated.children().size() == 2);
-        REQUIRE(layer0_activated.children()[0].gradient() ==
-                Approx(layer0_activated.gradient()));
-        REQUIRE(layer0_activated.children()[1].gradient() ==
-                Approx(layer0_activated.gradient()));
-        const auto &layer0_product = layer0_activated.children()[0];
-        REQUIRE(layer0_product.children().size() == 3);
+        const auto &layer0_neuron = child.children()[2];
+        REQUIRE(layer0_neuron.children().size() == 4);
+        const double layer0_grad =
+            layer0_neuron.gradient() *
+            (1.0 - layer0_neuron.value() * layer0_neuron.value());
+        REQUIRE(layer0_neuron.children()[3].gradient() ==
+                Approx(layer0_grad));
         const auto &neuron0_0 = mlp.layers()[0].neurons()[0];
         for (size_t i = 0; i < 3; ++i)
         {
-            REQUIRE(layer0_product.children()[i].reference() ==
+            REQUIRE(layer0_neuron.children()[i].reference() ==
                     &neuron0_0.weights()[i]);
+            REQUIRE(layer0_neuron.children()[i].gradient() ==
+                    Approx(layer0_grad * inputs[i]));
         }
+        REQUIRE(layer0_neuron.children()[3].reference() == &neuron0_0.bias());
 
         for (auto &parameter : mlp.mutable_parameters())
         {
@@ -151,4 +139,100 @@ TEST_CASE("Test mlp", "[MLP]")
         Variable new_loss = MSELoss(new_results, targets);
         REQUIRE(new_loss.value() <= Approx(loss.value()));
     }
+
+    SECTION("Test batched predict")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 2});
+        std::vector<double> batch{0.3, -1.2, 2.0, 0.0, 0.0, 0.0};
+        std::vector<double> batched = mlp.predict(batch, 2);
+        std::vector<double> first = mlp.predict(std::vector<double>{
+            batch.begin(), batch.begin() + 3});
+        REQUIRE(batched.size() == 4);
+        REQUIRE(batched[0] == Approx(first[0]));
+        REQUIRE(batched[1] == Approx(first[1]));
+        REQUIRE(batched[2] ==
+                Approx(mlp.predict(std::vector<double>(3, 0.0))[0]));
+        REQUIRE_THROWS(mlp.predict(batch, 3));
+    }
+
+    SECTION("Test releasing the results")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 1});
+        std::vector<double> inputs{2.0, 3.0, -1.0};
+        Variable loss = MSELoss(mlp.forward(inputs), std::vector<double>{1.0});
+        mlp.release_results();
+        REQUIRE(mlp.results()[0].size() == 4);
+        REQUIRE(mlp.results()[0][0].children().empty());
+        REQUIRE(mlp.results()[1][0].children().empty());
+
+        loss.set_gradient(1.0);
+        loss.backward();
+        REQUIRE(loss.children().empty());
+        double norm = 0;
+        for (const auto &parameter : mlp.parameters())
+        {
+            norm += std::fabs(parameter.reference()->gradient());
+        }
+        REQUIRE(norm > 0);
+        REQUIRE(mlp.forward(inputs).size() == 1);
+    }
+
+    SECTION("Test deferred materialization and checkpoints")
+    {
+        std::vector<double> inputs{2.0, 3.0, -1.0};
+        MLP deferred = MLP::deferred(3, std::vector<size_t>{4, 2});
+        REQUIRE_FALSE(deferred.materialized());
+        REQUIRE(deferred.parameters().empty());
+        REQUIRE(deferred.num_parameters() == 4 * 4 + 2 * 5);
+        REQUIRE_THROWS(deferred.predict(inputs));
+        REQUIRE(deferred.forward(inputs).size() == 2);
+        REQUIRE(deferred.materialized());
+        REQUIRE(deferred.parameters().size() == deferred.num_parameters());
+
+        MLP mlp(3, std::vector<size_t>{4, 2});
+        const std::string path =
+            "/tmp/tiny_nn_test_" + std::to_string(getpid()) + ".mlp";
+        mlp.save(path);
+        MLP loaded = MLP::load(path);
+        REQUIRE(loaded.materialized());
+        REQUIRE(loaded.n_in() == 3);
+        REQUIRE(loaded.n_outs() == std::vector<size_t>{4, 2});
+        REQUIRE(loaded.predict(inputs) == mlp.predict(inputs));
+
+        std::vector<double> values(mlp.num_parameters(), 0.5);
+        MLP filled = MLP::deferred(3, std::vector<size_t>{4, 2});
+        filled.materialize(values.data());
+        for (const auto &parameter : filled.parameters())
+        {
+            REQUIRE(parameter.reference()->value() == 0.5);
+        }
+        // Rebuilding the layers should first release the results of the
+        // last forward pass, which refer to the old parameters.
+        const std::vector<double> predicted = filled.predict(inputs);
+        filled.forward(inputs);
+        filled.materialize(values.data());
+        REQUIRE(filled.parameters().size() == filled.num_parameters());
+        REQUIRE(filled.predict(inputs) == predicted);
+
+        // Corrupt counts in the header, i.e. the number of layers and the
+        // width of the first layer, should be rejected, not allocated.
+        for (long position : {16L, 24L})
+        {
+            mlp.save(path);
+            std::FILE *corrupt = std::fopen(path.c_str(), "r+b");
+            const uint64_t count = uint64_t{1} << 60;
+            std::fseek(corrupt, position, SEEK_SET);
+            std::fwrite(&count, sizeof(count), 1, corrupt);
+            std::fclose(corrupt);
+            REQUIRE_THROWS_AS(MLP::load(path), std::runtime_error);
+        }
+
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        std::fputs("MLPB", file);
+        std::fclose(file);
+        REQUIRE_THROWS(MLP::load(path));
+        std::remove(path.c_str());
+        REQUIRE_THROWS(MLP::load(path));
+        REQUIRE_THROWS(MLP::deferred(3, std::vector<size_t>{1}).save(path));
+    }
 }
@@ -20,14 +20,11 @@ TEST_CASE("Test neuron", "[Neuron]")
         REQUIRE(result.gradient() == 0.0);
         result.set_gradient(1.0);
         REQUIRE(result.gradient() == 1.0);
-        REQUIRE(result.children().size() == 1);
-        const auto &child = result.children()[0];
-        REQUIRE(child.gradient() == 0.0);
-        REQUIRE(child.children().size() == 2);
+        REQUIRE(result.op() == "fused_neuron");
+        REQUIRE(result.children().size() == n_in + 1);
 
-        result.backward();
-        REQUIRE(child.gradient() ==
-                Approx(1.0 - result.value() * result.value()));
+        result.backward(true);
+        const double grad = 1.0 - result.value() * result.value();
         const std::vector<Variable> &parameters = neuron.parameters();
         const std::vector<Variable> &weights = neuron.weights();
         const Variable &bias = neuron.bias();
@@ -38,21 +35,22 @@ TEST_CASE("Test neuron", "[Neuron]")
             REQUIRE(parameters[i].reference() == &weights[i]);
         }
         REQUIRE(parameters[n_in].reference() == &bias);
+        REQUIRE(result.children()[n_in].reference() == &bias);
 
         for (size_t i = 0; i < n_in; i++)
         {
             REQUIRE(parameters[i].reference()->gradient() ==
-                    Approx(child.gradient() * input[i]));
+                    Approx(grad * input[i]));
         }
-        REQUIRE(neuron.bias().gradient() == Approx(child.gradient()));
+        REQUIRE(neuron.bias().gradient() == Approx(grad));
 
         for (std::vector<double>::size_type i = 0; i < n_in; i++)
         {
             REQUIRE(parameters[i].reference()->gradient() ==
-                    Approx(child.gradient() * input[i]));
+                    Approx(grad * input[i]));
         }
         REQUIRE(parameters[n_in].reference()->gradient() ==
-                Approx(child.gradient()));
+                Approx(grad));
     }
 
     SECTION("test variable")
@@ -68,15 +66,10 @@ TEST_CASE("Test neuron", "[Neuron]")
         REQUIRE(result.gradient() == 0.0);
         result.set_gradient(1.0);
         REQUIRE(result.gradient() == 1.0);
-        REQUIRE(result.children().size() == 1);
-        const auto &child = result.children()[0];
-        REQUIRE(child.gradient() == 0.0);
-        REQUIRE(child.children().size() == 2);
-        const auto &grandson = child.children()[0];
-        REQUIRE(grandson.children().size() == 2 * n_in);
-        result.backward();
-        REQUIRE(child.gradient() ==
-                Approx(1.0 - result.value() * result.value()));
+        REQUIRE(result.op() == "fused_neuron");
+        REQUIRE(result.children().size() == 2 * n_in + 1);
+        result.backward(true);
+        const double grad = 1.0 - result.value() * result.value();
         std::vector<Variable> parameters = neuron.parameters();
 
         // parameters check
@@ -90,19 +83,20 @@ TEST_CASE("Test neuron", "[Neuron]")
         // reference check
         for (size_t i = 0; i < n_in; i++)
         {
-            REQUIRE(grandson.children()[i].reference() == &neuron.weights()[i]);
-            REQUIRE(grandson.children()[i + n_in].reference() == &input[i]);
+            REQUIRE(result.children()[i].reference() == &neuron.weights()[i]);
+            REQUIRE(result.children()[i + n_in].reference() == &input[i]);
         }
+        REQUIRE(result.children()[2 * n_in].reference() == &neuron.bias());
 
         // gradient check
         for (size_t i = 0; i < n_in; i++)
         {
             REQUIRE(parameters[i].reference()->gradient() ==
-                    Approx(child.gradient() * input[i].value()));
+                    Approx(grad * input[i].value()));
             REQUIRE(input[i].gradient() ==
-                    Approx(child.gradient() * parameters[i].value()));
+                    Approx(grad * parameters[i].value()));
         }
         REQUIRE(parameters[n_in].reference()->gradient() ==
-                Approx(child.gradient()));
+                Approx(grad));
     }
 }
@@ -0,0 +1,103 @@
+#include "execution_plan.h"
+#include "numa.h"
+#include "parallel.h"
+#include <catch2/catch.hpp>
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdint>
+
+
+TEST_CASE("Test NUMA placement", "[NUMA]")
+{
+    SECTION("Test topology and CPU assignment")
+    {
+        CpuTopology detected = CpuTopology::detect();
+        REQUIRE(detected.num_cpus() > 0);
+        REQUIRE(detected.node_ids.size() == detected.nodes.size());
+        REQUIRE(std::is_sorted(detected.node_ids.begin(),
+                               detected.node_ids.end()));
+        REQUIRE(std::adjacent_find(detected.node_ids.begin(),
+                                   detected.node_ids.end()) ==
+                detected.node_ids.end());
+
+        CpuTopology topology;
+        topology.nodes = {{0, 1, 2}, {4, 5}};
+        REQUIRE(assign_cpus(topology, 4, PinningPolicy::Compact) ==
+                std::vector<int>{0, 1, 2, 4});
+        REQUIRE(assign_cpus(topology, 6, PinningPolicy::Scatter) ==
+                std::vector<int>{0, 4, 1, 5, 2, 0});
+        REQUIRE(assign_cpus(topology, 2, PinningPolicy::None) ==
+                std::vector<int>{-1, -1});
+        REQUIRE(assign_cpus(CpuTopology{}, 1, PinningPolicy::Compact) ==
+                std::vector<int>{-1});
+    }
+
+    SECTION("Test pinned thread pool")
+    {
+        const CpuTopology topology = CpuTopology::detect();
+        const int cpu = topology.nodes.front().front();
+        ThreadPool pool(2, PinningPolicy::Compact, topology);
+        REQUIRE(pool.size() == 2);
+        REQUIRE(pool.cpus().front() == cpu);
+
+        std::vector<int> seen(pool.size(), -1);
+        pool.run_on_each([&seen](size_t index) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            sched_getaffinity(0, sizeof(set), &set);
+            seen[index] = CPU_COUNT(&set) == 1 ? sched_getcpu() : -1;
+        });
+        REQUIRE(seen == pool.cpus());
+        REQUIRE(pool.worker_index() == pool.size());
+
+        std::vector<double> buffer(10000, 1.0);
+        first_touch(pool, buffer.data(), buffer.size() * sizeof(double));
+        for (double value : buffer)
+        {
+            REQUIRE(value == 0.0);
+        }
+    }
+
+    SECTION("Test mappings and arenas")
+    {
+        MemoryOptions options;
+        options.huge_pages = HugePages::Explicit;
+        options.numa_policy = NumaPolicy::Interleave;
+        REQUIRE(mapping_size(1, options) == size_t{2} << 20);
+
+        // Without reserved hugepages the arena falls back to THP or pages.
+        Arena arena(1000, options);
+        REQUIRE(arena.capacity() == size_t{2} << 20);
+        double *values = arena.allocate_array<double>(100);
+        REQUIRE(reinterpret_cast<uintptr_t>(values) % alignof(double) == 0);
+        REQUIRE(values[99] == 0.0);
+        void *aligned = arena.allocate(1, 64);
+        REQUIRE(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+        REQUIRE(arena.used() == 833);
+        REQUIRE_THROWS_AS(arena.allocate(arena.capacity()), std::bad_alloc);
+        arena.reset();
+        REQUIRE(arena.used() == 0);
+
+        Arena small(1);
+        REQUIRE(small.huge_pages() == HugePages::None);
+        REQUIRE(*small.create<int>(7) == 7);
+    }
+
+    SECTION("Test execution plan on mapped memory")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 2});
+        std::vector<double> inputs{2.0, 3.0, -1.0};
+        std::vector<double> targets{1.0, -0.5};
+        ExecutionPlan plan(mlp, targets.size());
+        const double expected = plan.replay(inputs, targets);
+
+        MemoryOptions options;
+        options.huge_pages = HugePages::Transparent;
+        options.numa_policy = NumaPolicy::Interleave;
+        plan.set_memory_options(options);
+        plan.capture(mlp, targets.size());
+        REQUIRE(plan.replay(inputs, targets) == Approx(expected));
+    }
+}
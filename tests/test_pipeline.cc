@@ -0,0 +1,136 @@
+#include "pipeline.h"
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+
+namespace
+{
+void copy_parameters(const MLP &from, MLP &to)
+{
+    for (size_t i = 0; i < from.parameters().size(); i++)
+    {
+        const double value = from.parameters()[i].reference()->value();
+        to.mutable_parameters()[i].set_value(value);
+        to.mutable_parameters()[i].reference()->set_value(value);
+    }
+}
+
+
+// Returns records "x0,x1,x2,target" for a fixed dataset.
+std::function<std::optional<std::string>()> make_reader(size_t n)
+{
+    return [n, i = size_t{0}]() mutable -> std::optional<std::string> {
+        if (i == n)
+        {
+            return std::nullopt;
+        }
+        const double x = static_cast<double>(i++) / static_cast<double>(n);
+        std::ostringstream record;
+        record << x << ',' << 1 - x << ',' << x * x << ',' << x - 0.5;
+        return record.str();
+    };
+}
+
+
+Sample decode_record(const std::string &record)
+{
+    Sample sample;
+    std::istringstream stream(record);
+    std::string field;
+    while (std::getline(stream, field, ','))
+    {
+        sample.inputs.push_back(std::stod(field));
+    }
+    sample.targets.push_back(sample.inputs.back());
+    sample.inputs.pop_back();
+    return sample;
+}
+
+
+Task<int> add(int a, int b)
+{
+    co_return a + b;
+}
+
+
+Task<void> produce(Channel<int> &channel, int n)
+{
+    for (int i = 1; i <= n; i++)
+    {
+        co_await channel.send(co_await add(i, 0));
+    }
+    channel.close();
+}
+
+
+Task<void> consume(Channel<int> &channel, long &sum)
+{
+    while (std::optional<int> value = co_await channel.receive())
+    {
+        sum += *value;
+    }
+}
+} // namespace
+
+
+TEST_CASE("Test coroutine pipeline", "[Pipeline]")
+{
+    Executor executor(2);
+
+    SECTION("Test tasks and channels")
+    {
+        Channel<int> channel(executor, 2);
+        long sum = 0;
+        std::vector<Task<void>> tasks;
+        tasks.push_back(produce(channel, 100));
+        tasks.push_back(consume(channel, sum));
+        run_all(executor, std::move(tasks));
+        REQUIRE(sum == 5050);
+        REQUIRE_THROWS(Channel<int>(executor, 0));
+    }
+
+    SECTION("Test pipelined training matches synchronous training")
+    {
+        MLP pipelined(3, std::vector<size_t>{4, 1});
+        MLP synchronous(3, std::vector<size_t>{4, 1});
+        copy_parameters(pipelined, synchronous);
+
+        PipelineOptions options;
+        options.batch_size = 4;
+        options.channel_capacity = 3;
+        PipelineStats stats = train_pipelined(
+            pipelined, executor, make_reader(30), decode_record, options);
+        PipelineStats expected = train_synchronous(
+            synchronous, make_reader(30), decode_record, options);
+
+        REQUIRE(stats.samples == 30);
+        REQUIRE(stats.batches == 8);
+        REQUIRE(stats.loss == Approx(expected.loss));
+        for (size_t i = 0; i < pipelined.parameters().size(); i++)
+        {
+            REQUIRE(pipelined.parameters()[i].reference()->value() ==
+                    Approx(synchronous.parameters()[i].reference()->value()));
+        }
+    }
+
+    SECTION("Test a failing stage stops the pipeline")
+    {
+        MLP mlp(3, std::vector<size_t>{2, 1});
+        size_t decoded = 0;
+        PipelineOptions options;
+        options.channel_capacity = 1;
+        REQUIRE_THROWS(train_pipelined(
+            mlp,
+            executor,
+            make_reader(100),
+            [&decoded](const std::string &record) {
+                if (++decoded == 10)
+                {
+                    throw std::runtime_error("bad record");
+                }
+                return decode_record(record);
+            },
+            options));
+    }
+}
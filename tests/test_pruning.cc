@@ -0,0 +1,172 @@
+#include "loss.h"
+#include "pruning.h"
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+// Returns the fraction of zero weights of each layer.
+std::vector<double> layer_sparsity(const MLP &mlp)
+{
+    std::vector<double> sparsity;
+    for (const auto &layer : mlp.layers())
+    {
+        size_t zeros = 0;
+        for (const auto &neuron : layer.neurons())
+        {
+            for (const auto &weight : neuron.weights())
+            {
+                zeros += weight.value() == 0 ? 1 : 0;
+            }
+        }
+        sparsity.push_back(static_cast<double>(zeros) /
+                           static_cast<double>(layer.n_in() * layer.n_out()));
+    }
+    return sparsity;
+}
+} // namespace
+
+
+TEST_CASE("Test magnitude pruning", "[Pruning]")
+{
+    MLP mlp(8, std::vector<size_t>{16, 8, 2});
+    std::vector<double> inputs{0.1, -0.2, 0.3, -0.4, 0.5, -0.6, 0.7, -0.8};
+
+    SECTION("Test per-layer pruning")
+    {
+        double smallest_kept = 1e9;
+        const double largest_pruned = [&mlp]() {
+            std::vector<double> magnitudes;
+            for (const auto &neuron : mlp.layers()[0].neurons())
+            {
+                for (const auto &weight : neuron.weights())
+                {
+                    magnitudes.push_back(std::fabs(weight.value()));
+                }
+            }
+            std::sort(magnitudes.begin(), magnitudes.end());
+            return magnitudes[magnitudes.size() / 2 - 1];
+        }();
+
+        PruningMask mask = magnitude_prune(mlp, 0.5);
+        REQUIRE(mask.keep.size() == mlp.parameters().size());
+        for (double sparsity : layer_sparsity(mlp))
+        {
+            REQUIRE(sparsity == Approx(0.5));
+        }
+        for (const auto &neuron : mlp.layers()[0].neurons())
+        {
+            REQUIRE(neuron.bias().value() != 0);
+            for (const auto &weight : neuron.weights())
+            {
+                if (weight.value() != 0)
+                {
+                    smallest_kept =
+                        std::min(smallest_kept, std::fabs(weight.value()));
+                }
+            }
+        }
+        REQUIRE(smallest_kept >= largest_pruned);
+        REQUIRE_THROWS(magnitude_prune(mlp, 1.5));
+    }
+
+    SECTION("Test global pruning")
+    {
+        PruningMask mask = magnitude_prune(mlp, 0.75, PruningScope::Global);
+        size_t zeros = 0;
+        size_t weights = 0;
+        for (const auto &layer : mlp.layers())
+        {
+            weights += layer.n_in() * layer.n_out();
+        }
+        for (size_t i = 0; i < mask.keep.size(); i++)
+        {
+            zeros += mask.keep[i] ? 0 : 1;
+            if (!mask.keep[i])
+            {
+                REQUIRE(mlp.parameters()[i].reference()->value() == 0);
+            }
+        }
+        REQUIRE(zeros == weights * 3 / 4);
+        REQUIRE(mask.sparsity() ==
+                Approx(static_cast<double>(zeros) /
+                       static_cast<double>(mask.keep.size())));
+    }
+
+    SECTION("Test pruning schedule")
+    {
+        PruningSchedule schedule(0.0, 0.8, 5);
+        REQUIRE(schedule.sparsity(0) == Approx(0.0));
+        REQUIRE(schedule.sparsity(2) == Approx(0.8 - 0.8 * 0.125));
+        REQUIRE(schedule.sparsity(4) == Approx(0.8));
+        REQUIRE(schedule.sparsity(1) < schedule.sparsity(2));
+        REQUIRE_THROWS(PruningSchedule(0.5, 0.2, 5));
+        REQUIRE_THROWS(PruningSchedule(0.0, 0.5, 0));
+    }
+
+    SECTION("Test pruning with fine-tuning")
+    {
+        std::vector<double> targets{0.5, -0.5};
+        PruningSchedule schedule(0.2, 0.8, 4);
+        size_t calls = 0;
+        PruningMask mask = prune_and_finetune(
+            mlp, schedule, [&](MLP &model, const PruningMask &current) {
+                for (int epoch = 0; epoch < 5; epoch++)
+                {
+                    for (auto &parameter : model.mutable_parameters())
+                    {
+                        parameter.zero_grad();
+                    }
+                    Variable loss = MSELoss(model.forward(inputs), targets);
+                    loss.set_gradient(1.0);
+                    loss.backward();
+                    for (auto &parameter : model.mutable_parameters())
+                    {
+                        parameter.gradient_descent(0.05);
+                    }
+                    apply_mask(model, current);
+                }
+                calls++;
+            });
+        REQUIRE(calls == 4);
+        for (double sparsity : layer_sparsity(mlp))
+        {
+            REQUIRE(sparsity >= 0.75);
+        }
+        for (size_t i = 0; i < mask.keep.size(); i++)
+        {
+            if (!mask.keep[i])
+            {
+                REQUIRE(mlp.parameters()[i].reference()->value() == 0);
+            }
+        }
+        REQUIRE_THROWS(apply_mask(mlp, PruningMask{}));
+    }
+
+    SECTION("Test sparse inference")
+    {
+        magnitude_prune(mlp, 0.9);
+        SparseMLP sparse(mlp);
+        REQUIRE(sparse.layers().size() == 3);
+        REQUIRE(sparse.nnz() < (8 * 16 + 16 * 8 + 8 * 2) / 5);
+        REQUIRE(sparse.size_bytes() <
+                mlp.parameters().size() * sizeof(double) / 2);
+
+        std::vector<double> expected = mlp.predict(inputs);
+        std::vector<double> outputs = sparse.predict(inputs);
+        REQUIRE(outputs.size() == 2);
+        REQUIRE(outputs[0] == Approx(expected[0]));
+        REQUIRE(outputs[1] == Approx(expected[1]));
+
+        std::vector<std::vector<double>> batch{inputs,
+                                               std::vector<double>(8, 0.5)};
+        std::vector<std::vector<double>> rows = sparse.predict(batch);
+        REQUIRE(rows.size() == 2);
+        REQUIRE(rows[0][0] == Approx(expected[0]));
+        REQUIRE(rows[1][1] == Approx(sparse.predict(batch[1])[1]));
+        REQUIRE_THROWS(sparse.predict(std::vector<double>(7, 0.0)));
+    }
+}
@@ -0,0 +1,77 @@
+#include "determinism.h"
+#include "quantization.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Test quantization", "[Quantization]")
+{
+    SeedScope scope(26);
+    std::vector<std::vector<double>> dataset(32, std::vector<double>(8));
+    for (size_t i = 0; i < dataset.size(); ++i)
+    {
+        for (size_t j = 0; j < dataset[i].size(); ++j)
+        {
+            dataset[i][j] =
+                static_cast<double>((i * 7 + j * 3) % 11) / 5.0 - 1.0;
+        }
+    }
+
+    SECTION("Test per channel quantization")
+    {
+        MLP mlp(8, std::vector<size_t>{16, 16, 2});
+        QuantizedMLP quantized(mlp, dataset);
+        REQUIRE(quantized.layers().size() == 3);
+        REQUIRE(quantized.layers()[0].n_in == 8);
+        REQUIRE(quantized.layers()[0].n_out == 16);
+        REQUIRE(quantized.layers()[0].weights.size() == 16 * 8);
+        REQUIRE(quantized.layers()[1].input_scale ==
+                quantized.layers()[0].output_scale);
+
+        QuantizationReport report = quantized.evaluate(mlp, dataset);
+        REQUIRE(report.num_samples == dataset.size());
+        REQUIRE(report.max_abs_error < 0.1);
+        REQUIRE(report.mean_abs_error <= report.max_abs_error);
+        REQUIRE(report.float_bytes == mlp.parameters().size() * sizeof(double));
+        REQUIRE(report.quantized_bytes == quantized.size_bytes());
+    }
+
+    SECTION("Test per layer quantization")
+    {
+        MLP mlp(8, std::vector<size_t>{4, 1});
+        QuantizedMLP quantized(mlp, dataset, QuantizationGranularity::PerLayer);
+        const auto &scales = quantized.layers()[0].weight_scales;
+        for (size_t i = 1; i < scales.size(); ++i)
+        {
+            REQUIRE(scales[i] == scales[0]);
+        }
+        REQUIRE(quantized.evaluate(mlp, dataset).max_abs_error < 0.1);
+    }
+
+    SECTION("Test batch forward")
+    {
+        MLP mlp(8, std::vector<size_t>{4, 3});
+        QuantizedMLP quantized(mlp, dataset);
+        std::vector<std::vector<double>> outputs = quantized.forward(dataset);
+        REQUIRE(outputs.size() == dataset.size());
+        for (size_t i = 0; i < dataset.size(); ++i)
+        {
+            REQUIRE(outputs[i] == quantized.forward(dataset[i]));
+        }
+    }
+
+    SECTION("Test model size")
+    {
+        MLP mlp(64, std::vector<size_t>{32, 1});
+        std::vector<std::vector<double>> inputs(4,
+                                                std::vector<double>(64, 0.5));
+        QuantizedMLP quantized(mlp, inputs);
+        REQUIRE(quantized.size_bytes() * 4 <
+                mlp.parameters().size() * sizeof(double));
+    }
+
+    SECTION("Test invalid calibration data")
+    {
+        MLP mlp(8, std::vector<size_t>{1});
+        REQUIRE_THROWS(QuantizedMLP(mlp, {}));
+        REQUIRE_THROWS(QuantizedMLP(mlp, {std::vector<double>(3)}));
+    }
+}
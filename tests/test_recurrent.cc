@@ -0,0 +1,264 @@
+#include "determinism.h"
+#include "loss.h"
+#include "recurrent.h"
+#include <catch2/catch.hpp>
+#include <cmath>
+
+
+namespace
+{
+std::vector<std::vector<double>> sequence(size_t n_steps, size_t n_in)
+{
+    std::vector<std::vector<double>> steps(n_steps, std::vector<double>(n_in));
+    for (size_t t = 0; t < n_steps; t++)
+    {
+        for (size_t i = 0; i < n_in; i++)
+        {
+            steps[t][i] = std::sin(0.9 * static_cast<double>(t) +
+                                   1.7 * static_cast<double>(i));
+        }
+    }
+    return steps;
+}
+
+
+// The sum of the squared errors, whose gradient MSELoss computes since it
+// does not scale its gradient by 1 / n.
+double squared_error(const std::vector<std::vector<double>> &outputs,
+                     const std::vector<double> &targets)
+{
+    double sum = 0;
+    size_t k = 0;
+    for (const auto &step : outputs)
+    {
+        for (const double output : step)
+        {
+            sum += (output - targets[k]) * (output - targets[k]);
+            k++;
+        }
+    }
+    return sum;
+}
+
+
+template <typename Cell> void check_gradients()
+{
+    Cell layer(2, 3);
+    const auto inputs = sequence(5, 2);
+    std::vector<double> targets(5 * 3);
+    for (size_t k = 0; k < targets.size(); k++)
+    {
+        targets[k] = 0.1 * static_cast<double>(k % 4) - 0.2;
+    }
+
+    const std::vector<std::vector<Variable>> outputs = layer.forward(inputs);
+    const std::vector<std::vector<double>> predicted = layer.predict(inputs);
+    std::vector<Variable> flat;
+    flat.reserve(targets.size());
+    for (size_t t = 0; t < outputs.size(); t++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            REQUIRE(outputs[t][j].value() == Approx(predicted[t][j]));
+            flat.push_back(outputs[t][j]);
+        }
+    }
+    REQUIRE(layer.num_kept_steps() == 5);
+    Variable loss = MSELoss(flat, targets);
+    loss.set_gradient(1.0);
+    loss.backward();
+    layer.backward();
+    REQUIRE(layer.num_kept_steps() == 0);
+
+    const double h = 1e-6;
+    for (size_t i = 0; i < layer.parameters().size(); i += 2)
+    {
+        Variable *parameter = layer.parameters()[i].reference();
+        const double value = parameter->value();
+        parameter->set_value(value + h);
+        const double plus = squared_error(layer.predict(inputs), targets);
+        parameter->set_value(value - h);
+        const double minus = squared_error(layer.predict(inputs), targets);
+        parameter->set_value(value);
+        REQUIRE(parameter->gradient() ==
+                Approx((plus - minus) / (2 * h)).margin(1e-6));
+    }
+}
+} // namespace
+
+
+TEST_CASE("Test recurrent layers", "[Recurrent]")
+{
+    set_seed(13);
+
+    SECTION("Test backpropagation through time")
+    {
+        check_gradients<RNN>();
+        check_gradients<GRU>();
+        check_gradients<LSTM>();
+        REQUIRE_THROWS_AS(RNN(0, 3), std::invalid_argument);
+    }
+
+    SECTION("Test streaming and carried state")
+    {
+        LSTM layer(2, 4);
+        REQUIRE(layer.parameters().size() == 4 * 4 * (2 + 4 + 1));
+        REQUIRE(layer.state().size() == 8);
+        const auto inputs = sequence(6, 2);
+        const auto predicted = layer.predict(inputs);
+        for (size_t t = 0; t < inputs.size(); t++)
+        {
+            const std::vector<double> hidden = layer.step(inputs[t]);
+            for (size_t j = 0; j < 4; j++)
+            {
+                REQUIRE(hidden[j] == Approx(predicted[t][j]));
+            }
+        }
+
+        // Two windows of a sequence continue from the carried state.
+        layer.reset_state();
+        const std::vector<std::vector<double>> first(inputs.begin(),
+                                                     inputs.begin() + 3);
+        const std::vector<std::vector<double>> second(inputs.begin() + 3,
+                                                      inputs.end());
+        layer.forward(first);
+        const auto outputs = layer.forward(second);
+        for (size_t t = 0; t < second.size(); t++)
+        {
+            for (size_t j = 0; j < 4; j++)
+            {
+                REQUIRE(outputs[t][j].value() ==
+                        Approx(predicted[3 + t][j]));
+            }
+        }
+
+        // A stream reuses its packed parameters until they are dropped.
+        layer.reset_state();
+        layer.step(inputs[0]);
+        const std::vector<double> state = layer.state();
+        Variable *bias = layer.parameters().back().reference();
+        bias->set_value(bias->value() + 0.5);
+        layer.invalidate_weights();
+        const std::vector<double> hidden = layer.step(inputs[1]);
+        layer.set_state(state);
+        REQUIRE(layer.step(inputs[1]) == hidden);
+
+        REQUIRE_THROWS_AS(layer.step({1.0}), std::runtime_error);
+        REQUIRE_THROWS_AS(layer.forward({{1.0, 2.0}, {1.0}}),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(layer.set_state({0.0}), std::invalid_argument);
+    }
+
+    SECTION("Test truncated backpropagation")
+    {
+        GRU layer(2, 3, 2);
+        const auto inputs = sequence(6, 2);
+        const std::vector<double> targets{0.3, -0.1, 0.2};
+        const auto outputs = layer.forward(inputs);
+        REQUIRE(layer.num_kept_steps() == 2);
+        Variable loss = MSELoss(outputs.back(), targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+        layer.backward();
+
+        // Only the last two steps are differentiated, from a fixed state.
+        layer.reset_state();
+        for (size_t t = 0; t < 4; t++)
+        {
+            layer.step(inputs[t]);
+        }
+        const std::vector<double> state = layer.state();
+        const auto last_output = [&]() {
+            layer.set_state(state);
+            layer.step(inputs[4]);
+            return squared_error({layer.step(inputs[5])}, targets);
+        };
+        const double h = 1e-6;
+        for (size_t i = 0; i < layer.parameters().size(); i += 3)
+        {
+            Variable *parameter = layer.parameters()[i].reference();
+            const double value = parameter->value();
+            parameter->set_value(value + h);
+            const double plus = last_output();
+            parameter->set_value(value - h);
+            const double minus = last_output();
+            parameter->set_value(value);
+            REQUIRE(parameter->gradient() ==
+                    Approx((plus - minus) / (2 * h)).margin(1e-6));
+        }
+    }
+
+    SECTION("Test the graph is bounded by the window")
+    {
+        // Only the state before the kept steps and after each of them is
+        // held, so the outputs of the released steps are plain values.
+        GRU layer(2, 3, 2);
+        const auto inputs = sequence(300, 2);
+        const auto outputs = layer.forward(inputs);
+        REQUIRE(layer.num_kept_steps() == 2);
+        for (size_t t = 0; t + 3 < outputs.size(); t++)
+        {
+            REQUIRE(outputs[t][0].reference() == nullptr);
+        }
+        for (size_t t = outputs.size() - 3; t < outputs.size(); t++)
+        {
+            REQUIRE(outputs[t][0].reference() != nullptr);
+        }
+        const auto predicted = layer.predict(inputs);
+        REQUIRE(outputs.front()[1].value() == Approx(predicted.front()[1]));
+        REQUIRE(outputs.back()[1].value() == Approx(predicted.back()[1]));
+
+        std::vector<Variable> flat;
+        for (const auto &output : outputs)
+        {
+            flat.insert(flat.end(), output.begin(), output.end());
+        }
+        Variable loss = MSELoss(flat, std::vector<double>(flat.size(), 0.0));
+        loss.set_gradient(1.0);
+        loss.backward();
+        layer.backward();
+        REQUIRE(layer.num_kept_steps() == 0);
+    }
+
+    SECTION("Test training")
+    {
+        // The first hidden unit learns to recall the previous input.
+        LSTM layer(1, 4, 8);
+        std::vector<std::vector<double>> inputs;
+        std::vector<double> targets;
+        for (size_t t = 0; t < 8; t++)
+        {
+            inputs.push_back({std::sin(1.3 * static_cast<double>(t))});
+            targets.push_back(t == 0 ? 0.0 : 0.5 * inputs[t - 1][0]);
+        }
+        double first_loss = 0;
+        double last_loss = 0;
+        for (size_t epoch = 0; epoch < 200; epoch++)
+        {
+            layer.reset_state();
+            const auto outputs = layer.forward(inputs);
+            std::vector<Variable> recalled;
+            recalled.reserve(outputs.size());
+            for (const auto &output : outputs)
+            {
+                recalled.push_back(output[0]);
+            }
+            Variable loss = MSELoss(recalled, targets);
+            (epoch == 0 ? first_loss : last_loss) = loss.value();
+            for (const auto &parameter : layer.parameters())
+            {
+                parameter.reference()->zero_grad();
+            }
+            loss.set_gradient(1.0);
+            loss.backward();
+            layer.backward();
+            for (const auto &parameter : layer.parameters())
+            {
+                parameter.reference()->gradient_descent(0.05);
+            }
+        }
+        REQUIRE(last_loss < first_loss / 4);
+    }
+
+    set_deterministic(false);
+}
@@ -0,0 +1,134 @@
+#include "loss.h"
+#include "mlp.h"
+#include "scheduler.h"
+#include <catch2/catch.hpp>
+
+
+namespace
+{
+void zero_grad(MLP &mlp)
+{
+    for (auto &parameter : mlp.mutable_parameters())
+    {
+        parameter.zero_grad();
+    }
+}
+
+
+std::vector<double> gradients(const MLP &mlp)
+{
+    std::vector<double> result;
+    for (const auto &parameter : mlp.parameters())
+    {
+        result.push_back(parameter.reference()->gradient());
+    }
+    return result;
+}
+
+
+// Counts the nodes of a recursive task tree of the given depth.
+void count_nodes(WorkStealingPool &pool,
+                 size_t depth,
+                 std::atomic<size_t> &count,
+                 std::atomic<size_t> &pending)
+{
+    count++;
+    if (depth > 0)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            pending++;
+            pool.submit([&pool, depth, &count, &pending]() {
+                count_nodes(pool, depth - 1, count, pending);
+            });
+        }
+    }
+    pending--;
+}
+} // namespace
+
+
+TEST_CASE("Test parallel backward", "[Scheduler]")
+{
+    WorkStealingPool pool(4);
+    std::vector<double> inputs{0.5, -1.0, 2.0};
+    std::vector<double> targets{0.25, -0.5};
+
+    SECTION("Test work-stealing pool")
+    {
+        REQUIRE(pool.size() == 4);
+        REQUIRE(pool.worker_index() == pool.size());
+        REQUIRE(pool.local_size() == 0);
+
+        std::atomic<size_t> count{0};
+        std::atomic<size_t> pending{1};
+        pool.submit([&]() { count_nodes(pool, 10, count, pending); });
+        while (pending > 0)
+        {
+            std::this_thread::yield();
+        }
+        REQUIRE(count == (size_t{1} << 11) - 1);
+    }
+
+    SECTION("Test gradients match the serial backward pass")
+    {
+        MLP mlp(3, std::vector<size_t>{6, 5, 2});
+        zero_grad(mlp);
+        Variable loss = MSELoss(mlp.forward(inputs), targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+        const std::vector<double> expected = gradients(mlp);
+
+        for (int run = 0; run < 3; run++)
+        {
+            zero_grad(mlp);
+            Variable parallel_loss = MSELoss(mlp.forward(inputs), targets);
+            parallel_loss.set_gradient(1.0);
+            parallel_backward(parallel_loss, pool);
+            REQUIRE(parallel_loss.children().empty());
+
+            const std::vector<double> actual = gradients(mlp);
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                REQUIRE(actual[i] == Approx(expected[i]));
+            }
+        }
+    }
+
+    SECTION("Test graphs of small nodes and retained graphs")
+    {
+        Variable x(0.5);
+        Variable y(-2.0);
+        Variable sum(0.0);
+        for (int i = 0; i < 200; i++)
+        {
+            sum = sum + x * y + x.sin();
+        }
+        sum.set_gradient(1.0);
+        parallel_backward(sum, pool, true);
+        REQUIRE(x.gradient() == Approx(200 * (-2.0 + std::cos(0.5))));
+        REQUIRE(y.gradient() == Approx(200 * 0.5));
+        REQUIRE_FALSE(sum.children().empty());
+
+        Variable leaf(3.0);
+        leaf.set_gradient(1.0);
+        parallel_backward(leaf, pool);
+        REQUIRE(leaf.gradient() == 1.0);
+    }
+
+    SECTION("Test many short-lived passes")
+    {
+        // Each pass owns a task group that is destroyed as soon as it has
+        // waited for its tasks, while workers may still be finishing them.
+        Variable x(0.5);
+        Variable y(-2.0);
+        for (int run = 0; run < 2000; run++)
+        {
+            Variable sum = x * y + (x + y) * x + y.sin();
+            sum.set_gradient(1.0);
+            parallel_backward(sum, pool);
+        }
+        REQUIRE(x.gradient() == Approx(2000 * (-2.0 + 2 * 0.5 - 2.0)));
+        REQUIRE(y.gradient() == Approx(2000 * (0.5 + 0.5 + std::cos(-2.0))));
+    }
+}
@@ -0,0 +1,211 @@
+#include "serving.h"
+#include <catch2/catch.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+TEST_CASE("Test inference serving", "[Serving]")
+{
+    MLP mlp(3, std::vector<size_t>{8, 2});
+    std::vector<std::vector<double>> inputs{
+        {0.1, 0.2, 0.3}, {-0.5, 0.4, 0.0}, {1.0, -1.0, 0.5}, {0.0, 0.0, 0.0}};
+
+    SECTION("Test lock-free queue")
+    {
+        MPMCQueue<int> queue(4);
+        for (int i = 0; i < 4; i++)
+        {
+            REQUIRE(queue.try_push(i));
+        }
+        int value = 4;
+        REQUIRE_FALSE(queue.try_push(value));
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == 0);
+        REQUIRE(queue.try_push(value));
+        REQUIRE_THROWS(MPMCQueue<int>(6));
+
+        // Producers and consumers on several threads see every value once.
+        MPMCQueue<int> shared(64);
+        std::atomic<long> sum{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; t++)
+        {
+            threads.emplace_back([&shared, t]() {
+                for (int i = 1; i <= 1000; i++)
+                {
+                    int item = t * 1000 + i;
+                    while (!shared.try_push(item))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&shared, &sum]() {
+                for (int i = 0; i < 1000; i++)
+                {
+                    int item = 0;
+                    while (!shared.try_pop(item))
+                    {
+                        std::this_thread::yield();
+                    }
+                    sum += item;
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        REQUIRE(sum == 2000L * 2001L / 2);
+    }
+
+    SECTION("Test latency histogram and thread pool")
+    {
+        LatencyHistogram histogram;
+        REQUIRE(histogram.percentile(50).count() == 0);
+        for (int i = 1; i <= 100; i++)
+        {
+            histogram.record(std::chrono::microseconds(i));
+        }
+        REQUIRE(histogram.count() == 100);
+        REQUIRE(histogram.mean() == std::chrono::nanoseconds(50500));
+        const auto p50 = static_cast<double>(histogram.percentile(50).count());
+        const auto p99 = static_cast<double>(histogram.percentile(99).count());
+        REQUIRE(p50 >= 50000);
+        REQUIRE(p50 <= 50000 * 1.125);
+        REQUIRE(p99 >= 99000);
+        REQUIRE(p99 <= 99000 * 1.125);
+        REQUIRE_THROWS(histogram.percentile(101));
+        histogram.reset();
+        REQUIRE(histogram.count() == 0);
+
+        ThreadPool pool(2);
+        REQUIRE(pool.size() == 2);
+        std::atomic<int> done{0};
+        std::vector<std::future<void>> tasks;
+        for (int i = 0; i < 10; i++)
+        {
+            tasks.push_back(pool.submit([&done]() { done++; }));
+        }
+        for (auto &task : tasks)
+        {
+            task.get();
+        }
+        REQUIRE(done == 10);
+        REQUIRE_THROWS(
+            pool.submit([]() { throw std::runtime_error("failed task"); })
+                .get());
+    }
+
+    SECTION("Test batched inference matches predict")
+    {
+        ServerOptions options;
+        options.max_batch_size = 4;
+        options.max_wait = std::chrono::milliseconds(50);
+        options.num_workers = 2;
+        InferenceServer server(mlp, options);
+        std::vector<std::future<std::vector<double>>> results;
+        for (const auto &sample : inputs)
+        {
+            results.push_back(server.submit(sample));
+        }
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            std::vector<double> outputs = results[i].get();
+            std::vector<double> expected = mlp.predict(inputs[i]);
+            REQUIRE(outputs.size() == 2);
+            REQUIRE(outputs[0] == Approx(expected[0]));
+            REQUIRE(outputs[1] == Approx(expected[1]));
+        }
+        REQUIRE(server.requests().count() == 4);
+        REQUIRE(server.batches().count() < 4);
+        REQUIRE(server.latency().count() == 4);
+        REQUIRE_THROWS(server.submit({1.0}));
+
+        server.stop();
+        REQUIRE_THROWS(server.submit(inputs[0]));
+        REQUIRE_THROWS(InferenceServer(mlp, ServerOptions{0}));
+    }
+
+    SECTION("Test submissions racing stop")
+    {
+        for (int run = 0; run < 20; run++)
+        {
+            InferenceServer server(mlp);
+            std::vector<std::future<std::vector<double>>> results;
+            std::thread client([&server, &results, &inputs]() {
+                for (int i = 0; i < 200; i++)
+                {
+                    try
+                    {
+                        results.push_back(server.submit(inputs[0]));
+                    }
+                    catch (const std::runtime_error &)
+                    {
+                    }
+                }
+            });
+            server.stop();
+            client.join();
+            // Every queued request is answered or failed by stop.
+            for (auto &result : results)
+            {
+                REQUIRE(result.wait_for(std::chrono::seconds(0)) ==
+                        std::future_status::ready);
+            }
+            REQUIRE_THROWS_AS(server.submit(inputs[0]), std::runtime_error);
+        }
+    }
+
+    SECTION("Test socket front ends")
+    {
+        InferenceServer server(mlp);
+        const std::string path =
+            "/tmp/tiny_nn_test_" + std::to_string(getpid()) + ".sock";
+        SocketServer unix_server(server, path);
+        unix_server.start();
+        SocketServer tcp_server(server, uint16_t{0});
+        tcp_server.start();
+        REQUIRE(tcp_server.port() != 0);
+
+        InferenceClient unix_client(path);
+        InferenceClient tcp_client(tcp_server.port());
+        std::vector<double> expected = mlp.predict(inputs[2]);
+        std::vector<double> outputs = unix_client.predict(inputs[2]);
+        REQUIRE(outputs.size() == 2);
+        REQUIRE(outputs[1] == Approx(expected[1]));
+        outputs = tcp_client.predict(inputs[2]);
+        REQUIRE(outputs[0] == Approx(expected[0]));
+        REQUIRE_THROWS(tcp_client.predict({1.0, 2.0}));
+        outputs = tcp_client.predict(inputs[2]);
+        REQUIRE(outputs[0] == Approx(expected[0]));
+
+        // A count far beyond the inputs is rejected without allocating.
+        const int raw = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        REQUIRE(connect(raw,
+                        reinterpret_cast<const sockaddr *>(&address),
+                        sizeof(address)) == 0);
+        const uint32_t huge_count = 0xfffffff0;
+        REQUIRE(write(raw, &huge_count, sizeof(huge_count)) == 4);
+        close(raw);
+
+        // Handlers of closed connections are joined on the next accept.
+        for (int i = 0; i < 20; i++)
+        {
+            InferenceClient client(path);
+            REQUIRE(client.predict(inputs[1]).size() == 2);
+        }
+        REQUIRE(unix_server.num_handlers() < 20);
+
+        std::vector<double> stats = unix_client.stats();
+        REQUIRE(stats.size() == 4);
+        REQUIRE(stats[0] == 23.0);
+        REQUIRE(stats[3] >= stats[2]);
+        REQUIRE_THROWS(InferenceClient(path + ".missing"));
+    }
+}
@@ -0,0 +1,152 @@
+#include "loss.h"
+#include "mlp.h"
+#include "sparse.h"
+#include <catch2/catch.hpp>
+
+
+TEST_CASE("Test sparse inputs", "[Sparse]")
+{
+    SparseVector x(6, {1, 4}, {2.0, -0.5});
+    std::vector<double> dense = x.to_dense();
+
+    SECTION("Test sparse vector and matrix")
+    {
+        REQUIRE(x.nnz() == 2);
+        REQUIRE(dense == std::vector<double>{0, 2.0, 0, 0, -0.5, 0});
+        REQUIRE(SparseVector::from_dense(dense).indices() ==
+                std::vector<size_t>{1, 4});
+        REQUIRE_THROWS(SparseVector(6, {4, 1}, {1.0, 1.0}));
+        REQUIRE_THROWS(SparseVector(6, {6}, {1.0}));
+        REQUIRE_THROWS(SparseVector(6, {1}, {1.0, 2.0}));
+
+        SparseMatrix m =
+            SparseMatrix::from_dense({{0, 1.0, 0}, {0, 0, 0}, {3.0, 0, 2.0}});
+        REQUIRE(m.rows() == 3);
+        REQUIRE(m.nnz() == 3);
+        REQUIRE(m.row_offsets() == std::vector<size_t>{0, 1, 1, 3});
+        REQUIRE(m.row(2).to_dense() == std::vector<double>{3.0, 0, 2.0});
+        REQUIRE(m.multiply({1.0, 2.0, 3.0}) ==
+                std::vector<double>{2.0, 0.0, 9.0});
+        REQUIRE_THROWS(SparseMatrix(2, 3, {0, 1}, {0}, {1.0}));
+        REQUIRE_THROWS(SparseMatrix(1, 3, {0, 2}, {2, 1}, {1.0, 1.0}));
+    }
+
+    SECTION("Test sparse dot product")
+    {
+        std::vector<Variable> a(6);
+        for (size_t i = 0; i < 6; ++i)
+        {
+            a[i] = Variable(static_cast<double>(i) + 1.0);
+        }
+        Variable c = dot_product(a, x);
+        REQUIRE(c.value() == Approx(2.0 * 2.0 + 5.0 * -0.5));
+        REQUIRE(c.children().size() == 2);
+        c.set_gradient(1.0);
+        c.backward();
+        REQUIRE(a[1].gradient() == 2.0);
+        REQUIRE(a[4].gradient() == -0.5);
+        REQUIRE(a[0].gradient() == 0.0);
+        REQUIRE_THROWS(dot_product(a, SparseVector(5)));
+    }
+
+    SECTION("Test sparse neuron matches dense neuron")
+    {
+        Neuron neuron(6, "sigmoid");
+        Variable sparse = neuron.forward(x);
+        Variable expected = neuron.forward(dense);
+        REQUIRE(sparse.value() == Approx(expected.value()));
+        REQUIRE(sparse.children().size() == 3);
+
+        sparse.set_gradient(1.0);
+        sparse.backward(true);
+        const double grad = sparse.value() * (1 - sparse.value());
+        REQUIRE(sparse.children()[0].reference() == &neuron.weights()[1]);
+        REQUIRE(neuron.weights()[1].gradient() == Approx(grad * 2.0));
+        REQUIRE(neuron.weights()[4].gradient() == Approx(grad * -0.5));
+        REQUIRE(neuron.weights()[0].gradient() == 0.0);
+        REQUIRE(neuron.bias().gradient() == Approx(grad));
+    }
+
+    SECTION("Test sparse MLP matches dense MLP")
+    {
+        MLP mlp(6, std::vector<size_t>{3, 2});
+        std::vector<double> targets{0.5, -0.5};
+        std::vector<Variable> &expected = mlp.forward(dense);
+        std::vector<double> dense_values{expected[0].value(),
+                                         expected[1].value()};
+        Variable dense_loss = MSELoss(expected, targets);
+        dense_loss.set_gradient(1.0);
+        dense_loss.backward();
+        std::vector<double> dense_gradients;
+        for (const auto &parameter : mlp.parameters())
+        {
+            dense_gradients.push_back(parameter.reference()->gradient());
+            parameter.reference()->zero_grad();
+        }
+
+        std::vector<Variable> &outputs = mlp.forward(x);
+        REQUIRE(outputs[0].value() == Approx(dense_values[0]));
+        REQUIRE(outputs[1].value() == Approx(dense_values[1]));
+        Variable loss = MSELoss(outputs, targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+        for (size_t i = 0; i < dense_gradients.size(); ++i)
+        {
+            REQUIRE(mlp.parameters()[i].reference()->gradient() ==
+                    Approx(dense_gradients[i]));
+        }
+
+        std::vector<double> predictions = mlp.predict(x);
+        REQUIRE(predictions[0] == Approx(dense_values[0]));
+        REQUIRE(predictions[1] == Approx(dense_values[1]));
+
+        SparseMatrix batch = SparseMatrix::from_rows({x, SparseVector(6)});
+        std::vector<std::vector<Variable>> rows = mlp.forward(batch);
+        REQUIRE(rows.size() == 2);
+        REQUIRE(rows[0][1].value() == Approx(dense_values[1]));
+        REQUIRE(rows[1][0].value() ==
+                Approx(mlp.predict(std::vector<double>(6, 0.0))[0]));
+    }
+
+    SECTION("Test gradients of sparse batch rows")
+    {
+        MLP mlp(6, std::vector<size_t>{4, 3, 2});
+        const std::vector<double> targets{0.5, -0.5};
+        const std::vector<SparseVector> samples{
+            x, SparseVector(6, {0, 3, 5}, {1.0, -1.5, 0.5})};
+        std::vector<std::vector<double>> expected;
+        for (const auto &sample : samples)
+        {
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.zero_grad();
+            }
+            Variable loss = MSELoss(mlp.forward(sample.to_dense()), targets);
+            loss.set_gradient(1.0);
+            loss.backward();
+            expected.emplace_back();
+            for (const auto &parameter : mlp.parameters())
+            {
+                expected.back().push_back(parameter.reference()->gradient());
+            }
+        }
+
+        std::vector<std::vector<Variable>> rows =
+            mlp.forward(SparseMatrix::from_rows(samples));
+        for (size_t r = 0; r < rows.size(); r++)
+        {
+            for (auto &parameter : mlp.mutable_parameters())
+            {
+                parameter.zero_grad();
+            }
+            Variable loss = MSELoss(rows[r], targets);
+            loss.set_gradient(1.0);
+            loss.backward();
+            for (size_t i = 0; i < expected[r].size(); i++)
+            {
+                REQUIRE(mlp.parameters()[i].reference()->gradient() ==
+                        Approx(expected[r][i]));
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#include "loss.h"
+#include "static_mlp.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Test static mlp", "[StaticMLP]")
+{
+    SECTION("Test forward")
+    {
+        BasicStaticMLP<IdentityActivation, 2, 1> mlp;
+        auto &layer = mlp.mutable_layer<0>();
+        layer.weights = {2.0, -3.0};
+        layer.bias = {0.5};
+
+        const auto &outputs = mlp.forward({1.0, 2.0});
+        REQUIRE(outputs[0] == Approx(2.0 - 6.0 + 0.5));
+
+        mlp.backward({1.0});
+        REQUIRE(mlp.layer<0>().weight_gradients[0] == Approx(1.0));
+        REQUIRE(mlp.layer<0>().weight_gradients[1] == Approx(2.0));
+        REQUIRE(mlp.layer<0>().bias_gradients[0] == Approx(1.0));
+
+        mlp.gradient_descent(0.1);
+        REQUIRE(mlp.layer<0>().weights[0] == Approx(1.9));
+        REQUIRE(mlp.layer<0>().weights[1] == Approx(-3.2));
+        REQUIRE(mlp.layer<0>().bias[0] == Approx(0.4));
+
+        mlp.zero_grad();
+        REQUIRE(mlp.layer<0>().weight_gradients[0] == 0.0);
+        REQUIRE(mlp.layer<0>().bias_gradients[0] == 0.0);
+    }
+
+    SECTION("Test consistency with MLP")
+    {
+        std::vector<double> inputs{2.0, 3.0, -1.0};
+        std::vector<double> targets{1.0};
+        MLP mlp(3, std::vector<size_t>{4, 4, 1});
+        StaticMLP<3, 4, 4, 1> static_mlp;
+        static_mlp.load(mlp);
+        REQUIRE(static_mlp.num_layers == 3);
+
+        std::vector<Variable> &results = mlp.forward(inputs);
+        const auto &outputs = static_mlp.forward({2.0, 3.0, -1.0});
+        REQUIRE(outputs[0] == Approx(results[0].value()));
+
+        Variable loss = MSELoss(results, targets);
+        loss.set_gradient(1.0);
+        loss.backward();
+        const auto &input_gradients =
+            static_mlp.backward({2.0 * (outputs[0] - targets[0])});
+        REQUIRE(input_gradients.size() == 3);
+
+        const auto &layer = static_mlp.layer<0>();
+        const auto &neurons = mlp.layers()[0].neurons();
+        for (size_t o = 0; o < 4; ++o)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                REQUIRE(layer.weight_gradients[o * 3 + i] ==
+                        Approx(neurons[o].weights()[i].gradient()));
+            }
+            REQUIRE(layer.bias_gradients[o] ==
+                    Approx(neurons[o].bias().gradient()));
+        }
+    }
+
+    SECTION("Test invalid load")
+    {
+        MLP mlp(3, std::vector<size_t>{4, 1});
+        StaticMLP<3, 4, 4, 1> deeper;
+        REQUIRE_THROWS(deeper.load(mlp));
+        StaticMLP<3, 5, 1> wider;
+        REQUIRE_THROWS(wider.load(mlp));
+        BasicStaticMLP<ReluActivation, 3, 4, 1> relu;
+        REQUIRE_THROWS(relu.load(mlp));
+
+        // A mismatch in a later layer leaves the earlier layers unchanged.
+        MLP narrower(3, std::vector<size_t>{4, 2});
+        StaticMLP<3, 4, 1> loaded;
+        const auto weights = loaded.layer<0>().weights;
+        REQUIRE_THROWS(loaded.load(narrower));
+        REQUIRE(loaded.layer<0>().weights == weights);
+    }
+}
@@ -0,0 +1,182 @@
+#include "determinism.h"
+#include "trainer.h"
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <unistd.h>
+
+
+namespace
+{
+// y = 0.5 * x0 - 0.25 * x1 on a grid.
+Dataset linear_dataset(size_t n)
+{
+    Dataset data;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double x0 = std::sin(static_cast<double>(i));
+        const double x1 = std::cos(static_cast<double>(3 * i));
+        data.inputs.push_back({x0, x1});
+        data.targets.push_back({0.5 * x0 - 0.25 * x1});
+    }
+    return data;
+}
+
+
+// The parameters and their gradients after one deterministic step on the
+// given threads.
+std::vector<double> step_parameters(size_t num_threads)
+{
+    set_deterministic(true, 3);
+    MLP mlp(2, std::vector<size_t>{16, 16, 1});
+    TrainerOptions options;
+    options.num_threads = num_threads;
+    Trainer trainer(mlp, options);
+    std::vector<size_t> batch(32);
+    std::iota(batch.begin(), batch.end(), 0);
+    trainer.step(linear_dataset(32), batch);
+
+    std::vector<double> values;
+    for (const auto &parameter : mlp.parameters())
+    {
+        values.push_back(parameter.value());
+        values.push_back(parameter.reference()->gradient());
+    }
+    return values;
+}
+} // namespace
+
+
+TEST_CASE("Test trainer", "[Trainer]")
+{
+    set_seed(11);
+
+    SECTION("Test datasets")
+    {
+        const std::string path =
+            "/tmp/tiny_nn_test_" + std::to_string(getpid()) + ".csv";
+        {
+            std::ofstream file(path);
+            file << "1.0,2.0,0.5\n\n-1, 0.25 ,1e-1\r\n3,4,5\n";
+        }
+        const Dataset data = load_csv(path, 2);
+        REQUIRE(data.size() == 3);
+        REQUIRE(data.inputs[1] == std::vector<double>{-1.0, 0.25});
+        REQUIRE(data.targets[1] == std::vector<double>{0.1});
+        REQUIRE_THROWS_AS(load_csv(path, 3), std::runtime_error);
+        {
+            std::ofstream file(path);
+            file << "1,2,3\n1,x,3\n";
+        }
+        REQUIRE_THROWS_AS(load_csv(path, 2), std::runtime_error);
+        std::remove(path.c_str());
+        REQUIRE_THROWS_AS(load_csv(path, 2), std::runtime_error);
+
+        const auto [train, validation] = split_dataset(data, 0.34);
+        REQUIRE(train.size() == 2);
+        REQUIRE(validation.size() == 1);
+        REQUIRE(validation.inputs[0] == data.inputs[2]);
+        REQUIRE_THROWS(split_dataset(data, 1.0));
+
+        REQUIRE(parse_loss("cross_entropy") == LossKind::CrossEntropy);
+        REQUIRE_THROWS_AS(parse_loss("l1"), std::invalid_argument);
+    }
+
+    SECTION("Test fit")
+    {
+        const auto [train, validation] =
+            split_dataset(linear_dataset(64), 0.25);
+        MLP mlp(2, std::vector<size_t>{8, 1});
+        TrainerOptions options;
+        options.epochs = 30;
+        options.batch_size = 8;
+        options.learning_rate = 0.05;
+        Trainer trainer(mlp, options);
+
+        const double initial_loss = trainer.evaluate(validation);
+        size_t calls = 0;
+        trainer.add_epoch_hook([&calls](const EpochStats &stats) {
+            REQUIRE(stats.epoch == calls);
+            calls++;
+            return true;
+        });
+        const std::vector<EpochStats> history =
+            trainer.fit(train, validation);
+        REQUIRE(history.size() == 30);
+        REQUIRE(calls == 30);
+        REQUIRE(history.back().train_loss < history.front().train_loss);
+        REQUIRE(history.back().validation_loss < initial_loss / 4);
+        REQUIRE(history.back().validation_loss ==
+                Approx(trainer.evaluate(validation)));
+        REQUIRE(history.back().samples_per_second > 0);
+        REQUIRE(history.back().step_p50 <= history.back().step_p99);
+        REQUIRE(history.back().step_p50.count() > 0);
+        REQUIRE(history.back().peak_rss_bytes > 0);
+        REQUIRE(std::isnan(trainer.evaluate(Dataset())));
+    }
+
+    SECTION("Test early stopping")
+    {
+        const Dataset data = linear_dataset(16);
+        MLP mlp(2, std::vector<size_t>{4, 1});
+        TrainerOptions options;
+        options.epochs = 50;
+        options.num_threads = 2;
+        Trainer trainer(mlp, options);
+        trainer.add_epoch_hook(
+            [](const EpochStats &stats) { return stats.epoch < 2; });
+        REQUIRE(trainer.fit(data).size() == 3);
+        REQUIRE(std::isnan(trainer.fit(data).back().validation_loss));
+
+        // Fitting the training set moves away from negated targets, so
+        // training stops after `patience` epochs without improvement.
+        Dataset negated = data;
+        for (auto &target : negated.targets)
+        {
+            target[0] = -target[0];
+        }
+        options.patience = 2;
+        options.learning_rate = 0.05;
+        Trainer patient(mlp, options);
+        REQUIRE(patient.fit(data, negated).size() < 50);
+
+        options.batch_size = 0;
+        REQUIRE_THROWS_AS(Trainer(mlp, options), std::invalid_argument);
+        REQUIRE_THROWS_AS(trainer.fit(Dataset()), std::invalid_argument);
+    }
+
+    SECTION("Test deterministic steps on any number of threads")
+    {
+        const std::vector<double> serial = step_parameters(1);
+        REQUIRE(step_parameters(4) == serial);
+        REQUIRE(step_parameters(3) == serial);
+    }
+
+    SECTION("Test cross entropy")
+    {
+        Dataset data;
+        for (size_t i = 0; i < 32; i++)
+        {
+            const double x = std::sin(static_cast<double>(i));
+            data.inputs.push_back({x});
+            data.targets.push_back({x > 0 ? 1.0 : 0.0});
+        }
+        MLP mlp(1, std::vector<size_t>{4, 2});
+        TrainerOptions options;
+        options.epochs = 20;
+        options.batch_size = 4;
+        options.learning_rate = 0.1;
+        options.loss = LossKind::CrossEntropy;
+        Trainer trainer(mlp, options);
+        const double initial_loss = trainer.evaluate(data);
+        trainer.fit(data);
+        REQUIRE(trainer.evaluate(data) < initial_loss);
+
+        data.targets[0] = {2.0};
+        REQUIRE_THROWS_AS(trainer.fit(data), std::invalid_argument);
+    }
+
+    set_deterministic(false);
+}
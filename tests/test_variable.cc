@@ -74,3 +74,66 @@ TEST_CASE("Test variable basic", "[Variable]")
         REQUIRE(a.value() == Approx(0.9));
     }
 }
+
+
+TEST_CASE("Test compact nodes", "[Variable]")
+{
+    REQUIRE(sizeof(Variable) <= 96);
+
+    SECTION("Test interned operations and names")
+    {
+        Variable a(1.0, 0.0, "", "a");
+        Variable b(2.0, 0.0, "", "b");
+        Variable c = a + b;
+        Variable d = b + a;
+        REQUIRE(c.op() == "+");
+        REQUIRE(&c.op() == &d.op());
+        Variable e(3.0, 0.0, "", "a");
+        REQUIRE(&e.name() == &a.name());
+        e.set_name("");
+        REQUIRE(e.name() == "");
+
+        // Other names are owned by the node and its copies, not interned.
+        Variable f(3.0, 0.0, "", std::string("a"));
+        REQUIRE(f.name() == "a");
+        REQUIRE(&f.name() != &a.name());
+        Variable g = f;
+        REQUIRE(&g.name() == &f.name());
+        f.set_name(std::string("f"));
+        REQUIRE(f.name() == "f");
+        REQUIRE(g.name() == "a");
+        Variable h(std::move(g));
+        REQUIRE(h.name() == "a");
+    }
+
+    SECTION("Test growing children keeps references")
+    {
+        Variable a(1.0, 0.0, "", "a");
+        Variable::Children children;
+        children.push_back(a);
+        for (size_t i = 0; i < 100; i++)
+        {
+            children.push_back(children.back());
+        }
+        REQUIRE(children.size() == 101);
+        REQUIRE(children.capacity() >= 101);
+        for (const auto &child : children)
+        {
+            REQUIRE(child.reference() == &a);
+        }
+
+        children.resize(2);
+        children.resize(3);
+        REQUIRE(children.size() == 3);
+        REQUIRE(children[2].reference() == &children[2]);
+        children.reserve(1024);
+        REQUIRE(children[2].reference() == &children[2]);
+        REQUIRE(children[0].reference() == &a);
+
+        Variable::Children copy(children.begin(), children.begin() + 1);
+        REQUIRE(copy.size() == 1);
+        REQUIRE(copy[0].reference() == &a);
+        children.clear();
+        REQUIRE(children.empty());
+    }
+}
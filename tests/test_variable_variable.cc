@@ -103,7 +103,7 @@ TEST_CASE("Test variable-variable operations", "[Variable-Variable]")
             REQUIRE(c.children()[i + 3].reference() == &b_vec[i]);
         }
         c.set_gradient(1.0);
-        c.backward();
+        c.backward(true);
         REQUIRE(c.gradient() == 1.0);
         for (size_t i = 0; i < 3; ++i)
         {